@@ -0,0 +1,295 @@
+/*
+ * Evolution.cc
+ *
+ * End-to-end benchmarks that run whole evolutions on the reference tasks of
+ * Tasks.hh and write one CSV row per run: generations and evaluations per
+ * second, the time spent in Population::Epoch(), peak resident memory and
+ * the time to the first solution. Runs use fixed seeds, so rows of the same
+ * task, population size and seed can be compared across commits.
+ *
+ *   MultiNEAT_evolution [--tasks=xor,pole,retina,maze]
+ *                       [--populations=150,1000] [--seeds=1]
+ *                       [--generations=N] [--run-all] [--csv=FILE]
+ *
+ * A run stops at the first solution unless --run-all is given, or after
+ * --generations, which defaults to a limit of each task. Rows are appended
+ * to FILE, or written to the standard output. Populations of 10000 can be
+ * asked for with --populations, but Species::Reproduce() copies and sorts
+ * the species for every parent it picks, so their runs take hours.
+ */
+
+#include "Tasks.hh"
+
+#include <MultiNEAT/Population.hh>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace NEAT;
+
+static const char *g_header =
+    "task,population,seed,generations,evaluations,seconds,epoch_seconds,"
+    "generations_per_second,evaluations_per_second,peak_rss_kb,solved,"
+    "solution_generation,time_to_solution\n";
+
+// The parameters all tasks start from
+static Parameters CommonParameters(unsigned int a_Population) {
+  Parameters t_params;
+  t_params.PopulationSize = a_Population;
+  t_params.DynamicCompatibility = true;
+  t_params.CompatThreshold = 2.0;
+  t_params.YoungAgeThreshold = 15;
+  t_params.SpeciesMaxStagnation = 15;
+  t_params.OldAgeThreshold = 35;
+  t_params.MinSpecies = 5;
+  t_params.MaxSpecies = 25;
+  t_params.RouletteWheelSelection = false;
+  t_params.RecurrentProb = 0.0;
+  t_params.OverallMutationRate = 0.8;
+
+  t_params.MutateWeightsProb = 0.90;
+  t_params.WeightMutationMaxPower = 2.5;
+  t_params.WeightReplacementMaxPower = 5.0;
+  t_params.MutateWeightsSevereProb = 0.5;
+  t_params.WeightMutationRate = 0.25;
+  t_params.MaxWeight = 8;
+
+  t_params.MutateAddNeuronProb = 0.03;
+  t_params.MutateAddLinkProb = 0.05;
+  t_params.MutateRemLinkProb = 0.0;
+
+  t_params.MinActivationA = 4.9;
+  t_params.MaxActivationA = 4.9;
+
+  t_params.CrossoverRate = 0.75;
+  t_params.MultipointCrossoverRate = 0.4;
+  t_params.SurvivalRate = 0.2;
+  return t_params;
+}
+
+// Peak resident memory of the process in kilobytes, 0 if unknown
+static long PeakRSS() {
+#ifndef _WIN32
+  struct rusage t_usage;
+  if (getrusage(RUSAGE_SELF, &t_usage) == 0) {
+#ifdef __APPLE__
+    return t_usage.ru_maxrss / 1024;
+#else
+    return t_usage.ru_maxrss;
+#endif
+  }
+#endif
+  return 0;
+}
+
+static double Now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Evolves a_Task and appends its row to a_Out
+static void Run(Task &a_Task, unsigned int a_Population, unsigned int a_Seed,
+                unsigned int a_Generations, bool a_RunAll, FILE *a_Out) {
+  Parameters t_params = CommonParameters(a_Population);
+  a_Task.Configure(t_params);
+  Population t_pop(a_Task.Start(t_params), t_params, true, 1.0, a_Seed);
+
+  unsigned long long t_evaluations = 0;
+  double t_epoch_seconds = 0;
+  int t_solution = -1;
+  double t_time_to_solution = 0;
+
+  double t_start = Now();
+  unsigned int t_generation = 0;
+  std::vector<Genome *> t_genomes;
+  while (t_generation < a_Generations) {
+    t_genomes.clear();
+    for (unsigned int i = 0; i < t_pop.m_Species.size(); i++) {
+      for (unsigned int j = 0; j < t_pop.m_Species[i].m_Individuals.size();
+           j++) {
+        t_genomes.push_back(&t_pop.m_Species[i].m_Individuals[j]);
+      }
+    }
+
+    bool t_solved = a_Task.Evaluate(t_genomes);
+    t_evaluations += t_genomes.size();
+    t_generation++;
+
+    if (t_solved && (t_solution < 0)) {
+      t_solution = t_generation;
+      t_time_to_solution = Now() - t_start;
+    }
+    if (t_solved && !a_RunAll) {
+      break;
+    }
+
+    if (t_generation < a_Generations) {
+      t_pop.Epoch();
+      t_epoch_seconds += t_pop.GetStats().m_EpochTime;
+    }
+  }
+  double t_seconds = Now() - t_start;
+
+  fprintf(a_Out, "%s,%u,%u,%u,%llu,%.6f,%.6f,%.6f,%.3f,%ld,%d,", a_Task.Name(),
+          a_Population, a_Seed, t_generation, t_evaluations, t_seconds,
+          t_epoch_seconds, t_generation / t_seconds,
+          t_evaluations / t_seconds, PeakRSS(), (t_solution >= 0) ? 1 : 0);
+  if (t_solution >= 0) {
+    fprintf(a_Out, "%d,%.6f\n", t_solution, t_time_to_solution);
+  } else {
+    fprintf(a_Out, ",\n");
+  }
+  fflush(a_Out);
+}
+
+// Runs in a process of its own where possible, so that the peak memory is
+// that of the run alone
+static bool RunIsolated(const std::string &a_Task, unsigned int a_Population,
+                        unsigned int a_Seed, unsigned int a_Generations,
+                        bool a_RunAll, FILE *a_Out) {
+  fflush(a_Out);
+#ifndef _WIN32
+  pid_t t_pid = fork();
+  if (t_pid == 0) {
+    std::unique_ptr<Task> t_task = MakeTask(a_Task);
+    unsigned int t_generations =
+        a_Generations ? a_Generations : t_task->MaxGenerations();
+    Run(*t_task, a_Population, a_Seed, t_generations, a_RunAll, a_Out);
+    _exit(0);
+  }
+  int t_status = 0;
+  if ((t_pid < 0) || (waitpid(t_pid, &t_status, 0) != t_pid)) {
+    return false;
+  }
+  return WIFEXITED(t_status) && (WEXITSTATUS(t_status) == 0);
+#else
+  std::unique_ptr<Task> t_task = MakeTask(a_Task);
+  unsigned int t_generations =
+      a_Generations ? a_Generations : t_task->MaxGenerations();
+  Run(*t_task, a_Population, a_Seed, t_generations, a_RunAll, a_Out);
+  return true;
+#endif
+}
+
+// Splits a comma separated list
+static std::vector<std::string> Split(const char *a_List) {
+  std::vector<std::string> t_items;
+  std::string t_item;
+  for (const char *t_c = a_List;; t_c++) {
+    if ((*t_c == ',') || (*t_c == 0)) {
+      if (!t_item.empty()) {
+        t_items.push_back(t_item);
+      }
+      t_item.clear();
+      if (*t_c == 0) {
+        break;
+      }
+    } else {
+      t_item += *t_c;
+    }
+  }
+  return t_items;
+}
+
+static std::vector<unsigned int> SplitNumbers(const char *a_List) {
+  std::vector<std::string> t_items = Split(a_List);
+  std::vector<unsigned int> t_numbers;
+  for (unsigned int i = 0; i < t_items.size(); i++) {
+    t_numbers.push_back(strtoul(t_items[i].c_str(), NULL, 10));
+  }
+  return t_numbers;
+}
+
+// the value of a "--name=value" argument, NULL if a_Arg is not one
+static const char *Option(const char *a_Arg, const char *a_Name) {
+  size_t t_len = strlen(a_Name);
+  if ((strncmp(a_Arg, a_Name, t_len) == 0) && (a_Arg[t_len] == '=')) {
+    return a_Arg + t_len + 1;
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> t_tasks = TaskNames();
+  std::vector<unsigned int> t_populations = {150, 1000};
+  std::vector<unsigned int> t_seeds = {1};
+  unsigned int t_generations = 0;
+  bool t_run_all = false;
+  const char *t_csv = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    const char *t_value;
+    if ((t_value = Option(argv[i], "--tasks"))) {
+      t_tasks = Split(t_value);
+    } else if ((t_value = Option(argv[i], "--populations"))) {
+      t_populations = SplitNumbers(t_value);
+    } else if ((t_value = Option(argv[i], "--seeds"))) {
+      t_seeds = SplitNumbers(t_value);
+    } else if ((t_value = Option(argv[i], "--generations"))) {
+      t_generations = strtoul(t_value, NULL, 10);
+    } else if ((t_value = Option(argv[i], "--csv"))) {
+      t_csv = t_value;
+    } else if (strcmp(argv[i], "--run-all") == 0) {
+      t_run_all = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--tasks=xor,pole,retina,maze] "
+              "[--populations=150,1000] [--seeds=1] [--generations=N] "
+              "[--run-all] [--csv=FILE]\n",
+              argv[0]);
+      return (strcmp(argv[i], "--help") == 0) ? 0 : 1;
+    }
+  }
+
+  for (unsigned int i = 0; i < t_tasks.size(); i++) {
+    if (!MakeTask(t_tasks[i])) {
+      fprintf(stderr, "unknown task %s\n", t_tasks[i].c_str());
+      return 1;
+    }
+  }
+
+  FILE *t_out = stdout;
+  if (t_csv) {
+    t_out = fopen(t_csv, "a");
+    if (!t_out) {
+      fprintf(stderr, "cannot open %s\n", t_csv);
+      return 1;
+    }
+  }
+  // a header only at the start of a file
+  fseek(t_out, 0, SEEK_END);
+  if (ftell(t_out) <= 0) {
+    fputs(g_header, t_out);
+  }
+
+  int t_result = 0;
+  for (unsigned int t = 0; t < t_tasks.size(); t++) {
+    for (unsigned int p = 0; p < t_populations.size(); p++) {
+      for (unsigned int s = 0; s < t_seeds.size(); s++) {
+        fprintf(stderr, "%s, population %u, seed %u\n", t_tasks[t].c_str(),
+                t_populations[p], t_seeds[s]);
+        if (!RunIsolated(t_tasks[t], t_populations[p], t_seeds[s],
+                         t_generations, t_run_all, t_out)) {
+          fprintf(stderr, "  run failed\n");
+          t_result = 1;
+        }
+      }
+    }
+  }
+
+  if (t_out != stdout) {
+    fclose(t_out);
+  }
+  return t_result;
+}
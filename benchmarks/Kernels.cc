@@ -0,0 +1,501 @@
+/*
+ * Kernels.cc
+ *
+ * Micro-benchmarks of the core kernels: activation, phenotype building,
+ * compatibility, mating, mutation, innovation lookups, the HyperNEAT
+ * builders and loading population text files. The argument of most
+ * benchmarks is the number of rounds the synthetic genome was grown through,
+ * see Synthetic.hh.
+ */
+
+#include "Synthetic.hh"
+
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/TextIO.hh>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace NEAT;
+
+static const unsigned int g_inputs = 8; // the bias included
+static const unsigned int g_outputs = 4;
+
+// A grown genome with g_inputs inputs and g_outputs outputs
+static Genome KernelGenome(unsigned int a_Steps, unsigned int a_Seed,
+                           InnovationDatabase &a_Innovs, Parameters &a_Params) {
+  Genome t_base = SyntheticBase(g_inputs, g_outputs, a_Params);
+  a_Innovs.Init(t_base);
+  return SyntheticGenome(t_base, a_Steps, a_Seed, a_Innovs, a_Params);
+}
+
+static void SetSizeCounters(benchmark::State &a_State,
+                            const NeuralNetwork &a_Net) {
+  a_State.counters["neurons"] = a_Net.m_neurons.size();
+  a_State.counters["links"] = a_Net.m_connections.size();
+}
+
+/////////////////////
+// Activation
+/////////////////////
+
+template <typename Activation>
+static void RunActivation(benchmark::State &a_State, Activation a_Activate) {
+  Parameters t_params = SyntheticParameters();
+  InnovationDatabase t_innovs;
+  Genome t_genome = KernelGenome(a_State.range(0), 1, t_innovs, t_params);
+  NeuralNetwork t_net;
+  t_genome.BuildLeanPhenotype(t_net);
+
+  RNG t_rng;
+  t_rng.Seed(2);
+  std::vector<double> t_inputs(g_inputs);
+  for (unsigned int i = 0; i < t_inputs.size(); i++) {
+    t_inputs[i] = t_rng.RandFloatSigned();
+  }
+
+  for (auto _ : a_State) {
+    t_net.Input(t_inputs);
+    a_Activate(t_net);
+    benchmark::DoNotOptimize(t_net.m_neurons.data());
+  }
+
+  SetSizeCounters(a_State, t_net);
+  a_State.SetItemsProcessed(a_State.iterations() * t_net.m_connections.size());
+}
+
+static void BM_Activate(benchmark::State &state) {
+  RunActivation(state, [](NeuralNetwork &a_Net) { a_Net.Activate(); });
+}
+BENCHMARK(BM_Activate)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_ActivateFast(benchmark::State &state) {
+  RunActivation(state, [](NeuralNetwork &a_Net) { a_Net.ActivateFast(); });
+}
+BENCHMARK(BM_ActivateFast)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_ActivateLeaky(benchmark::State &state) {
+  RunActivation(state, [](NeuralNetwork &a_Net) { a_Net.ActivateLeaky(0.01); });
+}
+BENCHMARK(BM_ActivateLeaky)->Arg(8)->Arg(64)->Arg(512);
+
+/////////////////////
+// Phenotypes
+/////////////////////
+
+static void BM_BuildPhenotype(benchmark::State &state) {
+  Parameters t_params = SyntheticParameters();
+  InnovationDatabase t_innovs;
+  Genome t_genome = KernelGenome(state.range(0), 1, t_innovs, t_params);
+  NeuralNetwork t_net;
+
+  for (auto _ : state) {
+    t_genome.BuildLeanPhenotype(t_net);
+    benchmark::DoNotOptimize(t_net.m_connections.data());
+  }
+
+  SetSizeCounters(state, t_net);
+}
+BENCHMARK(BM_BuildPhenotype)->Arg(8)->Arg(64)->Arg(512);
+
+// The argument is the number of inputs, hidden and outputs of the substrate
+static void BM_BuildHyperNEATPhenotype(benchmark::State &state) {
+  unsigned int t_side = state.range(0);
+  Substrate t_subst = SyntheticSubstrate(t_side, t_side, t_side);
+  Parameters t_params = SyntheticParameters();
+  Genome t_base =
+      SyntheticBase(t_subst.GetMinCPPNInputs(), t_subst.GetMinCPPNOutputs(),
+                    t_params, SIGNED_SIGMOID);
+  InnovationDatabase t_innovs;
+  t_innovs.Init(t_base);
+  Genome t_cppn = SyntheticGenome(t_base, 16, 1, t_innovs, t_params);
+
+  // the builders add to the network they are given
+  for (auto _ : state) {
+    NeuralNetwork t_net;
+    t_cppn.BuildHyperNEATPhenotype(t_net, t_subst);
+    benchmark::DoNotOptimize(t_net.m_connections.data());
+  }
+
+  NeuralNetwork t_net;
+  t_cppn.BuildHyperNEATPhenotype(t_net, t_subst);
+  SetSizeCounters(state, t_net);
+}
+BENCHMARK(BM_BuildHyperNEATPhenotype)->Arg(8)->Arg(32)->Arg(64);
+
+// The argument is the number of inputs and outputs of the substrate
+static void BM_BuildESHyperNEATPhenotype(benchmark::State &state) {
+  unsigned int t_side = state.range(0);
+  Substrate t_subst = SyntheticSubstrate(t_side, 0, t_side);
+  Parameters t_params = SyntheticParameters();
+  // explores deep enough to find hidden nodes in the synthetic CPPN
+  t_params.InitialDepth = 2;
+  t_params.MaxDepth = 4;
+  t_params.IterationLevel = 2;
+  Genome t_base =
+      SyntheticBase(t_subst.GetMinCPPNInputs(), t_subst.GetMinCPPNOutputs(),
+                    t_params, SIGNED_SIGMOID);
+  InnovationDatabase t_innovs;
+  t_innovs.Init(t_base);
+  // a CPPN that the exploration finds a few hundred links in
+  Genome t_cppn = SyntheticGenome(t_base, 40, 6, t_innovs, t_params);
+
+  for (auto _ : state) {
+    NeuralNetwork t_net;
+    t_cppn.BuildESHyperNEATPhenotype(t_net, t_subst, t_params);
+    benchmark::DoNotOptimize(t_net.m_connections.data());
+  }
+
+  NeuralNetwork t_net;
+  t_cppn.BuildESHyperNEATPhenotype(t_net, t_subst, t_params);
+  SetSizeCounters(state, t_net);
+}
+BENCHMARK(BM_BuildESHyperNEATPhenotype)->Arg(4)->Arg(16);
+
+/////////////////////
+// Genomes
+/////////////////////
+
+static void BM_CompatibilityDistance(benchmark::State &state) {
+  Parameters t_params = SyntheticParameters();
+  Genome t_base = SyntheticBase(g_inputs, g_outputs, t_params);
+  InnovationDatabase t_innovs;
+  t_innovs.Init(t_base);
+  Genome t_a = SyntheticGenome(t_base, state.range(0), 1, t_innovs, t_params);
+  Genome t_b = SyntheticGenome(t_base, state.range(0), 2, t_innovs, t_params);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(t_a.CompatibilityDistance(t_b, t_params));
+  }
+}
+BENCHMARK(BM_CompatibilityDistance)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_Mate(benchmark::State &state) {
+  Parameters t_params = SyntheticParameters();
+  Genome t_base = SyntheticBase(g_inputs, g_outputs, t_params);
+  InnovationDatabase t_innovs;
+  t_innovs.Init(t_base);
+  Genome t_mom = SyntheticGenome(t_base, state.range(0), 1, t_innovs, t_params);
+  Genome t_dad = SyntheticGenome(t_base, state.range(0), 2, t_innovs, t_params);
+  t_mom.SetFitness(1.0);
+  t_dad.SetFitness(0.5);
+  RNG t_rng;
+  t_rng.Seed(3);
+
+  for (auto _ : state) {
+    Genome t_baby = t_mom.Mate(t_dad, false, false, t_rng, t_params);
+    benchmark::DoNotOptimize(t_baby.NumLinks());
+  }
+}
+BENCHMARK(BM_Mate)->Arg(8)->Arg(64)->Arg(512);
+
+/////////////////////
+// Mutations
+/////////////////////
+
+typedef bool (*Mutation)(Genome &, InnovationDatabase &, Parameters &, RNG &);
+
+// Mutations that change the structure run on a fresh copy of the genome and
+// the innovations each time, the others keep mutating the same genome. The
+// copies are made a batch at a time with the timer paused, pausing it for
+// every mutation would cost more than the faster mutations take.
+static void BM_Mutate(benchmark::State &state, Mutation a_Mutate,
+                      bool a_Structural) {
+  Parameters t_params = SyntheticParameters();
+  InnovationDatabase t_innovs;
+  Genome t_genome = KernelGenome(state.range(0), 1, t_innovs, t_params);
+  RNG t_rng;
+  t_rng.Seed(4);
+
+  if (!a_Structural) {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(a_Mutate(t_genome, t_innovs, t_params, t_rng));
+    }
+    return;
+  }
+
+  const unsigned int t_batch = 64;
+  std::vector<Genome> t_copies;
+  std::vector<InnovationDatabase> t_innovs_copies;
+  unsigned int t_next = t_batch;
+  for (auto _ : state) {
+    if (t_next == t_batch) {
+      state.PauseTiming();
+      t_copies.assign(t_batch, t_genome);
+      t_innovs_copies.assign(t_batch, t_innovs);
+      t_next = 0;
+      state.ResumeTiming();
+    }
+
+    benchmark::DoNotOptimize(
+        a_Mutate(t_copies[t_next], t_innovs_copies[t_next], t_params, t_rng));
+    t_next++;
+  }
+}
+
+static bool AddNeuron(Genome &a_G, InnovationDatabase &a_I, Parameters &a_P,
+                      RNG &a_R) {
+  return a_G.Mutate_AddNeuron(a_I, a_P, a_R);
+}
+static bool AddLink(Genome &a_G, InnovationDatabase &a_I, Parameters &a_P,
+                    RNG &a_R) {
+  return a_G.Mutate_AddLink(a_I, a_P, a_R);
+}
+static bool RemoveLink(Genome &a_G, InnovationDatabase &, Parameters &,
+                       RNG &a_R) {
+  return a_G.Mutate_RemoveLink(a_R);
+}
+static bool RemoveSimpleNeuron(Genome &a_G, InnovationDatabase &a_I,
+                               Parameters &, RNG &a_R) {
+  return a_G.Mutate_RemoveSimpleNeuron(a_I, a_R);
+}
+static bool LinkWeights(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                        RNG &a_R) {
+  return a_G.Mutate_LinkWeights(a_P, a_R);
+}
+static bool ActivationsA(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                         RNG &a_R) {
+  return a_G.Mutate_NeuronActivations_A(a_P, a_R);
+}
+static bool ActivationsB(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                         RNG &a_R) {
+  return a_G.Mutate_NeuronActivations_B(a_P, a_R);
+}
+static bool ActivationType(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                           RNG &a_R) {
+  return a_G.Mutate_NeuronActivation_Type(a_P, a_R);
+}
+static bool TimeConstants(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                          RNG &a_R) {
+  return a_G.Mutate_NeuronTimeConstants(a_P, a_R);
+}
+static bool Biases(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                   RNG &a_R) {
+  return a_G.Mutate_NeuronBiases(a_P, a_R);
+}
+static bool NeuronTraits(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                         RNG &a_R) {
+  return a_G.Mutate_NeuronTraits(a_P, a_R);
+}
+static bool LinkTraits(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                       RNG &a_R) {
+  return a_G.Mutate_LinkTraits(a_P, a_R);
+}
+static bool GenomeTraits(Genome &a_G, InnovationDatabase &, Parameters &a_P,
+                         RNG &a_R) {
+  return a_G.Mutate_GenomeTraits(a_P, a_R);
+}
+
+BENCHMARK_CAPTURE(BM_Mutate, AddNeuron, AddNeuron, true)->Arg(8)->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, AddLink, AddLink, true)->Arg(8)->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, RemoveLink, RemoveLink, true)->Arg(8)->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, RemoveSimpleNeuron, RemoveSimpleNeuron, true)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, LinkWeights, LinkWeights, false)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, ActivationsA, ActivationsA, false)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, ActivationsB, ActivationsB, false)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, ActivationType, ActivationType, false)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, TimeConstants, TimeConstants, false)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, Biases, Biases, false)->Arg(8)->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, NeuronTraits, NeuronTraits, false)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, LinkTraits, LinkTraits, false)
+    ->Arg(8)
+    ->Arg(512);
+BENCHMARK_CAPTURE(BM_Mutate, GenomeTraits, GenomeTraits, false)
+    ->Arg(8)
+    ->Arg(512);
+
+/////////////////////
+// Innovations
+/////////////////////
+
+// Looks up the links and the split links of a grown genome in the database
+// that grew it
+static void BM_InnovationLookup(benchmark::State &state) {
+  Parameters t_params = SyntheticParameters();
+  InnovationDatabase t_innovs;
+  Genome t_genome = KernelGenome(state.range(0), 1, t_innovs, t_params);
+
+  std::vector<std::pair<int, int>> t_links;
+  for (unsigned int i = 0; i < t_genome.NumLinks(); i++) {
+    t_links.push_back(std::make_pair(t_genome.m_LinkGenes[i].FromNeuronID(),
+                                     t_genome.m_LinkGenes[i].ToNeuronID()));
+  }
+
+  unsigned int t_next = 0;
+  for (auto _ : state) {
+    const std::pair<int, int> &t_link = t_links[t_next];
+    benchmark::DoNotOptimize(
+        t_innovs.CheckInnovation(t_link.first, t_link.second, NEW_LINK));
+    benchmark::DoNotOptimize(
+        t_innovs.CheckInnovation(t_link.first, t_link.second, NEW_NEURON));
+    t_next = (t_next + 1) % t_links.size();
+  }
+
+  state.counters["links"] = t_links.size();
+}
+BENCHMARK(BM_InnovationLookup)->Arg(8)->Arg(64)->Arg(512);
+
+/////////////////////
+// Text files
+/////////////////////
+
+static const char *g_population_file = "Kernels.population.txt";
+
+// Writes a population text file of a_Size synthetic genomes grown through
+// a_Steps rounds, laid out as Population::Save() lays it out. The genomes
+// carry no traits, the old loader below did not read them.
+static void WritePopulationText(const char *a_FileName, unsigned int a_Size,
+                                unsigned int a_Steps) {
+  Parameters t_params = SyntheticParameters();
+  t_params.PopulationSize = a_Size;
+  t_params.NeuronTraits.clear();
+  t_params.LinkTraits.clear();
+  t_params.GenomeTraits.clear();
+  InnovationDatabase t_innovs;
+  Genome t_base = SyntheticBase(g_inputs, g_outputs, t_params);
+  t_innovs.Init(t_base);
+  std::vector<Genome> t_genomes;
+  for (unsigned int i = 0; i < a_Size; i++) {
+    t_genomes.push_back(
+        SyntheticGenome(t_base, a_Steps, i + 1, t_innovs, t_params));
+  }
+
+  FILE *t_file = fopen(a_FileName, "w");
+  t_params.Save(t_file);
+  t_innovs.Save(t_file);
+  for (unsigned int i = 0; i < t_genomes.size(); i++) {
+    t_genomes[i].Save(t_file);
+  }
+  fclose(t_file);
+}
+
+// Reads a population text file the way Population(const char *) did before
+// TextReader: every token goes through operator>> of an ifstream, as the
+// old Parameters::Load(), InnovationDatabase::Init() and
+// Genome(std::ifstream &) read them. Of the parameters only PopulationSize
+// is kept, the others are read and dropped.
+static void StreamLoad(const char *a_FileName,
+                       std::vector<Innovation> &a_Innovations,
+                       std::vector<Genome> &a_Genomes) {
+  std::ifstream t_file(a_FileName);
+  std::string t_str;
+
+  unsigned int t_size = 0;
+  do {
+    t_file >> t_str;
+  } while (t_str != "NEAT_ParametersStart");
+  while (t_str != "NEAT_ParametersEnd") {
+    t_file >> t_str;
+    if (t_str == "PopulationSize") {
+      t_file >> t_size;
+    }
+  }
+
+  do {
+    t_file >> t_str;
+  } while (t_str != "InnovationDatabaseStart");
+  int t_next_innovation, t_next_neuron;
+  t_file >> t_str >> t_next_innovation >> t_str >> t_next_neuron;
+  do {
+    t_file >> t_str;
+    if (t_str == "Innovation") {
+      int t_id, t_from, t_to, t_innovtype, t_neurontype, t_nid;
+      t_file >> t_id >> t_innovtype >> t_from >> t_to >> t_neurontype >>
+          t_nid;
+      a_Innovations.push_back(
+          Innovation(t_id, static_cast<InnovationType>(t_innovtype), t_from,
+                     t_to, static_cast<NeuronType>(t_neurontype), t_nid));
+    }
+  } while (t_str != "InnovationDatabaseEnd");
+
+  for (unsigned int i = 0; i < t_size; i++) {
+    do {
+      t_file >> t_str;
+    } while (t_str != "GenomeStart");
+    Genome t_genome;
+    unsigned int t_id;
+    t_file >> t_id;
+    t_genome.SetID(t_id);
+    do {
+      t_file >> t_str;
+      if (t_str == "Neuron") {
+        int t_nid, t_type, t_func;
+        double t_splity, t_a, t_b, t_timeconst, t_bias;
+        t_file >> t_nid >> t_type >> t_splity >> t_func >> t_a >> t_b >>
+            t_timeconst >> t_bias;
+        NeuronGene t_neuron(static_cast<NeuronType>(t_type), t_nid, t_splity);
+        t_neuron.Init(t_a, t_b, t_timeconst, t_bias,
+                      static_cast<ActivationFunction>(t_func));
+        t_genome.m_NeuronGenes.push_back(t_neuron);
+      }
+      if (t_str == "Link") {
+        int t_from, t_to, t_innov, t_isrecur;
+        double t_weight;
+        t_file >> t_from >> t_to >> t_innov >> t_isrecur >> t_weight;
+        t_genome.m_LinkGenes.push_back(LinkGene(
+            t_from, t_to, t_innov, t_weight, static_cast<bool>(t_isrecur)));
+      }
+    } while (t_str != "GenomeEnd");
+    a_Genomes.push_back(t_genome);
+  }
+}
+
+// Reads a population text file the way Population(const char *) does
+static void BufferedLoad(const char *a_FileName, InnovationDatabase &a_Innovs,
+                         std::vector<Genome> &a_Genomes) {
+  TextReader t_reader;
+  t_reader.Open(a_FileName);
+  Parameters t_params;
+  t_params.Load(t_reader);
+  a_Innovs.Init(t_reader);
+  a_Genomes.reserve(t_params.PopulationSize);
+  for (unsigned int i = 0; i < t_params.PopulationSize; i++) {
+    a_Genomes.emplace_back(t_reader);
+  }
+}
+
+// The argument is the number of genomes in the file
+static void BM_LoadPopulationStream(benchmark::State &state) {
+  WritePopulationText(g_population_file, state.range(0), 8);
+  for (auto _ : state) {
+    std::vector<Innovation> t_innovations;
+    std::vector<Genome> t_genomes;
+    StreamLoad(g_population_file, t_innovations, t_genomes);
+    benchmark::DoNotOptimize(t_genomes.data());
+  }
+  std::remove(g_population_file);
+}
+BENCHMARK(BM_LoadPopulationStream)->Arg(500)->Arg(5000);
+
+static void BM_LoadPopulationBuffered(benchmark::State &state) {
+  WritePopulationText(g_population_file, state.range(0), 8);
+  for (auto _ : state) {
+    InnovationDatabase t_innovs;
+    std::vector<Genome> t_genomes;
+    BufferedLoad(g_population_file, t_innovs, t_genomes);
+    benchmark::DoNotOptimize(t_genomes.data());
+  }
+  std::remove(g_population_file);
+}
+BENCHMARK(BM_LoadPopulationBuffered)->Arg(500)->Arg(5000);
+
+BENCHMARK_MAIN();
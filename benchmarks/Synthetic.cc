@@ -0,0 +1,125 @@
+/*
+ * Synthetic.cc
+ *
+ * Seeded generators of genomes and substrates for the benchmarks.
+ */
+
+#include "Synthetic.hh"
+
+#include <utility>
+#include <vector>
+
+using namespace NEAT;
+
+// A float trait drawn from [a_Min, a_Max], mutated half the time
+static TraitParameters FloatTrait(double a_Min, double a_Max) {
+  TraitParameters t_trait;
+  t_trait.type = "float";
+  t_trait.m_ImportanceCoeff = 0.2;
+  t_trait.m_MutationProb = 0.5;
+  FloatTraitParameters t_details;
+  t_details.min = a_Min;
+  t_details.max = a_Max;
+  t_details.mut_power = 0.1 * (a_Max - a_Min);
+  t_details.mut_replace_prob = 0.1;
+  t_trait.m_Details = t_details;
+  return t_trait;
+}
+
+Parameters SyntheticParameters() {
+  Parameters t_params;
+  // ActivateLeaky() divides by the time constants
+  t_params.MinNeuronTimeConstant = 0.05;
+  t_params.MaxNeuronTimeConstant = 0.5;
+
+  // traits of every kind of gene, so that mutating and comparing them does
+  // some work. The link traits are the Hebbian rates the phenotype reads.
+  TraitParameters t_level;
+  t_level.type = "int";
+  t_level.m_ImportanceCoeff = 0.2;
+  t_level.m_MutationProb = 0.5;
+  IntTraitParameters t_level_details;
+  t_level_details.min = -5;
+  t_level_details.max = 5;
+  t_level_details.mut_power = 1;
+  t_level_details.mut_replace_prob = 0.1;
+  t_level.m_Details = t_level_details;
+  t_params.NeuronTraits["level"] = t_level;
+  t_params.NeuronTraits["gain"] = FloatTrait(0.5, 2.0);
+
+  t_params.LinkTraits["hebb_rate"] = FloatTrait(0.0, 0.5);
+  t_params.LinkTraits["hebb_pre_rate"] = FloatTrait(0.0, 0.2);
+
+  TraitParameters t_size;
+  t_size.type = "intset";
+  t_size.m_ImportanceCoeff = 0.2;
+  t_size.m_MutationProb = 0.5;
+  IntSetTraitParameters t_size_details;
+  t_size_details.set = {{1}, {2}, {4}, {8}};
+  t_size_details.probs = {1, 1, 1, 1};
+  t_size.m_Details = t_size_details;
+  t_params.GenomeTraits["size"] = t_size;
+  t_params.GenomeTraits["rate"] = FloatTrait(0.0, 1.0);
+
+  return t_params;
+}
+
+Genome SyntheticBase(unsigned int a_Inputs, unsigned int a_Outputs,
+                     const Parameters &a_Params,
+                     ActivationFunction a_Activation) {
+  return Genome(0, a_Inputs, 0, a_Outputs, false, a_Activation, a_Activation,
+                0, a_Params, 0);
+}
+
+Genome SyntheticGenome(const Genome &a_Base, unsigned int a_Steps,
+                       unsigned int a_Seed, InnovationDatabase &a_Innovs,
+                       const Parameters &a_Params) {
+  Genome t_genome = a_Base;
+  RNG t_rng;
+  t_rng.Seed(a_Seed);
+
+  for (unsigned int i = 0; i < a_Steps; i++) {
+    t_genome.Mutate_AddNeuron(a_Innovs, a_Params, t_rng);
+    t_genome.Mutate_AddLink(a_Innovs, a_Params, t_rng);
+    t_genome.Mutate_AddLink(a_Innovs, a_Params, t_rng);
+  }
+
+  // the base genome was built with a time-seeded generator
+  t_genome.Randomize_LinkWeights(2.0, t_rng);
+  t_genome.Randomize_Traits(a_Params, t_rng);
+  for (unsigned int i = 0; i < t_genome.NumNeurons(); i++) {
+    NeuronGene &t_n = t_genome.m_NeuronGenes[i];
+    if ((t_n.Type() == INPUT) || (t_n.Type() == BIAS)) {
+      continue;
+    }
+    t_n.m_A = 1.0;
+    t_n.m_B = 0.0;
+    t_n.m_Bias = t_rng.RandFloatSigned();
+    t_n.m_TimeConstant =
+        a_Params.MinNeuronTimeConstant +
+        t_rng.RandFloat() *
+            (a_Params.MaxNeuronTimeConstant - a_Params.MinNeuronTimeConstant);
+  }
+  t_genome.MarkPhenotypeChanged(Genome::CHANGED_NEURONS);
+
+  return t_genome;
+}
+
+// a_Count points at y = a_Y, spread over x from -1 to 1
+static std::vector<std::vector<double>> Row(unsigned int a_Count, double a_Y) {
+  std::vector<std::vector<double>> t_row(a_Count);
+  for (unsigned int i = 0; i < a_Count; i++) {
+    double t_x = (a_Count > 1) ? (-1.0 + 2.0 * i / (a_Count - 1)) : 0.0;
+    t_row[i] = {t_x, a_Y};
+  }
+  return t_row;
+}
+
+Substrate SyntheticSubstrate(unsigned int a_Inputs, unsigned int a_Hidden,
+                             unsigned int a_Outputs) {
+  Substrate t_subst(Row(a_Inputs, -1.0), Row(a_Hidden, 0.0),
+                    Row(a_Outputs, 1.0));
+  t_subst.m_allow_input_output_links = (a_Hidden == 0);
+  t_subst.m_max_weight_and_bias = 8.0;
+  return t_subst;
+}
@@ -0,0 +1,46 @@
+/*
+ * Synthetic.hh
+ *
+ * Seeded generators of genomes and substrates for the benchmarks. The same
+ * sizes and seed always give the same genome, so timings stay comparable
+ * across commits.
+ */
+
+#ifndef _BENCHMARKS_SYNTHETIC_H
+#define _BENCHMARKS_SYNTHETIC_H
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/Innovation.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Random.hh>
+#include <MultiNEAT/Substrate.hh>
+
+// The parameters the synthetic genomes are grown and mutated with. Neurons,
+// links and genomes carry a few traits each.
+NEAT::Parameters SyntheticParameters();
+
+// The minimal genome with a_Inputs inputs, the bias included, and
+// a_Outputs outputs that synthetic genomes of these dimensions grow from.
+// Initialize the innovation database given to SyntheticGenome() from it.
+// CPPNs need a signed a_Activation for their outputs to vary enough.
+NEAT::Genome
+SyntheticBase(unsigned int a_Inputs, unsigned int a_Outputs,
+              const NEAT::Parameters &a_Params,
+              NEAT::ActivationFunction a_Activation = NEAT::UNSIGNED_SIGMOID);
+
+// Grows a_Base through a_Steps rounds of adding a neuron and two links,
+// then draws every weight, neuron parameter and trait from a generator
+// seeded with a_Seed. Genomes grown from the same base and database share
+// their first genes, like members of a population do.
+NEAT::Genome SyntheticGenome(const NEAT::Genome &a_Base, unsigned int a_Steps,
+                             unsigned int a_Seed,
+                             NEAT::InnovationDatabase &a_Innovs,
+                             const NEAT::Parameters &a_Params);
+
+// A substrate with rows of a_Inputs inputs, a_Hidden hidden and a_Outputs
+// outputs at y = -1, 0 and 1, spread over x from -1 to 1
+NEAT::Substrate SyntheticSubstrate(unsigned int a_Inputs,
+                                   unsigned int a_Hidden,
+                                   unsigned int a_Outputs);
+
+#endif
@@ -0,0 +1,578 @@
+/*
+ * Tasks.cc
+ *
+ * Reference tasks for the end-to-end evolution benchmarks.
+ */
+
+#include "Tasks.hh"
+
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Substrate.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+using namespace NEAT;
+
+static const double g_pi = 3.14159265358979323846;
+
+// The networks of the last generation, by the phenotype stamp they share
+// with the genome they were built from. Babies carry the stamp of their
+// parent, so a baby that only changed weights or neuron parameters takes
+// over its parent's network and patches it instead of building a new one.
+class Phenotypes {
+  typedef std::unordered_map<unsigned long long,
+                             std::unique_ptr<NeuralNetwork>>
+      Nets;
+  Nets m_last;
+  Nets m_current;
+
+public:
+  // Drops the networks no genome of the generation took over
+  void NextGeneration() {
+    m_last.swap(m_current);
+    m_current.clear();
+  }
+
+  NeuralNetwork &Get(Genome &a_Genome) {
+    std::unique_ptr<NeuralNetwork> t_net;
+    Nets::iterator t_found = m_last.find(a_Genome.GetPhenotypeStamp().Value());
+    if (t_found != m_last.end()) {
+      t_net = std::move(t_found->second);
+      m_last.erase(t_found);
+      a_Genome.RefreshPhenotype(*t_net);
+    } else {
+      t_net.reset(new NeuralNetwork());
+      a_Genome.BuildLeanPhenotype(*t_net);
+    }
+
+    NeuralNetwork &t_result = *t_net;
+    m_current[a_Genome.GetPhenotypeStamp().Value()] = std::move(t_net);
+    return t_result;
+  }
+};
+
+/////////////////////
+// XOR
+/////////////////////
+
+// The four patterns of two inputs and a bias. Fitness is (4 - error)^2.
+class XorTask : public Task {
+  Phenotypes m_phenotypes;
+
+public:
+  const char *Name() const { return "xor"; }
+  unsigned int MaxGenerations() const { return 150; }
+
+  Genome Start(const Parameters &a_Params) const {
+    return Genome(0, 3, 0, 1, false, UNSIGNED_SIGMOID, UNSIGNED_SIGMOID, 0,
+                  a_Params, 0);
+  }
+
+  bool Evaluate(const std::vector<Genome *> &a_Genomes) {
+    static const double t_patterns[4][3] = {
+        {0, 0, 0}, {0, 1, 1}, {1, 0, 1}, {1, 1, 0}};
+
+    bool t_solved = false;
+    double t_inputs[3] = {0, 0, 1};
+    m_phenotypes.NextGeneration();
+    for (unsigned int g = 0; g < a_Genomes.size(); g++) {
+      Genome &t_genome = *a_Genomes[g];
+      NeuralNetwork &t_net = m_phenotypes.Get(t_genome);
+      t_genome.CalculateDepth();
+      unsigned int t_depth = t_genome.GetDepth();
+
+      double t_error = 0;
+      unsigned int t_correct = 0;
+      for (unsigned int p = 0; p < 4; p++) {
+        t_inputs[0] = t_patterns[p][0];
+        t_inputs[1] = t_patterns[p][1];
+        t_net.Flush();
+        t_net.Input(t_inputs, 3);
+        for (unsigned int i = 0; i < t_depth; i++) {
+          t_net.Activate();
+        }
+
+        double t_output = t_net.Outputs()[0];
+        t_error += std::fabs(t_output - t_patterns[p][2]);
+        if ((t_output > 0.5) == (t_patterns[p][2] > 0.5)) {
+          t_correct++;
+        }
+      }
+
+      t_genome.SetFitness((4.0 - t_error) * (4.0 - t_error));
+      t_genome.SetEvaluated();
+      t_solved |= (t_correct == 4);
+    }
+    return t_solved;
+  }
+};
+
+/////////////////////
+// Double pole balancing
+/////////////////////
+
+// Two poles of different lengths on a cart, with the velocities given to the
+// network. The equations of motion and the constants are those of Wieland's
+// formulation, as used to benchmark NEAT. Fitness is the number of steps
+// both poles stay up, solved at 100000.
+class PoleBalancingTask : public Task {
+  static const unsigned int m_max_steps = 100000;
+
+  Phenotypes m_phenotypes;
+
+  // Derivatives of the state x, x', theta1, theta1', theta2, theta2' under
+  // a_Force
+  static void Derivatives(double a_Force, const double *a_State,
+                          double *a_Out) {
+    const double t_gravity = -9.8;
+    const double t_mass_cart = 1.0;
+    const double t_mass[2] = {0.1, 0.01};
+    const double t_length[2] = {0.5, 0.05}; // half the pole lengths
+    const double t_friction = 0.000002;
+
+    double t_cos[2], t_gsin[2], t_temp[2], t_fi[2], t_mi[2];
+    for (unsigned int i = 0; i < 2; i++) {
+      double t_theta = a_State[2 + 2 * i];
+      double t_omega = a_State[3 + 2 * i];
+      double t_ml = t_length[i] * t_mass[i];
+      t_cos[i] = std::cos(t_theta);
+      t_gsin[i] = t_gravity * std::sin(t_theta);
+      t_temp[i] = t_friction * t_omega / t_ml;
+      t_fi[i] = (t_ml * t_omega * t_omega * std::sin(t_theta)) +
+                (0.75 * t_mass[i] * t_cos[i] * (t_temp[i] + t_gsin[i]));
+      t_mi[i] = t_mass[i] * (1 - (0.75 * t_cos[i] * t_cos[i]));
+    }
+
+    a_Out[0] = a_State[1];
+    a_Out[1] =
+        (a_Force + t_fi[0] + t_fi[1]) / (t_mi[0] + t_mi[1] + t_mass_cart);
+    for (unsigned int i = 0; i < 2; i++) {
+      a_Out[2 + 2 * i] = a_State[3 + 2 * i];
+      a_Out[3 + 2 * i] =
+          -0.75 * (a_Out[1] * t_cos[i] + t_gsin[i] + t_temp[i]) / t_length[i];
+    }
+  }
+
+  // One Runge-Kutta step of a_Dt seconds
+  static void Step(double a_Force, double a_Dt, double *a_State) {
+    double t_k[4][6], t_trial[6];
+    Derivatives(a_Force, a_State, t_k[0]);
+    for (unsigned int s = 1; s < 4; s++) {
+      double t_h = (s < 3) ? (a_Dt / 2) : a_Dt;
+      for (unsigned int i = 0; i < 6; i++) {
+        t_trial[i] = a_State[i] + t_h * t_k[s - 1][i];
+      }
+      Derivatives(a_Force, t_trial, t_k[s]);
+    }
+    for (unsigned int i = 0; i < 6; i++) {
+      a_State[i] += a_Dt / 6 *
+                    (t_k[0][i] + 2 * t_k[1][i] + 2 * t_k[2][i] + t_k[3][i]);
+    }
+  }
+
+  static unsigned int Balance(NeuralNetwork &a_Net) {
+    const double t_track = 2.4;
+    const double t_failure_angle = 36.0 * g_pi / 180.0;
+
+    double t_state[6] = {0, 0, 4.0 * g_pi / 180.0, 0, 0, 0};
+    double t_inputs[7];
+    t_inputs[6] = 1.0;
+
+    a_Net.Flush();
+    for (unsigned int t_steps = 0; t_steps < m_max_steps; t_steps++) {
+      t_inputs[0] = t_state[0] / 4.8;
+      t_inputs[1] = t_state[1] / 2.0;
+      t_inputs[2] = t_state[2] / 0.52;
+      t_inputs[3] = t_state[3] / 2.0;
+      t_inputs[4] = t_state[4] / 0.52;
+      t_inputs[5] = t_state[5] / 2.0;
+      a_Net.Input(t_inputs, 7);
+      a_Net.Activate();
+
+      double t_force = (a_Net.Outputs()[0] - 0.5) * 2.0 * 10.0;
+      Step(t_force, 0.01, t_state);
+      Step(t_force, 0.01, t_state);
+
+      if ((std::fabs(t_state[0]) > t_track) ||
+          (std::fabs(t_state[2]) > t_failure_angle) ||
+          (std::fabs(t_state[4]) > t_failure_angle)) {
+        return t_steps;
+      }
+    }
+    return m_max_steps;
+  }
+
+public:
+  const char *Name() const { return "pole"; }
+  unsigned int MaxGenerations() const { return 100; }
+
+  Genome Start(const Parameters &a_Params) const {
+    return Genome(0, 7, 0, 1, false, UNSIGNED_SIGMOID, UNSIGNED_SIGMOID, 0,
+                  a_Params, 0);
+  }
+
+  void Configure(Parameters &a_Params) const { a_Params.RecurrentProb = 0.1; }
+
+  bool Evaluate(const std::vector<Genome *> &a_Genomes) {
+    bool t_solved = false;
+    m_phenotypes.NextGeneration();
+    for (unsigned int g = 0; g < a_Genomes.size(); g++) {
+      unsigned int t_steps = Balance(m_phenotypes.Get(*a_Genomes[g]));
+      a_Genomes[g]->SetFitness(t_steps);
+      a_Genomes[g]->SetEvaluated();
+      t_solved |= (t_steps == m_max_steps);
+    }
+    return t_solved;
+  }
+};
+
+/////////////////////
+// Retina
+/////////////////////
+
+// The retina problem of Kashtan and Alon, evolved with HyperNEAT. A retina
+// of two 2x2 patches shows one of 256 images, and the network has to tell
+// whether both patches show an object. Eight of the 16 patterns of a patch
+// are objects, those of the right patch mirror those of the left.
+class RetinaTask : public Task {
+  Substrate m_substrate;
+  bool m_objects[2][16];
+
+  // the bits of a patch are its top left, top right, bottom left and bottom
+  // right pixels
+  static unsigned int Mirror(unsigned int a_Pattern) {
+    return ((a_Pattern & 5) << 1) | ((a_Pattern & 10) >> 1);
+  }
+
+  // pixels of both patches at height a_Z, the left patch first
+  static std::vector<std::vector<double>> Layer(double a_Z) {
+    std::vector<std::vector<double>> t_layer;
+    for (unsigned int p = 0; p < 2; p++) {
+      for (unsigned int i = 0; i < 4; i++) {
+        double t_x = ((p == 0) ? -1.0 : 0.6) + 0.4 * (i % 2);
+        double t_y = 0.5 - (i / 2);
+        t_layer.push_back({t_x, t_y, a_Z});
+      }
+    }
+    return t_layer;
+  }
+
+public:
+  RetinaTask()
+      : m_substrate(Layer(-1.0), Layer(0.0),
+                    std::vector<std::vector<double>>{{0.0, 0.0, 1.0}}) {
+    m_substrate.m_hidden_nodes_activation = SIGNED_SIGMOID;
+    m_substrate.m_output_nodes_activation = UNSIGNED_SIGMOID;
+    m_substrate.m_max_weight_and_bias = 8.0;
+
+    static const unsigned int t_left[8] = {1, 4, 5, 6, 7, 9, 13, 15};
+    for (unsigned int i = 0; i < 16; i++) {
+      m_objects[0][i] = m_objects[1][i] = false;
+    }
+    for (unsigned int i = 0; i < 8; i++) {
+      m_objects[0][t_left[i]] = true;
+      m_objects[1][Mirror(t_left[i])] = true;
+    }
+  }
+
+  const char *Name() const { return "retina"; }
+  unsigned int MaxGenerations() const { return 100; }
+
+  void Configure(Parameters &a_Params) const {
+    a_Params.ActivationFunction_SignedSigmoid_Prob = 1.0;
+    a_Params.ActivationFunction_UnsignedSigmoid_Prob = 0.0;
+    a_Params.ActivationFunction_Tanh_Prob = 1.0;
+    a_Params.ActivationFunction_SignedGauss_Prob = 1.0;
+    a_Params.ActivationFunction_SignedSine_Prob = 1.0;
+    a_Params.ActivationFunction_Linear_Prob = 1.0;
+    a_Params.MutateNeuronActivationTypeProb = 0.03;
+  }
+
+  Genome Start(const Parameters &a_Params) const {
+    Substrate t_substrate = m_substrate;
+    return Genome(0, t_substrate.GetMinCPPNInputs(), 0,
+                  t_substrate.GetMinCPPNOutputs(), false, TANH, TANH, 0,
+                  a_Params, 0);
+  }
+
+  bool Evaluate(const std::vector<Genome *> &a_Genomes) {
+    bool t_solved = false;
+    double t_inputs[8];
+    for (unsigned int g = 0; g < a_Genomes.size(); g++) {
+      NeuralNetwork t_net;
+      a_Genomes[g]->BuildHyperNEATPhenotype(t_net, m_substrate);
+
+      double t_score = 0;
+      unsigned int t_correct = 0;
+      for (unsigned int t_image = 0; t_image < 256; t_image++) {
+        unsigned int t_left = t_image & 15, t_right = t_image >> 4;
+        for (unsigned int i = 0; i < 4; i++) {
+          t_inputs[i] = (t_left & (1 << i)) ? 1.0 : -1.0;
+          t_inputs[4 + i] = (t_right & (1 << i)) ? 1.0 : -1.0;
+        }
+        double t_target =
+            (m_objects[0][t_left] && m_objects[1][t_right]) ? 1.0 : 0.0;
+
+        t_net.Flush();
+        t_net.Input(t_inputs, 8);
+        for (unsigned int i = 0; i < 3; i++) {
+          t_net.Activate();
+        }
+
+        double t_output = t_net.Outputs()[0];
+        t_score += 1.0 - std::fabs(t_output - t_target);
+        if ((t_output > 0.5) == (t_target > 0.5)) {
+          t_correct++;
+        }
+      }
+
+      a_Genomes[g]->SetFitness(t_score / 256.0);
+      a_Genomes[g]->SetEvaluated();
+      t_solved |= (t_correct == 256);
+    }
+    return t_solved;
+  }
+};
+
+/////////////////////
+// Maze
+/////////////////////
+
+// A robot with six rangefinders and a four-slice radar towards the goal
+// drives through the medium maze of Lehman and Stanley's novelty search
+// experiments. Fitness is the novelty of where the robot ends up: its mean
+// distance to the 15 nearest end points of the generation and the archive.
+// End points more novel than a threshold go to the archive, and the
+// threshold adapts to how many do.
+class MazeTask : public Task {
+  struct Wall {
+    double m_x1, m_y1, m_x2, m_y2;
+  };
+
+  static const unsigned int m_steps = 400;
+  static const unsigned int m_neighbours = 15;
+
+  std::vector<Wall> m_walls;
+  double m_start_x, m_start_y, m_goal_x, m_goal_y;
+  Phenotypes m_phenotypes;
+
+  std::vector<std::pair<double, double>> m_archive;
+  double m_threshold;
+  unsigned int m_generations_unarchived;
+
+  static double Distance(double a_X1, double a_Y1, double a_X2, double a_Y2) {
+    return std::sqrt((a_X1 - a_X2) * (a_X1 - a_X2) +
+                     (a_Y1 - a_Y2) * (a_Y1 - a_Y2));
+  }
+
+  // the distance from a point to a wall
+  static double Distance(const Wall &a_Wall, double a_X, double a_Y) {
+    double t_dx = a_Wall.m_x2 - a_Wall.m_x1, t_dy = a_Wall.m_y2 - a_Wall.m_y1;
+    double t_len2 = t_dx * t_dx + t_dy * t_dy;
+    double t_u = 0;
+    if (t_len2 > 0) {
+      t_u = ((a_X - a_Wall.m_x1) * t_dx + (a_Y - a_Wall.m_y1) * t_dy) / t_len2;
+      t_u = std::max(0.0, std::min(1.0, t_u));
+    }
+    return Distance(a_X, a_Y, a_Wall.m_x1 + t_u * t_dx,
+                    a_Wall.m_y1 + t_u * t_dy);
+  }
+
+  bool Collides(double a_X, double a_Y) const {
+    const double t_radius = 8.0;
+    for (unsigned int i = 0; i < m_walls.size(); i++) {
+      if (Distance(m_walls[i], a_X, a_Y) < t_radius) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // How far a ray from a point goes at a_Angle degrees before it hits a
+  // wall, up to a_Range
+  double Range(double a_X, double a_Y, double a_Angle, double a_Range) const {
+    double t_dx = std::cos(a_Angle * g_pi / 180.0) * a_Range;
+    double t_dy = std::sin(a_Angle * g_pi / 180.0) * a_Range;
+    double t_nearest = a_Range;
+    for (unsigned int i = 0; i < m_walls.size(); i++) {
+      const Wall &t_w = m_walls[i];
+      double t_wx = t_w.m_x2 - t_w.m_x1, t_wy = t_w.m_y2 - t_w.m_y1;
+      double t_denom = t_dx * t_wy - t_dy * t_wx;
+      if (t_denom == 0) {
+        continue;
+      }
+      double t_ox = t_w.m_x1 - a_X, t_oy = t_w.m_y1 - a_Y;
+      double t_ray = (t_ox * t_wy - t_oy * t_wx) / t_denom;
+      double t_along = (t_ox * t_dy - t_oy * t_dx) / t_denom;
+      if ((t_ray >= 0) && (t_ray <= 1) && (t_along >= 0) && (t_along <= 1)) {
+        t_nearest = std::min(t_nearest, t_ray * a_Range);
+      }
+    }
+    return t_nearest;
+  }
+
+  // Drives the robot and returns where it ended up. a_Solved is set if it
+  // reached the goal on the way.
+  std::pair<double, double> Drive(NeuralNetwork &a_Net, bool &a_Solved) const {
+    static const double t_rangefinders[6] = {-90, -45, 0, 45, 90, -180};
+    const double t_range = 100.0;
+
+    double t_x = m_start_x, t_y = m_start_y;
+    double t_heading = 0, t_speed = 0, t_turn = 0;
+    double t_inputs[11];
+    t_inputs[10] = 1.0;
+
+    a_Solved = false;
+    a_Net.Flush();
+    for (unsigned int s = 0; s < m_steps; s++) {
+      for (unsigned int i = 0; i < 6; i++) {
+        t_inputs[i] =
+            Range(t_x, t_y, t_heading + t_rangefinders[i], t_range) / t_range;
+      }
+
+      double t_goal = std::atan2(m_goal_y - t_y, m_goal_x - t_x) * 180.0 / g_pi;
+      // fmod keeps the sign, so bring the angle back into [0, 360)
+      double t_relative = std::fmod(t_goal - t_heading + 405.0, 360.0);
+      if (t_relative < 0) {
+        t_relative += 360.0;
+      }
+      for (unsigned int i = 0; i < 4; i++) {
+        t_inputs[6 + i] = ((t_relative >= 90.0 * i) &&
+                           (t_relative < 90.0 * (i + 1)))
+                              ? 1.0
+                              : 0.0;
+      }
+
+      a_Net.Input(t_inputs, 11);
+      a_Net.Activate();
+
+      t_turn = std::max(-3.0, std::min(3.0, t_turn + a_Net.Outputs()[0] - 0.5));
+      t_speed =
+          std::max(-3.0, std::min(3.0, t_speed + a_Net.Outputs()[1] - 0.5));
+      t_heading = std::fmod(t_heading + t_turn + 360.0, 360.0);
+
+      double t_nx = t_x + std::cos(t_heading * g_pi / 180.0) * t_speed;
+      double t_ny = t_y + std::sin(t_heading * g_pi / 180.0) * t_speed;
+      if (!Collides(t_nx, t_ny)) {
+        t_x = t_nx;
+        t_y = t_ny;
+      }
+
+      if (Distance(t_x, t_y, m_goal_x, m_goal_y) < 5.0) {
+        a_Solved = true;
+        break;
+      }
+    }
+    return std::make_pair(t_x, t_y);
+  }
+
+public:
+  MazeTask()
+      : m_start_x(30), m_start_y(22), m_goal_x(270), m_goal_y(100),
+        m_threshold(6.0), m_generations_unarchived(0) {
+    m_walls = {{293, 7, 289, 130},  {289, 130, 6, 134}, {6, 134, 8, 5},
+               {8, 5, 292, 7},      {241, 130, 58, 65}, {114, 7, 73, 42},
+               {130, 91, 107, 46},  {196, 8, 139, 51},  {219, 122, 182, 63},
+               {267, 9, 214, 63},   {271, 129, 237, 88}};
+  }
+
+  const char *Name() const { return "maze"; }
+  unsigned int MaxGenerations() const { return 100; }
+
+  Genome Start(const Parameters &a_Params) const {
+    return Genome(0, 11, 0, 2, false, UNSIGNED_SIGMOID, UNSIGNED_SIGMOID, 0,
+                  a_Params, 0);
+  }
+
+  bool Evaluate(const std::vector<Genome *> &a_Genomes) {
+    bool t_solved = false;
+    std::vector<std::pair<double, double>> t_ends(a_Genomes.size());
+    m_phenotypes.NextGeneration();
+    for (unsigned int g = 0; g < a_Genomes.size(); g++) {
+      bool t_reached = false;
+      t_ends[g] = Drive(m_phenotypes.Get(*a_Genomes[g]), t_reached);
+      t_solved |= t_reached;
+    }
+
+    // novelty against the generation, itself excluded, and the archive as
+    // it was before the generation
+    std::vector<double> t_distances;
+    std::vector<unsigned int> t_archived;
+    for (unsigned int g = 0; g < a_Genomes.size(); g++) {
+      t_distances.clear();
+      for (unsigned int i = 0; i < t_ends.size(); i++) {
+        if (i != g) {
+          t_distances.push_back(Distance(t_ends[g].first, t_ends[g].second,
+                                         t_ends[i].first, t_ends[i].second));
+        }
+      }
+      for (unsigned int i = 0; i < m_archive.size(); i++) {
+        t_distances.push_back(Distance(t_ends[g].first, t_ends[g].second,
+                                       m_archive[i].first,
+                                       m_archive[i].second));
+      }
+
+      unsigned int t_k =
+          std::min<unsigned int>(m_neighbours, t_distances.size());
+      double t_novelty = 0;
+      if (t_k > 0) {
+        std::nth_element(t_distances.begin(), t_distances.begin() + (t_k - 1),
+                         t_distances.end());
+        for (unsigned int i = 0; i < t_k; i++) {
+          t_novelty += t_distances[i];
+        }
+        t_novelty /= t_k;
+      }
+
+      a_Genomes[g]->SetFitness(t_novelty);
+      a_Genomes[g]->SetEvaluated();
+      if (t_novelty > m_threshold) {
+        t_archived.push_back(g);
+      }
+    }
+    for (unsigned int i = 0; i < t_archived.size(); i++) {
+      m_archive.push_back(t_ends[t_archived[i]]);
+    }
+
+    // keep the archive growing by a few end points per generation
+    if (t_archived.size() > std::max<size_t>(4, a_Genomes.size() / 40)) {
+      m_threshold *= 1.2;
+    }
+    if (!t_archived.empty()) {
+      m_generations_unarchived = 0;
+    } else {
+      m_generations_unarchived++;
+    }
+    if (m_generations_unarchived >= 5) {
+      m_threshold = std::max(1.0, m_threshold * 0.95);
+    }
+
+    return t_solved;
+  }
+};
+
+const std::vector<std::string> &TaskNames() {
+  static const std::vector<std::string> t_names = {"xor", "pole", "retina",
+                                                   "maze"};
+  return t_names;
+}
+
+std::unique_ptr<Task> MakeTask(const std::string &a_Name) {
+  if (a_Name == "xor") {
+    return std::unique_ptr<Task>(new XorTask());
+  }
+  if (a_Name == "pole") {
+    return std::unique_ptr<Task>(new PoleBalancingTask());
+  }
+  if (a_Name == "retina") {
+    return std::unique_ptr<Task>(new RetinaTask());
+  }
+  if (a_Name == "maze") {
+    return std::unique_ptr<Task>(new MazeTask());
+  }
+  return std::unique_ptr<Task>();
+}
@@ -0,0 +1,47 @@
+/*
+ * Tasks.hh
+ *
+ * Reference tasks for the end-to-end evolution benchmarks: XOR, double
+ * pole balancing, the HyperNEAT retina problem and a maze solved with
+ * novelty search. Each task is simulated locally and is deterministic, so
+ * runs with the same seed evolve the same way on every commit that does
+ * not change evolution itself.
+ */
+
+#ifndef _BENCHMARKS_TASKS_H
+#define _BENCHMARKS_TASKS_H
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/Parameters.hh>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Task {
+public:
+  virtual ~Task() {}
+
+  virtual const char *Name() const = 0;
+
+  // The generations a run gives up after
+  virtual unsigned int MaxGenerations() const = 0;
+
+  // Sets the parameters of evolution that differ from the common ones
+  virtual void Configure(NEAT::Parameters &) const {}
+
+  // The genome the population starts from
+  virtual NEAT::Genome Start(const NEAT::Parameters &a_Params) const = 0;
+
+  // Sets the fitness of every genome of a generation and marks them
+  // evaluated. Returns true if any of them solved the task.
+  virtual bool Evaluate(const std::vector<NEAT::Genome *> &a_Genomes) = 0;
+};
+
+// The names MakeTask() knows, in the order they are run by default
+const std::vector<std::string> &TaskNames();
+
+// A new task by name, NULL if there is none of that name
+std::unique_ptr<Task> MakeTask(const std::string &a_Name);
+
+#endif
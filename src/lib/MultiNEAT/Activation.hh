@@ -0,0 +1,151 @@
+#ifndef _ACTIVATION_H
+#define _ACTIVATION_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        Activation.hh
+// Description: The activation functions, for any floating point type.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Genes.hh>
+#include <cmath>
+
+namespace NEAT {
+
+/////////////////////////////////////
+// The set of activation functions //
+/////////////////////////////////////
+
+template <typename T>
+inline T af_sigmoid_unsigned(T aX, T aSlope, T aShift) {
+  return T(1.0) / (T(1.0) + std::exp(-aSlope * aX - aShift));
+}
+
+template <typename T> inline T af_sigmoid_signed(T aX, T aSlope, T aShift) {
+  T tY = af_sigmoid_unsigned(aX, aSlope, aShift);
+  return (tY - T(0.5)) * T(2.0);
+}
+
+template <typename T> inline T af_tanh(T aX, T aSlope, T aShift) {
+  return std::tanh(aX * aSlope);
+}
+
+template <typename T> inline T af_tanh_cubic(T aX, T aSlope, T aShift) {
+  return std::tanh(aX * aX * aX * aSlope);
+}
+
+template <typename T> inline T af_step_signed(T aX, T aShift) {
+  T tY;
+  if (aX > aShift) {
+    tY = T(1.0);
+  } else {
+    tY = T(-1.0);
+  }
+
+  return tY;
+}
+
+template <typename T> inline T af_step_unsigned(T aX, T aShift) {
+  if (aX > (T(0.5) + aShift)) {
+    return T(1.0);
+  } else {
+    return T(0.0);
+  }
+}
+
+template <typename T> inline T af_gauss_signed(T aX, T aSlope, T aShift) {
+  T tY = std::exp(-aSlope * aX * aX +
+                  aShift); // TODO: Need separate a, b per activation function
+  return (tY - T(0.5)) * T(2.0);
+}
+
+template <typename T> inline T af_gauss_unsigned(T aX, T aSlope, T aShift) {
+  return std::exp(-aSlope * aX * aX + aShift);
+}
+
+template <typename T> inline T af_abs(T aX, T aShift) {
+  return ((aX + aShift) < T(0.0)) ? -(aX + aShift) : (aX + aShift);
+}
+
+template <typename T> inline T af_sine_signed(T aX, T aFreq, T aShift) {
+  return std::sin(aX * aFreq + aShift);
+}
+
+template <typename T> inline T af_sine_unsigned(T aX, T aFreq, T aShift) {
+  T tY = std::sin((aX * aFreq + aShift));
+  return (tY + T(1.0)) / T(2.0);
+}
+
+template <typename T> inline T af_linear(T aX, T aShift) {
+  return (aX + aShift);
+}
+
+template <typename T> inline T af_relu(T aX) { return (aX > 0) ? aX : T(0); }
+
+template <typename T> inline T af_softplus(T aX) {
+  return std::log(T(1) + std::exp(aX));
+}
+
+// Applies the activation function of a neuron to its input x
+template <typename T>
+inline T af_apply(ActivationFunction aType, T x, T aA, T aB) {
+  switch (aType) {
+  case SIGNED_SIGMOID:
+    return af_sigmoid_signed(x, aA, aB);
+  case UNSIGNED_SIGMOID:
+    return af_sigmoid_unsigned(x, aA, aB);
+  case TANH:
+    return af_tanh(x, aA, aB);
+  case TANH_CUBIC:
+    return af_tanh_cubic(x, aA, aB);
+  case SIGNED_STEP:
+    return af_step_signed(x, aB);
+  case UNSIGNED_STEP:
+    return af_step_unsigned(x, aB);
+  case SIGNED_GAUSS:
+    return af_gauss_signed(x, aA, aB);
+  case UNSIGNED_GAUSS:
+    return af_gauss_unsigned(x, aA, aB);
+  case ABS:
+    return af_abs(x, aB);
+  case SIGNED_SINE:
+    return af_sine_signed(x, aA, aB);
+  case UNSIGNED_SINE:
+    return af_sine_unsigned(x, aA, aB);
+  case LINEAR:
+    return af_linear(x, aB);
+  case RELU:
+    return af_relu(x);
+  case SOFTPLUS:
+    return af_softplus(x);
+  default:
+    return af_sigmoid_unsigned(x, aA, aB);
+  }
+}
+
+} // namespace NEAT
+
+#endif
@@ -0,0 +1,713 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        Checkpoint.cc
+// Description: Implementation of the checkpoint reader and writer.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Checkpoint.hh>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace NEAT {
+
+static const char CHECKPOINT_MAGIC[8] = {'M', 'N', 'E', 'A',
+                                         'T', 'C', 'K', 'P'};
+static const uint32_t CHECKPOINT_BYTE_ORDER = 0x01020304;
+
+// magic, version, byte order, section count, reserved
+static const size_t CHECKPOINT_HEADER_SIZE = 8 + 4 * 4;
+// ID, reserved, offset, size
+static const size_t CHECKPOINT_ENTRY_SIZE = 4 * 2 + 8 * 2;
+
+template <typename T> static void AppendBytes(std::vector<char> &a_Out, T a_V) {
+  const char *t_bytes = reinterpret_cast<const char *>(&a_V);
+  a_Out.insert(a_Out.end(), t_bytes, t_bytes + sizeof(T));
+}
+
+template <typename T> static T ReadBytes(const char *a_Data) {
+  T t_value;
+  std::memcpy(&t_value, a_Data, sizeof(T));
+  return t_value;
+}
+
+////////////////////////////
+// Writer
+////////////////////////////
+
+void CheckpointWriter::BeginSection(uint32_t a_ID) {
+  Section t_s;
+  t_s.m_id = a_ID;
+  t_s.m_offset = m_data.size();
+  t_s.m_size = 0;
+  m_sections.push_back(t_s);
+}
+
+void CheckpointWriter::EndSection() {
+  m_sections.back().m_size = m_data.size() - m_sections.back().m_offset;
+}
+
+void CheckpointWriter::PutString(const std::string &a_Str) {
+  Put(static_cast<uint64_t>(a_Str.size()));
+  m_data.insert(m_data.end(), a_Str.begin(), a_Str.end());
+}
+
+void CheckpointWriter::PutTrait(const TraitType &a_Value) {
+  Put(static_cast<int32_t>(a_Value.which()));
+  PutTraitValue(a_Value);
+}
+
+void CheckpointWriter::PutTraitValue(const TraitType &a_Value) {
+  switch (a_Value.which()) {
+  case 0:
+    Put(bs::get<int>(a_Value));
+    break;
+  case 1:
+    Put(bs::get<double>(a_Value));
+    break;
+  case 2:
+    PutString(bs::get<std::string>(a_Value));
+    break;
+  case 3:
+    Put(bs::get<intsetelement>(a_Value).value);
+    break;
+  case 4:
+    Put(bs::get<floatsetelement>(a_Value).value);
+    break;
+  }
+}
+
+void CheckpointWriter::PutTraits(const std::map<std::string, Trait> &a_Traits) {
+  Put(static_cast<uint32_t>(a_Traits.size()));
+  for (auto t_it = a_Traits.begin(); t_it != a_Traits.end(); t_it++) {
+    Put(static_cast<uint32_t>(m_traits.Intern(t_it->first, t_it->second)));
+    PutTraitValue(t_it->second.value);
+  }
+}
+
+void CheckpointWriter::PutTraitSchema(const TraitSchema &a_Schema) {
+  Put(static_cast<uint32_t>(a_Schema.size()));
+  for (unsigned int i = 0; i < a_Schema.size(); i++) {
+    const TraitSchema::Entry &t_e = a_Schema.entries[i];
+    PutString(t_e.name);
+    Put(static_cast<int32_t>(t_e.type));
+    PutString(t_e.dep_key);
+    Put(static_cast<uint64_t>(t_e.dep_values.size()));
+    for (unsigned int j = 0; j < t_e.dep_values.size(); j++) {
+      PutTrait(t_e.dep_values[j]);
+    }
+  }
+}
+
+void CheckpointWriter::PutTraitParameters(
+    const std::map<std::string, TraitParameters> &a_Params) {
+  Put(static_cast<uint64_t>(a_Params.size()));
+  for (auto t_it = a_Params.begin(); t_it != a_Params.end(); t_it++) {
+    const TraitParameters &t_tp = t_it->second;
+
+    PutString(t_it->first);
+    Put(t_tp.m_ImportanceCoeff);
+    Put(t_tp.m_MutationProb);
+    PutString(t_tp.type);
+
+    Put(static_cast<int32_t>(t_tp.m_Details.which()));
+    switch (t_tp.m_Details.which()) {
+    case 0: {
+      const IntTraitParameters &t_d =
+          bs::get<IntTraitParameters>(t_tp.m_Details);
+      Put(t_d.min);
+      Put(t_d.max);
+      Put(t_d.mut_power);
+      Put(t_d.mut_replace_prob);
+      break;
+    }
+    case 1: {
+      const FloatTraitParameters &t_d =
+          bs::get<FloatTraitParameters>(t_tp.m_Details);
+      Put(t_d.min);
+      Put(t_d.max);
+      Put(t_d.mut_power);
+      Put(t_d.mut_replace_prob);
+      break;
+    }
+    case 2: {
+      const StringTraitParameters &t_d =
+          bs::get<StringTraitParameters>(t_tp.m_Details);
+      Put(static_cast<uint64_t>(t_d.set.size()));
+      for (unsigned int i = 0; i < t_d.set.size(); i++) {
+        PutString(t_d.set[i]);
+      }
+      PutVector(t_d.probs);
+      break;
+    }
+    case 3: {
+      const IntSetTraitParameters &t_d =
+          bs::get<IntSetTraitParameters>(t_tp.m_Details);
+      PutVector(t_d.set);
+      PutVector(t_d.probs);
+      break;
+    }
+    case 4: {
+      const FloatSetTraitParameters &t_d =
+          bs::get<FloatSetTraitParameters>(t_tp.m_Details);
+      PutVector(t_d.set);
+      PutVector(t_d.probs);
+      break;
+    }
+    }
+
+    PutString(t_tp.dep_key);
+    Put(static_cast<uint64_t>(t_tp.dep_values.size()));
+    for (unsigned int i = 0; i < t_tp.dep_values.size(); i++) {
+      PutTrait(t_tp.dep_values[i]);
+    }
+  }
+}
+
+void CheckpointWriter::GetHeader(std::vector<char> &a_Bytes,
+                                 std::vector<char> &a_Tail) const {
+  std::vector<Section> t_sections = m_sections;
+  a_Tail.clear();
+  if (!m_traits.empty()) {
+    CheckpointWriter t_traits;
+    t_traits.PutTraitSchema(m_traits);
+    a_Tail = t_traits.GetPayload();
+
+    Section t_s;
+    t_s.m_id = CHECKPOINT_TRAITS;
+    t_s.m_offset = m_data.size();
+    t_s.m_size = a_Tail.size();
+    t_sections.push_back(t_s);
+  }
+
+  const uint64_t t_start =
+      CHECKPOINT_HEADER_SIZE + CHECKPOINT_ENTRY_SIZE * t_sections.size();
+
+  a_Bytes.clear();
+  a_Bytes.insert(a_Bytes.end(), CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 8);
+  AppendBytes(a_Bytes, static_cast<uint32_t>(CHECKPOINT_VERSION));
+  AppendBytes(a_Bytes, CHECKPOINT_BYTE_ORDER);
+  AppendBytes(a_Bytes, static_cast<uint32_t>(t_sections.size()));
+  AppendBytes(a_Bytes, static_cast<uint32_t>(0));
+
+  for (unsigned int i = 0; i < t_sections.size(); i++) {
+    AppendBytes(a_Bytes, t_sections[i].m_id);
+    AppendBytes(a_Bytes, static_cast<uint32_t>(0));
+    AppendBytes(a_Bytes, t_start + t_sections[i].m_offset);
+    AppendBytes(a_Bytes, t_sections[i].m_size);
+  }
+}
+
+void CheckpointWriter::GetBytes(std::vector<char> &a_Bytes) const {
+  std::vector<char> t_tail;
+  GetHeader(a_Bytes, t_tail);
+  a_Bytes.insert(a_Bytes.end(), m_data.begin(), m_data.end());
+  a_Bytes.insert(a_Bytes.end(), t_tail.begin(), t_tail.end());
+}
+
+bool CheckpointWriter::Write(const char *a_FileName) const {
+  std::vector<char> t_header, t_tail;
+  GetHeader(t_header, t_tail);
+
+  ReplacementFile t_file(a_FileName);
+  if (!t_file.Get()) {
+    return false;
+  }
+
+  bool t_ok = (fwrite(t_header.data(), 1, t_header.size(), t_file.Get()) ==
+               t_header.size()) &&
+              (fwrite(m_data.data(), 1, m_data.size(), t_file.Get()) ==
+               m_data.size()) &&
+              (fwrite(t_tail.data(), 1, t_tail.size(), t_file.Get()) ==
+               t_tail.size());
+  return t_ok && t_file.Commit();
+}
+
+////////////////////////////
+// Reader
+////////////////////////////
+
+CheckpointReader::CheckpointReader()
+    : m_data(NULL), m_size(0), m_pos(0), m_end(0), m_version(0),
+      m_genomes(NULL) {}
+
+void CheckpointReader::Open(const char *a_FileName) {
+  FILE *t_file = fopen(a_FileName, "rb");
+  if (!t_file) {
+    throw std::runtime_error("Cannot open checkpoint file");
+  }
+
+  std::vector<char> t_buffer;
+  bool t_ok = (fseek(t_file, 0, SEEK_END) == 0);
+  long t_size = t_ok ? ftell(t_file) : -1;
+  if (t_size >= 0) {
+    t_buffer.resize(t_size);
+    t_ok = (fseek(t_file, 0, SEEK_SET) == 0) &&
+           (fread(t_buffer.data(), 1, t_size, t_file) ==
+            static_cast<size_t>(t_size));
+  }
+  fclose(t_file);
+  if (!t_ok || (t_size < 0)) {
+    throw std::runtime_error("Cannot read checkpoint file");
+  }
+
+  m_buffer.swap(t_buffer);
+  Open(m_buffer.data(), m_buffer.size());
+}
+
+void CheckpointReader::Open(const char *a_Data, size_t a_Size) {
+  m_data = a_Data;
+  m_size = a_Size;
+  m_sections.clear();
+
+  if ((a_Size < CHECKPOINT_HEADER_SIZE) ||
+      (std::memcmp(a_Data, CHECKPOINT_MAGIC, 8) != 0)) {
+    throw std::runtime_error("Not a checkpoint");
+  }
+
+  m_version = ReadBytes<uint32_t>(a_Data + 8);
+  if ((m_version == 0) || (m_version > CHECKPOINT_VERSION)) {
+    throw std::runtime_error("Unsupported checkpoint version");
+  }
+  if (ReadBytes<uint32_t>(a_Data + 12) != CHECKPOINT_BYTE_ORDER) {
+    throw std::runtime_error("Checkpoint has a different byte order");
+  }
+
+  uint32_t t_count = ReadBytes<uint32_t>(a_Data + 16);
+  if (t_count > (a_Size - CHECKPOINT_HEADER_SIZE) / CHECKPOINT_ENTRY_SIZE) {
+    throw std::runtime_error("Checkpoint is truncated");
+  }
+
+  for (unsigned int i = 0; i < t_count; i++) {
+    const char *t_entry =
+        a_Data + CHECKPOINT_HEADER_SIZE + i * CHECKPOINT_ENTRY_SIZE;
+    Section t_s;
+    t_s.m_id = ReadBytes<uint32_t>(t_entry);
+    t_s.m_offset = ReadBytes<uint64_t>(t_entry + 8);
+    t_s.m_size = ReadBytes<uint64_t>(t_entry + 16);
+    if ((t_s.m_offset > a_Size) || (t_s.m_size > a_Size - t_s.m_offset)) {
+      throw std::runtime_error("Checkpoint is truncated");
+    }
+    m_sections.push_back(t_s);
+  }
+
+  m_traits.clear();
+  if (HasSection(CHECKPOINT_TRAITS)) {
+    BeginSection(CHECKPOINT_TRAITS);
+    GetTraitSchema();
+  }
+
+  m_pos = m_end = 0;
+}
+
+void CheckpointReader::Attach(const char *a_Data, size_t a_Size,
+                              unsigned int a_Version) {
+  m_data = a_Data;
+  m_size = a_Size;
+  m_sections.clear();
+  m_traits.clear();
+  m_version = a_Version;
+  m_pos = 0;
+  m_end = a_Size;
+}
+
+bool CheckpointReader::IsCheckpoint(const char *a_FileName) {
+  FILE *t_file = fopen(a_FileName, "rb");
+  if (!t_file) {
+    return false;
+  }
+
+  char t_magic[8];
+  bool t_is = (fread(t_magic, 1, 8, t_file) == 8) &&
+              (std::memcmp(t_magic, CHECKPOINT_MAGIC, 8) == 0);
+  fclose(t_file);
+  return t_is;
+}
+
+bool CheckpointReader::HasSection(uint32_t a_ID) const {
+  for (unsigned int i = 0; i < m_sections.size(); i++) {
+    if (m_sections[i].m_id == a_ID) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void CheckpointReader::BeginSection(uint32_t a_ID) {
+  for (unsigned int i = 0; i < m_sections.size(); i++) {
+    if (m_sections[i].m_id == a_ID) {
+      m_pos = m_sections[i].m_offset;
+      m_end = m_sections[i].m_offset + m_sections[i].m_size;
+      return;
+    }
+  }
+  throw std::runtime_error("Checkpoint section is missing");
+}
+
+void CheckpointReader::GetSection(uint32_t a_ID, const char *&a_Data,
+                                  size_t &a_Size) const {
+  for (unsigned int i = 0; i < m_sections.size(); i++) {
+    if (m_sections[i].m_id == a_ID) {
+      a_Data = m_data + m_sections[i].m_offset;
+      a_Size = m_sections[i].m_size;
+      return;
+    }
+  }
+  throw std::runtime_error("Checkpoint section is missing");
+}
+
+std::string CheckpointReader::GetString() {
+  uint64_t t_size = Get<uint64_t>();
+  Need(t_size);
+  std::string t_str(m_data + m_pos, t_size);
+  m_pos += t_size;
+  return t_str;
+}
+
+TraitType CheckpointReader::GetTrait() { return GetTraitValue(Get<int32_t>()); }
+
+TraitType CheckpointReader::GetTraitValue(int a_Type) {
+  TraitType t_value;
+  switch (a_Type) {
+  case 0:
+    t_value = Get<int>();
+    break;
+  case 1:
+    t_value = Get<double>();
+    break;
+  case 2:
+    t_value = GetString();
+    break;
+  case 3: {
+    intsetelement t_e;
+    t_e.value = Get<int>();
+    t_value = t_e;
+    break;
+  }
+  case 4: {
+    floatsetelement t_e;
+    t_e.value = Get<double>();
+    t_value = t_e;
+    break;
+  }
+  default:
+    throw std::runtime_error("Unknown trait type in checkpoint");
+  }
+  return t_value;
+}
+
+void CheckpointReader::GetTraits(std::map<std::string, Trait> &a_Traits) {
+  a_Traits.clear();
+  if (m_version >= 2) {
+    uint32_t t_count = Get<uint32_t>();
+    for (uint32_t i = 0; i < t_count; i++) {
+      uint32_t t_kind = Get<uint32_t>();
+      if (t_kind >= m_traits.size()) {
+        throw std::runtime_error("Unknown kind of trait in checkpoint");
+      }
+      Trait &t_tr = a_Traits[m_traits.entries[t_kind].name];
+      m_traits.Apply(t_kind, t_tr);
+      t_tr.value = GetTraitValue(m_traits.entries[t_kind].type);
+    }
+    return;
+  }
+
+  uint64_t t_count = Get<uint64_t>();
+  for (uint64_t i = 0; i < t_count; i++) {
+    std::string t_name = GetString();
+    Trait &t_tr = a_Traits[t_name];
+    t_tr.value = GetTrait();
+    t_tr.dep_key = GetString();
+    t_tr.dep_values.clear();
+    uint64_t t_deps = Get<uint64_t>();
+    for (uint64_t j = 0; j < t_deps; j++) {
+      t_tr.dep_values.push_back(GetTrait());
+    }
+  }
+}
+
+void CheckpointReader::GetTraitSchema() {
+  m_traits.clear();
+  if (m_version < 2) {
+    return;
+  }
+
+  uint32_t t_count = Get<uint32_t>();
+  for (uint32_t i = 0; i < t_count; i++) {
+    TraitSchema::Entry t_e;
+    t_e.name = GetString();
+    t_e.type = Get<int32_t>();
+    if ((t_e.type < 0) || (t_e.type > 4)) {
+      throw std::runtime_error("Unknown trait type in checkpoint");
+    }
+    t_e.dep_key = GetString();
+    uint64_t t_deps = Get<uint64_t>();
+    for (uint64_t j = 0; j < t_deps; j++) {
+      t_e.dep_values.push_back(GetTrait());
+    }
+    m_traits.entries.push_back(t_e);
+  }
+}
+
+void CheckpointReader::GetTraitParameters(
+    std::map<std::string, TraitParameters> &a_Params) {
+  a_Params.clear();
+  uint64_t t_count = Get<uint64_t>();
+  for (uint64_t i = 0; i < t_count; i++) {
+    std::string t_name = GetString();
+    TraitParameters &t_tp = a_Params[t_name];
+
+    Get(t_tp.m_ImportanceCoeff);
+    Get(t_tp.m_MutationProb);
+    t_tp.type = GetString();
+
+    switch (Get<int32_t>()) {
+    case 0: {
+      IntTraitParameters t_d;
+      Get(t_d.min);
+      Get(t_d.max);
+      Get(t_d.mut_power);
+      Get(t_d.mut_replace_prob);
+      t_tp.m_Details = t_d;
+      break;
+    }
+    case 1: {
+      FloatTraitParameters t_d;
+      Get(t_d.min);
+      Get(t_d.max);
+      Get(t_d.mut_power);
+      Get(t_d.mut_replace_prob);
+      t_tp.m_Details = t_d;
+      break;
+    }
+    case 2: {
+      StringTraitParameters t_d;
+      uint64_t t_size = Get<uint64_t>();
+      for (uint64_t j = 0; j < t_size; j++) {
+        t_d.set.push_back(GetString());
+      }
+      GetVector(t_d.probs);
+      t_tp.m_Details = t_d;
+      break;
+    }
+    case 3: {
+      IntSetTraitParameters t_d;
+      GetVector(t_d.set);
+      GetVector(t_d.probs);
+      t_tp.m_Details = t_d;
+      break;
+    }
+    case 4: {
+      FloatSetTraitParameters t_d;
+      GetVector(t_d.set);
+      GetVector(t_d.probs);
+      t_tp.m_Details = t_d;
+      break;
+    }
+    default:
+      throw std::runtime_error("Unknown trait parameters in checkpoint");
+    }
+
+    t_tp.dep_key = GetString();
+    t_tp.dep_values.clear();
+    uint64_t t_deps = Get<uint64_t>();
+    for (uint64_t j = 0; j < t_deps; j++) {
+      t_tp.dep_values.push_back(GetTrait());
+    }
+  }
+}
+
+////////////////////////////
+// Replacing files
+////////////////////////////
+
+// Makes sure that what was written to a_File reached the disk
+static bool SyncFile(FILE *a_File) {
+  if (fflush(a_File) != 0) {
+    return false;
+  }
+#ifdef _WIN32
+  return _commit(_fileno(a_File)) == 0;
+#else
+  return fsync(fileno(a_File)) == 0;
+#endif
+}
+
+// Makes a rename in the directory of a_FileName last. Only needed, and
+// possible, on POSIX systems.
+static void SyncDirectory(const std::string &a_FileName) {
+#ifndef _WIN32
+  std::string t_dir = std::filesystem::path(a_FileName).parent_path().string();
+  int t_fd = open(t_dir.empty() ? "." : t_dir.c_str(), O_RDONLY);
+  if (t_fd >= 0) {
+    fsync(t_fd);
+    close(t_fd);
+  }
+#endif
+}
+
+// The ID of this process, for temporary names
+static long ProcessID() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return getpid();
+#endif
+}
+
+ReplacementFile::ReplacementFile(const char *a_FileName, const char *a_Mode)
+    : m_name(a_FileName) {
+  // Writers in this and other processes each get a name of their own. The
+  // file is only created if there is none of that name, so a left over one
+  // is never written into.
+  static std::atomic<unsigned long> s_counter(0);
+  m_temp = m_name + "." + std::to_string(ProcessID()) + "." +
+           std::to_string(s_counter++) + ".tmp";
+  m_file = fopen(m_temp.c_str(), (std::string(a_Mode) + "x").c_str());
+}
+
+ReplacementFile::~ReplacementFile() {
+  if (m_file) {
+    fclose(m_file);
+    remove(m_temp.c_str());
+  }
+}
+
+bool ReplacementFile::Commit() {
+  if (!m_file) {
+    return false;
+  }
+
+  // a write that failed earlier leaves the error flag of the stream set
+  bool t_ok = (ferror(m_file) == 0) && SyncFile(m_file);
+  t_ok = (fclose(m_file) == 0) && t_ok;
+  m_file = NULL;
+
+  if (t_ok) {
+    std::error_code t_error;
+    std::filesystem::rename(m_temp, m_name, t_error);
+    t_ok = !t_error;
+  }
+  if (!t_ok) {
+    remove(m_temp.c_str());
+    return false;
+  }
+
+  SyncDirectory(m_name);
+  return true;
+}
+
+////////////////////////////
+// Background writer
+////////////////////////////
+
+AsyncCheckpointWriter::AsyncCheckpointWriter()
+    : m_writing(false), m_stop(false), m_failed(false), m_written(0),
+      m_dropped(0) {
+  m_thread = std::thread(&AsyncCheckpointWriter::Run, this);
+}
+
+AsyncCheckpointWriter::~AsyncCheckpointWriter() {
+  {
+    std::lock_guard<std::mutex> t_lock(m_mutex);
+    m_stop = true;
+  }
+  m_queued.notify_one();
+  m_thread.join();
+}
+
+void AsyncCheckpointWriter::Write(CheckpointWriter &&a_Checkpoint,
+                                  const char *a_FileName) {
+  {
+    std::lock_guard<std::mutex> t_lock(m_mutex);
+    // a newer checkpoint of the same file makes the waiting one useless
+    for (auto t_it = m_jobs.begin(); t_it != m_jobs.end(); t_it++) {
+      if (t_it->m_file == a_FileName) {
+        m_jobs.erase(t_it);
+        m_dropped++;
+        break;
+      }
+    }
+    m_jobs.emplace_back();
+    m_jobs.back().m_checkpoint = std::move(a_Checkpoint);
+    m_jobs.back().m_file = a_FileName;
+  }
+  m_queued.notify_one();
+}
+
+void AsyncCheckpointWriter::Run() {
+  std::unique_lock<std::mutex> t_lock(m_mutex);
+  for (;;) {
+    m_queued.wait(t_lock, [this] { return m_stop || !m_jobs.empty(); });
+    if (m_jobs.empty()) {
+      return;
+    }
+
+    Job t_job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    m_writing = true;
+
+    t_lock.unlock();
+    bool t_ok = t_job.m_checkpoint.Write(t_job.m_file.c_str());
+    t_lock.lock();
+
+    m_writing = false;
+    if (t_ok) {
+      m_written++;
+    } else {
+      m_failed = true;
+    }
+    m_done.notify_all();
+  }
+}
+
+bool AsyncCheckpointWriter::Wait() {
+  std::unique_lock<std::mutex> t_lock(m_mutex);
+  m_done.wait(t_lock, [this] { return m_jobs.empty() && !m_writing; });
+  bool t_ok = !m_failed;
+  m_failed = false;
+  return t_ok;
+}
+
+unsigned int AsyncCheckpointWriter::NumWritten() {
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+  return m_written;
+}
+
+unsigned int AsyncCheckpointWriter::NumDropped() {
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+  return m_dropped;
+}
+
+} // namespace NEAT
@@ -0,0 +1,335 @@
+#ifndef _CHECKPOINT_H
+#define _CHECKPOINT_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        Checkpoint.hh
+// Description: Binary checkpoint files of populations.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Traits.hh>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace NEAT {
+
+// A checkpoint file starts with a header
+//
+//   char[8]   "MNEATCKP"
+//   uint32    format version
+//   uint32    byte order mark, 0x01020304 as written
+//   uint32    number of sections
+//   uint32    reserved
+//
+// followed by a table of sections
+//
+//   uint32    section ID
+//   uint32    reserved
+//   uint64    offset of the section from the start of the file
+//   uint64    size of the section in bytes
+//
+// and the sections themselves. Values are stored in the byte order of the
+// machine that wrote the file.
+//
+// Version 2 writes the name, type and dependency of each kind of trait once,
+// in the traits section, and genes only the index of the kind and the value.
+// Version 1 wrote all of them with every gene.
+const unsigned int CHECKPOINT_VERSION = 2;
+
+enum CheckpointSection {
+  CHECKPOINT_PARAMETERS = 1,
+  CHECKPOINT_INNOVATIONS = 2,
+  CHECKPOINT_SPECIES = 3,
+  CHECKPOINT_POPULATION = 4,
+  CHECKPOINT_TRAITS = 5
+};
+
+// Keeps genomes out of line. When a writer or a reader has a table, every
+// genome in the checkpoint is stored as a reference into it followed by its
+// ID and evaluation, and the table holds the genes. Run logs (RunLog.hh) use
+// this to write each distinct set of genes only once.
+class CheckpointGenomeTable {
+public:
+  virtual ~CheckpointGenomeTable() {}
+
+  // Keeps the a_Size bytes of a genome and returns their reference
+  virtual uint32_t Store(const char *a_Data, size_t a_Size) = 0;
+
+  // The bytes kept under a_Ref. Throws std::runtime_error if there are none.
+  virtual const std::vector<char> &Find(uint32_t a_Ref) const = 0;
+};
+
+// Collects the sections of a checkpoint in memory and writes them out at once
+class CheckpointWriter {
+  struct Section {
+    uint32_t m_id;
+    uint64_t m_offset;
+    uint64_t m_size;
+  };
+
+  std::vector<char> m_data;
+  std::vector<Section> m_sections;
+  CheckpointGenomeTable *m_genomes;
+  // the kinds of traits written so far
+  TraitSchema m_traits;
+
+  // the header and the section table into a_Bytes, and the sections that
+  // follow m_data into a_Tail
+  void GetHeader(std::vector<char> &a_Bytes, std::vector<char> &a_Tail) const;
+
+public:
+  CheckpointWriter() : m_genomes(NULL) {}
+
+  // Genomes written from now on go to a_Table, NULL writes them inline
+  void SetGenomeTable(CheckpointGenomeTable *a_Table) { m_genomes = a_Table; }
+  CheckpointGenomeTable *GetGenomeTable() const { return m_genomes; }
+
+  // Everything written between these two calls belongs to the section
+  void BeginSection(uint32_t a_ID);
+  void EndSection();
+
+  template <typename T> void Put(const T &a_Value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be written directly");
+    size_t t_pos = m_data.size();
+    m_data.resize(t_pos + sizeof(T));
+    std::memcpy(m_data.data() + t_pos, &a_Value, sizeof(T));
+  }
+
+  template <typename T> void PutVector(const std::vector<T> &a_Values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be written directly");
+    Put(static_cast<uint64_t>(a_Values.size()));
+    const char *t_bytes = reinterpret_cast<const char *>(a_Values.data());
+    m_data.insert(m_data.end(), t_bytes, t_bytes + a_Values.size() * sizeof(T));
+  }
+
+  // Writes a_Size bytes as they are, without a length
+  void PutBytes(const char *a_Data, size_t a_Size) {
+    m_data.insert(m_data.end(), a_Data, a_Data + a_Size);
+  }
+
+  void PutString(const std::string &a_Str);
+  void PutTrait(const TraitType &a_Value);
+  // Only the value, the type is known to the reader
+  void PutTraitValue(const TraitType &a_Value);
+  // The kinds of the traits go to the traits section, or to wherever
+  // PutTraitSchema() is called with GetTraitSchema()
+  void PutTraits(const std::map<std::string, Trait> &a_Traits);
+  void PutTraitSchema(const TraitSchema &a_Schema);
+  const TraitSchema &GetTraitSchema() const { return m_traits; }
+  void PutTraitParameters(
+      const std::map<std::string, TraitParameters> &a_Params);
+
+  // The complete file: header, section table and sections
+  void GetBytes(std::vector<char> &a_Bytes) const;
+
+  // Everything written so far, without header, section table and traits
+  const std::vector<char> &GetPayload() const { return m_data; }
+
+  // Returns false if the file could not be written. The file is replaced
+  // at once, see ReplacementFile.
+  bool Write(const char *a_FileName) const;
+};
+
+// Reads a checkpoint from memory. Reading past the end of a section or
+// opening a malformed checkpoint throws std::runtime_error.
+class CheckpointReader {
+  struct Section {
+    uint32_t m_id;
+    uint64_t m_offset;
+    uint64_t m_size;
+  };
+
+  // owns the data when a file was opened
+  std::vector<char> m_buffer;
+
+  const char *m_data;
+  size_t m_size;
+  size_t m_pos, m_end;
+  unsigned int m_version;
+  std::vector<Section> m_sections;
+  const CheckpointGenomeTable *m_genomes;
+  TraitSchema m_traits;
+
+  void Need(size_t a_Bytes) const {
+    if (a_Bytes > m_end - m_pos) {
+      throw std::runtime_error("Checkpoint is truncated");
+    }
+  }
+
+public:
+  CheckpointReader();
+
+  // Reads a whole checkpoint file
+  void Open(const char *a_FileName);
+  // Reads a checkpoint from a_Size bytes at a_Data. The bytes are not copied
+  // and must outlive the reader.
+  void Open(const char *a_Data, size_t a_Size);
+  // Reads a_Size bytes written without header, like GetPayload() returns
+  // them, as if they were the current section of a checkpoint of version
+  // a_Version. Not copied either.
+  void Attach(const char *a_Data, size_t a_Size,
+              unsigned int a_Version = CHECKPOINT_VERSION);
+
+  // Returns true if the file starts like a checkpoint
+  static bool IsCheckpoint(const char *a_FileName);
+
+  // Genomes read from now on are looked up in a_Table, NULL reads them inline
+  void SetGenomeTable(const CheckpointGenomeTable *a_Table) {
+    m_genomes = a_Table;
+  }
+  const CheckpointGenomeTable *GetGenomeTable() const { return m_genomes; }
+
+  unsigned int GetVersion() const { return m_version; }
+  bool HasSection(uint32_t a_ID) const;
+
+  // Continues reading at the start of a section
+  void BeginSection(uint32_t a_ID);
+
+  // Points a_Data and a_Size at the raw bytes of a section
+  void GetSection(uint32_t a_ID, const char *&a_Data, size_t &a_Size) const;
+
+  template <typename T> void Get(T &a_Value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be read directly");
+    Need(sizeof(T));
+    std::memcpy(&a_Value, m_data + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+  }
+
+  template <typename T> T Get() {
+    T t_value;
+    Get(t_value);
+    return t_value;
+  }
+
+  template <typename T> void GetVector(std::vector<T> &a_Values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only plain values can be read directly");
+    uint64_t t_count = Get<uint64_t>();
+    if (t_count > (m_end - m_pos) / sizeof(T)) {
+      throw std::runtime_error("Checkpoint is truncated");
+    }
+    a_Values.resize(t_count);
+    std::memcpy(a_Values.data(), m_data + m_pos, t_count * sizeof(T));
+    m_pos += t_count * sizeof(T);
+  }
+
+  std::string GetString();
+  TraitType GetTrait();
+  // A value written with PutTraitValue(), a_Type is its which()
+  TraitType GetTraitValue(int a_Type);
+  void GetTraits(std::map<std::string, Trait> &a_Traits);
+  // Reads the kinds of traits written with PutTraitSchema(). Checkpoints
+  // before version 2 have none.
+  void GetTraitSchema();
+  void GetTraitParameters(std::map<std::string, TraitParameters> &a_Params);
+};
+
+// A file that takes the place of another only once it is complete. It is
+// written under a temporary name next to the target, unique to the process
+// and the object, and Commit() syncs it to disk and renames it over the
+// target, so that a crash leaves either the old file or the new one. Of
+// several writers of the same target, the last to commit wins.
+class ReplacementFile {
+  FILE *m_file;
+  std::string m_name;
+  std::string m_temp;
+
+public:
+  // Opens the temporary file with fopen() mode a_Mode
+  ReplacementFile(const char *a_FileName, const char *a_Mode = "wb");
+  // Removes the temporary file unless it was committed
+  ~ReplacementFile();
+
+  ReplacementFile(const ReplacementFile &) = delete;
+  ReplacementFile &operator=(const ReplacementFile &) = delete;
+
+  // NULL if the temporary file could not be opened
+  FILE *Get() const { return m_file; }
+
+  // Closes the file and replaces the target with it. Returns false if any
+  // of this or any write before it failed, in which case the target is left
+  // as it was.
+  bool Commit();
+};
+
+// Writes checkpoints on a thread of its own, so that evolution only waits
+// for the population to be serialized into memory. Checkpoints are written
+// in the order they come. One that is still waiting when another for the
+// same file comes is dropped.
+class AsyncCheckpointWriter {
+  struct Job {
+    CheckpointWriter m_checkpoint;
+    std::string m_file;
+  };
+
+  std::mutex m_mutex;
+  std::condition_variable m_queued; // signals the thread
+  std::condition_variable m_done;   // signals Wait()
+  std::deque<Job> m_jobs;
+  bool m_writing;
+  bool m_stop;
+  bool m_failed;
+  unsigned int m_written;
+  unsigned int m_dropped;
+  std::thread m_thread;
+
+  void Run();
+
+public:
+  AsyncCheckpointWriter();
+  // Writes the checkpoints still waiting, then stops the thread
+  ~AsyncCheckpointWriter();
+
+  AsyncCheckpointWriter(const AsyncCheckpointWriter &) = delete;
+  AsyncCheckpointWriter &operator=(const AsyncCheckpointWriter &) = delete;
+
+  // Takes over the contents of a_Checkpoint and writes them to a_FileName
+  void Write(CheckpointWriter &&a_Checkpoint, const char *a_FileName);
+
+  // Blocks until all checkpoints are written. Returns false if any of them
+  // could not be since the last call.
+  bool Wait();
+
+  unsigned int NumWritten();
+  unsigned int NumDropped();
+};
+
+} // namespace NEAT
+
+#endif
@@ -0,0 +1,245 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        CompactNetwork.cc
+// Description: Implementation of the compact inference network.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Activation.hh>
+#include <MultiNEAT/CompactNetwork.hh>
+#include <algorithm>
+
+namespace NEAT {
+
+template <typename Real>
+CompactNetwork<Real>::CompactNetwork() {
+  m_spans.m_num_inputs = 0;
+  m_spans.m_num_outputs = 0;
+  UseOwn();
+}
+
+template <typename Real>
+CompactNetwork<Real>::CompactNetwork(const NeuralNetwork &a_Net) {
+  Build(a_Net);
+}
+
+template <typename Real>
+CompactNetwork<Real>::CompactNetwork(const CompactNetwork &a_Other) {
+  *this = a_Other;
+}
+
+// The borrowed arrays are shared, the own ones copied
+template <typename Real>
+CompactNetwork<Real> &
+CompactNetwork<Real>::operator=(const CompactNetwork &a_Other) {
+  if (this != &a_Other) {
+    m_own_source = a_Other.m_own_source;
+    m_own_target = a_Other.m_own_target;
+    m_own_weight = a_Other.m_own_weight;
+    m_own_a = a_Other.m_own_a;
+    m_own_b = a_Other.m_own_b;
+    m_own_bias = a_Other.m_own_bias;
+    m_own_timeconst = a_Other.m_own_timeconst;
+    m_own_activation_function_type = a_Other.m_own_activation_function_type;
+    m_activesum = a_Other.m_activesum;
+    m_activation = a_Other.m_activation;
+    m_membrane_potential = a_Other.m_membrane_potential;
+
+    m_spans = a_Other.m_spans;
+    m_borrowed = a_Other.m_borrowed;
+    if (!m_borrowed) {
+      UseOwn();
+    }
+  }
+  return *this;
+}
+
+template <typename Real> void CompactNetwork<Real>::UseOwn() {
+  m_borrowed = false;
+  m_spans.m_num_neurons = m_own_a.size();
+  m_spans.m_num_connections = m_own_weight.size();
+  m_spans.m_source = m_own_source.data();
+  m_spans.m_target = m_own_target.data();
+  m_spans.m_weight = m_own_weight.data();
+  m_spans.m_a = m_own_a.data();
+  m_spans.m_b = m_own_b.data();
+  m_spans.m_bias = m_own_bias.data();
+  m_spans.m_timeconst = m_own_timeconst.data();
+  m_spans.m_activation_function_type = m_own_activation_function_type.data();
+}
+
+template <typename Real>
+void CompactNetwork<Real>::Build(const NeuralNetwork &a_Net) {
+  m_spans.m_num_inputs = a_Net.NumInputs();
+  m_spans.m_num_outputs = a_Net.NumOutputs();
+
+  const unsigned int t_num_conns = a_Net.m_connections.size();
+  m_own_source.resize(t_num_conns);
+  m_own_target.resize(t_num_conns);
+  m_own_weight.resize(t_num_conns);
+  for (unsigned int i = 0; i < t_num_conns; i++) {
+    const Connection &t_c = a_Net.m_connections[i];
+    m_own_source[i] = t_c.m_source_neuron_idx;
+    m_own_target[i] = t_c.m_target_neuron_idx;
+    m_own_weight[i] = static_cast<Real>(t_c.m_weight);
+  }
+
+  const unsigned int t_num_neurons = a_Net.m_neurons.size();
+  m_activesum.resize(t_num_neurons);
+  m_activation.resize(t_num_neurons);
+  m_membrane_potential.resize(t_num_neurons);
+  m_own_a.resize(t_num_neurons);
+  m_own_b.resize(t_num_neurons);
+  m_own_bias.resize(t_num_neurons);
+  m_own_timeconst.resize(t_num_neurons);
+  m_own_activation_function_type.resize(t_num_neurons);
+  for (unsigned int i = 0; i < t_num_neurons; i++) {
+    const NeuronState &t_n = a_Net.m_neurons[i];
+    m_activesum[i] = static_cast<Real>(t_n.m_activesum);
+    m_activation[i] = static_cast<Real>(t_n.m_activation);
+    m_membrane_potential[i] = static_cast<Real>(t_n.m_membrane_potential);
+    m_own_a[i] = static_cast<Real>(t_n.m_a);
+    m_own_b[i] = static_cast<Real>(t_n.m_b);
+    m_own_bias[i] = static_cast<Real>(t_n.m_bias);
+    m_own_timeconst[i] = static_cast<Real>(t_n.m_timeconst);
+    m_own_activation_function_type[i] = t_n.m_activation_function_type;
+  }
+
+  UseOwn();
+}
+
+template <typename Real>
+void CompactNetwork<Real>::Borrow(const CompactNetworkSpans<Real> &a_Spans) {
+  m_spans = a_Spans;
+  m_borrowed = true;
+
+  m_own_source.clear();
+  m_own_target.clear();
+  m_own_weight.clear();
+  m_own_a.clear();
+  m_own_b.clear();
+  m_own_bias.clear();
+  m_own_timeconst.clear();
+  m_own_activation_function_type.clear();
+
+  m_activesum.assign(a_Spans.m_num_neurons, Real(0));
+  m_activation.assign(a_Spans.m_num_neurons, Real(0));
+  m_membrane_potential.assign(a_Spans.m_num_neurons, Real(0));
+}
+
+template <typename Real> void CompactNetwork<Real>::Propagate() {
+  const uint32_t *t_source = m_spans.m_source;
+  const uint32_t *t_target = m_spans.m_target;
+  const Real *t_weight = m_spans.m_weight;
+  const Real *t_activation = m_activation.data();
+  Real *t_activesum = m_activesum.data();
+
+  // Activations only change after all signals are in, so one pass is enough
+  for (unsigned int i = 0; i < m_spans.m_num_connections; i++) {
+    t_activesum[t_target[i]] += t_activation[t_source[i]] * t_weight[i];
+  }
+}
+
+template <typename Real> void CompactNetwork<Real>::Activate() {
+  Propagate();
+
+  // skip inputs since they do not get an activation
+  for (unsigned int i = m_spans.m_num_inputs; i < m_spans.m_num_neurons; i++) {
+    Real x = m_activesum[i];
+    m_activesum[i] = 0;
+    m_activation[i] =
+        af_apply(ActivationType(i), x, m_spans.m_a[i], m_spans.m_b[i]);
+  }
+}
+
+template <typename Real> void CompactNetwork<Real>::ActivateUseInternalBias() {
+  Propagate();
+
+  for (unsigned int i = m_spans.m_num_inputs; i < m_spans.m_num_neurons; i++) {
+    Real x = m_activesum[i] + m_spans.m_bias[i];
+    m_activesum[i] = 0;
+    m_activation[i] =
+        af_apply(ActivationType(i), x, m_spans.m_a[i], m_spans.m_b[i]);
+  }
+}
+
+template <typename Real>
+void CompactNetwork<Real>::ActivateLeaky(Real a_dtime) {
+  Propagate();
+
+  // the leaky integrator step, then the activation function
+  for (unsigned int i = m_spans.m_num_inputs; i < m_spans.m_num_neurons; i++) {
+    Real t_const = a_dtime / m_spans.m_timeconst[i];
+    m_membrane_potential[i] = (Real(1.0) - t_const) * m_membrane_potential[i] +
+                              t_const * m_activesum[i];
+  }
+  for (unsigned int i = m_spans.m_num_inputs; i < m_spans.m_num_neurons; i++) {
+    Real x = m_membrane_potential[i] + m_spans.m_bias[i];
+    m_activesum[i] = 0;
+    m_activation[i] =
+        af_apply(ActivationType(i), x, m_spans.m_a[i], m_spans.m_b[i]);
+  }
+}
+
+template <typename Real> void CompactNetwork<Real>::Flush() {
+  std::fill(m_activesum.begin(), m_activesum.end(), Real(0));
+  std::fill(m_activation.begin(), m_activation.end(), Real(0));
+  std::fill(m_membrane_potential.begin(), m_membrane_potential.end(),
+            Real(0));
+}
+
+template <typename Real>
+void CompactNetwork<Real>::Input(const std::vector<double> &a_Inputs) {
+  Input(a_Inputs.data(), a_Inputs.size());
+}
+
+template <typename Real>
+void CompactNetwork<Real>::Input(const double *a_Inputs, size_t a_Count) {
+  size_t mx = std::min(a_Count, static_cast<size_t>(m_spans.m_num_inputs));
+  for (size_t i = 0; i < mx; i++) {
+    m_activation[i] = static_cast<Real>(a_Inputs[i]);
+  }
+}
+
+template <typename Real>
+std::vector<double> CompactNetwork<Real>::Output() const {
+  std::vector<double> t_output(m_spans.m_num_outputs);
+  OutputInto(t_output.data(), t_output.size());
+  return t_output;
+}
+
+template <typename Real>
+void CompactNetwork<Real>::OutputInto(double *a_Outputs,
+                                      size_t a_Count) const {
+  size_t mx = std::min(a_Count, static_cast<size_t>(m_spans.m_num_outputs));
+  for (size_t i = 0; i < mx; i++) {
+    a_Outputs[i] = m_activation[i + m_spans.m_num_inputs];
+  }
+}
+
+template class CompactNetwork<float>;
+template class CompactNetwork<double>;
+
+} // namespace NEAT
@@ -0,0 +1,127 @@
+#ifndef _COMPACTNETWORK_H
+#define _COMPACTNETWORK_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        CompactNetwork.hh
+// Description: An inference-only copy of a NeuralNetwork in a chosen
+//              floating point precision.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <cstdint>
+#include <vector>
+
+namespace NEAT {
+
+// The structure and parameters of a CompactNetwork as arrays it does not own,
+// m_num_connections long for the connections and m_num_neurons long for the
+// neurons. The indices and activation function types must be valid.
+template <typename Real> struct CompactNetworkSpans {
+  unsigned int m_num_inputs, m_num_outputs;
+  unsigned int m_num_neurons, m_num_connections;
+
+  const uint32_t *m_source;
+  const uint32_t *m_target;
+  const Real *m_weight;
+  const Real *m_a, *m_b, *m_bias, *m_timeconst;
+  const int32_t *m_activation_function_type;
+};
+
+// Holds the weights, the neuron parameters and the state of a NeuralNetwork as
+// flat arrays of Real. It activates the same way the source network does, so
+// CompactNetwork<float> is a single precision version of it and
+// CompactNetwork<double> reproduces it exactly.
+// Learning (RTRL, Hebbian) stays with NeuralNetwork.
+template <typename Real> class CompactNetwork {
+  // the arrays activation runs on, the m_own_ ones or borrowed ones
+  CompactNetworkSpans<Real> m_spans;
+  bool m_borrowed;
+
+  // what Build() copies a network into
+  std::vector<uint32_t> m_own_source;
+  std::vector<uint32_t> m_own_target;
+  std::vector<Real> m_own_weight;
+  std::vector<Real> m_own_a, m_own_b, m_own_bias;
+  std::vector<Real> m_own_timeconst;
+  std::vector<int32_t> m_own_activation_function_type;
+
+  // state
+  std::vector<Real> m_activesum;
+  std::vector<Real> m_activation;
+  std::vector<Real> m_membrane_potential;
+
+  // points m_spans at the m_own_ arrays
+  void UseOwn();
+
+  ActivationFunction ActivationType(unsigned int a_idx) const {
+    return static_cast<ActivationFunction>(
+        m_spans.m_activation_function_type[a_idx]);
+  }
+
+  // adds the weighted signals of all connections to m_activesum
+  void Propagate();
+
+public:
+  CompactNetwork();
+  explicit CompactNetwork(const NeuralNetwork &a_Net);
+  CompactNetwork(const CompactNetwork &a_Other);
+  CompactNetwork(CompactNetwork &&) = default;
+  CompactNetwork &operator=(const CompactNetwork &a_Other);
+  CompactNetwork &operator=(CompactNetwork &&) = default;
+
+  // copies the structure, parameters and state of a_Net
+  void Build(const NeuralNetwork &a_Net);
+
+  // runs on a_Spans in place, with all activations zero. The arrays must
+  // outlive the network, or its next Build() or Borrow().
+  void Borrow(const CompactNetworkSpans<Real> &a_Spans);
+
+  void Activate();                // like NeuralNetwork::Activate()
+  void ActivateUseInternalBias(); // like Activate() but uses the bias as well
+  void ActivateLeaky(Real a_dtime); // activates in leaky integrator mode
+
+  void Flush(); // clears all activations
+
+  void Input(const std::vector<double> &a_Inputs);
+  void Input(const double *a_Inputs, size_t a_Count);
+  std::vector<double> Output() const;
+  void OutputInto(double *a_Outputs, size_t a_Count) const;
+
+  unsigned int NumInputs() const { return m_spans.m_num_inputs; }
+  unsigned int NumOutputs() const { return m_spans.m_num_outputs; }
+  unsigned int NumNeurons() const { return m_spans.m_num_neurons; }
+  unsigned int NumConnections() const { return m_spans.m_num_connections; }
+};
+
+typedef CompactNetwork<float> FloatNetwork;
+
+extern template class CompactNetwork<float>;
+extern template class CompactNetwork<double>;
+
+} // namespace NEAT
+
+#endif
@@ -28,20 +28,25 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <algorithm>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics/stats.hpp>
-#include <boost/accumulators/statistics/variance.hpp>
-#include <boost/shared_ptr.hpp>
-#include <boost/unordered_map.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/atomic.hpp>
+#include <condition_variable>
 #include <fstream>
 #include <math.h>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include <utility>
 
 #include <MultiNEAT/Assert.hh>
+#include <MultiNEAT/Checkpoint.hh>
 #include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/MappedFile.hh>
 #include <MultiNEAT/Parameters.hh>
 #include <MultiNEAT/Random.hh>
+#include <MultiNEAT/Stats.hh>
+#include <MultiNEAT/TextIO.hh>
 #include <MultiNEAT/Utils.hh>
 
 namespace NEAT {
@@ -86,6 +91,8 @@ Genome::Genome(const Genome &a_G) {
   m_PhenotypeBehavior = a_G.m_PhenotypeBehavior;
   m_initial_num_neurons = a_G.m_initial_num_neurons;
   m_initial_num_links = a_G.m_initial_num_links;
+  m_PhenotypeChanges = a_G.m_PhenotypeChanges;
+  m_PhenotypeStamp.Share(a_G.m_PhenotypeStamp);
 }
 
 // assignment operator
@@ -106,6 +113,8 @@ Genome &Genome::operator=(const Genome &a_G) {
     m_PhenotypeBehavior = a_G.m_PhenotypeBehavior;
     m_initial_num_neurons = a_G.m_initial_num_neurons;
     m_initial_num_links = a_G.m_initial_num_links;
+    m_PhenotypeChanges = a_G.m_PhenotypeChanges;
+    m_PhenotypeStamp.Share(a_G.m_PhenotypeStamp);
   }
 
   return *this;
@@ -623,7 +632,7 @@ bool Genome::HasLink(int a_n1id, int a_n2id) const {
 
 bool Genome::HasLoops() {
   NeuralNetwork net;
-  BuildPhenotype(net);
+  BuildNetwork(net, false);
   bool has_cycles = false;
 
   // convert the net to a Boost::Graph object
@@ -659,6 +668,22 @@ bool Genome::HasLinkByInnovID(int id) const {
 
 // This builds a fastnetwork structure out from the genome
 void Genome::BuildPhenotype(NeuralNetwork &a_Net) {
+  NEAT_STAT(double t_start = StatsClock());
+  BuildNetwork(a_Net, true);
+  NEAT_STAT(CountPhenotypeBuild(StatsClock() - t_start));
+
+  // Note however that the RTRL variables are not initialized.
+  // The user must manually call the InitRTRLMatrix() method to do it.
+  // This is because of storage issues. RTRL need not to be used every time.
+}
+
+void Genome::BuildLeanPhenotype(NeuralNetwork &a_Net) {
+  NEAT_STAT(double t_start = StatsClock());
+  BuildNetwork(a_Net, false);
+  NEAT_STAT(CountPhenotypeBuild(StatsClock() - t_start));
+}
+
+void Genome::BuildNetwork(NeuralNetwork &a_Net, bool a_Metadata) {
   // first clear out the network
   a_Net.Clear();
   a_Net.SetInputOutputDimentions(m_NumInputs, m_NumOutputs);
@@ -672,7 +697,9 @@ void Genome::BuildPhenotype(NeuralNetwork &a_Net) {
     t_n.m_timeconst = m_NeuronGenes[i].m_TimeConstant;
     t_n.m_bias = m_NeuronGenes[i].m_Bias;
     t_n.m_activation_function_type = m_NeuronGenes[i].m_ActFunction;
-    t_n.m_split_y = m_NeuronGenes[i].SplitY();
+    if (a_Metadata) {
+      t_n.m_split_y = m_NeuronGenes[i].SplitY();
+    }
     t_n.m_type = m_NeuronGenes[i].Type();
 
     a_Net.AddNeuron(t_n);
@@ -687,40 +714,139 @@ void Genome::BuildPhenotype(NeuralNetwork &a_Net) {
     t_c.m_weight = m_LinkGenes[i].GetWeight();
     t_c.m_recur_flag = m_LinkGenes[i].IsRecurrent();
 
-    //////////////////////
-    // default values
-    t_c.m_hebb_rate = 0.3;
-    t_c.m_hebb_pre_rate = 0.1;
+    GetHebbRates(i, t_c.m_hebb_rate, t_c.m_hebb_pre_rate);
 
-    // if a float trait "hebb_rate" exists
-    if (m_LinkGenes[i].m_Traits.count("hebb_rate") == 1) {
-      try {
-        t_c.m_hebb_rate =
-            boost::get<double>(m_LinkGenes[i].m_Traits["hebb_rate"].value);
-      } catch (std::exception e) {
-        // do nothing
-      }
+    a_Net.AddConnection(t_c);
+  }
+
+  a_Net.Flush();
+  m_PhenotypeChanges = CHANGED_NONE;
+  m_PhenotypeStamp.Renew(a_Net.m_stamp);
+}
+
+void Genome::GetHebbRates(unsigned int a_LinkIdx, double &a_Rate,
+                          double &a_PreRate) const {
+  //////////////////////
+  // default values
+  a_Rate = 0.3;
+  a_PreRate = 0.1;
+
+  const std::map<std::string, Trait> &t_traits =
+      m_LinkGenes[a_LinkIdx].m_Traits;
+  if (t_traits.empty()) {
+    return;
+  }
+
+  // if a float trait "hebb_rate" exists
+  auto t_it = t_traits.find("hebb_rate");
+  if (t_it != t_traits.end()) {
+    try {
+      a_Rate = boost::get<double>(t_it->second.value);
+    } catch (std::exception e) {
+      // do nothing
     }
-    // if a float trait "hebb_pre_rate" exists
-    if (m_LinkGenes[i].m_Traits.count("hebb_pre_rate") == 1) {
-      try {
-        t_c.m_hebb_pre_rate =
-            boost::get<double>(m_LinkGenes[i].m_Traits["hebb_pre_rate"].value);
-      } catch (std::exception e) {
-        // do nothing
-      }
+  }
+  // if a float trait "hebb_pre_rate" exists
+  t_it = t_traits.find("hebb_pre_rate");
+  if (t_it != t_traits.end()) {
+    try {
+      a_PreRate = boost::get<double>(t_it->second.value);
+    } catch (std::exception e) {
+      // do nothing
     }
+  }
+}
 
-    //////////////////////
+bool Genome::PhenotypeMatches(const NeuralNetwork &a_Net) const {
+  if ((a_Net.NumInputs() != m_NumInputs) ||
+      (a_Net.NumOutputs() != m_NumOutputs) ||
+      (a_Net.m_neurons.size() != NumNeurons()) ||
+      (a_Net.m_connections.size() != NumLinks())) {
+    return false;
+  }
 
-    a_Net.AddConnection(t_c);
+  // neuron ID -> index, sorted by ID
+  std::vector<std::pair<int, int>> t_index(NumNeurons());
+  for (unsigned int i = 0; i < NumNeurons(); i++) {
+    if (a_Net.m_neurons[i].m_type != m_NeuronGenes[i].Type()) {
+      return false;
+    }
+    t_index[i] = std::make_pair(m_NeuronGenes[i].ID(), static_cast<int>(i));
+  }
+  std::sort(t_index.begin(), t_index.end());
+
+  auto t_lookup = [&t_index](int a_ID) {
+    auto t_it = std::lower_bound(t_index.begin(), t_index.end(),
+                                 std::make_pair(a_ID, -1));
+    return ((t_it != t_index.end()) && (t_it->first == a_ID)) ? t_it->second
+                                                               : -1;
+  };
+
+  for (unsigned int i = 0; i < NumLinks(); i++) {
+    const Connection &t_c = a_Net.m_connections[i];
+    if ((t_c.m_source_neuron_idx != t_lookup(m_LinkGenes[i].FromNeuronID())) ||
+        (t_c.m_target_neuron_idx != t_lookup(m_LinkGenes[i].ToNeuronID()))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Genome::RefreshPhenotype(NeuralNetwork &a_Net) {
+  if ((m_PhenotypeChanges & CHANGED_STRUCTURE) ||
+      !m_PhenotypeStamp.Matches(a_Net.m_stamp) || !PhenotypeMatches(a_Net)) {
+    // a net that was built lean stays lean
+    if (!a_Net.m_neurons.empty() && !a_Net.HasNeuronMetadata()) {
+      BuildLeanPhenotype(a_Net);
+    } else {
+      BuildPhenotype(a_Net);
+    }
+    return false;
+  }
+
+  // a patch counts as a build too, it is what the caller gets instead
+  NEAT_STAT(double t_start = StatsClock());
+
+  if (m_PhenotypeChanges & CHANGED_WEIGHTS) {
+    for (unsigned int i = 0; i < NumLinks(); i++) {
+      a_Net.m_connections[i].m_weight = m_LinkGenes[i].GetWeight();
+    }
+  }
+
+  if (m_PhenotypeChanges & CHANGED_NEURONS) {
+    for (unsigned int i = 0; i < NumNeurons(); i++) {
+      NeuronState &t_n = a_Net.m_neurons[i];
+      t_n.m_a = m_NeuronGenes[i].m_A;
+      t_n.m_b = m_NeuronGenes[i].m_B;
+      t_n.m_timeconst = m_NeuronGenes[i].m_TimeConstant;
+      t_n.m_bias = m_NeuronGenes[i].m_Bias;
+      t_n.m_activation_function_type = m_NeuronGenes[i].m_ActFunction;
+    }
+  }
+
+  if (m_PhenotypeChanges & CHANGED_TRAITS) {
+    for (unsigned int i = 0; i < NumLinks(); i++) {
+      GetHebbRates(i, a_Net.m_connections[i].m_hebb_rate,
+                   a_Net.m_connections[i].m_hebb_pre_rate);
+    }
   }
 
   a_Net.Flush();
+  m_PhenotypeChanges = CHANGED_NONE;
+  // copies that shared the old stamp no longer describe the net
+  m_PhenotypeStamp.Renew(a_Net.m_stamp);
+  NEAT_STAT(CountPhenotypeBuild(StatsClock() - t_start));
+  return true;
+}
 
-  // Note however that the RTRL variables are not initialized.
-  // The user must manually call the InitRTRLMatrix() method to do it.
-  // This is because of storage issues. RTRL need not to be used every time.
+// Builds the same network as above in single precision
+void Genome::BuildPhenotype(FloatNetwork &a_Net) {
+  NEAT_STAT(double t_start = StatsClock());
+  NeuralNetwork t_net;
+  BuildNetwork(t_net, false);
+  a_Net.Build(t_net);
+  NEAT_STAT(CountPhenotypeBuild(StatsClock() - t_start));
 }
 
 // Builds a HyperNEAT phenotype based on the substrate
@@ -733,6 +859,8 @@ void Genome::BuildPhenotype(NeuralNetwork &a_Net) {
 // substrate is leaky, [1] and [2] for time constants and biases Also assumes
 // the CPPN uses signed activation outputs
 void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
+  NEAT_STAT(double t_start = StatsClock());
+
   // We need a substrate with at least one input and output
   ASSERT(subst.m_input_coords.size() > 0);
   ASSERT(subst.m_output_coords.size() > 0);
@@ -797,7 +925,7 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
   // Begin querying the CPPN
   // Create the neural network that will represent the CPPN
   NeuralNetwork t_temp_phenotype(true);
-  BuildPhenotype(t_temp_phenotype);
+  BuildNetwork(t_temp_phenotype, false);
   t_temp_phenotype.Flush();
 
   // To ensure network relaxation
@@ -811,6 +939,9 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
   // weight
 
   // For leaky substrates, first loop over the neurons and set their properties
+  // The CPPN's inputs, reused by every query
+  std::vector<double> t_inputs(NumInputs());
+
   if (subst.m_leaky) {
     for (unsigned int i = net.NumInputs(); i < net.m_neurons.size(); i++) {
       // neuron specific stuff
@@ -819,12 +950,12 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
       // Inputs for the generation of time consts and biases across
       // the nodes in the substrate
       // We input only the position of the first node and ignore the other one
-      std::vector<double> t_inputs;
-      t_inputs.resize(NumInputs());
+      std::fill(t_inputs.begin(), t_inputs.end(), 0.0);
 
-      for (unsigned int n = 0; n < net.m_neurons[i].m_substrate_coords.size();
-           n++) {
-        t_inputs[n] = net.m_neurons[i].m_substrate_coords[n];
+      const std::vector<double> &t_coords =
+          net.m_neuron_meta[i].m_substrate_coords;
+      for (unsigned int n = 0; n < t_coords.size(); n++) {
+        t_inputs[n] = t_coords[n];
       }
 
       if (subst.m_with_distance) {
@@ -845,8 +976,9 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
         t_temp_phenotype.Activate();
       }
 
-      double t_tc = t_temp_phenotype.Output()[NumOutputs() - 2];
-      double t_bias = t_temp_phenotype.Output()[NumOutputs() - 1];
+      OutputView t_out = t_temp_phenotype.Outputs();
+      double t_tc = t_out[NumOutputs() - 2];
+      double t_bias = t_out[NumOutputs() - 1];
 
       Clamp(t_tc, -1, 1);
       Clamp(t_bias, -1, 1);
@@ -862,14 +994,15 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
   }
 
   // list of src_idx, dst_idx pairs of all connections to query
-  std::vector<std::vector<int>> t_to_query;
+  std::vector<std::pair<int, int>> t_to_query;
 
   // There isn't custom connectiviy scheme?
   if (subst.m_custom_connectivity.size() == 0) {
+    const int t_num_neurons = net.m_neurons.size();
     // only incoming connections, so loop only the hidden and output neurons
-    for (int i = net.NumInputs(); i < net.m_neurons.size(); i++) {
+    for (int i = net.NumInputs(); i < t_num_neurons; i++) {
       // loop all neurons
-      for (int j = 0; j < net.m_neurons.size(); j++) {
+      for (int j = 0; j < t_num_neurons; j++) {
         // this is connection "j" to "i"
 
         // conditions for canceling the CPPN query
@@ -910,10 +1043,7 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
         }
 
         // Save potential link to query
-        std::vector<int> t_link;
-        t_link.push_back(j);
-        t_link.push_back(i);
-        t_to_query.push_back(t_link);
+        t_to_query.push_back(std::make_pair(j, i));
       }
     }
   } else {
@@ -984,34 +1114,30 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
       }
 
       // Save potential link to query
-      std::vector<int> t_link;
-      t_link.push_back(j);
-      t_link.push_back(i);
-      t_to_query.push_back(t_link);
+      t_to_query.push_back(std::make_pair(j, i));
     }
   }
 
   // Query and create all links
   for (unsigned int conn = 0; conn < t_to_query.size(); conn++) {
-    int j = t_to_query[conn][0];
-    int i = t_to_query[conn][1];
+    int j = t_to_query[conn].first;
+    int i = t_to_query[conn].second;
 
     // Take the weight of this connection by querying the CPPN
     // as many times as deep (recurrent or looped CPPNs may be very slow!!!*)
-    std::vector<double> t_inputs;
-    t_inputs.resize(NumInputs());
+    std::fill(t_inputs.begin(), t_inputs.end(), 0.0);
 
-    int from_dims = net.m_neurons[j].m_substrate_coords.size();
-    int to_dims = net.m_neurons[i].m_substrate_coords.size();
+    int from_dims = net.m_neuron_meta[j].m_substrate_coords.size();
+    int to_dims = net.m_neuron_meta[i].m_substrate_coords.size();
 
     // input the node positions to the CPPN
     // from
     for (int n = 0; n < from_dims; n++) {
-      t_inputs[n] = net.m_neurons[j].m_substrate_coords[n];
+      t_inputs[n] = net.m_neuron_meta[j].m_substrate_coords[n];
     }
     // to
     for (int n = 0; n < to_dims; n++) {
-      t_inputs[max_dims + n] = net.m_neurons[i].m_substrate_coords[n];
+      t_inputs[max_dims + n] = net.m_neuron_meta[i].m_substrate_coords[n];
     }
 
     // the input is like
@@ -1047,11 +1173,12 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
     double t_link = 0;
     double t_weight = 0;
 
+    OutputView t_out = t_temp_phenotype.Outputs();
     if (subst.m_query_weights_only) {
-      t_weight = t_temp_phenotype.Output()[0];
+      t_weight = t_out[0];
     } else {
-      t_link = t_temp_phenotype.Output()[0];
-      t_weight = t_temp_phenotype.Output()[1];
+      t_link = t_out[0];
+      t_weight = t_out[1];
     }
 
     if (((t_link > 0) && (!subst.m_query_weights_only)) ||
@@ -1070,6 +1197,9 @@ void Genome::BuildHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst) {
       net.AddConnection(t_c);
     }
   }
+
+  // the CPPN build is part of this one
+  NEAT_STAT(CountPhenotypeBuild(StatsClock() - t_start));
 }
 
 // Projects the weight changes of a phenotype back to the genome.
@@ -1086,6 +1216,7 @@ void Genome::DerivePhenotypicChanges(NeuralNetwork &a_Net) {
   for (unsigned int i = 0; i < NumLinks(); i++) {
     m_LinkGenes[i].SetWeight(a_Net.GetConnectionByIndex(i).m_weight);
   }
+  m_PhenotypeChanges |= CHANGED_WEIGHTS;
 
   // TODO: if neuron parameters were changed, derive them
   // * in future expansions
@@ -1347,7 +1478,8 @@ ActivationFunction GetRandomActivation(const Parameters &a_Parameters,
 // Adds a new neuron to the genome
 // returns true if succesful
 bool Genome::Mutate_AddNeuron(InnovationDatabase &a_Innovs,
-                              const Parameters &a_Parameters, RNG &a_RNG) {
+                              const Parameters &a_Parameters, RNG &a_RNG,
+                              unsigned int *a_Tries) {
   // No links to split - go away..
   if (NumLinks() == 0)
     return false;
@@ -1364,6 +1496,10 @@ bool Genome::Mutate_AddNeuron(InnovationDatabase &a_Innovs,
   // number of tries to find a good link or give up
   int t_tries = 64;
   while (!t_link_found) {
+    if (a_Tries) {
+      (*a_Tries)++;
+    }
+
     if (NumLinks() == 1) {
       t_link_num = 0;
     }
@@ -1434,6 +1570,7 @@ bool Genome::Mutate_AddNeuron(InnovationDatabase &a_Innovs,
     if (t_iter->InnovationID() == m_LinkGenes[t_link_num].InnovationID()) {
       // found it! now erase..
       m_LinkGenes.erase(t_iter);
+      m_PhenotypeChanges |= CHANGED_STRUCTURE;
       break;
     }
   }
@@ -1624,7 +1761,8 @@ bool Genome::Mutate_AddNeuron(InnovationDatabase &a_Innovs,
 // Adds a new link to the genome
 // returns true if succesful
 bool Genome::Mutate_AddLink(InnovationDatabase &a_Innovs,
-                            const Parameters &a_Parameters, RNG &a_RNG) {
+                            const Parameters &a_Parameters, RNG &a_RNG,
+                            unsigned int *a_Tries) {
   // this variable tells where is the first noninput node
   int t_first_noninput = 0;
 
@@ -1690,6 +1828,9 @@ bool Genome::Mutate_AddLink(InnovationDatabase &a_Innovs,
       t_n2idx =
           a_RNG.RandInt(t_first_noninput, static_cast<int>(NumNeurons() - 1));
       t_NumTries++;
+      if (a_Tries) {
+        (*a_Tries)++;
+      }
 
       if (t_NumTries >= a_Parameters.LinkTries) {
         // couldn't find anything
@@ -1712,6 +1853,9 @@ bool Genome::Mutate_AddLink(InnovationDatabase &a_Innovs,
         t_n2idx =
             a_RNG.RandInt(t_first_noninput, static_cast<int>(NumNeurons() - 1));
         t_NumTries++;
+        if (a_Tries) {
+          (*a_Tries)++;
+        }
 
         if (t_NumTries >= a_Parameters.LinkTries) {
           // couldn't find anything
@@ -1740,6 +1884,9 @@ bool Genome::Mutate_AddLink(InnovationDatabase &a_Innovs,
       t_n2idx =
           a_RNG.RandInt(t_first_noninput, static_cast<int>(NumNeurons() - 1));
       t_NumTries++;
+      if (a_Tries) {
+        (*a_Tries)++;
+      }
 
       if (t_NumTries >= a_Parameters.LinkTries) {
         // couldn't find anything
@@ -1766,6 +1913,9 @@ bool Genome::Mutate_AddLink(InnovationDatabase &a_Innovs,
       t_n1idx = t_n2idx =
           a_RNG.RandInt(t_first_noninput, static_cast<int>(NumNeurons() - 1));
       t_NumTries++;
+      if (a_Tries) {
+        (*a_Tries)++;
+      }
 
       if (t_NumTries >= a_Parameters.LinkTries) {
         // couldn't find anything
@@ -1815,6 +1965,7 @@ bool Genome::Mutate_AddLink(InnovationDatabase &a_Innovs,
   // init the link's traits
   l.InitTraits(a_Parameters.LinkTraits, a_RNG);
   m_LinkGenes.push_back(l);
+  m_PhenotypeChanges |= CHANGED_STRUCTURE;
 
   // All done.
   return true;
@@ -1832,6 +1983,7 @@ void Genome::RemoveLinkGene(int a_InnovID) {
     if (t_curlink->InnovationID() == a_InnovID) {
       // found it - erase & quit
       t_curlink = m_LinkGenes.erase(t_curlink);
+      m_PhenotypeChanges |= CHANGED_STRUCTURE;
       break;
     }
 
@@ -1867,6 +2019,7 @@ void Genome::RemoveNeuronGene(int a_ID) {
     if (t_curneuron->ID() == a_ID) {
       // found it, erase and quit
       m_NeuronGenes.erase(t_curneuron);
+      m_PhenotypeChanges |= CHANGED_STRUCTURE;
       break;
     }
 
@@ -2185,6 +2338,9 @@ bool Genome::Mutate_LinkWeights(const Parameters &a_Parameters, RNG &a_RNG) {
     }
   }
 
+  if (did_mutate) {
+    m_PhenotypeChanges |= CHANGED_WEIGHTS;
+  }
   return did_mutate;
 }
 
@@ -2194,6 +2350,7 @@ void Genome::Randomize_LinkWeights(double a_Range, RNG &a_RNG) {
   for (unsigned int i = 0; i < NumLinks(); i++) {
     m_LinkGenes[i].SetWeight(a_RNG.RandFloatSigned() * a_Range);
   }
+  m_PhenotypeChanges |= CHANGED_WEIGHTS;
 }
 
 // Randomize traits
@@ -2206,6 +2363,7 @@ void Genome::Randomize_Traits(const Parameters &a_Parameters, RNG &a_RNG) {
   }
 
   m_GenomeGene.InitTraits(a_Parameters.GenomeTraits, a_RNG);
+  m_PhenotypeChanges |= CHANGED_TRAITS;
 }
 
 // Perturbs the A parameters of the neuron activation functions
@@ -2226,6 +2384,7 @@ bool Genome::Mutate_NeuronActivations_A(const Parameters &a_Parameters,
     }
   }
 
+  m_PhenotypeChanges |= CHANGED_NEURONS;
   return true;
 }
 
@@ -2247,6 +2406,7 @@ bool Genome::Mutate_NeuronActivations_B(const Parameters &a_Parameters,
     }
   }
 
+  m_PhenotypeChanges |= CHANGED_NEURONS;
   return true;
 }
 
@@ -2261,6 +2421,7 @@ bool Genome::Mutate_NeuronActivation_Type(const Parameters &a_Parameters,
 
   m_NeuronGenes[t_choice].m_ActFunction =
       GetRandomActivation(a_Parameters, a_RNG);
+  m_PhenotypeChanges |= CHANGED_NEURONS;
   if (m_NeuronGenes[t_choice].m_ActFunction == cur) // same as before?
   {
     return false;
@@ -2287,6 +2448,7 @@ bool Genome::Mutate_NeuronTimeConstants(const Parameters &a_Parameters,
     }
   }
 
+  m_PhenotypeChanges |= CHANGED_NEURONS;
   return true;
 }
 
@@ -2307,6 +2469,7 @@ bool Genome::Mutate_NeuronBiases(const Parameters &a_Parameters, RNG &a_RNG) {
     }
   }
 
+  m_PhenotypeChanges |= CHANGED_NEURONS;
   return true;
 }
 
@@ -2330,6 +2493,9 @@ bool Genome::Mutate_LinkTraits(const Parameters &a_Parameters, RNG &a_RNG) {
       did_mutate = true;
     }
   }
+  if (did_mutate) {
+    m_PhenotypeChanges |= CHANGED_TRAITS;
+  }
   return did_mutate;
 }
 
@@ -2783,74 +2949,92 @@ void Genome::CalculateDepth() {
 
 // Builds this genome from a file
 Genome::Genome(const char *a_FileName) {
-  std::ifstream t_DataFile(a_FileName);
-  *this = Genome(t_DataFile);
-  t_DataFile.close();
+  TextReader t_reader;
+  if (!t_reader.Open(a_FileName)) {
+    throw std::runtime_error("Genome file error!");
+  }
+  LoadText(t_reader);
 }
 
-// Builds the genome from an *opened* file
 Genome::Genome(std::ifstream &a_DataFile) {
-  std::string t_Str;
-
   if (!a_DataFile) {
-    std::ostringstream tStream;
-    tStream << "Genome file error!" << std::endl;
     throw std::runtime_error("Genome file error!");
   }
 
+  TextReader t_reader(a_DataFile);
+  LoadText(t_reader);
+}
+
+Genome::Genome(TextReader &a_Reader) { LoadText(a_Reader); }
+
+void Genome::LoadText(TextReader &a_Reader) {
   // search for GenomeStart
-  do {
-    a_DataFile >> t_Str;
-  } while (t_Str != "GenomeStart");
+  if (!a_Reader.SkipPast("GenomeStart")) {
+    throw std::runtime_error("Genome file error!");
+  }
 
   // read the genome ID
-  unsigned int t_gid;
-  a_DataFile >> t_gid;
-  m_ID = t_gid;
+  a_Reader.Get(m_ID);
+
+  // A Traits line holds the traits of the gene before it, or of the genome
+  // if it comes before the genes. They refer to the kinds of traits of the
+  // Trait lines by index.
+  TraitSchema t_kinds;
+  std::map<std::string, Trait> *t_traits = &m_GenomeGene.m_Traits;
 
   // read the genome until GenomeEnd is encountered
+  std::string_view t_str;
   do {
-    a_DataFile >> t_Str;
+    t_str = a_Reader.Next();
+    if (t_str.empty()) {
+      throw std::runtime_error("GenomeEnd not found in file!");
+    }
 
-    if (t_Str == "Neuron") {
+    if (t_str == "Neuron") {
       int t_id, t_type, t_activationfunc;
       double t_splity, t_a, t_b, t_timeconst, t_bias;
 
-      a_DataFile >> t_id;
-      a_DataFile >> t_type;
-      a_DataFile >> t_splity;
-
-      a_DataFile >> t_activationfunc;
-      a_DataFile >> t_a;
-      a_DataFile >> t_b;
-      a_DataFile >> t_timeconst;
-      a_DataFile >> t_bias;
+      a_Reader.Get(t_id);
+      a_Reader.Get(t_type);
+      a_Reader.Get(t_splity);
 
-      // TODO read neuron traits
+      a_Reader.Get(t_activationfunc);
+      a_Reader.Get(t_a);
+      a_Reader.Get(t_b);
+      a_Reader.Get(t_timeconst);
+      a_Reader.Get(t_bias);
 
       NeuronGene t_neuron(static_cast<NeuronType>(t_type), t_id, t_splity);
       t_neuron.Init(t_a, t_b, t_timeconst, t_bias,
                     static_cast<ActivationFunction>(t_activationfunc));
 
       m_NeuronGenes.push_back(t_neuron);
+      t_traits = &m_NeuronGenes.back().m_Traits;
     }
 
-    if (t_Str == "Link") {
+    if (t_str == "Link") {
       int t_from, t_to, t_innov, t_isrecur;
       double t_weight;
 
-      a_DataFile >> t_from;
-      a_DataFile >> t_to;
-      a_DataFile >> t_innov;
-      a_DataFile >> t_isrecur;
-      a_DataFile >> t_weight;
-
-      // TODO read link traits
+      a_Reader.Get(t_from);
+      a_Reader.Get(t_to);
+      a_Reader.Get(t_innov);
+      a_Reader.Get(t_isrecur);
+      a_Reader.Get(t_weight);
 
       m_LinkGenes.push_back(LinkGene(t_from, t_to, t_innov, t_weight,
                                      static_cast<bool>(t_isrecur)));
+      t_traits = &m_LinkGenes.back().m_Traits;
+    }
+
+    if (t_str == "Trait") {
+      a_Reader.GetTraitKind(t_kinds);
+    }
+
+    if (t_str == "Traits") {
+      a_Reader.GetTraits(*t_traits, t_kinds);
     }
-  } while (t_Str != "GenomeEnd");
+  } while (t_str != "GenomeEnd");
 
   // Init additional stuff
   // count inputs/outputs
@@ -2875,7 +3059,6 @@ Genome::Genome(std::ifstream &a_DataFile) {
   m_Evaluated = false;
 }
 
-// Saves this genome to a file
 void Genome::Save(const char *a_FileName) {
   FILE *t_file;
   t_file = fopen(a_FileName, "w");
@@ -2885,30 +3068,245 @@ void Genome::Save(const char *a_FileName) {
 
 // Saves this genome to an already opened file for writing
 void Genome::Save(FILE *a_file) {
-  fprintf(a_file, "GenomeStart %d\n", GetID());
+  TextWriter t_out(a_file);
+  t_out.Put("GenomeStart");
+  t_out.Put(GetID());
+  t_out.EndLine();
+
+  // the kinds of traits, which the Traits lines refer to by index
+  TraitSchema t_kinds;
+  t_kinds.Intern(m_GenomeGene.m_Traits);
+  for (unsigned int i = 0; i < NumNeurons(); i++) {
+    t_kinds.Intern(m_NeuronGenes[i].m_Traits);
+  }
+  for (unsigned int i = 0; i < NumLinks(); i++) {
+    t_kinds.Intern(m_LinkGenes[i].m_Traits);
+  }
+  for (unsigned int i = 0; i < t_kinds.size(); i++) {
+    t_out.Put("Trait");
+    t_out.PutTraitKind(t_kinds, i);
+    t_out.EndLine();
+  }
+  if (!m_GenomeGene.m_Traits.empty()) {
+    t_out.Put("Traits");
+    t_out.PutTraits(m_GenomeGene.m_Traits, t_kinds);
+    t_out.EndLine();
+  }
 
   // loop over the neurons and save each one
   for (unsigned int i = 0; i < NumNeurons(); i++) {
-    // Save neuron
-    fprintf(a_file, "Neuron %d %d %3.8f %d %3.8f %3.8f %3.8f %3.8f\n",
-            m_NeuronGenes[i].ID(), static_cast<int>(m_NeuronGenes[i].Type()),
-            m_NeuronGenes[i].SplitY(),
-            static_cast<int>(m_NeuronGenes[i].m_ActFunction),
-            m_NeuronGenes[i].m_A, m_NeuronGenes[i].m_B,
-            m_NeuronGenes[i].m_TimeConstant, m_NeuronGenes[i].m_Bias);
-    // TODO write neuron traits
+    const NeuronGene &t_n = m_NeuronGenes[i];
+    t_out.Put("Neuron");
+    t_out.Put(t_n.ID());
+    t_out.Put(static_cast<int>(t_n.Type()));
+    t_out.Put(t_n.SplitY(), 8);
+    t_out.Put(static_cast<int>(t_n.m_ActFunction));
+    t_out.Put(t_n.m_A, 8);
+    t_out.Put(t_n.m_B, 8);
+    t_out.Put(t_n.m_TimeConstant, 8);
+    t_out.Put(t_n.m_Bias, 8);
+    t_out.EndLine();
+    if (!t_n.m_Traits.empty()) {
+      t_out.Put("Traits");
+      t_out.PutTraits(t_n.m_Traits, t_kinds);
+      t_out.EndLine();
+    }
   }
 
   // loop over the connections and save each one
   for (unsigned int i = 0; i < NumLinks(); i++) {
-    fprintf(a_file, "Link %d %d %d %d %3.8f\n", m_LinkGenes[i].FromNeuronID(),
-            m_LinkGenes[i].ToNeuronID(), m_LinkGenes[i].InnovationID(),
-            static_cast<int>(m_LinkGenes[i].IsRecurrent()),
-            m_LinkGenes[i].GetWeight());
-    // TODO write link traits
+    const LinkGene &t_l = m_LinkGenes[i];
+    t_out.Put("Link");
+    t_out.Put(t_l.FromNeuronID());
+    t_out.Put(t_l.ToNeuronID());
+    t_out.Put(t_l.InnovationID());
+    t_out.Put(static_cast<int>(t_l.IsRecurrent()));
+    t_out.Put(t_l.GetWeight(), 8);
+    t_out.EndLine();
+    if (!t_l.m_Traits.empty()) {
+      t_out.Put("Traits");
+      t_out.PutTraits(t_l.m_Traits, t_kinds);
+      t_out.EndLine();
+    }
+  }
+
+  t_out.Put("GenomeEnd");
+  t_out.EndLine();
+  t_out.EndLine();
+}
+
+Genome::Genome(CheckpointReader &a_Reader) {
+  const CheckpointGenomeTable *t_table = a_Reader.GetGenomeTable();
+  if (t_table) {
+    const std::vector<char> &t_bytes = t_table->Find(a_Reader.Get<uint32_t>());
+    a_Reader.Get(m_ID);
+    LoadEvaluation(a_Reader);
+
+    CheckpointReader t_genome;
+    t_genome.Attach(t_bytes.data(), t_bytes.size(), a_Reader.GetVersion());
+    t_genome.GetTraitSchema();
+    LoadGenes(t_genome, false);
+  } else {
+    LoadGenes(a_Reader, true);
   }
 
-  fprintf(a_file, "GenomeEnd\n\n");
+  m_PhenotypeBehavior = NULL;
+}
+
+void Genome::LoadEvaluation(CheckpointReader &a_Reader) {
+  a_Reader.Get(m_Fitness);
+  a_Reader.Get(m_AdjustedFitness);
+  a_Reader.Get(m_Depth);
+  a_Reader.Get(m_OffspringAmount);
+  a_Reader.Get(m_Evaluated);
+}
+
+void Genome::LoadGenes(CheckpointReader &a_Reader, bool a_Evaluation) {
+  if (a_Evaluation) {
+    a_Reader.Get(m_ID);
+  }
+  a_Reader.Get(m_NumInputs);
+  a_Reader.Get(m_NumOutputs);
+  if (a_Evaluation) {
+    LoadEvaluation(a_Reader);
+  }
+  a_Reader.Get(m_initial_num_neurons);
+  a_Reader.Get(m_initial_num_links);
+  a_Reader.GetTraits(m_GenomeGene.m_Traits);
+
+  m_NeuronGenes.resize(a_Reader.Get<uint64_t>());
+  for (unsigned int i = 0; i < NumNeurons(); i++) {
+    NeuronGene &t_n = m_NeuronGenes[i];
+    a_Reader.Get(t_n.m_ID);
+    t_n.m_Type = static_cast<NeuronType>(a_Reader.Get<int32_t>());
+    a_Reader.Get(t_n.x);
+    a_Reader.Get(t_n.y);
+    a_Reader.Get(t_n.m_SplitY);
+    a_Reader.Get(t_n.m_A);
+    a_Reader.Get(t_n.m_B);
+    a_Reader.Get(t_n.m_TimeConstant);
+    a_Reader.Get(t_n.m_Bias);
+    t_n.m_ActFunction =
+        static_cast<ActivationFunction>(a_Reader.Get<int32_t>());
+    a_Reader.GetTraits(t_n.m_Traits);
+  }
+
+  m_LinkGenes.resize(a_Reader.Get<uint64_t>());
+  for (unsigned int i = 0; i < NumLinks(); i++) {
+    LinkGene &t_l = m_LinkGenes[i];
+    a_Reader.Get(t_l.m_FromNeuronID);
+    a_Reader.Get(t_l.m_ToNeuronID);
+    a_Reader.Get(t_l.m_InnovationID);
+    a_Reader.Get(t_l.m_Weight);
+    a_Reader.Get(t_l.m_IsRecurrent);
+    a_Reader.GetTraits(t_l.m_Traits);
+  }
+}
+
+Genome::Genome(const MappedGenome &a_Flat) {
+  m_ID = a_Flat.GetID();
+  m_NumInputs = a_Flat.NumInputs();
+  m_NumOutputs = a_Flat.NumOutputs();
+  m_Fitness = a_Flat.GetFitness();
+  m_AdjustedFitness = 0;
+  m_Depth = 0;
+  m_OffspringAmount = 0;
+  m_Evaluated = false;
+  m_PhenotypeBehavior = NULL;
+
+  m_NeuronGenes.reserve(a_Flat.NumNeurons());
+  for (unsigned int i = 0; i < a_Flat.NumNeurons(); i++) {
+    const MappedNeuronGene &t_r = a_Flat.GetNeuronByIndex(i);
+    NeuronGene t_neuron(static_cast<NeuronType>(t_r.m_type), t_r.m_id,
+                        t_r.m_split_y);
+    t_neuron.Init(t_r.m_a, t_r.m_b, t_r.m_time_constant, t_r.m_bias,
+                  static_cast<ActivationFunction>(t_r.m_activation_function));
+    t_neuron.x = t_r.m_x;
+    t_neuron.y = t_r.m_y;
+    m_NeuronGenes.push_back(t_neuron);
+  }
+
+  m_LinkGenes.reserve(a_Flat.NumLinks());
+  for (unsigned int i = 0; i < a_Flat.NumLinks(); i++) {
+    const MappedLinkGene &t_r = a_Flat.GetLinkByIndex(i);
+    m_LinkGenes.push_back(LinkGene(t_r.m_from_neuron_id, t_r.m_to_neuron_id,
+                                   t_r.m_innovation_id, t_r.m_weight,
+                                   t_r.m_recurrent != 0));
+  }
+
+  m_initial_num_neurons = NumNeurons();
+  m_initial_num_links = NumLinks();
+}
+
+void Genome::Save(CheckpointWriter &a_Writer) const {
+  CheckpointGenomeTable *t_table = a_Writer.GetGenomeTable();
+  if (t_table) {
+    // The table keeps only the genes, so that clones and survivors share
+    // their bytes whatever their ID and fitness. The bytes start with the
+    // kinds of their traits, so that they can be read without the
+    // checkpoint they were first written to.
+    CheckpointWriter t_genes;
+    SaveGenes(t_genes, false);
+    CheckpointWriter t_genome;
+    t_genome.PutTraitSchema(t_genes.GetTraitSchema());
+    t_genome.PutBytes(t_genes.GetPayload().data(),
+                      t_genes.GetPayload().size());
+    const std::vector<char> &t_bytes = t_genome.GetPayload();
+    a_Writer.Put(t_table->Store(t_bytes.data(), t_bytes.size()));
+    a_Writer.Put(m_ID);
+    SaveEvaluation(a_Writer);
+  } else {
+    SaveGenes(a_Writer, true);
+  }
+}
+
+void Genome::SaveEvaluation(CheckpointWriter &a_Writer) const {
+  a_Writer.Put(m_Fitness);
+  a_Writer.Put(m_AdjustedFitness);
+  a_Writer.Put(m_Depth);
+  a_Writer.Put(m_OffspringAmount);
+  a_Writer.Put(m_Evaluated);
+}
+
+void Genome::SaveGenes(CheckpointWriter &a_Writer, bool a_Evaluation) const {
+  if (a_Evaluation) {
+    a_Writer.Put(m_ID);
+  }
+  a_Writer.Put(m_NumInputs);
+  a_Writer.Put(m_NumOutputs);
+  if (a_Evaluation) {
+    SaveEvaluation(a_Writer);
+  }
+  a_Writer.Put(m_initial_num_neurons);
+  a_Writer.Put(m_initial_num_links);
+  a_Writer.PutTraits(m_GenomeGene.m_Traits);
+
+  a_Writer.Put(static_cast<uint64_t>(NumNeurons()));
+  for (unsigned int i = 0; i < NumNeurons(); i++) {
+    const NeuronGene &t_n = m_NeuronGenes[i];
+    a_Writer.Put(t_n.m_ID);
+    a_Writer.Put(static_cast<int32_t>(t_n.m_Type));
+    a_Writer.Put(t_n.x);
+    a_Writer.Put(t_n.y);
+    a_Writer.Put(t_n.m_SplitY);
+    a_Writer.Put(t_n.m_A);
+    a_Writer.Put(t_n.m_B);
+    a_Writer.Put(t_n.m_TimeConstant);
+    a_Writer.Put(t_n.m_Bias);
+    a_Writer.Put(static_cast<int32_t>(t_n.m_ActFunction));
+    a_Writer.PutTraits(t_n.m_Traits);
+  }
+
+  a_Writer.Put(static_cast<uint64_t>(NumLinks()));
+  for (unsigned int i = 0; i < NumLinks(); i++) {
+    const LinkGene &t_l = m_LinkGenes[i];
+    a_Writer.Put(t_l.m_FromNeuronID);
+    a_Writer.Put(t_l.m_ToNeuronID);
+    a_Writer.Put(t_l.m_InnovationID);
+    a_Writer.Put(t_l.m_Weight);
+    a_Writer.Put(t_l.m_IsRecurrent);
+    a_Writer.PutTraits(t_l.m_Traits);
+  }
 }
 
 void Genome::PrintTraits(std::map<std::string, Trait> &traits) {
@@ -3015,6 +3413,7 @@ generation. Relies on the Divide Initialize, PruneExpress and CleanNet methods.
 
 void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
                                        Parameters &params) {
+  NEAT_STAT(double t_start = StatsClock());
   ASSERT(subst.m_input_coords.size() > 0);
   ASSERT(subst.m_output_coords.size() > 0);
 
@@ -3026,41 +3425,37 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
   unsigned int hidden_counter = 0;
   unsigned int maxNodes = std::pow(4, params.MaxDepth);
 
-  std::vector<TempConnection> TempConnections;
-  TempConnections.reserve(maxNodes + 1);
+  // The connections expressed by each explored node of the current phase
+  std::vector<std::vector<TempConnection>> found;
 
   std::vector<double> point;
   point.reserve(3);
 
-  boost::shared_ptr<QuadPoint> root;
-
-  boost::unordered_map<std::vector<double>, int> hidden_nodes;
+  // Maps the coordinates of each hidden node to its index
+  CoordMap hidden_nodes;
   hidden_nodes.reserve(maxNodes);
 
-  boost::unordered_map<std::vector<double>, int> temp;
-  temp.reserve(maxNodes);
-
-  boost::unordered_map<std::vector<double>, int> unexplored_nodes;
+  // The hidden nodes still to be explored, and the ones discovered while
+  // exploring them
+  CoordMap unexplored_nodes;
   unexplored_nodes.reserve(maxNodes);
 
+  CoordMap discovered_nodes;
+  discovered_nodes.reserve(maxNodes);
+
   net.m_neurons.reserve(maxNodes);
   net.m_connections.reserve((maxNodes * (maxNodes - 1)) / 2);
   net.SetInputOutputDimentions(static_cast<unsigned short>(input_count),
                                static_cast<unsigned short>(output_count));
 
   NeuralNetwork t_temp_phenotype(true);
-  BuildPhenotype(t_temp_phenotype);
+  BuildNetwork(t_temp_phenotype, false);
 
   // Find Inputs to Hidden connections.
+  // Get the Quadtree and express the connections in it for every input
+  ExploreNodes(subst.m_input_coords, t_temp_phenotype, params, true, found);
   for (unsigned int i = 0; i < input_count; i++) {
-    // Get the Quadtree and express the connections in it for this input
-    root = boost::shared_ptr<QuadPoint>(new QuadPoint(
-        params.Qtree_X, params.Qtree_Y, params.Width, params.Height, 1));
-    DivideInitialize(subst.m_input_coords[i], root, t_temp_phenotype, params,
-                     true, 0.0);
-    TempConnections.clear();
-    PruneExpress(subst.m_input_coords[i], root, t_temp_phenotype, params,
-                 TempConnections, true);
+    std::vector<TempConnection> &TempConnections = found[i];
 
     for (unsigned int j = 0; j < TempConnections.size(); j++) {
       if (std::abs(TempConnections[j].weight * subst.m_max_weight_and_bias) <
@@ -3068,14 +3463,14 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
         continue;
 
       // Find the hidden node in the hidden nodes. If it is not there add it.
-      if (hidden_nodes.find(TempConnections[j].target) == hidden_nodes.end()) {
+      int t_found = hidden_nodes.find(TempConnections[j].target);
+      if (t_found < 0) {
         target_index = hidden_counter++;
-        hidden_nodes.insert(
-            std::make_pair(TempConnections[j].target, target_index));
+        hidden_nodes.insert(TempConnections[j].target, target_index);
       }
       // Add connection
       else {
-        target_index = hidden_nodes.find(TempConnections[j].target)->second;
+        target_index = t_found;
       }
 
       Connection tc;
@@ -3091,36 +3486,42 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
   // Basically the same procedure as above repeated IterationLevel times (see
   // the params)
   unexplored_nodes = hidden_nodes;
+  std::vector<std::vector<double>> unexplored_coords;
+  std::vector<int> unexplored_indices;
   for (unsigned int i = 0; i < params.IterationLevel; i++) {
-    boost::unordered_map<std::vector<double>, int>::iterator itr_hid;
+    // Take the nodes in a fixed order, so the new hidden nodes are numbered
+    // the same way no matter how the exploration is scheduled
+    unexplored_coords.clear();
+    unexplored_indices.clear();
+    CoordMap::const_iterator itr_hid;
     for (itr_hid = unexplored_nodes.begin(); itr_hid != unexplored_nodes.end();
          itr_hid++) {
-      root = boost::shared_ptr<QuadPoint>(new QuadPoint(
-          params.Qtree_X, params.Qtree_Y, params.Width, params.Height, 1));
-      DivideInitialize(itr_hid->first, root, t_temp_phenotype, params, true,
-                       0.0);
-      TempConnections.clear();
-      PruneExpress(itr_hid->first, root, t_temp_phenotype, params,
-                   TempConnections, true);
-      // root.reset();
+      unexplored_coords.push_back(
+          std::vector<double>(itr_hid->first.begin(), itr_hid->first.end()));
+      unexplored_indices.push_back(itr_hid->second);
+    }
+
+    ExploreNodes(unexplored_coords, t_temp_phenotype, params, true, found);
+    for (unsigned int n = 0; n < unexplored_coords.size(); n++) {
+      std::vector<TempConnection> &TempConnections = found[n];
 
       for (unsigned int k = 0; k < TempConnections.size(); k++) {
         if (std::abs(TempConnections[k].weight * subst.m_max_weight_and_bias) <
             0.2 /*subst.m_link_threshold*/) // TODO: fix this
           continue;
 
-        if (hidden_nodes.find(TempConnections[k].target) ==
-            hidden_nodes.end()) {
+        int t_found = hidden_nodes.find(TempConnections[k].target);
+        if (t_found < 0) {
           target_index = hidden_counter++;
-          hidden_nodes.insert(
-              std::make_pair(TempConnections[k].target, target_index));
+          hidden_nodes.insert(TempConnections[k].target, target_index);
+          discovered_nodes.insert(TempConnections[k].target, target_index);
         } else // TODO: This can be skipped if building a feed forwad network.
         {
-          target_index = hidden_nodes.find(TempConnections[k].target)->second;
+          target_index = t_found;
         }
 
         Connection tc;
-        tc.m_source_neuron_idx = itr_hid->second + hidden_index; // NO!!!
+        tc.m_source_neuron_idx = unexplored_indices[n] + hidden_index;
         tc.m_target_neuron_idx = target_index + hidden_index;
         tc.m_weight = TempConnections[k].weight * subst.m_max_weight_and_bias;
         tc.m_recur_flag = false;
@@ -3128,26 +3529,16 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
         net.m_connections.push_back(tc);
       }
     }
-    // Now get the newly discovered hidden nodes
-    boost::unordered_map<std::vector<double>, int>::iterator itr1;
-    for (itr1 = hidden_nodes.begin(); itr1 != hidden_nodes.end(); itr1++) {
-      if (unexplored_nodes.find(itr1->first) == unexplored_nodes.end()) {
-        temp.insert(std::make_pair(itr1->first, itr1->second));
-      }
-    }
-    unexplored_nodes = temp;
+    // Only the newly discovered hidden nodes are explored next time
+    unexplored_nodes.swap(discovered_nodes);
+    discovered_nodes.clear();
   }
 
   // Finally Output to Hidden. Note that unlike before, here we connect the
   // outputs to existing hidden nodes and no new nodes are added.
+  ExploreNodes(subst.m_output_coords, t_temp_phenotype, params, false, found);
   for (unsigned int i = 0; i < output_count; i++) {
-    root = boost::shared_ptr<QuadPoint>(new QuadPoint(
-        params.Qtree_X, params.Qtree_Y, params.Width, params.Height, 1));
-    DivideInitialize(subst.m_output_coords[i], root, t_temp_phenotype, params,
-                     false, 0.0);
-    TempConnections.clear();
-    PruneExpress(subst.m_output_coords[i], root, t_temp_phenotype, params,
-                 TempConnections, false);
+    std::vector<TempConnection> &TempConnections = found[i];
 
     for (unsigned int j = 0; j < TempConnections.size(); j++) {
       // Make sure the link weight is above the expected threshold.
@@ -3155,8 +3546,9 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
           0.2 /*subst.m_link_threshold*/) // TODO: fix this
         continue;
 
-      if (hidden_nodes.find(TempConnections[j].source) != hidden_nodes.end()) {
-        source_index = hidden_nodes.find(TempConnections[j].source)->second;
+      int t_found = hidden_nodes.find(TempConnections[j].source);
+      if (t_found >= 0) {
+        source_index = t_found;
 
         Connection tc;
         tc.m_source_neuron_idx = source_index + hidden_index;
@@ -3179,7 +3571,7 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
     t_n.m_substrate_coords = subst.m_input_coords[i];
     t_n.m_activation_function_type = NEAT::LINEAR;
     t_n.m_type = NEAT::INPUT;
-    net.m_neurons.push_back(t_n);
+    net.AddNeuron(t_n);
   }
   // Bias n.
   Neuron t_n;
@@ -3188,7 +3580,7 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
   t_n.m_substrate_coords = subst.m_input_coords[input_count - 1];
   t_n.m_activation_function_type = NEAT::LINEAR;
   t_n.m_type = NEAT::BIAS;
-  net.m_neurons.push_back(t_n);
+  net.AddNeuron(t_n);
 
   for (unsigned int i = 0; i < output_count; i++) {
     Neuron t_n;
@@ -3197,109 +3589,214 @@ void Genome::BuildESHyperNEATPhenotype(NeuralNetwork &net, Substrate &subst,
     t_n.m_substrate_coords = subst.m_output_coords[i];
     t_n.m_activation_function_type = subst.m_output_nodes_activation;
     t_n.m_type = NEAT::OUTPUT;
-    net.m_neurons.push_back(t_n);
+    net.AddNeuron(t_n);
   }
 
-  boost::unordered_map<std::vector<double>, int>::iterator itr;
+  // The map iterates in insertion order, so the neurons follow their indices
+  CoordMap::const_iterator itr;
   for (itr = hidden_nodes.begin(); itr != hidden_nodes.end(); itr++) {
     Neuron t_n;
     t_n.m_a = 1;
     t_n.m_b = 0;
-    t_n.m_substrate_coords = itr->first;
+    t_n.m_substrate_coords.assign(itr->first.begin(), itr->first.end());
 
     ASSERT(t_n.m_substrate_coords.size() > 0); // prevent 0D points
     t_n.m_activation_function_type = subst.m_hidden_nodes_activation;
     t_n.m_type = NEAT::HIDDEN;
-    net.m_neurons.push_back(t_n);
+    net.AddNeuron(t_n);
   }
 
-  // Clean the generated network from dangling connections and we're good to go.
+  // Clean the generated network from dangling connections.
   Clean_Net(net.m_connections, input_count, output_count, hidden_nodes.size());
+
+  // Drop the hidden neurons left without connections and renumber the rest,
+  // and we're good to go.
+  std::vector<bool> connected(net.m_neurons.size(), false);
+  for (unsigned int i = 0; i < net.m_connections.size(); i++) {
+    connected[net.m_connections[i].m_source_neuron_idx] = true;
+    connected[net.m_connections[i].m_target_neuron_idx] = true;
+  }
+  std::vector<int> new_index(net.m_neurons.size(), -1);
+  for (unsigned int i = 0; i < hidden_index; i++) {
+    new_index[i] = i;
+  }
+  unsigned int kept = hidden_index;
+  for (unsigned int i = hidden_index; i < net.m_neurons.size(); i++) {
+    if (connected[i]) {
+      new_index[i] = kept;
+      if (kept != i) {
+        net.m_neurons[kept] = net.m_neurons[i];
+        net.m_neuron_meta[kept] = net.m_neuron_meta[i];
+      }
+      kept++;
+    }
+  }
+  net.m_neurons.resize(kept);
+  net.m_neuron_meta.resize(kept);
+  for (unsigned int i = 0; i < net.m_connections.size(); i++) {
+    Connection &c = net.m_connections[i];
+    c.m_source_neuron_idx = new_index[c.m_source_neuron_idx];
+    c.m_target_neuron_idx = new_index[c.m_target_neuron_idx];
+  }
+
+  NEAT_STAT(CountPhenotypeBuild(StatsClock() - t_start));
+}
+
+// The threads ExploreNodes() hands nodes to. They are started by the first
+// parallel build and kept, along with their quadtree pools, for later ones.
+static boost::asio::thread_pool &ExplorePool() {
+  static boost::asio::thread_pool s_pool(
+      std::max(1u, std::thread::hardware_concurrency()));
+  return s_pool;
+}
+
+// Grows and prunes the quadtree of every node in a_nodes and stores the
+// connections it expresses in a_connections, one list per node.
+// If params.ES_Threads is more than 1, the calling thread shares the nodes
+// with that many less one threads of a pool kept across builds. Each of them
+// queries its own copy of the CPPN. The results do not depend on the number
+// of threads.
+void Genome::ExploreNodes(
+    const std::vector<std::vector<double>> &a_nodes, NeuralNetwork &cppn,
+    Parameters &params, const bool &outgoing,
+    std::vector<std::vector<TempConnection>> &a_connections) {
+  a_connections.resize(a_nodes.size());
+
+  // Explores nodes from a shared counter until none are left
+  boost::atomic<unsigned int> t_next(0);
+  auto t_worker = [&](NeuralNetwork &t_cppn) {
+    // The quadtree pool is reused by every query on this thread
+    static thread_local QuadTree tree;
+
+    for (unsigned int i = t_next++; i < a_nodes.size(); i = t_next++) {
+      tree.Reset(params.Qtree_X, params.Qtree_Y, params.Width, params.Height,
+                 1);
+      DivideInitialize(a_nodes[i], tree, t_cppn, params, outgoing, 0.0);
+      a_connections[i].clear();
+      PruneExpress(a_nodes[i], tree, 0, t_cppn, params, a_connections[i],
+                   outgoing);
+    }
+  };
+
+  unsigned int t_threads = params.ES_Threads;
+  if (t_threads > a_nodes.size()) {
+    t_threads = a_nodes.size();
+  }
+
+  if (t_threads <= 1) {
+    t_worker(cppn);
+    return;
+  }
+
+  // copied here, the calling thread activates cppn while the others start
+  std::vector<NeuralNetwork> t_cppns(t_threads - 1, cppn);
+  std::mutex t_mutex;
+  std::condition_variable t_done;
+  unsigned int t_running = t_threads - 1;
+  for (unsigned int t = 0; t < t_threads - 1; t++) {
+    boost::asio::post(ExplorePool(), [&, t]() {
+      t_worker(t_cppns[t]);
+      std::lock_guard<std::mutex> t_lock(t_mutex);
+      if (--t_running == 0) {
+        t_done.notify_one();
+      }
+    });
+  }
+  t_worker(cppn);
+
+  std::unique_lock<std::mutex> t_lock(t_mutex);
+  t_done.wait(t_lock, [&]() { return t_running == 0; });
 }
 
 // Used to determine the placement of hidden neurons in the Evolvable Substrate.
 void Genome::DivideInitialize(
-    const std::vector<double> &node, boost::shared_ptr<QuadPoint> &root,
-    NeuralNetwork &cppn, Parameters &params, const bool &outgoing,
+    const std::vector<double> &node, QuadTree &tree, NeuralNetwork &cppn,
+    Parameters &params, const bool &outgoing,
     const double
         &z_coord) { // Have to check if this actually does something useful here
   // CalculateDepth();
   int cppn_depth = 8; // GetDepth();
 
-  std::vector<double> t_inputs;
+  // How many queued points are divided at once. Their children are sent to
+  // the CPPN as a single batch of up to 16 queries.
+  const unsigned int t_max_parents = 4;
+  const unsigned int t_input_size = outgoing ? node.size() + 3 : 6;
+  const unsigned int t_num_outputs = cppn.NumOutputs();
+
+  std::vector<double> &t_inputs = tree.m_inputs;
+  std::vector<double> &t_outputs = tree.m_outputs;
 
   // Standard Tree stuff. Create children, check their output with the CPPN
   // and if they have higher variance add them to their parent. Repeat with the
   // children until maxDepth has been reached or if the variance isn't high
   // enough.
-  boost::shared_ptr<QuadPoint> p;
-
-  std::queue<boost::shared_ptr<QuadPoint>> q;
-  q.push(root);
-  while (!q.empty()) {
-    p = q.front();
-    // Add children
-    p->children.push_back(boost::shared_ptr<QuadPoint>(
-        new QuadPoint(p->x - p->width / 2, p->y - p->height / 2, p->width / 2,
-                      p->height / 2, p->level + 1)));
-    p->children.push_back(boost::shared_ptr<QuadPoint>(
-        new QuadPoint(p->x - p->width / 2, p->y + p->height / 2, p->width / 2,
-                      p->height / 2, p->level + 1)));
-    p->children.push_back(boost::shared_ptr<QuadPoint>(
-        new QuadPoint(p->x + p->width / 2, p->y + p->height / 2, p->width / 2,
-                      p->height / 2, p->level + 1)));
-    p->children.push_back(boost::shared_ptr<QuadPoint>(
-        new QuadPoint(p->x + p->width / 2, p->y - p->height / 2, p->width / 2,
-                      p->height / 2, p->level + 1)));
-
-    for (unsigned int i = 0; i < p->children.size(); i++) {
-      t_inputs.clear();
-      t_inputs.reserve(cppn.NumInputs());
-
-      if (outgoing) {
-        // node goes here
-        t_inputs = node;
+  // The queue is a plain index array, consumed from the front.
+  tree.m_queue.clear();
+  tree.m_queue.push_back(0);
+  unsigned int head = 0;
+  while (head < tree.m_queue.size()) {
+    unsigned int t_end = head + t_max_parents;
+    if (t_end > tree.m_queue.size()) {
+      t_end = tree.m_queue.size();
+    }
+
+    // Add children and lay out their queries
+    t_inputs.clear();
+    for (unsigned int q = head; q < t_end; q++) {
+      int first = tree.Subdivide(tree.m_queue[q]);
+
+      for (int c = first; c < first + 4; c++) {
+        if (outgoing) {
+          // node goes here
+          t_inputs.insert(t_inputs.end(), node.begin(), node.end());
 
-        t_inputs.push_back(p->children[i]->x);
-        t_inputs.push_back(p->children[i]->y);
-        t_inputs.push_back(p->children[i]->z);
-      }
+          t_inputs.push_back(tree[c].x);
+          t_inputs.push_back(tree[c].y);
+          t_inputs.push_back(tree[c].z);
+        }
 
-      else {
-        // QuadPoint goes first
-        t_inputs.push_back(p->children[i]->x);
-        t_inputs.push_back(p->children[i]->y);
-        t_inputs.push_back(p->children[i]->z);
+        else {
+          // QuadPoint goes first
+          t_inputs.push_back(tree[c].x);
+          t_inputs.push_back(tree[c].y);
+          t_inputs.push_back(tree[c].z);
+
+          t_inputs.push_back(node[0]);
+          t_inputs.push_back(node[1]);
+          t_inputs.push_back(node[2]);
+        }
 
-        t_inputs.push_back(node[0]);
-        t_inputs.push_back(node[1]);
-        t_inputs.push_back(node[2]);
+        // Bias
+        t_inputs.back() = params.CPPN_Bias;
       }
+    }
 
-      // Bias
-      t_inputs[t_inputs.size() - 1] = (params.CPPN_Bias);
+    cppn.ActivateBatch(t_inputs, t_input_size, (t_end - head) * 4, cppn_depth,
+                       t_outputs);
 
-      cppn.Flush();
-      cppn.Input(t_inputs);
+    for (unsigned int q = head; q < t_end; q++) {
+      int p = tree.m_queue[q];
+      int first = tree[p].first_child;
 
-      for (int d = 0; d < cppn_depth; d++) {
-        cppn.Activate();
-      }
-      p->children[i]->weight = cppn.Output()[0];
-      if (params.Leo) {
-        p->children[i]->leo = cppn.Output()[cppn.Output().size() - 1];
+      for (int c = first; c < first + 4; c++) {
+        const double *t_out =
+            &t_outputs[((q - head) * 4 + (c - first)) * t_num_outputs];
+        tree[c].weight = t_out[0];
+        if (params.Leo) {
+          tree[c].leo = t_out[t_num_outputs - 1];
+        }
       }
-      cppn.Flush();
-    }
 
-    if ((p->level < params.InitialDepth) ||
-        ((p->level < params.MaxDepth) &&
-         Variance(p) > params.DivisionThreshold)) {
-      for (unsigned int i = 0; i < 4; i++) {
-        q.push(p->children[i]);
+      if ((tree[p].level < params.InitialDepth) ||
+          ((tree[p].level < params.MaxDepth) &&
+           Variance(tree, p) > params.DivisionThreshold)) {
+        for (int c = first; c < first + 4; c++) {
+          tree.m_queue.push_back(c);
+        }
       }
     }
-    q.pop();
+
+    head = t_end;
   }
 
   return;
@@ -3307,206 +3804,268 @@ void Genome::DivideInitialize(
 
 // We take the tree generated above and see which connections can be expressed
 // on the basis of Variance threshold, Band threshold and LEO.
-void Genome::PruneExpress(const std::vector<double> &node,
-                          boost::shared_ptr<QuadPoint> &root,
-                          NeuralNetwork &cppn, Parameters &params,
+void Genome::PruneExpress(const std::vector<double> &node, QuadTree &tree,
+                          int a_idx, NeuralNetwork &cppn, Parameters &params,
                           std::vector<Genome::TempConnection> &connections,
                           const bool &outgoing) {
-  if (root->children[0] == NULL) {
+  if (tree[a_idx].IsLeaf()) {
     return;
   }
 
   else {
-    for (unsigned int i = 0; i < 4; i++) {
-      if (Variance(root->children[i]) > params.VarianceThreshold) {
-        PruneExpress(node, root->children[i], cppn, params, connections,
-                     outgoing);
+    // CalculateDepth();
+    int cppn_depth = 8; // GetDepth();
+
+    const double width = tree[a_idx].width;
+    const int first = tree[a_idx].first_child;
+    const unsigned int t_input_size = outgoing ? node.size() + 4 : 7;
+    const unsigned int root_index = outgoing ? node.size() : 0;
+    const unsigned int t_num_outputs = cppn.NumOutputs();
+
+    bool t_descend[4];
+    bool t_express[4];
+    int t_probes[4];
+    unsigned int t_batch = 0;
+
+    std::vector<double> &t_inputs = tree.m_inputs;
+    std::vector<double> &t_outputs = tree.m_outputs;
+    std::vector<double> inputs;
+    t_inputs.clear();
+
+    // Band Pruning phase.
+    // If LEO is turned off this should always happen.
+    // If it is not it should only happen if the LEO output is greater than a
+    // specified threshold
+    // The left, right, top and bottom probes of all the children that need
+    // them are evaluated together in one batch.
+    for (int k = 0; k < 4; k++) {
+      const QuadPoint &child = tree[first + k];
+
+      t_descend[k] = Variance(tree, first + k) > params.VarianceThreshold;
+      t_express[k] = false;
+      t_probes[k] = -1;
+
+      if (t_descend[k] ||
+          !(!params.Leo || (params.Leo && child.leo > params.LeoThreshold))) {
+        continue;
       }
 
-      // Band Pruning phase.
-      // If LEO is turned off this should always happen.
-      // If it is not it should only happen if the LEO output is greater than a
-      // specified threshold
-      else if (!params.Leo ||
-               (params.Leo && root->children[i]->leo > params.LeoThreshold)) {
-        // CalculateDepth();
-        int cppn_depth = 8; // GetDepth();
-
-        double d_left, d_right, d_top, d_bottom;
-        std::vector<double> inputs;
-
-        int root_index = 0;
-
-        if (outgoing) {
-          inputs = node;
-          inputs.push_back(root->children[i]->x);
-          inputs.push_back(root->children[i]->y);
-          inputs.push_back(root->children[i]->z);
-
-          root_index = node.size();
-        }
-
-        else {
-          inputs.push_back(root->children[i]->x);
-          inputs.push_back(root->children[i]->y);
-          inputs.push_back(root->children[i]->z);
-          inputs.push_back(node[0]);
-          inputs.push_back(node[1]);
-          inputs.push_back(node[2]);
-        }
-
-        // Left
-        inputs.push_back(params.CPPN_Bias);
-        inputs[root_index] -= root->width;
-
-        cppn.Input(inputs);
-
-        for (int d = 0; d < cppn_depth; d++) {
-          cppn.Activate();
-        }
-
-        d_left = Abs(root->children[i]->weight - cppn.Output()[0]);
-        cppn.Flush();
-
-        // Right
-        inputs[root_index] += 2 * (root->width);
-        cppn.Input(inputs);
-
-        for (int d = 0; d < cppn_depth; d++) {
-          cppn.Activate();
-        }
-
-        d_right = Abs(root->children[i]->weight - cppn.Output()[0]);
-        cppn.Flush();
-
-        // Top
-        inputs[root_index] -= root->width;
-        inputs[root_index + 1] -= root->width;
-        cppn.Input(inputs);
-
-        for (int d = 0; d < cppn_depth; d++) {
-          cppn.Activate();
-        }
-
-        d_top = Abs(root->children[i]->weight - cppn.Output()[0]);
-        cppn.Flush();
-        // Bottom
-        inputs[root_index + 1] += 2 * root->width;
-        cppn.Input(inputs);
+      inputs.clear();
+      if (outgoing) {
+        inputs = node;
+        inputs.push_back(child.x);
+        inputs.push_back(child.y);
+        inputs.push_back(child.z);
+      }
 
-        for (int d = 0; d < cppn_depth; d++) {
-          cppn.Activate();
+      else {
+        inputs.push_back(child.x);
+        inputs.push_back(child.y);
+        inputs.push_back(child.z);
+        inputs.push_back(node[0]);
+        inputs.push_back(node[1]);
+        inputs.push_back(node[2]);
+      }
+      inputs.push_back(params.CPPN_Bias);
+
+      // Left
+      inputs[root_index] -= width;
+      t_inputs.insert(t_inputs.end(), inputs.begin(), inputs.end());
+      // Right
+      inputs[root_index] += 2 * width;
+      t_inputs.insert(t_inputs.end(), inputs.begin(), inputs.end());
+      // Top
+      inputs[root_index] -= width;
+      inputs[root_index + 1] -= width;
+      t_inputs.insert(t_inputs.end(), inputs.begin(), inputs.end());
+      // Bottom
+      inputs[root_index + 1] += 2 * width;
+      t_inputs.insert(t_inputs.end(), inputs.begin(), inputs.end());
+
+      t_probes[k] = t_batch;
+      t_batch += 4;
+    }
+
+    if (t_batch > 0) {
+      cppn.ActivateBatch(t_inputs, t_input_size, t_batch, cppn_depth,
+                         t_outputs);
+
+      for (int k = 0; k < 4; k++) {
+        if (t_probes[k] < 0) {
+          continue;
         }
 
-        d_bottom = Abs(root->children[i]->weight - cppn.Output()[0]);
-        cppn.Flush();
+        const double weight = tree[first + k].weight;
+        const double *t_out = &t_outputs[t_probes[k] * t_num_outputs];
+        double d_left = Abs(weight - t_out[0]);
+        double d_right = Abs(weight - t_out[t_num_outputs]);
+        double d_top = Abs(weight - t_out[2 * t_num_outputs]);
+        double d_bottom = Abs(weight - t_out[3 * t_num_outputs]);
 
-        if (std::max(std::min(d_top, d_bottom), std::min(d_left, d_right)) >
-            params.BandThreshold) {
-          Genome::TempConnection tc;
-          // Yeah its ugly
-          if (outgoing) {
-            tc.source = node;
+        t_express[k] =
+            std::max(std::min(d_top, d_bottom), std::min(d_left, d_right)) >
+            params.BandThreshold;
+      }
+    }
 
-            tc.target.push_back(root->children[i]->x);
-            tc.target.push_back(root->children[i]->y);
-            tc.target.push_back(root->children[i]->z);
-          } else {
-            tc.source.push_back(root->children[i]->x);
-            tc.source.push_back(root->children[i]->y);
-            tc.source.push_back(root->children[i]->z);
+    // The scratch buffers are free again, so recursing is safe
+    for (int k = 0; k < 4; k++) {
+      if (t_descend[k]) {
+        PruneExpress(node, tree, first + k, cppn, params, connections,
+                     outgoing);
+      }
 
-            tc.target = node;
-          }
-          // Normalize
-          // TODO: Put in Parameters
-          tc.weight = root->children[i]->weight;
-          connections.push_back(tc);
+      else if (t_express[k]) {
+        const QuadPoint &child = tree[first + k];
+        Genome::TempConnection tc;
+        const Coords t_point = {{child.x, child.y, child.z}};
+        if (outgoing) {
+          tc.source = ToCoords(node);
+          tc.target = t_point;
+        } else {
+          tc.source = t_point;
+          tc.target = ToCoords(node);
         }
+        // Normalize
+        // TODO: Put in Parameters
+        tc.weight = child.weight;
+        connections.push_back(tc);
       }
     }
   }
   return;
 }
 
-// Calculates the variance of a given Quadpoint.
-// Maybe an alternative solution would be to add this in the Quadpoint const.
-double Genome::Variance(boost::shared_ptr<QuadPoint> &point) {
-  if (point->children.size() == 0) {
+// Calculates the (population) variance of the weights of a Quadpoint's
+// children. Leaves have zero variance.
+double Genome::Variance(const QuadTree &tree, int a_idx) {
+  if (tree[a_idx].IsLeaf()) {
     return 0.0;
   }
 
-  boost::accumulators::accumulator_set<
-      double, boost::accumulators::stats<boost::accumulators::tag::variance>>
-      acc;
-  for (unsigned int i = 0; i < 4; i++) {
-    acc(point->children[i]->weight);
+  const int first = tree[a_idx].first_child;
+  double mean = 0.0;
+  for (int c = first; c < first + 4; c++) {
+    mean += tree[c].weight;
+  }
+  mean /= 4.0;
+
+  double var = 0.0;
+  for (int c = first; c < first + 4; c++) {
+    var += sqr(tree[c].weight - mean);
   }
 
-  return boost::accumulators::variance(acc);
+  return var / 4.0;
 }
 
 // Helper method for Variance
-void Genome::CollectValues(std::vector<double> &vals,
-                           boost::shared_ptr<QuadPoint> &point) {
+void Genome::CollectValues(std::vector<double> &vals, const QuadTree &tree,
+                           int a_idx) {
   // In theory we shouldn't get here at all.
-  if (point == NULL) {
+  if (a_idx < 0) {
     return;
   }
 
-  if (point->children.size() > 0) {
-    for (unsigned int i = 0; i < 4; i++) {
-      CollectValues(vals, point->children[i]);
+  if (!tree[a_idx].IsLeaf()) {
+    const int first = tree[a_idx].first_child;
+    for (int c = first; c < first + 4; c++) {
+      CollectValues(vals, tree, c);
     }
   }
 
   else { // Here, Apparently it treats the point a if it is not initialized
-    vals.push_back(point->weight);
+    vals.push_back(tree[a_idx].weight);
   }
 }
 
-// Removes all the dangling connections. This still leaves the nodes though,
+// Removes all the dangling connections, i.e. the ones touching a hidden node
+// without incoming or without outgoing connections (loops don't count).
+// Removing them can leave other nodes dangling, so the nodes are processed from
+// a worklist while their degrees are kept up to date. This is O(V + E) and the
+// remaining connections keep their order. This still leaves the nodes though.
 void Genome::Clean_Net(std::vector<Connection> &connections,
                        unsigned int input_count, unsigned int output_count,
                        unsigned int hidden_count) {
-  bool loose_connections = true;
-  int node_count = input_count + output_count + hidden_count;
-  std::vector<Connection> temp;
-  temp.reserve(connections.size());
-  while (loose_connections) {
-    std::vector<bool> hasOutgoing(node_count, false);
-    std::vector<bool> hasIncoming(node_count, false);
-    // Make sure inputs and outputs are covered.
-    for (unsigned int i = 0; i < output_count + input_count; i++) {
-      hasOutgoing[i] = true;
-      hasIncoming[i] = true;
-    }
-
-    // Move on to the nodes.
-    for (unsigned int i = 0; i < connections.size(); i++) {
-      if (connections[i].m_source_neuron_idx !=
-          connections[i].m_target_neuron_idx) {
-        hasOutgoing[connections[i].m_source_neuron_idx] = true;
-        hasIncoming[connections[i].m_target_neuron_idx] = true;
-      }
-    }
-
-    loose_connections = false;
-
-    std::vector<Connection>::iterator itr;
-    for (itr = connections.begin(); itr < connections.end();) {
-      if (!hasOutgoing[itr->m_target_neuron_idx] ||
-          !hasIncoming[itr->m_source_neuron_idx]) {
-        itr = connections.erase(itr);
-        if (!loose_connections) {
-          loose_connections = true;
-        }
+  const unsigned int io_count = input_count + output_count;
+  const unsigned int node_count = io_count + hidden_count;
+  const unsigned int conn_count = connections.size();
 
-      } else {
-        itr++;
+  std::vector<int> in_degree(node_count, 0);
+  std::vector<int> out_degree(node_count, 0);
+
+  // The connections touching each node, stored contiguously per node
+  std::vector<int> first(node_count + 1, 0);
+  for (unsigned int i = 0; i < conn_count; i++) {
+    int src = connections[i].m_source_neuron_idx;
+    int dst = connections[i].m_target_neuron_idx;
+    first[src + 1]++;
+    if (src != dst) {
+      out_degree[src]++;
+      in_degree[dst]++;
+      first[dst + 1]++;
+    }
+  }
+  for (unsigned int n = 0; n < node_count; n++) {
+    first[n + 1] += first[n];
+  }
+  std::vector<int> touching(first[node_count]);
+  std::vector<int> fill(first.begin(), first.end() - 1);
+  for (unsigned int i = 0; i < conn_count; i++) {
+    int src = connections[i].m_source_neuron_idx;
+    int dst = connections[i].m_target_neuron_idx;
+    touching[fill[src]++] = i;
+    if (src != dst) {
+      touching[fill[dst]++] = i;
+    }
+  }
+
+  // Inputs and outputs are never dangling.
+  std::vector<bool> dangling(node_count, false);
+  std::vector<int> worklist;
+  for (unsigned int n = io_count; n < node_count; n++) {
+    if ((in_degree[n] == 0) || (out_degree[n] == 0)) {
+      dangling[n] = true;
+      worklist.push_back(n);
+    }
+  }
+
+  std::vector<bool> removed(conn_count, false);
+  while (!worklist.empty()) {
+    int n = worklist.back();
+    worklist.pop_back();
+
+    for (int k = first[n]; k < first[n + 1]; k++) {
+      int i = touching[k];
+      if (removed[i]) {
+        continue;
       }
+      removed[i] = true;
+
+      int src = connections[i].m_source_neuron_idx;
+      int dst = connections[i].m_target_neuron_idx;
+      if (src == dst) {
+        continue;
+      }
+      out_degree[src]--;
+      in_degree[dst]--;
+
+      int other = (src == n) ? dst : src;
+      if ((other >= static_cast<int>(io_count)) && !dangling[other] &&
+          ((in_degree[other] == 0) || (out_degree[other] == 0))) {
+        dangling[other] = true;
+        worklist.push_back(other);
+      }
+    }
+  }
+
+  // Compact the survivors in one pass
+  unsigned int kept = 0;
+  for (unsigned int i = 0; i < conn_count; i++) {
+    if (!removed[i]) {
+      connections[kept++] = connections[i];
     }
   }
+  connections.resize(kept);
 }
 
 } // namespace NEAT
@@ -30,16 +30,18 @@
 // Description: Definition for the Genome class.
 ///////////////////////////////////////////////////////////////////////////////
 
-#include <boost/shared_ptr.hpp>
-
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/topological_sort.hpp>
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <queue>
 #include <vector>
 
 #include <MultiNEAT/Assert.hh>
+#include <MultiNEAT/CompactNetwork.hh>
 #include <MultiNEAT/Genes.hh>
 #include <MultiNEAT/Innovation.hh>
 #include <MultiNEAT/NeuralNetwork.hh>
@@ -54,12 +56,20 @@ namespace NEAT {
 //////////////////////////////////////////////
 
 // forward
+class CheckpointReader;
+
+class CheckpointWriter;
+
+class MappedGenome;
+
 class Innovation;
 
 class InnovationDatabase;
 
 class PhenotypeBehavior;
 
+class TextReader;
+
 extern ActivationFunction GetRandomActivation(Parameters &a_Parameters,
                                               RNG &a_RNG);
 
@@ -69,6 +79,17 @@ typedef bs::adjacency_list<bs::vecS, bs::vecS, bs::directedS> Graph;
 typedef bs::graph_traits<Graph>::vertex_descriptor Vertex;
 
 class Genome {
+public:
+  // What RefreshPhenotype() has to update
+  enum PhenotypeChange {
+    CHANGED_NONE = 0,
+    CHANGED_WEIGHTS = 1,   // link weights
+    CHANGED_NEURONS = 2,   // neuron parameters and activation functions
+    CHANGED_TRAITS = 4,    // link traits
+    CHANGED_STRUCTURE = 8, // neurons or links added or removed
+    CHANGED_ALL = 15
+  };
+
   /////////////////////
   // Members
   /////////////////////
@@ -92,9 +113,30 @@ private:
   // how many individuals this genome should spawn
   double m_OffspringAmount;
 
+  // What changed since the phenotype was last built, a mask of
+  // PhenotypeChange values. They apply to the network that holds the same
+  // stamp. Copies carry both, so a baby that only changed the parameters of
+  // its parent can patch the parent's network.
+  unsigned int m_PhenotypeChanges = CHANGED_ALL;
+  PhenotypeStamp m_PhenotypeStamp;
+
   ////////////////////
   // Private methods
 
+  // Returns true if a_Net has the neurons and connections of this genome
+  bool PhenotypeMatches(const NeuralNetwork &a_Net) const;
+
+  // Reads the text format Save(FILE*) writes
+  void LoadText(TextReader &a_Reader);
+
+  // The checkpoint fields of the genome. Without a_Evaluation the ID and the
+  // evaluation are left out, which is what genome tables keep.
+  void SaveGenes(CheckpointWriter &a_Writer, bool a_Evaluation) const;
+  void LoadGenes(CheckpointReader &a_Reader, bool a_Evaluation);
+  // Fitness, adjusted fitness, depth, offspring and whether it was evaluated
+  void SaveEvaluation(CheckpointWriter &a_Writer) const;
+  void LoadEvaluation(CheckpointReader &a_Reader);
+
   // Returns true if the specified neuron ID is present in the genome
   bool HasNeuronID(int a_id) const;
 
@@ -121,6 +163,10 @@ private:
   // the inputs
   unsigned int NeuronDepth(int a_NeuronID, unsigned int a_Depth);
 
+  // BuildPhenotype() without counting the build, for the builds that make a
+  // network of their own out of it
+  void BuildNetwork(NeuralNetwork &a_Net, bool a_Metadata);
+
   // Returns true is the specified neuron ID is a dead end or isolated
   bool IsDeadEndNeuron(int a_id) const;
 
@@ -166,6 +212,14 @@ public:
 
   // Builds this genome from an opened file
   Genome(std::ifstream &a_DataFile);
+  Genome(TextReader &a_Reader);
+
+  // Builds this genome from a checkpoint, see Checkpoint.hh
+  Genome(CheckpointReader &a_Reader);
+
+  // Copies a genome out of a mapped archive, see MappedFile.hh. The archive
+  // does not keep traits, so the genome has none.
+  Genome(const MappedGenome &a_Flat);
 
   // This creates a CTRNN fully-connected genome
   Genome(unsigned int a_ID, unsigned int a_NumInputs, unsigned int a_NumHidden,
@@ -281,6 +335,30 @@ public:
   // This builds a fastnetwork structure out from the genome
   void BuildPhenotype(NeuralNetwork &net);
 
+  // The same without the split Y of the neurons, which only displaying and
+  // saving need, for networks that are only evaluated
+  void BuildLeanPhenotype(NeuralNetwork &a_Net);
+
+  // Brings a phenotype built from this genome up to date. If a_Net is the
+  // network this genome was last built into and only weights, neuron
+  // parameters or link traits changed since, they are patched in place and
+  // true is returned. Otherwise the net is rebuilt. Copies of a genome may
+  // refresh the net it was built into, the first one to do so takes it over.
+  bool RefreshPhenotype(NeuralNetwork &a_Net);
+
+  // Call after editing the genes directly
+  void MarkPhenotypeChanged(unsigned int a_Changes = CHANGED_ALL) {
+    m_PhenotypeChanges |= a_Changes;
+  }
+  unsigned int GetPhenotypeChanges() const { return m_PhenotypeChanges; }
+  const PhenotypeStamp &GetPhenotypeStamp() const { return m_PhenotypeStamp; }
+
+  // Reads the Hebbian rates of a link from its traits
+  void GetHebbRates(unsigned int a_LinkIdx, double &a_Rate,
+                    double &a_PreRate) const;
+  // Same, for inference in single precision
+  void BuildPhenotype(FloatNetwork &a_Net);
+
   // Projects the phenotype's weights back to the genome
   void DerivePhenotypicChanges(NeuralNetwork &a_Net);
 
@@ -296,6 +374,9 @@ public:
   // Saves this genome to an already opened file for writing
   void Save(FILE *a_fstream);
 
+  // Saves this genome with its traits to a checkpoint
+  void Save(CheckpointWriter &a_Writer) const;
+
   void PrintTraits(std::map<std::string, Trait> &traits);
   void PrintAllTraits();
 
@@ -330,13 +411,18 @@ public:
 
   // Adds a new neuron to the genome
   // returns true if succesful
+  // If a_Tries is given, the number of links looked at for splitting is
+  // added to it
   bool Mutate_AddNeuron(InnovationDatabase &a_Innovs,
-                        const Parameters &a_Parameters, RNG &a_RNG);
+                        const Parameters &a_Parameters, RNG &a_RNG,
+                        unsigned int *a_Tries = NULL);
 
   // Adds a new link to the genome
   // returns true if succesful
+  // If a_Tries is given, the number of neuron pairs looked at is added to it
   bool Mutate_AddLink(InnovationDatabase &a_Innovs,
-                      const Parameters &a_Parameters, RNG &a_RNG);
+                      const Parameters &a_Parameters, RNG &a_RNG,
+                      unsigned int *a_Tries = NULL);
 
   // Remove a random link from the genome
   // A cleanup procedure is invoked so any dead-ends or stranded neurons are
@@ -412,30 +498,39 @@ public:
   // Evolvable Substrate HyperNEAT
   ////////////////////////////////////////////
 
+  // The coordinates of a point in the hypercube
+  typedef std::array<double, 3> Coords;
+
+  // Converts substrate coordinates to Coords. Missing dimensions are set to 0
+  // and extra ones are dropped.
+  static Coords ToCoords(const std::vector<double> &a_point) {
+    Coords t_c = {{0.0, 0.0, 0.0}};
+    for (unsigned int i = 0; (i < a_point.size()) && (i < 3); i++) {
+      t_c[i] = a_point[i];
+    }
+    return t_c;
+  }
+
   // A connection between two points. Stores weight and the coordinates of the
   // points
   struct TempConnection {
-    std::vector<double> source;
-    std::vector<double> target;
+    Coords source;
+    Coords target;
     double weight;
 
     TempConnection() {
-      source.reserve(3);
-      target.reserve(3);
+      source.fill(0);
+      target.fill(0);
       weight = 0;
     }
 
-    TempConnection(std::vector<double> t_source, std::vector<double> t_target,
+    TempConnection(const Coords &t_source, const Coords &t_target,
                    double t_weight) {
       source = t_source;
       target = t_target;
       weight = t_weight;
-      source.reserve(3);
-      target.reserve(3);
     }
 
-    ~TempConnection(){};
-
     bool operator==(const TempConnection &rhs) const {
       return (source == rhs.source && target == rhs.target);
     }
@@ -445,7 +540,108 @@ public:
     }
   };
 
+  // An open-addressing hash map from Coords to a non-negative int. The entries
+  // live in a dense array in insertion order, which is also the order of
+  // iteration.
+  class CoordMap {
+  public:
+    typedef std::pair<Coords, int> Entry;
+    typedef std::vector<Entry>::const_iterator const_iterator;
+
+    unsigned int size() const { return m_entries.size(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+
+    void reserve(unsigned int a_size) {
+      m_entries.reserve(a_size);
+      if (m_slots.size() < 2 * a_size) {
+        Rehash(2 * a_size);
+      }
+    }
+
+    void clear() {
+      m_entries.clear();
+      std::fill(m_slots.begin(), m_slots.end(), -1);
+    }
+
+    void swap(CoordMap &a_other) {
+      m_entries.swap(a_other.m_entries);
+      m_slots.swap(a_other.m_slots);
+    }
+
+    // Returns the value stored for a_key or -1 if there is none
+    int find(const Coords &a_key) const {
+      if (m_slots.empty()) {
+        return -1;
+      }
+      const size_t t_mask = m_slots.size() - 1;
+      for (size_t i = Hash(a_key) & t_mask;; i = (i + 1) & t_mask) {
+        if (m_slots[i] < 0) {
+          return -1;
+        }
+        if (m_entries[m_slots[i]].first == a_key) {
+          return m_entries[m_slots[i]].second;
+        }
+      }
+    }
+
+    // Adds a_key with a_value if it isn't there yet
+    // Returns the value stored for a_key
+    int insert(const Coords &a_key, int a_value) {
+      if (2 * (m_entries.size() + 1) > m_slots.size()) {
+        Rehash(2 * (m_entries.size() + 1));
+      }
+      const size_t t_mask = m_slots.size() - 1;
+      size_t i = Hash(a_key) & t_mask;
+      for (; m_slots[i] >= 0; i = (i + 1) & t_mask) {
+        if (m_entries[m_slots[i]].first == a_key) {
+          return m_entries[m_slots[i]].second;
+        }
+      }
+      m_slots[i] = m_entries.size();
+      m_entries.push_back(Entry(a_key, a_value));
+      return a_value;
+    }
+
+  private:
+    std::vector<Entry> m_entries;
+    // Indices into m_entries, -1 marks a free slot. Always a power of 2 long.
+    std::vector<int> m_slots;
+
+    static size_t Hash(const Coords &a_key) {
+      uint64_t h = 0;
+      for (unsigned int i = 0; i < 3; i++) {
+        // -0.0 and 0.0 are the same point
+        double t_v = (a_key[i] == 0.0) ? 0.0 : a_key[i];
+        uint64_t t_bits;
+        std::memcpy(&t_bits, &t_v, sizeof(t_bits));
+        h = (h ^ t_bits) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+      }
+      return h ^ (h >> 32);
+    }
+
+    void Rehash(size_t a_min_slots) {
+      size_t t_slots = 16;
+      while (t_slots < a_min_slots) {
+        t_slots *= 2;
+      }
+      m_slots.assign(t_slots, -1);
+      const size_t t_mask = t_slots - 1;
+      for (unsigned int e = 0; e < m_entries.size(); e++) {
+        size_t i = Hash(m_entries[e].first) & t_mask;
+        while (m_slots[i] >= 0) {
+          i = (i + 1) & t_mask;
+        }
+        m_slots[i] = e;
+      }
+    }
+  };
+
   // A quadpoint in the HyperCube.
+  // Quadpoints live in a QuadTree pool and refer to their children by index.
+  // The four children of a subdivided point are stored consecutively starting
+  // at first_child, which is -1 for a leaf.
   struct QuadPoint {
     double x;
     double y;
@@ -458,12 +654,12 @@ public:
     // Do I use this?
     double leo;
 
-    std::vector<boost::shared_ptr<QuadPoint>> children;
+    int first_child;
 
     QuadPoint() {
       x = y = z = width = height = weight = variance = leo = 0;
       level = 0;
-      children.reserve(4);
+      first_child = -1;
     }
 
     QuadPoint(double t_x, double t_y, double t_width, double t_height,
@@ -477,8 +673,7 @@ public:
       weight = 0.0;
       leo = 0.0;
       variance = 0.0;
-      children.reserve(4);
-      children.clear();
+      first_child = -1;
     }
 
     // Mind the Z
@@ -493,31 +688,72 @@ public:
       weight = 0.0;
       variance = 0.0;
       leo = 0.0;
-      children.reserve(4);
-      children.clear();
+      first_child = -1;
+    }
+
+    bool IsLeaf() const { return first_child < 0; }
+  };
+
+  // A flat node pool holding one quadtree at a time. Node 0 is the root.
+  // Reset() keeps the allocated storage, so a single pool can be reused for
+  // every query of every genome without touching the heap again.
+  struct QuadTree {
+    std::vector<QuadPoint> m_nodes;
+    // BFS work queue for DivideInitialize and the CPPN batch buffers,
+    // kept here for the same reason
+    std::vector<int> m_queue;
+    std::vector<double> m_inputs;
+    std::vector<double> m_outputs;
+
+    void Reset(double a_x, double a_y, double a_width, double a_height,
+               int a_level) {
+      m_nodes.clear();
+      m_queue.clear();
+      m_nodes.push_back(QuadPoint(a_x, a_y, a_width, a_height, a_level));
     }
 
-    ~QuadPoint(){};
+    // Appends the four children of node a_idx and returns the first one's
+    // index. Any references into m_nodes are invalidated.
+    int Subdivide(int a_idx) {
+      const QuadPoint p = m_nodes[a_idx];
+      int t_first = static_cast<int>(m_nodes.size());
+      double hw = p.width / 2, hh = p.height / 2;
+
+      m_nodes.push_back(QuadPoint(p.x - hw, p.y - hh, hw, hh, p.level + 1));
+      m_nodes.push_back(QuadPoint(p.x - hw, p.y + hh, hw, hh, p.level + 1));
+      m_nodes.push_back(QuadPoint(p.x + hw, p.y + hh, hw, hh, p.level + 1));
+      m_nodes.push_back(QuadPoint(p.x + hw, p.y - hh, hw, hh, p.level + 1));
+      m_nodes[a_idx].first_child = t_first;
+
+      return t_first;
+    }
+
+    QuadPoint &operator[](int a_idx) { return m_nodes[a_idx]; }
+    const QuadPoint &operator[](int a_idx) const { return m_nodes[a_idx]; }
   };
 
   void BuildESHyperNEATPhenotype(NeuralNetwork &a_net, Substrate &subst,
                                  Parameters &params);
 
-  void DivideInitialize(const std::vector<double> &node,
-                        boost::shared_ptr<QuadPoint> &root, NeuralNetwork &cppn,
-                        Parameters &params, const bool &outgoing,
-                        const double &z_coord);
+  void ExploreNodes(const std::vector<std::vector<double>> &a_nodes,
+                    NeuralNetwork &cppn, Parameters &params,
+                    const bool &outgoing,
+                    std::vector<std::vector<TempConnection>> &a_connections);
+
+  // Grows the tree from its root (node 0), which must be set by Reset()
+  void DivideInitialize(const std::vector<double> &node, QuadTree &tree,
+                        NeuralNetwork &cppn, Parameters &params,
+                        const bool &outgoing, const double &z_coord);
 
-  void PruneExpress(const std::vector<double> &node,
-                    boost::shared_ptr<QuadPoint> &root, NeuralNetwork &cppn,
-                    Parameters &params,
+  void PruneExpress(const std::vector<double> &node, QuadTree &tree,
+                    int a_idx, NeuralNetwork &cppn, Parameters &params,
                     std::vector<Genome::TempConnection> &connections,
                     const bool &outgoing);
 
-  void CollectValues(std::vector<double> &vals,
-                     boost::shared_ptr<QuadPoint> &point);
+  void CollectValues(std::vector<double> &vals, const QuadTree &tree,
+                     int a_idx);
 
-  double Variance(boost::shared_ptr<QuadPoint> &point);
+  double Variance(const QuadTree &tree, int a_idx);
 
   void Clean_Net(std::vector<Connection> &connections, unsigned int input_count,
                  unsigned int output_count, unsigned int hidden_count);
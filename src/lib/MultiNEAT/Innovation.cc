@@ -32,9 +32,11 @@
 #include <string>
 
 #include <MultiNEAT/Assert.hh>
+#include <MultiNEAT/Checkpoint.hh>
 #include <MultiNEAT/Genes.hh>
 #include <MultiNEAT/Genome.hh>
 #include <MultiNEAT/Innovation.hh>
+#include <MultiNEAT/TextIO.hh>
 
 namespace NEAT {
 
@@ -79,61 +81,121 @@ void InnovationDatabase::Init(const Genome &a_Genome) {
 }
 
 void InnovationDatabase::Init(std::ifstream &a_DataFile) {
+  TextReader t_reader(a_DataFile);
+  Init(t_reader);
+}
+
+void InnovationDatabase::Init(TextReader &a_Reader) {
   m_Innovations.clear();
   m_NextInnovationNum = 0;
   m_NextNeuronID = 0;
 
-  std::string t_str;
-
   // search for InnovationDatabaseStart
-  do {
-    a_DataFile >> t_str;
-  } while (t_str != "InnovationDatabaseStart");
+  if (!a_Reader.SkipPast("InnovationDatabaseStart")) {
+    return;
+  }
 
   // Read the last innov numbers
-  a_DataFile >> t_str;
-  a_DataFile >> m_NextInnovationNum;
-  a_DataFile >> t_str;
-  a_DataFile >> m_NextNeuronID;
+  a_Reader.Next();
+  a_Reader.Get(m_NextInnovationNum);
+  a_Reader.Next();
+  a_Reader.Get(m_NextNeuronID);
 
   // Read the database until InnovationDatabaseEnd is encountered
+  std::string_view t_str;
   do {
-    a_DataFile >> t_str;
+    t_str = a_Reader.Next();
 
     if (t_str == "Innovation") {
       // Read in the innovation
       int t_id, t_from, t_to, t_innovtype, t_neurontype, t_nid;
 
-      a_DataFile >> t_id;
-      a_DataFile >> t_innovtype;
-      a_DataFile >> t_from;
-      a_DataFile >> t_to;
-      a_DataFile >> t_neurontype;
-      a_DataFile >> t_nid;
+      a_Reader.Get(t_id);
+      a_Reader.Get(t_innovtype);
+      a_Reader.Get(t_from);
+      a_Reader.Get(t_to);
+      a_Reader.Get(t_neurontype);
+      a_Reader.Get(t_nid);
 
       m_Innovations.push_back(
           Innovation(t_id, static_cast<InnovationType>(t_innovtype), t_from,
                      t_to, static_cast<NeuronType>(t_neurontype), t_nid));
     }
 
-  } while (t_str != "InnovationDatabaseEnd");
+  } while ((t_str != "InnovationDatabaseEnd") && !t_str.empty());
 }
 
 // The file is assumed to be opened
 void InnovationDatabase::Save(FILE *a_file) {
-  fprintf(a_file, "InnovationDatabaseStart\n");
-  fprintf(a_file, "NextInnovNum: %d\n", m_NextInnovationNum);
-  fprintf(a_file, "NextNeuronID: %d\n", m_NextNeuronID);
+  TextWriter t_out(a_file);
+  t_out.Put("InnovationDatabaseStart");
+  t_out.EndLine();
+  t_out.Put("NextInnovNum:");
+  t_out.Put(m_NextInnovationNum);
+  t_out.EndLine();
+  t_out.Put("NextNeuronID:");
+  t_out.Put(m_NextNeuronID);
+  t_out.EndLine();
 
   // Now save all innovations
   for (unsigned int i = 0; i < m_Innovations.size(); i++) {
-    fprintf(a_file, "Innovation %d %d %d %d %d %d\n", m_Innovations[i].ID(),
-            static_cast<int>(m_Innovations[i].InnovType()),
-            m_Innovations[i].FromNeuronID(), m_Innovations[i].ToNeuronID(),
-            static_cast<int>(m_Innovations[i].GetNeuronType()),
-            m_Innovations[i].NeuronID());
+    t_out.Put("Innovation");
+    t_out.Put(m_Innovations[i].ID());
+    t_out.Put(static_cast<int>(m_Innovations[i].InnovType()));
+    t_out.Put(m_Innovations[i].FromNeuronID());
+    t_out.Put(m_Innovations[i].ToNeuronID());
+    t_out.Put(static_cast<int>(m_Innovations[i].GetNeuronType()));
+    t_out.Put(m_Innovations[i].NeuronID());
+    t_out.EndLine();
+  }
+  t_out.Put("InnovationDatabaseEnd");
+  t_out.EndLine();
+  t_out.EndLine();
+}
+
+void InnovationDatabase::Save(CheckpointWriter &a_Writer,
+                              unsigned int a_First) const {
+  ASSERT(a_First <= m_Innovations.size());
+
+  a_Writer.Put(m_NextInnovationNum);
+  a_Writer.Put(m_NextNeuronID);
+
+  a_Writer.Put(static_cast<uint64_t>(a_First));
+  a_Writer.Put(static_cast<uint64_t>(m_Innovations.size() - a_First));
+  for (unsigned int i = a_First; i < m_Innovations.size(); i++) {
+    a_Writer.Put(m_Innovations[i].ID());
+    a_Writer.Put(static_cast<int32_t>(m_Innovations[i].InnovType()));
+    a_Writer.Put(m_Innovations[i].FromNeuronID());
+    a_Writer.Put(m_Innovations[i].ToNeuronID());
+    a_Writer.Put(static_cast<int32_t>(m_Innovations[i].GetNeuronType()));
+    a_Writer.Put(m_Innovations[i].NeuronID());
+  }
+}
+
+void InnovationDatabase::Init(CheckpointReader &a_Reader) {
+  a_Reader.Get(m_NextInnovationNum);
+  a_Reader.Get(m_NextNeuronID);
+
+  // innovations before the first one saved are kept
+  uint64_t t_first = a_Reader.Get<uint64_t>();
+  uint64_t t_count = a_Reader.Get<uint64_t>();
+  if (t_first > m_Innovations.size()) {
+    throw std::runtime_error("Checkpoint continues missing innovations");
+  }
+  m_Innovations.erase(m_Innovations.begin() + t_first, m_Innovations.end());
+  m_Innovations.reserve(t_first + t_count);
+  for (uint64_t i = 0; i < t_count; i++) {
+    int t_id = a_Reader.Get<int>();
+    int t_innovtype = a_Reader.Get<int32_t>();
+    int t_from = a_Reader.Get<int>();
+    int t_to = a_Reader.Get<int>();
+    int t_neurontype = a_Reader.Get<int32_t>();
+    int t_nid = a_Reader.Get<int>();
+
+    m_Innovations.push_back(
+        Innovation(t_id, static_cast<InnovationType>(t_innovtype), t_from, t_to,
+                   static_cast<NeuronType>(t_neurontype), t_nid));
   }
-  fprintf(a_file, "InnovationDatabaseEnd\n\n");
 }
 
 // Checks the database if the innovation has already occured
@@ -98,6 +98,9 @@ public:
 
 // forward
 class Genome;
+class CheckpointReader;
+class CheckpointWriter;
+class TextReader;
 
 ////////////////////////////////////////////////////////
 // This class defines the innovation database structure
@@ -142,6 +145,7 @@ public:
   // Initializes a database from saved data
   // File is assumed to be already opened!
   void Init(std::ifstream &a_file);
+  void Init(TextReader &a_Reader);
 
   // Checks the database if the innovation has already occured
   // Returns the innovation id if true or -1 if false
@@ -177,6 +181,12 @@ public:
 
   // Saves the database to an already opened file
   void Save(FILE *a_file);
+
+  // Binary checkpoint section, see Checkpoint.hh. Only the innovations from
+  // index a_First on are saved. Init() keeps as many innovations of its own
+  // in front of them, so a run log can append to an earlier state.
+  void Save(CheckpointWriter &a_Writer, unsigned int a_First = 0) const;
+  void Init(CheckpointReader &a_Reader);
 };
 
 } // namespace NEAT
@@ -0,0 +1,387 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        MappedFile.cc
+// Description: Implementation of the memory-mapped networks and genomes.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Checkpoint.hh>
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/MappedFile.hh>
+#include <MultiNEAT/Population.hh>
+#include <algorithm>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace NEAT {
+
+static const char NETWORK_MAGIC[8] = {'M', 'N', 'E', 'A', 'T', 'N', 'E', 'T'};
+static const char ARCHIVE_MAGIC[8] = {'M', 'N', 'E', 'A', 'T', 'G', 'A', 'R'};
+static const uint32_t MAPPED_VERSION = 1;
+static const uint32_t MAPPED_BYTE_ORDER = 0x01020304;
+
+// magic, six counts, eight array offsets
+static const size_t NETWORK_HEADER_SIZE = 8 + 6 * 4 + 8 * 8;
+// magic, four counts, index offset
+static const size_t ARCHIVE_HEADER_SIZE = 8 + 4 * 4 + 8;
+
+static_assert(sizeof(MappedGenomeEntry) == 40, "unexpected record padding");
+static_assert(sizeof(MappedNeuronGene) == 64, "unexpected record padding");
+static_assert(sizeof(MappedLinkGene) == 24, "unexpected record padding");
+
+template <typename T> static void Append(std::vector<char> &a_Out, T a_V) {
+  const char *t_bytes = reinterpret_cast<const char *>(&a_V);
+  a_Out.insert(a_Out.end(), t_bytes, t_bytes + sizeof(T));
+}
+
+// Appends an array, starting at the next multiple of 8
+template <typename T>
+static uint64_t AppendArray(std::vector<char> &a_Out,
+                            const std::vector<T> &a_Values) {
+  a_Out.resize((a_Out.size() + 7) & ~size_t(7));
+  uint64_t t_offset = a_Out.size();
+  const char *t_bytes = reinterpret_cast<const char *>(a_Values.data());
+  a_Out.insert(a_Out.end(), t_bytes, t_bytes + a_Values.size() * sizeof(T));
+  return t_offset;
+}
+
+template <typename T> static T Read(const char *a_Data) {
+  T t_value;
+  std::memcpy(&t_value, a_Data, sizeof(T));
+  return t_value;
+}
+
+// Writes a_Bytes under a temporary name and only then replaces a_FileName,
+// so that mapped readers never see a partly written file
+static bool WriteFile(const std::vector<char> &a_Bytes,
+                      const char *a_FileName) {
+  ReplacementFile t_file(a_FileName);
+  if (!t_file.Get()) {
+    return false;
+  }
+  bool t_ok = fwrite(a_Bytes.data(), 1, a_Bytes.size(), t_file.Get()) ==
+              a_Bytes.size();
+  return t_ok && t_file.Commit();
+}
+
+// Checks the magic, the version and the byte order of a flat file
+static void CheckHeader(const char *a_Data, size_t a_Size, size_t a_HeaderSize,
+                        const char *a_Magic) {
+  if ((a_Size < a_HeaderSize) || (std::memcmp(a_Data, a_Magic, 8) != 0)) {
+    throw std::runtime_error("Not a flat MultiNEAT file");
+  }
+  uint32_t t_version = Read<uint32_t>(a_Data + 8);
+  if ((t_version == 0) || (t_version > MAPPED_VERSION)) {
+    throw std::runtime_error("Unsupported flat file version");
+  }
+  if (Read<uint32_t>(a_Data + 12) != MAPPED_BYTE_ORDER) {
+    throw std::runtime_error("Flat file has a different byte order");
+  }
+  if (reinterpret_cast<uintptr_t>(a_Data) % 8 != 0) {
+    throw std::runtime_error("Flat file data is not aligned");
+  }
+}
+
+// Returns a pointer to a_Count values at a_Offset, checking that they fit
+template <typename T>
+static const T *ArrayAt(const char *a_Data, size_t a_Size, uint64_t a_Offset,
+                        uint64_t a_Count) {
+  if ((a_Offset % alignof(T) != 0) || (a_Offset > a_Size) ||
+      (a_Count > (a_Size - a_Offset) / sizeof(T))) {
+    throw std::runtime_error("Flat file is truncated");
+  }
+  return reinterpret_cast<const T *>(a_Data + a_Offset);
+}
+
+////////////////////////////
+// MappedFile
+////////////////////////////
+
+MappedFile::MappedFile() : m_data(NULL), m_size(0) {}
+
+void MappedFile::Open(const char *a_FileName) {
+  namespace ip = boost::interprocess;
+  try {
+    ip::file_mapping t_mapping(a_FileName, ip::read_only);
+    m_region = std::make_shared<ip::mapped_region>(t_mapping, ip::read_only);
+  } catch (ip::interprocess_exception &e) {
+    throw std::runtime_error(std::string("Cannot map file: ") + e.what());
+  }
+  m_data = static_cast<const char *>(m_region->get_address());
+  m_size = m_region->get_size();
+}
+
+////////////////////////////
+// MappedNetwork
+////////////////////////////
+
+MappedNetwork::MappedNetwork() {}
+
+void MappedNetwork::Open(const char *a_FileName) {
+  MappedFile t_file;
+  t_file.Open(a_FileName);
+  Open(t_file.Data(), t_file.Size());
+  m_file = t_file;
+}
+
+void MappedNetwork::Open(const char *a_Data, size_t a_Size) {
+  CheckHeader(a_Data, a_Size, NETWORK_HEADER_SIZE, NETWORK_MAGIC);
+
+  CompactNetworkSpans<double> t_spans;
+  t_spans.m_num_inputs = Read<uint32_t>(a_Data + 16);
+  t_spans.m_num_outputs = Read<uint32_t>(a_Data + 20);
+  const unsigned int t_neurons = Read<uint32_t>(a_Data + 24);
+  const unsigned int t_conns = Read<uint32_t>(a_Data + 28);
+  if (uint64_t(t_spans.m_num_inputs) + t_spans.m_num_outputs > t_neurons) {
+    throw std::runtime_error("Flat network is malformed");
+  }
+  t_spans.m_num_neurons = t_neurons;
+  t_spans.m_num_connections = t_conns;
+
+  // everything is checked before the network changes, so a bad file leaves
+  // it as it was
+  const char *t_offsets = a_Data + 32;
+  t_spans.m_source = ArrayAt<uint32_t>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets), t_conns);
+  t_spans.m_target = ArrayAt<uint32_t>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets + 8), t_conns);
+  t_spans.m_weight = ArrayAt<double>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets + 16), t_conns);
+  t_spans.m_a = ArrayAt<double>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets + 24), t_neurons);
+  t_spans.m_b = ArrayAt<double>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets + 32), t_neurons);
+  t_spans.m_bias = ArrayAt<double>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets + 40), t_neurons);
+  t_spans.m_timeconst = ArrayAt<double>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets + 48), t_neurons);
+  t_spans.m_activation_function_type = ArrayAt<int32_t>(
+      a_Data, a_Size, Read<uint64_t>(t_offsets + 56), t_neurons);
+
+  // a bad index would make activation write out of bounds
+  for (unsigned int i = 0; i < t_conns; i++) {
+    if ((t_spans.m_source[i] >= t_neurons) ||
+        (t_spans.m_target[i] >= t_neurons)) {
+      throw std::runtime_error("Flat network is malformed");
+    }
+  }
+  // and a bad activation function type would be applied as none of them
+  for (unsigned int i = 0; i < t_neurons; i++) {
+    if ((t_spans.m_activation_function_type[i] < SIGNED_SIGMOID) ||
+        (t_spans.m_activation_function_type[i] > SOFTPLUS)) {
+      throw std::runtime_error("Flat network is malformed");
+    }
+  }
+
+  m_net.Borrow(t_spans);
+  m_file = MappedFile();
+}
+
+bool MappedNetwork::Write(const NeuralNetwork &a_Net, const char *a_FileName) {
+  const unsigned int t_neurons = a_Net.m_neurons.size();
+  const unsigned int t_conns = a_Net.m_connections.size();
+
+  std::vector<uint32_t> t_source(t_conns), t_target(t_conns);
+  std::vector<double> t_weight(t_conns);
+  for (unsigned int i = 0; i < t_conns; i++) {
+    t_source[i] = a_Net.m_connections[i].m_source_neuron_idx;
+    t_target[i] = a_Net.m_connections[i].m_target_neuron_idx;
+    t_weight[i] = a_Net.m_connections[i].m_weight;
+  }
+
+  std::vector<double> t_a(t_neurons), t_b(t_neurons), t_bias(t_neurons);
+  std::vector<double> t_timeconst(t_neurons);
+  std::vector<int32_t> t_act(t_neurons);
+  for (unsigned int i = 0; i < t_neurons; i++) {
+    const NeuronState &t_n = a_Net.m_neurons[i];
+    t_a[i] = t_n.m_a;
+    t_b[i] = t_n.m_b;
+    t_bias[i] = t_n.m_bias;
+    t_timeconst[i] = t_n.m_timeconst;
+    t_act[i] = static_cast<int32_t>(t_n.m_activation_function_type);
+  }
+
+  std::vector<char> t_bytes(NETWORK_HEADER_SIZE);
+  uint64_t t_offsets[8];
+  t_offsets[0] = AppendArray(t_bytes, t_source);
+  t_offsets[1] = AppendArray(t_bytes, t_target);
+  t_offsets[2] = AppendArray(t_bytes, t_weight);
+  t_offsets[3] = AppendArray(t_bytes, t_a);
+  t_offsets[4] = AppendArray(t_bytes, t_b);
+  t_offsets[5] = AppendArray(t_bytes, t_bias);
+  t_offsets[6] = AppendArray(t_bytes, t_timeconst);
+  t_offsets[7] = AppendArray(t_bytes, t_act);
+
+  std::vector<char> t_header;
+  t_header.insert(t_header.end(), NETWORK_MAGIC, NETWORK_MAGIC + 8);
+  Append(t_header, MAPPED_VERSION);
+  Append(t_header, MAPPED_BYTE_ORDER);
+  Append(t_header, static_cast<uint32_t>(a_Net.NumInputs()));
+  Append(t_header, static_cast<uint32_t>(a_Net.NumOutputs()));
+  Append(t_header, static_cast<uint32_t>(t_neurons));
+  Append(t_header, static_cast<uint32_t>(t_conns));
+  for (unsigned int i = 0; i < 8; i++) {
+    Append(t_header, t_offsets[i]);
+  }
+  std::copy(t_header.begin(), t_header.end(), t_bytes.begin());
+
+  return WriteFile(t_bytes, a_FileName);
+}
+
+////////////////////////////
+// MappedGenomeArchive
+////////////////////////////
+
+MappedGenomeArchive::MappedGenomeArchive()
+    : m_data(NULL), m_size(0), m_index(NULL), m_num_genomes(0) {}
+
+void MappedGenomeArchive::Open(const char *a_FileName) {
+  MappedFile t_file;
+  t_file.Open(a_FileName);
+  Open(t_file.Data(), t_file.Size());
+  m_file = t_file;
+}
+
+void MappedGenomeArchive::Open(const char *a_Data, size_t a_Size) {
+  CheckHeader(a_Data, a_Size, ARCHIVE_HEADER_SIZE, ARCHIVE_MAGIC);
+
+  const unsigned int t_count = Read<uint32_t>(a_Data + 16);
+  m_index = ArrayAt<MappedGenomeEntry>(a_Data, a_Size,
+                                       Read<uint64_t>(a_Data + 24), t_count);
+  m_num_genomes = t_count;
+  m_data = a_Data;
+  m_size = a_Size;
+  m_file = MappedFile();
+}
+
+MappedGenome MappedGenomeArchive::GetGenome(unsigned int a_idx) const {
+  if (a_idx >= m_num_genomes) {
+    throw std::out_of_range("No such genome in the archive");
+  }
+
+  const MappedGenomeEntry *t_entry = &m_index[a_idx];
+  const uint64_t t_bytes =
+      uint64_t(t_entry->m_num_neurons) * sizeof(MappedNeuronGene) +
+      uint64_t(t_entry->m_num_links) * sizeof(MappedLinkGene);
+  ArrayAt<char>(m_data, m_size, t_entry->m_offset, t_bytes);
+  if (t_entry->m_offset % 8 != 0) {
+    throw std::runtime_error("Flat file is malformed");
+  }
+
+  return MappedGenome(t_entry, m_data + t_entry->m_offset);
+}
+
+// Lays out the archive of a_Genomes and writes it
+static bool WriteArchive(const std::vector<const Genome *> &a_Genomes,
+                         const char *a_FileName) {
+  const uint64_t t_index_offset = ARCHIVE_HEADER_SIZE;
+
+  std::vector<char> t_bytes;
+  t_bytes.insert(t_bytes.end(), ARCHIVE_MAGIC, ARCHIVE_MAGIC + 8);
+  Append(t_bytes, MAPPED_VERSION);
+  Append(t_bytes, MAPPED_BYTE_ORDER);
+  Append(t_bytes, static_cast<uint32_t>(a_Genomes.size()));
+  Append(t_bytes, static_cast<uint32_t>(0));
+  Append(t_bytes, t_index_offset);
+
+  // the index first, the records after it
+  uint64_t t_offset =
+      t_index_offset + a_Genomes.size() * sizeof(MappedGenomeEntry);
+  for (unsigned int i = 0; i < a_Genomes.size(); i++) {
+    const Genome &t_g = *a_Genomes[i];
+    MappedGenomeEntry t_e;
+    t_e.m_id = t_g.GetID();
+    t_e.m_num_inputs = t_g.NumInputs();
+    t_e.m_num_outputs = t_g.NumOutputs();
+    t_e.m_num_neurons = t_g.NumNeurons();
+    t_e.m_num_links = t_g.NumLinks();
+    t_e.m_reserved = 0;
+    t_e.m_fitness = t_g.GetFitness();
+    t_e.m_offset = t_offset;
+    Append(t_bytes, t_e);
+
+    t_offset += t_g.NumNeurons() * sizeof(MappedNeuronGene) +
+                t_g.NumLinks() * sizeof(MappedLinkGene);
+  }
+  t_bytes.reserve(t_offset);
+
+  for (unsigned int i = 0; i < a_Genomes.size(); i++) {
+    const Genome &t_g = *a_Genomes[i];
+    for (unsigned int j = 0; j < t_g.NumNeurons(); j++) {
+      const NeuronGene &t_n = t_g.m_NeuronGenes[j];
+      MappedNeuronGene t_r;
+      t_r.m_id = t_n.ID();
+      t_r.m_type = static_cast<int32_t>(t_n.Type());
+      t_r.m_activation_function = static_cast<int32_t>(t_n.m_ActFunction);
+      t_r.m_x = t_n.x;
+      t_r.m_y = t_n.y;
+      t_r.m_reserved = 0;
+      t_r.m_split_y = t_n.SplitY();
+      t_r.m_a = t_n.m_A;
+      t_r.m_b = t_n.m_B;
+      t_r.m_time_constant = t_n.m_TimeConstant;
+      t_r.m_bias = t_n.m_Bias;
+      Append(t_bytes, t_r);
+    }
+    for (unsigned int j = 0; j < t_g.NumLinks(); j++) {
+      const LinkGene &t_l = t_g.m_LinkGenes[j];
+      MappedLinkGene t_r;
+      t_r.m_from_neuron_id = t_l.FromNeuronID();
+      t_r.m_to_neuron_id = t_l.ToNeuronID();
+      t_r.m_innovation_id = t_l.InnovationID();
+      t_r.m_recurrent = t_l.IsRecurrent() ? 1 : 0;
+      t_r.m_weight = t_l.GetWeight();
+      Append(t_bytes, t_r);
+    }
+  }
+
+  return WriteFile(t_bytes, a_FileName);
+}
+
+bool MappedGenomeArchive::Write(const std::vector<Genome> &a_Genomes,
+                                const char *a_FileName) {
+  std::vector<const Genome *> t_genomes;
+  for (unsigned int i = 0; i < a_Genomes.size(); i++) {
+    t_genomes.push_back(&a_Genomes[i]);
+  }
+  return WriteArchive(t_genomes, a_FileName);
+}
+
+bool MappedGenomeArchive::Write(const Population &a_Pop,
+                                const char *a_FileName) {
+  std::vector<const Genome *> t_genomes;
+  for (unsigned int i = 0; i < a_Pop.m_Species.size(); i++) {
+    const std::vector<Genome> &t_members = a_Pop.m_Species[i].m_Individuals;
+    for (unsigned int j = 0; j < t_members.size(); j++) {
+      t_genomes.push_back(&t_members[j]);
+    }
+  }
+  return WriteArchive(t_genomes, a_FileName);
+}
+
+} // namespace NEAT
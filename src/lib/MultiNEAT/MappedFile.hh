@@ -0,0 +1,213 @@
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        MappedFile.hh
+// Description: Flat, read-only files of networks and genomes that are
+//              memory-mapped and used in place.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/CompactNetwork.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace boost {
+namespace interprocess {
+class mapped_region;
+}
+} // namespace boost
+
+namespace NEAT {
+
+class Genome;
+class Population;
+
+// A whole file mapped read-only into memory. Copies share the mapping, which
+// is released with the last of them.
+class MappedFile {
+  std::shared_ptr<boost::interprocess::mapped_region> m_region;
+  const char *m_data;
+  size_t m_size;
+
+public:
+  MappedFile();
+
+  // Throws std::runtime_error if the file cannot be mapped
+  void Open(const char *a_FileName);
+
+  const char *Data() const { return m_data; }
+  size_t Size() const { return m_size; }
+};
+
+// A network stored as flat arrays. The file starts with
+//
+//   char[8]   "MNEATNET"
+//   uint32    format version, byte order mark, inputs, outputs, neurons and
+//             connections
+//   uint64    offsets of the arrays from the start of the file: source,
+//             target, weight, a, b, bias, time constant, activation function
+//
+// and each array is 8-byte aligned. Only the activation state lives in
+// ordinary memory, so any number of MappedNetworks can run on one mapping.
+// A CompactNetwork<double> borrowing the mapped arrays does the activation.
+class MappedNetwork {
+  MappedFile m_file;
+  CompactNetwork<double> m_net;
+
+public:
+  MappedNetwork();
+
+  // Maps a file written by Write(). Both throw std::runtime_error if the
+  // data is not a valid network, and then leave the network as it was.
+  void Open(const char *a_FileName);
+  // Uses a_Size bytes at a_Data in place. They must be 8-byte aligned and
+  // outlive the network.
+  void Open(const char *a_Data, size_t a_Size);
+
+  // Returns false if the file could not be written. An existing file is
+  // only replaced once the new one is complete, see ReplacementFile.
+  static bool Write(const NeuralNetwork &a_Net, const char *a_FileName);
+
+  void Activate() { m_net.Activate(); }
+  void ActivateUseInternalBias() { m_net.ActivateUseInternalBias(); }
+  void ActivateLeaky(double a_dtime) { m_net.ActivateLeaky(a_dtime); }
+
+  void Flush() { m_net.Flush(); }
+
+  void Input(const std::vector<double> &a_Inputs) { m_net.Input(a_Inputs); }
+  void Input(const double *a_Inputs, size_t a_Count) {
+    m_net.Input(a_Inputs, a_Count);
+  }
+  std::vector<double> Output() const { return m_net.Output(); }
+  void OutputInto(double *a_Outputs, size_t a_Count) const {
+    m_net.OutputInto(a_Outputs, a_Count);
+  }
+
+  unsigned int NumInputs() const { return m_net.NumInputs(); }
+  unsigned int NumOutputs() const { return m_net.NumOutputs(); }
+  unsigned int NumNeurons() const { return m_net.NumNeurons(); }
+  unsigned int NumConnections() const { return m_net.NumConnections(); }
+};
+
+// The records of a genome archive, as they are stored
+struct MappedGenomeEntry {
+  uint32_t m_id;
+  uint32_t m_num_inputs, m_num_outputs;
+  uint32_t m_num_neurons, m_num_links;
+  uint32_t m_reserved;
+  double m_fitness;
+  uint64_t m_offset; // of the neuron records, the link records follow
+};
+
+struct MappedNeuronGene {
+  int32_t m_id;
+  int32_t m_type;
+  int32_t m_activation_function;
+  int32_t m_x, m_y;
+  int32_t m_reserved;
+  double m_split_y;
+  double m_a, m_b, m_time_constant, m_bias;
+};
+
+struct MappedLinkGene {
+  int32_t m_from_neuron_id, m_to_neuron_id;
+  int32_t m_innovation_id;
+  int32_t m_recurrent;
+  double m_weight;
+};
+
+// A genome inside a mapped archive. Nothing is copied; the pages holding it
+// are read when it is first accessed.
+class MappedGenome {
+  const MappedGenomeEntry *m_entry;
+  const MappedNeuronGene *m_neurons;
+  const MappedLinkGene *m_links;
+
+public:
+  MappedGenome(const MappedGenomeEntry *a_Entry, const char *a_Records)
+      : m_entry(a_Entry),
+        m_neurons(reinterpret_cast<const MappedNeuronGene *>(a_Records)),
+        m_links(reinterpret_cast<const MappedLinkGene *>(
+            a_Records + a_Entry->m_num_neurons * sizeof(MappedNeuronGene))) {}
+
+  unsigned int GetID() const { return m_entry->m_id; }
+  double GetFitness() const { return m_entry->m_fitness; }
+  unsigned int NumInputs() const { return m_entry->m_num_inputs; }
+  unsigned int NumOutputs() const { return m_entry->m_num_outputs; }
+  unsigned int NumNeurons() const { return m_entry->m_num_neurons; }
+  unsigned int NumLinks() const { return m_entry->m_num_links; }
+
+  const MappedNeuronGene &GetNeuronByIndex(unsigned int a_idx) const {
+    return m_neurons[a_idx];
+  }
+  const MappedLinkGene &GetLinkByIndex(unsigned int a_idx) const {
+    return m_links[a_idx];
+  }
+};
+
+// A file of genomes without their traits. It starts with
+//
+//   char[8]   "MNEATGAR"
+//   uint32    format version, byte order mark, number of genomes, reserved
+//   uint64    offset of the index
+//
+// The index holds a MappedGenomeEntry per genome, each pointing at the
+// genome's neuron and link records. Opening only checks the header, so it
+// takes the same time for any size of archive.
+class MappedGenomeArchive {
+  MappedFile m_file;
+  const char *m_data;
+  size_t m_size;
+  const MappedGenomeEntry *m_index;
+  unsigned int m_num_genomes;
+
+public:
+  MappedGenomeArchive();
+
+  void Open(const char *a_FileName);
+  // Uses a_Size bytes at a_Data in place. They must be 8-byte aligned and
+  // outlive the archive.
+  void Open(const char *a_Data, size_t a_Size);
+
+  // Return false if the file could not be written. As with networks, an
+  // existing file is only replaced once the new one is complete.
+  static bool Write(const std::vector<Genome> &a_Genomes,
+                    const char *a_FileName);
+  // all members of all species
+  static bool Write(const Population &a_Pop, const char *a_FileName);
+
+  unsigned int NumGenomes() const { return m_num_genomes; }
+
+  // Throws std::runtime_error if the genome's records lie outside the file
+  MappedGenome GetGenome(unsigned int a_idx) const;
+};
+
+} // namespace NEAT
+
+#endif
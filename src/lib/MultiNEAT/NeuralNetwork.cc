@@ -27,9 +27,15 @@
 // Description: Implementation of the phenotype activation functions.
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <MultiNEAT/Activation.hh>
 #include <MultiNEAT/Assert.hh>
 #include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/TextIO.hh>
 #include <MultiNEAT/Utils.hh>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <float.h>
 #include <fstream>
 #include <iostream>
@@ -43,83 +49,86 @@
 
 namespace NEAT {
 
-/////////////////////////////////////
-// The set of activation functions //
-/////////////////////////////////////
-
-inline double af_sigmoid_unsigned(double aX, double aSlope, double aShift) {
-  return 1.0 / (1.0 + exp(-aSlope * aX - aShift));
-}
-
-inline double af_sigmoid_signed(double aX, double aSlope, double aShift) {
-  double tY = af_sigmoid_unsigned(aX, aSlope, aShift);
-  return (tY - 0.5) * 2.0;
-}
-
-inline double af_tanh(double aX, double aSlope, double aShift) {
-  return tanh(aX * aSlope);
-}
-
-inline double af_tanh_cubic(double aX, double aSlope, double aShift) {
-  return tanh(aX * aX * aX * aSlope);
-}
-
-inline double af_step_signed(double aX, double aShift) {
-  double tY;
-  if (aX > aShift) {
-    tY = 1.0;
-  } else {
-    tY = -1.0;
-  }
-
-  return tY;
-}
-
-inline double af_step_unsigned(double aX, double aShift) {
-  if (aX > (0.5 + aShift)) {
-    return 1.0;
-  } else {
-    return 0.0;
-  }
-}
+double unsigned_sigmoid_derivative(double x) { return x * (1 - x); }
 
-inline double af_gauss_signed(double aX, double aSlope, double aShift) {
-  double tY = exp(-aSlope * aX * aX +
-                  aShift); // TODO: Need separate a, b per activation function
-  return (tY - 0.5) * 2.0;
-}
+double tanh_derivative(double x) { return 1 - x * x; }
 
-inline double af_gauss_unsigned(double aX, double aSlope, double aShift) {
-  return exp(-aSlope * aX * aX + aShift);
+// The bits of a double and back. The Hebbian kernel below picks and clamps
+// the weights with integer masks. Floating point compares would make the
+// compiler keep the branches, as they may trap.
+static inline int64_t double_bits(double a_Value) {
+  int64_t t_bits;
+  std::memcpy(&t_bits, &a_Value, sizeof(t_bits));
+  return t_bits;
 }
 
-inline double af_abs(double aX, double aShift) {
-  return ((aX + aShift) < 0.0) ? -(aX + aShift) : (aX + aShift);
+static inline double bits_double(int64_t a_Bits) {
+  double t_value;
+  std::memcpy(&t_value, &a_Bits, sizeof(t_value));
+  return t_value;
 }
 
-inline double af_sine_signed(double aX, double aFreq, double aShift) {
-  return sin(aX * aFreq + aShift);
+// One Hebbian step for a_Count connections kept as separate arrays. a_Sources
+// and a_Targets index a_Activations. The signal of every connection is
+// stored into a_Signals on the way, with the weight it had. The loop has no
+// branches, so the compiler can vectorize it. Returns the largest |weight|
+// after the step. The arrays must not overlap.
+static double hebbian_sweep(double *__restrict a_Weights,
+                            double *__restrict a_Signals,
+                            const double *a_Rates, const double *a_PreRates,
+                            const int *a_Sources, const int *a_Targets,
+                            const double *a_Activations, unsigned int a_Count,
+                            double a_MaxWeight, double a_Limit) {
+  const int64_t t_limit = double_bits(a_Limit);
+  int64_t t_max_weight = 0;
+  for (unsigned int i = 0; i < a_Count; i++) {
+    const double t_in = a_Activations[a_Sources[i]];
+    const double t_out = a_Activations[a_Targets[i]];
+    const double t_w = a_Weights[i];
+    a_Signals[i] = t_in * t_w;
+
+    double t_pos =
+        t_w + ((a_Rates[i] * (a_MaxWeight - t_w) * t_in * t_out) +
+               a_PreRates[i] * a_MaxWeight * t_in * (t_out - 1.0));
+
+    // In the inhibatory case, we strengthen the synapse when output is low
+    // and input is high
+    double t_neg =
+        -(t_w + (a_PreRates[i] * (a_MaxWeight - t_w) * t_in * (1.0 - t_out) -
+                 a_Rates[i] * a_MaxWeight * t_in * t_out));
+
+    // positive weights take t_pos, negative ones t_neg and zero stays
+    const int64_t t_bits = double_bits(t_w);
+    const int64_t t_negative = t_bits >> 63;
+    const int64_t t_nonzero = -static_cast<int64_t>((t_bits << 1) != 0);
+    int64_t t_new = (double_bits(t_pos) & ~t_negative) |
+                    (double_bits(t_neg) & t_negative);
+    t_new = (t_new & t_nonzero) | (t_bits & ~t_nonzero);
+
+    // clamp to +-a_Limit, the magnitudes compare as integers
+    const int64_t t_magnitude = t_new & INT64_MAX;
+    const int64_t t_over = -static_cast<int64_t>(t_magnitude > t_limit);
+    t_new = (t_new & ~t_over) | ((t_limit | (t_new & INT64_MIN)) & t_over);
+    a_Weights[i] = bits_double(t_new);
+
+    const int64_t t_abs = t_new & INT64_MAX;
+    t_max_weight = (t_abs > t_max_weight) ? t_abs : t_max_weight;
+  }
+  return bits_double(t_max_weight);
 }
 
-inline double af_sine_unsigned(double aX, double aFreq, double aShift) {
-  double tY = sin((aX * aFreq + aShift));
-  return (tY + 1.0) / 2.0;
+void PhenotypeStamp::Renew(PhenotypeStamp &a_Other) {
+  static std::atomic<unsigned long long> s_last(0);
+  m_value = ++s_last;
+  a_Other.m_value = m_value;
 }
 
-inline double af_linear(double aX, double aShift) { return (aX + aShift); }
-
-inline double af_relu(double aX) { return (aX > 0) ? aX : 0; }
-
-inline double af_softplus(double aX) { return log(1 + exp(aX)); }
-
-double unsigned_sigmoid_derivative(double x) { return x * (1 - x); }
-
-double tanh_derivative(double x) { return 1 - x * x; }
-
 ///////////////////////////////////////
 // Neural network class implementation
 ///////////////////////////////////////
 NeuralNetwork::NeuralNetwork(bool a_Minimal) {
+  m_hebb_max_weight = 0;
+  m_hebb_current = false;
   if (!a_Minimal) {
     // build an XOR network
 
@@ -132,11 +141,11 @@ NeuralNetwork::NeuralNetwork(bool a_Minimal) {
     // The hidden neuron       // index 4
     Neuron t_h1;
 
-    m_neurons.push_back(t_i1);
-    m_neurons.push_back(t_i2);
-    m_neurons.push_back(t_i3);
-    m_neurons.push_back(t_o1);
-    m_neurons.push_back(t_h1);
+    AddNeuron(t_i1);
+    AddNeuron(t_i2);
+    AddNeuron(t_i3);
+    AddNeuron(t_o1);
+    AddNeuron(t_h1);
 
     // The connections
     Connection t_c;
@@ -197,6 +206,7 @@ NeuralNetwork::NeuralNetwork(bool a_Minimal) {
     // an empty network
     m_num_inputs = m_num_outputs = 0;
     m_total_error = 0;
+    m_rtrl_steps = 0;
     // clean up other neuron data as well
     for (unsigned int i = 0; i < m_neurons.size(); i++) {
       m_neurons[i].m_a = 1;
@@ -209,9 +219,12 @@ NeuralNetwork::NeuralNetwork(bool a_Minimal) {
 }
 
 NeuralNetwork::NeuralNetwork() {
+  m_hebb_max_weight = 0;
+  m_hebb_current = false;
   // an empty network
   m_num_inputs = m_num_outputs = 0;
   m_total_error = 0;
+  m_rtrl_steps = 0;
   // clean up other neuron data as well
   for (unsigned int i = 0; i < m_neurons.size(); i++) {
     m_neurons[i].m_a = 1;
@@ -223,20 +236,68 @@ NeuralNetwork::NeuralNetwork() {
 }
 
 void NeuralNetwork::InitRTRLMatrix() {
-  // Allocate memory for the neurons sensitivity matrices.
-  for (unsigned int i = 0; i < m_neurons.size(); i++) {
-    m_neurons[i].m_sensitivity_matrix.resize(
-        m_neurons.size()); // first dimention
-    for (unsigned int j = 0; j < m_neurons.size(); j++) {
-      m_neurons[i].m_sensitivity_matrix[j].resize(
-          m_neurons.size()); // second dimention
+  const unsigned int t_num_neurons = m_neurons.size();
+  const unsigned int t_num_conns = m_connections.size();
+
+  // Build the incoming adjacency. Connections are bucketed by target, then
+  // each bucket is sorted by source so duplicates collapse onto the first
+  // connection between the pair.
+  m_rtrl_in_start.assign(t_num_neurons + 1, 0);
+  for (unsigned int c = 0; c < t_num_conns; c++) {
+    m_rtrl_in_start[m_connections[c].m_target_neuron_idx + 1]++;
+  }
+  for (unsigned int i = 0; i < t_num_neurons; i++) {
+    m_rtrl_in_start[i + 1] += m_rtrl_in_start[i];
+  }
+
+  std::vector<unsigned int> t_fill(m_rtrl_in_start.begin(),
+                                   m_rtrl_in_start.end() - 1);
+  m_rtrl_in_conn.resize(t_num_conns);
+  for (unsigned int c = 0; c < t_num_conns; c++) {
+    m_rtrl_in_conn[t_fill[m_connections[c].m_target_neuron_idx]++] = c;
+  }
+
+  unsigned int t_out = 0;
+  m_rtrl_in_source.resize(t_num_conns);
+  for (unsigned int i = 0; i < t_num_neurons; i++) {
+    unsigned int t_begin = m_rtrl_in_start[i];
+    unsigned int t_end = m_rtrl_in_start[i + 1];
+    std::stable_sort(m_rtrl_in_conn.begin() + t_begin,
+                     m_rtrl_in_conn.begin() + t_end,
+                     [this](unsigned int a, unsigned int b) {
+                       return m_connections[a].m_source_neuron_idx <
+                              m_connections[b].m_source_neuron_idx;
+                     });
+
+    m_rtrl_in_start[i] = t_out;
+    for (unsigned int e = t_begin; e < t_end; e++) {
+      unsigned int c = m_rtrl_in_conn[e];
+      unsigned int t_src = m_connections[c].m_source_neuron_idx;
+      if ((t_out > m_rtrl_in_start[i]) &&
+          (m_rtrl_in_source[t_out - 1] == t_src)) {
+        continue;
+      }
+      m_rtrl_in_source[t_out] = t_src;
+      m_rtrl_in_conn[t_out] = c;
+      t_out++;
     }
   }
+  m_rtrl_in_start[t_num_neurons] = t_out;
+  m_rtrl_in_source.resize(t_out);
+  m_rtrl_in_conn.resize(t_out);
+
+  // Allocate memory for the sensitivities
+  m_rtrl_sensitivity.resize(
+      (t_num_neurons > m_num_inputs ? t_num_neurons - m_num_inputs : 0) *
+      t_num_conns);
+  m_rtrl_scratch.resize(t_num_conns);
 
   // now clear it
   FlushCube();
   // clear out the other RTRL stuff as well
   m_total_error = 0;
+  m_rtrl_steps = 0;
+  m_rtrl_error.assign(m_num_outputs, 0.0);
   m_total_weight_change.resize(m_connections.size());
   for (unsigned int i = 0; i < m_connections.size(); i++) {
     m_total_weight_change[i] = 0;
@@ -291,54 +352,8 @@ void NeuralNetwork::Activate() {
     double x = m_neurons[i].m_activesum;
     m_neurons[i].m_activesum = 0;
     // Apply the activation function
-    double y = 0.0;
-    switch (m_neurons[i].m_activation_function_type) {
-    case SIGNED_SIGMOID:
-      y = af_sigmoid_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_SIGMOID:
-      y = af_sigmoid_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case TANH:
-      y = af_tanh(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case TANH_CUBIC:
-      y = af_tanh_cubic(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case SIGNED_STEP:
-      y = af_step_signed(x, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_STEP:
-      y = af_step_unsigned(x, m_neurons[i].m_b);
-      break;
-    case SIGNED_GAUSS:
-      y = af_gauss_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_GAUSS:
-      y = af_gauss_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case ABS:
-      y = af_abs(x, m_neurons[i].m_b);
-      break;
-    case SIGNED_SINE:
-      y = af_sine_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_SINE:
-      y = af_sine_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case LINEAR:
-      y = af_linear(x, m_neurons[i].m_b);
-      break;
-    case RELU:
-      y = af_relu(x);
-      break;
-    case SOFTPLUS:
-      y = af_softplus(x);
-      break;
-    default:
-      y = af_sigmoid_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    }
+    double y = af_apply(m_neurons[i].m_activation_function_type, x,
+                        m_neurons[i].m_a, m_neurons[i].m_b);
     m_neurons[i].m_activation = y;
   }
 }
@@ -364,54 +379,8 @@ void NeuralNetwork::ActivateUseInternalBias() {
     double x = m_neurons[i].m_activesum + m_neurons[i].m_bias;
     m_neurons[i].m_activesum = 0;
     // Apply the activation function
-    double y = 0.0;
-    switch (m_neurons[i].m_activation_function_type) {
-    case SIGNED_SIGMOID:
-      y = af_sigmoid_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_SIGMOID:
-      y = af_sigmoid_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case TANH:
-      y = af_tanh(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case TANH_CUBIC:
-      y = af_tanh_cubic(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case SIGNED_STEP:
-      y = af_step_signed(x, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_STEP:
-      y = af_step_unsigned(x, m_neurons[i].m_b);
-      break;
-    case SIGNED_GAUSS:
-      y = af_gauss_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_GAUSS:
-      y = af_gauss_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case ABS:
-      y = af_abs(x, m_neurons[i].m_b);
-      break;
-    case SIGNED_SINE:
-      y = af_sine_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_SINE:
-      y = af_sine_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case LINEAR:
-      y = af_linear(x, m_neurons[i].m_b);
-      break;
-    case RELU:
-      y = af_relu(x);
-      break;
-    case SOFTPLUS:
-      y = af_softplus(x);
-      break;
-    default:
-      y = af_sigmoid_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    }
+    double y = af_apply(m_neurons[i].m_activation_function_type, x,
+                        m_neurons[i].m_a, m_neurons[i].m_b);
     m_neurons[i].m_activation = y;
   }
 }
@@ -444,75 +413,205 @@ void NeuralNetwork::ActivateLeaky(double a_dtime) {
     double x = m_neurons[i].m_membrane_potential + m_neurons[i].m_bias;
     m_neurons[i].m_activesum = 0;
     // Apply the activation function
-    double y = 0.0;
-    switch (m_neurons[i].m_activation_function_type) {
-    case SIGNED_SIGMOID:
-      y = af_sigmoid_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_SIGMOID:
-      y = af_sigmoid_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case TANH:
-      y = af_tanh(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case TANH_CUBIC:
-      y = af_tanh_cubic(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case SIGNED_STEP:
-      y = af_step_signed(x, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_STEP:
-      y = af_step_unsigned(x, m_neurons[i].m_b);
-      break;
-    case SIGNED_GAUSS:
-      y = af_gauss_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_GAUSS:
-      y = af_gauss_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case ABS:
-      y = af_abs(x, m_neurons[i].m_b);
-      break;
-    case SIGNED_SINE:
-      y = af_sine_signed(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case UNSIGNED_SINE:
-      y = af_sine_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    case LINEAR:
-      y = af_linear(x, m_neurons[i].m_b);
-      break;
-    case RELU:
-      y = af_relu(x);
-      break;
-    case SOFTPLUS:
-      y = af_softplus(x);
-      break;
-    default:
-      y = af_sigmoid_unsigned(x, m_neurons[i].m_a, m_neurons[i].m_b);
-      break;
-    }
+    double y = af_apply(m_neurons[i].m_activation_function_type, x,
+                        m_neurons[i].m_a, m_neurons[i].m_b);
     m_neurons[i].m_activation = y;
   }
 }
 
+void NeuralNetwork::ActivateLeaky(double a_dtime, unsigned int a_Substeps,
+                                  LeakyIntegrator a_Method) {
+  const unsigned int t_num_neurons = m_neurons.size();
+  const unsigned int t_num_conns = m_connections.size();
+
+  // Copy the state out to contiguous arrays and work there
+  m_leaky_rate.resize(t_num_neurons);
+  m_leaky_potential.resize(t_num_neurons);
+  m_leaky_activation.resize(t_num_neurons);
+  m_leaky_sum.assign(t_num_neurons, 0.0);
+  for (unsigned int i = 0; i < t_num_neurons; i++) {
+    m_leaky_rate[i] = a_dtime / m_neurons[i].m_timeconst;
+    m_leaky_potential[i] = m_neurons[i].m_membrane_potential;
+    m_leaky_activation[i] = m_neurons[i].m_activation;
+    if (i >= m_num_inputs) {
+      m_leaky_sum[i] = m_neurons[i].m_activesum;
+    }
+  }
+
+  double *t_rate = m_leaky_rate.data();
+  double *t_pot = m_leaky_potential.data();
+  double *t_act = m_leaky_activation.data();
+  double *t_sum = m_leaky_sum.data();
+
+  if (a_Method == LEAKY_EULER) {
+    // The same steps ActivateLeaky(a_dtime) takes
+    for (unsigned int k = 0; k < a_Substeps; k++) {
+      for (unsigned int c = 0; c < t_num_conns; c++) {
+        t_sum[m_connections[c].m_target_neuron_idx] +=
+            t_act[m_connections[c].m_source_neuron_idx] *
+            m_connections[c].m_weight;
+      }
+      for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+        t_pot[i] = (1.0 - t_rate[i]) * t_pot[i] + t_rate[i] * t_sum[i];
+        t_sum[i] = 0;
+        t_act[i] = af_apply(m_neurons[i].m_activation_function_type,
+                            t_pot[i] + m_neurons[i].m_bias, m_neurons[i].m_a,
+                            m_neurons[i].m_b);
+      }
+    }
+  } else {
+    // Stages are scaled by the step already, see LeakyDerivative()
+    const unsigned int t_stages = (a_Method == LEAKY_RK2) ? 2 : 4;
+    m_leaky_k.resize((t_stages + 1) * t_num_neurons);
+    double *t_k1 = &m_leaky_k[0];
+    double *t_k2 = &m_leaky_k[t_num_neurons];
+    double *t_trial = &m_leaky_k[t_stages * t_num_neurons];
+
+    for (unsigned int k = 0; k < a_Substeps; k++) {
+      LeakyDerivative(t_pot, t_k1);
+      for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+        t_trial[i] = t_pot[i] + 0.5 * t_k1[i];
+      }
+      LeakyDerivative(t_trial, t_k2);
+
+      if (a_Method == LEAKY_RK2) {
+        // midpoint method
+        for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+          t_pot[i] += t_k2[i];
+        }
+        continue;
+      }
+
+      double *t_k3 = &m_leaky_k[2 * t_num_neurons];
+      double *t_k4 = &m_leaky_k[3 * t_num_neurons];
+      for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+        t_trial[i] = t_pot[i] + 0.5 * t_k2[i];
+      }
+      LeakyDerivative(t_trial, t_k3);
+      for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+        t_trial[i] = t_pot[i] + t_k3[i];
+      }
+      LeakyDerivative(t_trial, t_k4);
+      for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+        t_pot[i] += (t_k1[i] + 2.0 * (t_k2[i] + t_k3[i]) + t_k4[i]) / 6.0;
+      }
+    }
+
+    for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+      t_sum[i] = 0;
+      t_act[i] =
+          af_apply(m_neurons[i].m_activation_function_type,
+                   t_pot[i] + m_neurons[i].m_bias, m_neurons[i].m_a,
+                   m_neurons[i].m_b);
+    }
+  }
+
+  // write the state back
+  for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+    m_neurons[i].m_membrane_potential = t_pot[i];
+    m_neurons[i].m_activation = t_act[i];
+    m_neurons[i].m_activesum = t_sum[i];
+  }
+}
+
+void NeuralNetwork::LeakyDerivative(const double *a_Potential,
+                                    double *a_Out) {
+  const unsigned int t_num_neurons = m_neurons.size();
+  double *t_act = m_leaky_activation.data();
+  double *t_sum = m_leaky_sum.data();
+
+  for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+    t_act[i] = af_apply(m_neurons[i].m_activation_function_type,
+                        a_Potential[i] + m_neurons[i].m_bias,
+                        m_neurons[i].m_a, m_neurons[i].m_b);
+    t_sum[i] = 0;
+  }
+  for (unsigned int c = 0; c < m_connections.size(); c++) {
+    t_sum[m_connections[c].m_target_neuron_idx] +=
+        t_act[m_connections[c].m_source_neuron_idx] *
+        m_connections[c].m_weight;
+  }
+  for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+    a_Out[i] = m_leaky_rate[i] * (t_sum[i] - a_Potential[i]);
+  }
+}
+
+void NeuralNetwork::ActivateBatch(const std::vector<double> &a_Inputs,
+                                  unsigned int a_InputSize,
+                                  unsigned int a_BatchSize,
+                                  unsigned int a_Steps,
+                                  std::vector<double> &a_Outputs) {
+  const unsigned int t_batch = a_BatchSize;
+  const unsigned int t_num_neurons = m_neurons.size();
+
+  // The batch state is neuron-major, so the queries of one neuron are
+  // contiguous and every connection updates a whole row at once.
+  m_batch_activation.assign(t_num_neurons * t_batch, 0.0);
+  m_batch_activesum.assign(t_num_neurons * t_batch, 0.0);
+
+  unsigned int mx = a_InputSize;
+  if (mx > m_num_inputs) {
+    mx = m_num_inputs;
+  }
+  for (unsigned int b = 0; b < t_batch; b++) {
+    for (unsigned int i = 0; i < mx; i++) {
+      m_batch_activation[i * t_batch + b] = a_Inputs[b * a_InputSize + i];
+    }
+  }
+
+  for (unsigned int d = 0; d < a_Steps; d++) {
+    // Accumulate the signals. Activations are only written below, so this is
+    // the same as computing all the signals first.
+    for (unsigned int i = 0; i < m_connections.size(); i++) {
+      const double *t_src =
+          &m_batch_activation[m_connections[i].m_source_neuron_idx * t_batch];
+      double *t_dst =
+          &m_batch_activesum[m_connections[i].m_target_neuron_idx * t_batch];
+      const double t_weight = m_connections[i].m_weight;
+      for (unsigned int b = 0; b < t_batch; b++) {
+        t_dst[b] += t_src[b] * t_weight;
+      }
+    }
+    // Pass the sums through the activation functions, skipping the inputs
+    for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+      double *t_sum = &m_batch_activesum[i * t_batch];
+      double *t_act = &m_batch_activation[i * t_batch];
+      for (unsigned int b = 0; b < t_batch; b++) {
+        t_act[b] = af_apply(m_neurons[i].m_activation_function_type, t_sum[b],
+                            m_neurons[i].m_a, m_neurons[i].m_b);
+        t_sum[b] = 0;
+      }
+    }
+  }
+
+  a_Outputs.resize(t_batch * m_num_outputs);
+  for (unsigned int b = 0; b < t_batch; b++) {
+    for (unsigned int o = 0; o < m_num_outputs; o++) {
+      a_Outputs[b * m_num_outputs + o] =
+          m_batch_activation[(m_num_inputs + o) * t_batch + b];
+    }
+  }
+}
+
 void NeuralNetwork::Flush() {
   for (unsigned int i = 0; i < m_neurons.size(); i++) {
     m_neurons[i].m_activation = 0;
     m_neurons[i].m_activesum = 0;
     m_neurons[i].m_membrane_potential = 0;
   }
+  m_hebb_current = false;
 }
 
 void NeuralNetwork::FlushCube() {
   // clear the cube
-  for (unsigned int i = 0; i < m_neurons.size(); i++)
-    for (unsigned int j = 0; j < m_neurons.size(); j++)
-      for (unsigned int k = 0; k < m_neurons.size(); k++)
-        m_neurons[k].m_sensitivity_matrix[i][j] = 0;
+  std::fill(m_rtrl_sensitivity.begin(), m_rtrl_sensitivity.end(), 0.0);
 }
-void NeuralNetwork::Input(std::vector<double> &a_Inputs) {
-  unsigned mx = a_Inputs.size();
+void NeuralNetwork::Input(const std::vector<double> &a_Inputs) {
+  Input(a_Inputs.data(), a_Inputs.size());
+}
+
+void NeuralNetwork::Input(const double *a_Inputs, size_t a_Count) {
+  unsigned mx = a_Count;
   if (mx > m_num_inputs) {
     mx = m_num_inputs;
   }
@@ -522,139 +621,183 @@ void NeuralNetwork::Input(std::vector<double> &a_Inputs) {
   }
 }
 
-std::vector<double> NeuralNetwork::Output() {
-  std::vector<double> t_output;
-  for (int i = 0; i < m_num_outputs; i++) {
-    t_output.push_back(m_neurons[i + m_num_inputs].m_activation);
-  }
+std::vector<double> NeuralNetwork::Output() const {
+  std::vector<double> t_output(m_num_outputs);
+  OutputInto(t_output.data(), t_output.size());
   return t_output;
 }
 
-void NeuralNetwork::Adapt(Parameters &a_Parameters) {
-  // find max absolute magnitude of the weight
-  double t_max_weight = -999999999;
-  for (unsigned int i = 0; i < m_connections.size(); i++) {
-    if (fabs(m_connections[i].m_weight) > t_max_weight) {
-      t_max_weight = fabs(m_connections[i].m_weight);
-    }
+void NeuralNetwork::OutputInto(double *a_Outputs, size_t a_Count) const {
+  unsigned mx = a_Count;
+  if (mx > m_num_outputs) {
+    mx = m_num_outputs;
   }
 
-  for (unsigned int i = 0; i < m_connections.size(); i++) {
-    /////////////////////////////////////
-    // modify weight of that connection
-    ////
-    double t_incoming_neuron_activation =
-        m_neurons[m_connections[i].m_source_neuron_idx].m_activation;
-    double t_outgoing_neuron_activation =
-        m_neurons[m_connections[i].m_target_neuron_idx].m_activation;
-    if (m_connections[i].m_weight > 0) // positive weight
-    {
-      double t_delta =
-          (m_connections[i].m_hebb_rate *
-           (t_max_weight - m_connections[i].m_weight) *
-           t_incoming_neuron_activation * t_outgoing_neuron_activation) +
-          m_connections[i].m_hebb_pre_rate * t_max_weight *
-              t_incoming_neuron_activation *
-              (t_outgoing_neuron_activation - 1.0);
-      m_connections[i].m_weight = (m_connections[i].m_weight + t_delta);
-    } else if (m_connections[i].m_weight < 0) // negative weight
-    {
-      // In the inhibatory case, we strengthen the synapse when output is low
-      // and input is high
-      double t_delta = m_connections[i].m_hebb_pre_rate *
-                           (t_max_weight - m_connections[i].m_weight) *
-                           t_incoming_neuron_activation *
-                           (1.0 - t_outgoing_neuron_activation) -
-                       m_connections[i].m_hebb_rate * t_max_weight *
-                           t_incoming_neuron_activation *
-                           t_outgoing_neuron_activation;
-      m_connections[i].m_weight = -(m_connections[i].m_weight + t_delta);
+  for (unsigned int i = 0; i < mx; i++) {
+    a_Outputs[i] = m_neurons[i + m_num_inputs].m_activation;
+  }
+}
+
+void NeuralNetwork::HebbianSweep(double a_Limit) {
+  const unsigned int t_num_conns = m_connections.size();
+  if (!m_hebb_current || (m_hebb_weights.size() != t_num_conns)) {
+    m_hebb_weights.resize(t_num_conns);
+    m_hebb_rates.resize(t_num_conns);
+    m_hebb_pre_rates.resize(t_num_conns);
+    m_hebb_sources.resize(t_num_conns);
+    m_hebb_targets.resize(t_num_conns);
+    m_hebb_signals.resize(t_num_conns);
+    m_hebb_max_weight = 0;
+    for (unsigned int i = 0; i < t_num_conns; i++) {
+      const Connection &t_c = m_connections[i];
+      m_hebb_weights[i] = t_c.m_weight;
+      m_hebb_rates[i] = t_c.m_hebb_rate;
+      m_hebb_pre_rates[i] = t_c.m_hebb_pre_rate;
+      m_hebb_sources[i] = t_c.m_source_neuron_idx;
+      m_hebb_targets[i] = t_c.m_target_neuron_idx;
+      m_hebb_max_weight = std::max(m_hebb_max_weight, fabs(t_c.m_weight));
     }
+    m_hebb_current = true;
+  }
 
-    Clamp(m_connections[i].m_weight, -a_Parameters.MaxWeight,
-          a_Parameters.MaxWeight);
+  m_hebb_activations.resize(m_neurons.size());
+  for (unsigned int i = 0; i < m_neurons.size(); i++) {
+    m_hebb_activations[i] = m_neurons[i].m_activation;
   }
+
+  m_hebb_max_weight = hebbian_sweep(
+      m_hebb_weights.data(), m_hebb_signals.data(), m_hebb_rates.data(),
+      m_hebb_pre_rates.data(), m_hebb_sources.data(), m_hebb_targets.data(),
+      m_hebb_activations.data(), t_num_conns, m_hebb_max_weight, a_Limit);
 }
 
-int NeuralNetwork::ConnectionExists(int a_to, int a_from) {
+void NeuralNetwork::Adapt(Parameters &a_Parameters) {
+  HebbianSweep(a_Parameters.MaxWeight);
+
   for (unsigned int i = 0; i < m_connections.size(); i++) {
-    if ((m_connections[i].m_source_neuron_idx == a_from) &&
-        (m_connections[i].m_target_neuron_idx == a_to)) {
-      return i;
-    }
+    m_connections[i].m_weight = m_hebb_weights[i];
   }
+}
 
-  return -1;
+void NeuralNetwork::ActivateAndAdapt(Parameters &a_Parameters) {
+  // the signals and the weight steps, in one sweep
+  HebbianSweep(a_Parameters.MaxWeight);
+
+  // Add the signals to the target neurons and write the weights back
+  for (unsigned int i = 0; i < m_connections.size(); i++) {
+    m_neurons[m_hebb_targets[i]].m_activesum += m_hebb_signals[i];
+    m_connections[i].m_signal = m_hebb_signals[i];
+    m_connections[i].m_weight = m_hebb_weights[i];
+  }
+  // Now loop nodes_activesums, pass the signals through the activation function
+  // and store the result back to nodes_activations
+  // also skip inputs since they do not get an activation
+  for (unsigned int i = m_num_inputs; i < m_neurons.size(); i++) {
+    double x = m_neurons[i].m_activesum;
+    m_neurons[i].m_activesum = 0;
+    // Apply the activation function
+    double y = af_apply(m_neurons[i].m_activation_function_type, x,
+                        m_neurons[i].m_a, m_neurons[i].m_b);
+    m_neurons[i].m_activation = y;
+  }
 }
 
 void NeuralNetwork::RTRL_update_gradients() {
-  // for every neuron
+  const unsigned int t_num_conns = m_connections.size();
+  double *t_sum = m_rtrl_scratch.data();
+
+  // for every neuron, in order. Rows of lower neurons are already updated
+  // when they are read, the row of the neuron itself is only written at the
+  // end.
   for (unsigned int k = m_num_inputs; k < m_neurons.size(); k++) {
-    // for all possible connections
-    for (unsigned int i = m_num_inputs; i < m_neurons.size(); i++)
-      // to
-      for (unsigned int j = 0; j < m_neurons.size(); j++) // from
-      {
-        int t_idx = ConnectionExists(i, j);
-        if (t_idx != -1) {
-          // double t_derivative = unsigned_sigmoid_derivative(
-          // m_neurons[k].m_activation );
-          double t_derivative = 0;
-          if (m_neurons[k].m_activation_function_type ==
-              NEAT::UNSIGNED_SIGMOID) {
-            t_derivative =
-                unsigned_sigmoid_derivative(m_neurons[k].m_activation);
-          } else if (m_neurons[k].m_activation_function_type == NEAT::TANH) {
-            t_derivative = tanh_derivative(m_neurons[k].m_activation);
-          }
-
-          double t_sum = 0;
-          // calculate the other sum
-          for (unsigned int l = 0; l < m_neurons.size(); l++) {
-            int t_l_idx = ConnectionExists(k, l);
-            if (t_l_idx != -1) {
-              t_sum += m_connections[t_l_idx].m_weight *
-                       m_neurons[l].m_sensitivity_matrix[i][j];
-            }
-          }
-
-          if (i == k) {
-            t_sum += m_neurons[j].m_activation;
-          }
-          m_neurons[k].m_sensitivity_matrix[i][j] = t_derivative * t_sum;
-        } else {
-          m_neurons[k].m_sensitivity_matrix[i][j] = 0;
-        }
+    double *t_row = &m_rtrl_sensitivity[(k - m_num_inputs) * t_num_conns];
+
+    double t_derivative = 0;
+    if (m_neurons[k].m_activation_function_type == NEAT::UNSIGNED_SIGMOID) {
+      t_derivative = unsigned_sigmoid_derivative(m_neurons[k].m_activation);
+    } else if (m_neurons[k].m_activation_function_type == NEAT::TANH) {
+      t_derivative = tanh_derivative(m_neurons[k].m_activation);
+    }
+
+    std::fill(t_sum, t_sum + t_num_conns, 0.0);
+
+    // the recurrent sum over the incoming connections of k. Inputs have no
+    // sensitivities, so they contribute nothing.
+    for (unsigned int e = m_rtrl_in_start[k]; e < m_rtrl_in_start[k + 1];
+         e++) {
+      unsigned int l = m_rtrl_in_source[e];
+      if (l < m_num_inputs) {
+        continue;
+      }
+      const double t_w = m_connections[m_rtrl_in_conn[e]].m_weight;
+      const double *t_lrow =
+          &m_rtrl_sensitivity[(l - m_num_inputs) * t_num_conns];
+      for (unsigned int c = 0; c < t_num_conns; c++) {
+        t_sum[c] += t_w * t_lrow[c];
       }
+    }
+
+    // the direct term, for the weights going into k
+    for (unsigned int e = m_rtrl_in_start[k]; e < m_rtrl_in_start[k + 1];
+         e++) {
+      t_sum[m_rtrl_in_conn[e]] += m_neurons[m_rtrl_in_source[e]].m_activation;
+    }
+
+    for (unsigned int c = 0; c < t_num_conns; c++) {
+      t_row[c] = t_derivative * t_sum[c];
+    }
   }
 }
 
 // please pay attention. notice here only one output is assumed
 void NeuralNetwork::RTRL_update_error(double a_target) {
-  // add to total error
-  m_total_error = (a_target - Output()[0]);
-  // adjust each weight
-  for (unsigned int i = 0; i < m_neurons.size(); i++) // to
-  {
-    for (unsigned int j = 0; j < m_neurons.size(); j++) // from
-    {
-      int t_idx = ConnectionExists(i, j);
-      if (t_idx != -1) {
-        // we know the first output's index is m_num_inputs
-        double t_delta =
-            m_total_error * m_neurons[m_num_inputs].m_sensitivity_matrix[i][j];
-        m_total_weight_change[t_idx] += t_delta * LEARNING_RATE;
-      }
+  m_rtrl_error.resize(1);
+  m_rtrl_error[0] = a_target - m_neurons[m_num_inputs].m_activation;
+  RTRL_accumulate_error(1);
+}
+
+void NeuralNetwork::RTRL_update_error(const std::vector<double> &a_targets) {
+  unsigned int t_num = std::min(static_cast<unsigned int>(a_targets.size()),
+                                m_num_outputs);
+
+  // the outputs follow the inputs
+  m_rtrl_error.resize(t_num);
+  for (unsigned int o = 0; o < t_num; o++) {
+    m_rtrl_error[o] = a_targets[o] - m_neurons[m_num_inputs + o].m_activation;
+  }
+  RTRL_accumulate_error(t_num);
+}
+
+void NeuralNetwork::RTRL_accumulate_error(unsigned int a_num_outputs) {
+  const unsigned int t_num_conns = m_connections.size();
+  double *t_change = m_total_weight_change.data();
+
+  // Connections without a tracked sensitivity have zero rows, so every row
+  // can be swept in full.
+  for (unsigned int o = 0; o < a_num_outputs; o++) {
+    const double t_err = m_rtrl_error[o];
+    const double *t_row = &m_rtrl_sensitivity[o * t_num_conns];
+    for (unsigned int c = 0; c < t_num_conns; c++) {
+      t_change[c] += (t_err * t_row[c]) * LEARNING_RATE;
     }
+    m_total_error += t_err * t_err;
   }
+  m_rtrl_steps++;
 }
 
-void NeuralNetwork::RTRL_update_weights() {
+void NeuralNetwork::RTRL_update_weights(bool a_Average) {
+  double t_scale = 1.0;
+  if (a_Average && (m_rtrl_steps > 1)) {
+    t_scale = 1.0 / m_rtrl_steps;
+  }
+
   for (unsigned int i = 0; i < m_connections.size(); i++) {
-    m_connections[i].m_weight += m_total_weight_change[i];
+    m_connections[i].m_weight += m_total_weight_change[i] * t_scale;
     m_total_weight_change[i] = 0; // clear this out
   }
+  m_hebb_current = false;
   m_total_error = 0;
+  m_rtrl_steps = 0;
 }
 
 void NeuralNetwork::Save(const char *a_filename) {
@@ -664,62 +807,66 @@ void NeuralNetwork::Save(const char *a_filename) {
 }
 
 void NeuralNetwork::Save(FILE *a_file) {
-  fprintf(a_file, "NNstart\n");
+  TextWriter t_out(a_file);
+  t_out.Put("NNstart");
+  t_out.EndLine();
   // save num inputs/outputs and stuff
-  fprintf(a_file, "%d %d\n", m_num_inputs, m_num_outputs);
+  t_out.Put(m_num_inputs);
+  t_out.Put(m_num_outputs);
+  t_out.EndLine();
   // save neurons
   for (unsigned int i = 0; i < m_neurons.size(); i++) {
     // TYPE .. A .. B .. time_const .. bias .. activation_function_type ..
     // split_y
-    fprintf(a_file, "neuron %d %3.18f %3.18f %3.18f %3.18f %d %3.18f\n",
-            static_cast<int>(m_neurons[i].m_type), m_neurons[i].m_a,
-            m_neurons[i].m_b, m_neurons[i].m_timeconst, m_neurons[i].m_bias,
-            static_cast<int>(m_neurons[i].m_activation_function_type),
-            m_neurons[i].m_split_y);
+    t_out.Put("neuron");
+    t_out.Put(static_cast<int>(m_neurons[i].m_type));
+    t_out.Put(m_neurons[i].m_a, 18);
+    t_out.Put(m_neurons[i].m_b, 18);
+    t_out.Put(m_neurons[i].m_timeconst, 18);
+    t_out.Put(m_neurons[i].m_bias, 18);
+    t_out.Put(static_cast<int>(m_neurons[i].m_activation_function_type));
+    t_out.Put(GetNeuronMetadataByIndex(i).m_split_y, 18);
+    t_out.EndLine();
   }
   // save connections
   for (unsigned int i = 0; i < m_connections.size(); i++) {
     // from .. to .. weight.. isrecur
-    fprintf(a_file, "connection %d %d %3.18f %d %3.18f %3.18f\n",
-            m_connections[i].m_source_neuron_idx,
-            m_connections[i].m_target_neuron_idx, m_connections[i].m_weight,
-            static_cast<int>(m_connections[i].m_recur_flag),
-            m_connections[i].m_hebb_rate, m_connections[i].m_hebb_pre_rate);
+    t_out.Put("connection");
+    t_out.Put(m_connections[i].m_source_neuron_idx);
+    t_out.Put(m_connections[i].m_target_neuron_idx);
+    t_out.Put(m_connections[i].m_weight, 18);
+    t_out.Put(static_cast<int>(m_connections[i].m_recur_flag));
+    t_out.Put(m_connections[i].m_hebb_rate, 18);
+    t_out.Put(m_connections[i].m_hebb_pre_rate, 18);
+    t_out.EndLine();
   }
   // end
-  fprintf(a_file, "NNend\n\n");
+  t_out.Put("NNend");
+  t_out.EndLine();
+  t_out.EndLine();
 }
 
 bool NeuralNetwork::Load(std::ifstream &a_DataFile) {
-  std::string t_str;
-  bool t_no_start = true, t_no_end = true;
-
-  if (!a_DataFile) {
-    std::ostringstream tStream;
-    tStream << "NN file error!" << std::endl;
-    //    throw NS::Exception(tStream.str());
-  }
+  TextReader t_reader(a_DataFile);
+  return Load(t_reader);
+}
 
+bool NeuralNetwork::Load(TextReader &a_Reader) {
   // search for NNstart
-  do {
-    a_DataFile >> t_str;
-    if (t_str == "NNstart")
-      t_no_start = false;
-
-  } while ((t_str != "NNstart") && (!a_DataFile.eof()));
-
-  if (t_no_start)
+  if (!a_Reader.SkipPast("NNstart")) {
     return false;
+  }
 
   Clear();
 
   // read in the input/output dimentions
-  a_DataFile >> m_num_inputs;
-  a_DataFile >> m_num_outputs;
+  a_Reader.Get(m_num_inputs);
+  a_Reader.Get(m_num_outputs);
 
   // read in all data
+  std::string_view t_str;
   do {
-    a_DataFile >> t_str;
+    t_str = a_Reader.Next();
 
     // a neuron?
     if (t_str == "neuron") {
@@ -728,19 +875,19 @@ bool NeuralNetwork::Load(std::ifstream &a_DataFile) {
       // for type and aftype
       int t_type, t_aftype;
 
-      a_DataFile >> t_type;
-      a_DataFile >> t_n.m_a;
-      a_DataFile >> t_n.m_b;
-      a_DataFile >> t_n.m_timeconst;
-      a_DataFile >> t_n.m_bias;
-      a_DataFile >> t_aftype;
-      a_DataFile >> t_n.m_split_y;
+      a_Reader.Get(t_type);
+      a_Reader.Get(t_n.m_a);
+      a_Reader.Get(t_n.m_b);
+      a_Reader.Get(t_n.m_timeconst);
+      a_Reader.Get(t_n.m_bias);
+      a_Reader.Get(t_aftype);
+      a_Reader.Get(t_n.m_split_y);
 
       t_n.m_type = static_cast<NEAT::NeuronType>(t_type);
       t_n.m_activation_function_type =
           static_cast<NEAT::ActivationFunction>(t_aftype);
 
-      m_neurons.push_back(t_n);
+      AddNeuron(t_n);
     }
 
     // a connection?
@@ -749,34 +896,29 @@ bool NeuralNetwork::Load(std::ifstream &a_DataFile) {
 
       int t_isrecur;
 
-      a_DataFile >> t_c.m_source_neuron_idx;
-      a_DataFile >> t_c.m_target_neuron_idx;
-      a_DataFile >> t_c.m_weight;
-      a_DataFile >> t_isrecur;
+      a_Reader.Get(t_c.m_source_neuron_idx);
+      a_Reader.Get(t_c.m_target_neuron_idx);
+      a_Reader.Get(t_c.m_weight);
+      a_Reader.Get(t_isrecur);
 
-      a_DataFile >> t_c.m_hebb_rate;
-      a_DataFile >> t_c.m_hebb_pre_rate;
+      a_Reader.Get(t_c.m_hebb_rate);
+      a_Reader.Get(t_c.m_hebb_pre_rate);
 
       t_c.m_recur_flag = static_cast<bool>(t_isrecur);
 
       m_connections.push_back(t_c);
     }
-
-    if (t_str == "NNend")
-      t_no_end = false;
-  } while ((t_str != "NNend") && (!a_DataFile.eof()));
-
-  if (t_no_end) {
-    std::ostringstream tStream;
-    tStream << "NNend not found in file!" << std::endl;
-    //    throw NS::Exception(tStream.str());
-  }
+  } while ((t_str != "NNend") && !t_str.empty());
 
   return true;
 }
+
 bool NeuralNetwork::Load(const char *a_filename) {
-  std::ifstream t_DataFile(a_filename);
-  return Load(t_DataFile);
+  TextReader t_reader;
+  if (!t_reader.Open(a_filename)) {
+    return false;
+  }
+  return Load(t_reader);
 }
 
 }; // namespace NEAT
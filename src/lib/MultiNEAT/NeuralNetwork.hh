@@ -35,6 +35,11 @@
 
 namespace NEAT {
 
+class TextReader;
+
+// Integration schemes for leaky integrator (CTRNN) networks
+enum LeakyIntegrator { LEAKY_EULER, LEAKY_RK2, LEAKY_RK4 };
+
 class Connection {
 public:
   int m_source_neuron_idx; // index of source neuron
@@ -62,7 +67,9 @@ public:
   }
 };
 
-class Neuron {
+// The state of a neuron that activation touches. The network keeps an array
+// of these, so it is kept to a cache line.
+class NeuronState {
 public:
   double m_activesum; // the synaptic input
   double
@@ -71,16 +78,35 @@ public:
   double m_a, m_b, m_timeconst, m_bias; // misc parameters
   double m_membrane_potential;          // used in leaky integrator mode
   ActivationFunction m_activation_function_type;
+  NeuronType m_type;
+};
 
+// Displaying and substrate data of a neuron. The network only allocates a
+// table of these once some neuron carries any.
+class NeuronMetadata {
+public:
   // displaying and stuff
   double m_x, m_y, m_z;
   double m_sx, m_sy, m_sz;
   std::vector<double> m_substrate_coords;
   double m_split_y;
-  NeuronType m_type;
 
-  // the sensitivity matrix of this neuron (for RTRL learning)
-  std::vector<std::vector<double>> m_sensitivity_matrix;
+  NeuronMetadata()
+      : m_x(0), m_y(0), m_z(0), m_sx(0), m_sy(0), m_sz(0), m_split_y(0) {}
+
+  bool IsEmpty() const {
+    return m_substrate_coords.empty() && (m_split_y == 0) && (m_x == 0) &&
+           (m_y == 0) && (m_z == 0) && (m_sx == 0) && (m_sy == 0) &&
+           (m_sz == 0);
+  }
+};
+
+// A complete neuron, as it is added to and read back from a network
+class Neuron : public NeuronState, public NeuronMetadata {
+public:
+  Neuron() {}
+  Neuron(const NeuronState &a_state, const NeuronMetadata &a_meta)
+      : NeuronState(a_state), NeuronMetadata(a_meta) {}
 
   // comparison operator (nessesary for boost::python)
   bool operator==(Neuron const &other) const {
@@ -94,22 +120,119 @@ public:
   }
 };
 
+// Read-only view of the output activations of a network. It stays valid
+// until neurons are added or removed.
+class OutputView {
+  const NeuronState *m_first;
+  unsigned int m_size;
+
+public:
+  OutputView(const NeuronState *a_first, unsigned int a_size)
+      : m_first(a_first), m_size(a_size) {}
+
+  double operator[](unsigned int a_idx) const {
+    return m_first[a_idx].m_activation;
+  }
+  unsigned int size() const { return m_size; }
+};
+
+// Identifies one BuildPhenotype() call. The genome and the network it built
+// hold the same stamp. Copies start without one, so only the network that was
+// built is ever taken for it. Genome copies take the value with Share().
+class PhenotypeStamp {
+  unsigned long long m_value;
+
+public:
+  PhenotypeStamp() : m_value(0) {}
+  PhenotypeStamp(const PhenotypeStamp &) : m_value(0) {}
+  PhenotypeStamp &operator=(const PhenotypeStamp &) {
+    m_value = 0;
+    return *this;
+  }
+
+  // Gives this and a_Other a value no other stamp had
+  void Renew(PhenotypeStamp &a_Other);
+  void Clear() { m_value = 0; }
+  void Share(const PhenotypeStamp &a_Other) { m_value = a_Other.m_value; }
+  unsigned long long Value() const { return m_value; }
+
+  bool Matches(const PhenotypeStamp &a_Other) const {
+    return (m_value != 0) && (m_value == a_Other.m_value);
+  }
+};
+
 class NeuralNetwork {
   /////////////////////
   // RTRL variables
+  // Sum of squared output errors since the last weight update
   double m_total_error;
+  // Timesteps accumulated since the last weight update
+  unsigned int m_rtrl_steps;
+  // Per-output error of the last RTRL_update_error() call
+  std::vector<double> m_rtrl_error;
 
   // Always the size of m_connections
   std::vector<double> m_total_weight_change;
+
+  // Sensitivities of every non-input neuron to every connection weight, one
+  // row of m_connections.size() values per neuron, starting at neuron
+  // m_num_inputs. Only the first connection between a pair of neurons is
+  // tracked, the entries of the others stay zero.
+  std::vector<double> m_rtrl_sensitivity;
+  std::vector<double> m_rtrl_scratch;
+
+  // Incoming adjacency of each neuron (CSR). For every distinct source the
+  // index of its first connection is kept, sources in ascending order.
+  std::vector<unsigned int> m_rtrl_in_start;
+  std::vector<unsigned int> m_rtrl_in_source;
+  std::vector<unsigned int> m_rtrl_in_conn;
+
+  // The connections as separate arrays, for the Hebbian kernels. They are
+  // taken from m_connections when m_hebb_current is false, and the kernels
+  // write the weights they change back to m_connections.
+  std::vector<double> m_hebb_weights;
+  std::vector<double> m_hebb_rates;
+  std::vector<double> m_hebb_pre_rates;
+  std::vector<int> m_hebb_sources;
+  std::vector<int> m_hebb_targets;
+  std::vector<double> m_hebb_signals;
+  std::vector<double> m_hebb_activations;
+  // the largest |weight| in m_hebb_weights
+  double m_hebb_max_weight;
+  bool m_hebb_current;
+
+  // Takes the arrays above from m_connections if they are not current, then
+  // the signals and one Hebbian step of every connection into them
+  void HebbianSweep(double a_Limit);
+
+  // adds the weight changes for the first a_num_outputs entries of
+  // m_rtrl_error
+  void RTRL_accumulate_error(unsigned int a_num_outputs);
   /////////////////////
 
-  // returns the index if that connection exists or -1 otherwise
-  int ConnectionExists(int a_to, int a_from);
+  // Scratch state for the multi-step ActivateLeaky()
+  std::vector<double> m_leaky_rate; // dt / time constant of each neuron
+  std::vector<double> m_leaky_potential;
+  std::vector<double> m_leaky_activation;
+  std::vector<double> m_leaky_sum;
+  std::vector<double> m_leaky_k; // RK stages and trial state
+
+  // Stores a_Rate * (synaptic input - potential) for every non-input neuron
+  // into a_Out, with the activations taken from the potentials in a_Potential
+  void LeakyDerivative(const double *a_Potential, double *a_Out);
+
+  // Scratch state for ActivateBatch(), neuron-major
+  std::vector<double> m_batch_activesum;
+  std::vector<double> m_batch_activation;
 
 public:
   unsigned int m_num_inputs, m_num_outputs;
   std::vector<Connection> m_connections; // array size - number of connections
-  std::vector<Neuron> m_neurons;
+  std::vector<NeuronState> m_neurons;
+  // Either empty or the size of m_neurons. Use AddNeuron() to keep it so.
+  std::vector<NeuronMetadata> m_neuron_meta;
+  // Set by Genome::BuildPhenotype()
+  PhenotypeStamp m_stamp;
 
   NeuralNetwork(bool a_Minimal); // if given false, the constructor will create
                                  // a standard XOR network topology.
@@ -122,28 +245,79 @@ public:
   void Activate();                 // any activation functions are supported
   void ActivateUseInternalBias();  // like Activate() but uses m_bias as well
   void ActivateLeaky(double step); // activates in leaky integrator mode
+  // Integrates a_Substeps steps of a_dtime each. LEAKY_EULER gives the same
+  // result as calling ActivateLeaky(a_dtime) a_Substeps times.
+  void ActivateLeaky(double a_dtime, unsigned int a_Substeps,
+                     LeakyIntegrator a_Method = LEAKY_EULER);
+
+  // Evaluates a_BatchSize independent queries like Activate() does. Every
+  // query starts from a flushed network, takes a_InputSize values from
+  // a_Inputs and is activated a_Steps times. a_Outputs receives NumOutputs()
+  // values per query. The network's own activations are left untouched.
+  void ActivateBatch(const std::vector<double> &a_Inputs,
+                     unsigned int a_InputSize, unsigned int a_BatchSize,
+                     unsigned int a_Steps, std::vector<double> &a_Outputs);
 
   void RTRL_update_gradients();
-  void RTRL_update_error(double a_target);
-  void RTRL_update_weights(); // performs the backprop step
+  void RTRL_update_error(double a_target); // uses the first output only
+  // Accumulates the weight changes for all outputs at once. Can be called for
+  // several timesteps before RTRL_update_weights() to train in mini-batches.
+  void RTRL_update_error(const std::vector<double> &a_targets);
+  // performs the backprop step. If a_Average is set, the accumulated change
+  // is divided by the number of timesteps in the batch.
+  void RTRL_update_weights(bool a_Average = false);
+  double RTRL_total_error() const { return m_total_error; }
 
   // Hebbian learning
   void Adapt(Parameters &a_Parameters);
+  // Activate() and a Hebbian step in one sweep over the connections. Each
+  // weight first carries its signal and then takes the step, from the
+  // activations the signal was taken from. Unlike Activate() followed by
+  // Adapt(), the step does not see the activations this call computes.
+  void ActivateAndAdapt(Parameters &a_Parameters);
+
+  // Call after changing m_connections directly. Flush(), Clear() and
+  // AddConnection() do so already.
+  void ConnectionsChanged() { m_hebb_current = false; }
 
   void Flush();     // clears all activations
   void FlushCube(); // clears the sensitivity cube
 
-  void Input(std::vector<double> &a_Inputs);
+  void Input(const std::vector<double> &a_Inputs);
+  void Input(const double *a_Inputs, size_t a_Count);
 
-  std::vector<double> Output();
+  std::vector<double> Output() const;
+  // copies up to a_Count outputs without allocating
+  void OutputInto(double *a_Outputs, size_t a_Count) const;
+  OutputView Outputs() const {
+    return OutputView(m_neurons.data() + m_num_inputs, m_num_outputs);
+  }
 
   // accessor methods
-  void AddNeuron(const Neuron &a_n) { m_neurons.push_back(a_n); }
-  void AddConnection(const Connection &a_c) { m_connections.push_back(a_c); }
+  void AddNeuron(const Neuron &a_n) {
+    m_neurons.push_back(a_n);
+    if (!m_neuron_meta.empty() || !a_n.IsEmpty()) {
+      m_neuron_meta.resize(m_neurons.size() - 1);
+      m_neuron_meta.push_back(a_n);
+    }
+  }
+  void AddConnection(const Connection &a_c) {
+    m_connections.push_back(a_c);
+    m_hebb_current = false;
+  }
   Connection GetConnectionByIndex(unsigned int a_idx) const {
     return m_connections[a_idx];
   }
-  Neuron GetNeuronByIndex(unsigned int a_idx) const { return m_neurons[a_idx]; }
+  Neuron GetNeuronByIndex(unsigned int a_idx) const {
+    return Neuron(m_neurons[a_idx], GetNeuronMetadataByIndex(a_idx));
+  }
+  NeuronMetadata GetNeuronMetadataByIndex(unsigned int a_idx) const {
+    if (a_idx < m_neuron_meta.size()) {
+      return m_neuron_meta[a_idx];
+    }
+    return NeuronMetadata();
+  }
+  bool HasNeuronMetadata() const { return !m_neuron_meta.empty(); }
   void SetInputOutputDimentions(const unsigned int a_i,
                                 const unsigned int a_o) {
     m_num_inputs = a_i;
@@ -155,8 +329,15 @@ public:
   // clears the network and makes it a minimal one
   void Clear() {
     m_neurons.clear();
+    m_neuron_meta.clear();
+    m_stamp.Clear();
     m_connections.clear();
     m_total_weight_change.clear();
+    m_rtrl_sensitivity.clear();
+    m_rtrl_in_start.clear();
+    m_rtrl_in_source.clear();
+    m_rtrl_in_conn.clear();
+    m_hebb_current = false;
     SetInputOutputDimentions(0, 0);
   }
 
@@ -178,6 +359,7 @@ public:
   // save/load from already opened files for reading/writing
   void Save(FILE *a_file);
   bool Load(std::ifstream &a_DataFile);
+  bool Load(TextReader &a_Reader);
 };
 
 }; // namespace NEAT
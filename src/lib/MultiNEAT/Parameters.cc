@@ -28,854 +28,349 @@
 // global parameters object
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <MultiNEAT/Checkpoint.hh>
 #include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/TextIO.hh>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 namespace NEAT {
 
-// Load defaults
-void Parameters::Reset() {
-  ////////////////////
-  // Basic parameters
-  ////////////////////
-
-  // Size of population
-  PopulationSize = 300;
-
-  // If true, this enables dynamic compatibility thresholding
-  // It will keep the number of species between MinSpecies and MaxSpecies
-  DynamicCompatibility = true;
-
-  // Minimum number of species
-  MinSpecies = 5;
-
-  // Maximum number of species
-  MaxSpecies = 10;
-
-  // Don't wipe the innovation database each generation?
-  InnovationsForever = true;
-
-  // Allow clones or nearly identical genomes to exist simultaneously in the
-  // population. This is useful for non-deterministic environments, as the same
-  // individual will get more than one chance to prove himself, also there will
-  // be more chances the same individual to mutate in different ways. The
-  // drawback is greatly increased time for reproduction. If you want to search
-  // quickly, yet less efficient, leave this to true.
-  AllowClones = true;
-
-  // Keep an archive of genomes and don't allow any new genome to exist in the
-  // archive or the population
-  ArchiveEnforcement = false;
-
-  // When true, don't have a special bias neuron and treat all inputs equal
-  DontUseBiasNeuron = false;
+// A parameter with its key in the text format, NULL if it is not in the
+// text, and its default. Only the member of its type is set.
+struct ParameterField {
+  const char *m_Name;
+  int Parameters::*m_Int;
+  unsigned int Parameters::*m_Unsigned;
+  double Parameters::*m_Double;
+  bool Parameters::*m_Bool;
+  double m_Default;
+};
+
+static constexpr ParameterField Field(const char *a_Name,
+                                      int Parameters::*a_Member,
+                                      double a_Default) {
+  return ParameterField{a_Name, a_Member, NULL, NULL, NULL, a_Default};
+}
+static constexpr ParameterField Field(const char *a_Name,
+                                      unsigned int Parameters::*a_Member,
+                                      double a_Default) {
+  return ParameterField{a_Name, NULL, a_Member, NULL, NULL, a_Default};
+}
+static constexpr ParameterField Field(const char *a_Name,
+                                      double Parameters::*a_Member,
+                                      double a_Default) {
+  return ParameterField{a_Name, NULL, NULL, a_Member, NULL, a_Default};
+}
+static constexpr ParameterField Field(const char *a_Name,
+                                      bool Parameters::*a_Member,
+                                      double a_Default) {
+  return ParameterField{a_Name, NULL, NULL, NULL, a_Member, a_Default};
+}
 
-  // When false, this prevents any recurrent pathways in the genomes from
-  // forming
-  AllowLoops = true;
+// Every plain parameter, in checkpoint order. Reset(), the text format and
+// the checkpoints all go by this table. New parameters go at the end,
+// together with a new checkpoint version. The comments of the members are
+// in Parameters.hh.
+static const ParameterField PARAMETER_FIELDS[] = {
+    Field("PopulationSize", &Parameters::PopulationSize, 300),
+    Field("DynamicCompatibility", &Parameters::DynamicCompatibility, true),
+    Field("MinSpecies", &Parameters::MinSpecies, 5),
+    Field("MaxSpecies", &Parameters::MaxSpecies, 10),
+    Field("InnovationsForever", &Parameters::InnovationsForever, true),
+    Field("AllowClones", &Parameters::AllowClones, true),
+    Field("ArchiveEnforcement", &Parameters::ArchiveEnforcement, false),
+    Field("NormalizeGenomeSize", &Parameters::NormalizeGenomeSize, true),
+    Field("YoungAgeThreshold", &Parameters::YoungAgeThreshold, 5),
+    Field("YoungAgeFitnessBoost", &Parameters::YoungAgeFitnessBoost, 1.1),
+    Field("SpeciesDropoffAge", &Parameters::SpeciesMaxStagnation, 50),
+    Field("StagnationDelta", &Parameters::StagnationDelta, 0.0),
+    Field("OldAgeThreshold", &Parameters::OldAgeThreshold, 30),
+    Field("OldAgePenalty", &Parameters::OldAgePenalty, 0.5),
+    Field("DetectCompetetiveCoevolutionStagnation",
+          &Parameters::DetectCompetetiveCoevolutionStagnation, false),
+    Field("KillWorstSpeciesEach", &Parameters::KillWorstSpeciesEach, 15),
+    Field("KillWorstAge", &Parameters::KillWorstAge, 10),
+    Field("SurvivalRate", &Parameters::SurvivalRate, 0.25),
+    Field("CrossoverRate", &Parameters::CrossoverRate, 0.7),
+    Field("OverallMutationRate", &Parameters::OverallMutationRate, 0.25),
+    Field("InterspeciesCrossoverRate",
+          &Parameters::InterspeciesCrossoverRate, 0.0001),
+    Field("MultipointCrossoverRate",
+          &Parameters::MultipointCrossoverRate, 0.75),
+    Field("RouletteWheelSelection", &Parameters::RouletteWheelSelection, false),
+    Field("TournamentSize", &Parameters::TournamentSize, 4),
+    Field("Elitism", &Parameters::EliteFraction, 0.01),
+    Field("PhasedSearching", &Parameters::PhasedSearching, false),
+    Field("DeltaCoding", &Parameters::DeltaCoding, false),
+    Field("SimplifyingPhaseMPCThreshold",
+          &Parameters::SimplifyingPhaseMPCThreshold, 20),
+    Field("SimplifyingPhaseStagnationThreshold",
+          &Parameters::SimplifyingPhaseStagnationThreshold, 30),
+    Field("ComplexityFloorGenerations",
+          &Parameters::ComplexityFloorGenerations, 40),
+    Field("NoveltySearch_K", &Parameters::NoveltySearch_K, 15),
+    Field("NoveltySearch_P_min", &Parameters::NoveltySearch_P_min, 0.5),
+    Field("NoveltySearch_Dynamic_Pmin",
+          &Parameters::NoveltySearch_Dynamic_Pmin, true),
+    Field("NoveltySearch_No_Archiving_Stagnation_Threshold",
+          &Parameters::NoveltySearch_No_Archiving_Stagnation_Threshold, 150),
+    Field("NoveltySearch_Pmin_lowering_multiplier",
+          &Parameters::NoveltySearch_Pmin_lowering_multiplier, 0.9),
+    Field("NoveltySearch_Pmin_min", &Parameters::NoveltySearch_Pmin_min, 0.05),
+    Field("NoveltySearch_Quick_Archiving_Min_Evaluations",
+          &Parameters::NoveltySearch_Quick_Archiving_Min_Evaluations, 8),
+    Field("NoveltySearch_Pmin_raising_multiplier",
+          &Parameters::NoveltySearch_Pmin_raising_multiplier, 1.1),
+    Field("NoveltySearch_Recompute_Sparseness_Each",
+          &Parameters::NoveltySearch_Recompute_Sparseness_Each, 25),
+    Field("MutateAddNeuronProb", &Parameters::MutateAddNeuronProb, 0.01),
+    Field("SplitRecurrent", &Parameters::SplitRecurrent, true),
+    Field("SplitLoopedRecurrent", &Parameters::SplitLoopedRecurrent, true),
+    Field("NeuronTries", &Parameters::NeuronTries, 64),
+    Field("MutateAddLinkProb", &Parameters::MutateAddLinkProb, 0.03),
+    Field("MutateAddLinkFromBiasProb",
+          &Parameters::MutateAddLinkFromBiasProb, 0.0),
+    Field("MutateRemLinkProb", &Parameters::MutateRemLinkProb, 0.0),
+    Field("MutateRemSimpleNeuronProb",
+          &Parameters::MutateRemSimpleNeuronProb, 0.0),
+    Field("LinkTries", &Parameters::LinkTries, 32),
+    Field("RecurrentProb", &Parameters::RecurrentProb, 0.25),
+    Field("RecurrentLoopProb", &Parameters::RecurrentLoopProb, 0.25),
+    Field("MutateWeightsProb", &Parameters::MutateWeightsProb, 0.90),
+    Field("MutateWeightsSevereProb",
+          &Parameters::MutateWeightsSevereProb, 0.25),
+    Field("WeightMutationRate", &Parameters::WeightMutationRate, 1.0),
+    Field("WeightReplacementRate", &Parameters::WeightReplacementRate, 0.2),
+    Field("WeightMutationMaxPower", &Parameters::WeightMutationMaxPower, 1.0),
+    Field("WeightReplacementMaxPower",
+          &Parameters::WeightReplacementMaxPower, 1.0),
+    Field("MaxWeight", &Parameters::MaxWeight, 8.0),
+    Field("MutateActivationAProb", &Parameters::MutateActivationAProb, 0.0),
+    Field("MutateActivationBProb", &Parameters::MutateActivationBProb, 0.0),
+    Field("ActivationAMutationMaxPower",
+          &Parameters::ActivationAMutationMaxPower, 0.0),
+    Field("ActivationBMutationMaxPower",
+          &Parameters::ActivationBMutationMaxPower, 0.0),
+    Field("TimeConstantMutationMaxPower",
+          &Parameters::TimeConstantMutationMaxPower, 0.0),
+    Field("BiasMutationMaxPower", &Parameters::BiasMutationMaxPower, 1.0),
+    Field("MinActivationA", &Parameters::MinActivationA, 1.0),
+    Field("MaxActivationA", &Parameters::MaxActivationA, 1.0),
+    Field("MinActivationB", &Parameters::MinActivationB, 0.0),
+    Field("MaxActivationB", &Parameters::MaxActivationB, 0.0),
+    Field("MutateNeuronActivationTypeProb",
+          &Parameters::MutateNeuronActivationTypeProb, 0.0),
+    Field("ActivationFunction_SignedSigmoid_Prob",
+          &Parameters::ActivationFunction_SignedSigmoid_Prob, 0.0),
+    Field("ActivationFunction_UnsignedSigmoid_Prob",
+          &Parameters::ActivationFunction_UnsignedSigmoid_Prob, 1.0),
+    Field("ActivationFunction_Tanh_Prob",
+          &Parameters::ActivationFunction_Tanh_Prob, 0.0),
+    Field("ActivationFunction_TanhCubic_Prob",
+          &Parameters::ActivationFunction_TanhCubic_Prob, 0.0),
+    Field("ActivationFunction_SignedStep_Prob",
+          &Parameters::ActivationFunction_SignedStep_Prob, 0.0),
+    Field("ActivationFunction_UnsignedStep_Prob",
+          &Parameters::ActivationFunction_UnsignedStep_Prob, 0.0),
+    Field("ActivationFunction_SignedGauss_Prob",
+          &Parameters::ActivationFunction_SignedGauss_Prob, 0.0),
+    Field("ActivationFunction_UnsignedGauss_Prob",
+          &Parameters::ActivationFunction_UnsignedGauss_Prob, 0.0),
+    Field("ActivationFunction_Abs_Prob",
+          &Parameters::ActivationFunction_Abs_Prob, 0.0),
+    Field("ActivationFunction_SignedSine_Prob",
+          &Parameters::ActivationFunction_SignedSine_Prob, 0.0),
+    Field("ActivationFunction_UnsignedSine_Prob",
+          &Parameters::ActivationFunction_UnsignedSine_Prob, 0.0),
+    Field("ActivationFunction_Linear_Prob",
+          &Parameters::ActivationFunction_Linear_Prob, 0.0),
+    Field("ActivationFunction_Relu_Prob",
+          &Parameters::ActivationFunction_Relu_Prob, 0.0),
+    Field("ActivationFunction_Softplus_Prob",
+          &Parameters::ActivationFunction_Softplus_Prob, 0.0),
+    Field("MutateNeuronTimeConstantsProb",
+          &Parameters::MutateNeuronTimeConstantsProb, 0.0),
+    Field("MutateNeuronBiasesProb", &Parameters::MutateNeuronBiasesProb, 0.0),
+    Field("MinNeuronTimeConstant", &Parameters::MinNeuronTimeConstant, 0.0),
+    Field("MaxNeuronTimeConstant", &Parameters::MaxNeuronTimeConstant, 0.0),
+    Field("MinNeuronBias", &Parameters::MinNeuronBias, 0.0),
+    Field("MaxNeuronBias", &Parameters::MaxNeuronBias, 0.0),
+    Field("DisjointCoeff", &Parameters::DisjointCoeff, 1.0),
+    Field("ExcessCoeff", &Parameters::ExcessCoeff, 1.0),
+    Field("ActivationADiffCoeff", &Parameters::ActivationADiffCoeff, 0.0),
+    Field("ActivationBDiffCoeff", &Parameters::ActivationBDiffCoeff, 0.0),
+    Field("WeightDiffCoeff", &Parameters::WeightDiffCoeff, 0.5),
+    Field("TimeConstantDiffCoeff", &Parameters::TimeConstantDiffCoeff, 0.0),
+    Field("BiasDiffCoeff", &Parameters::BiasDiffCoeff, 0.0),
+    Field("ActivationFunctionDiffCoeff",
+          &Parameters::ActivationFunctionDiffCoeff, 0.0),
+    Field("CompatThreshold", &Parameters::CompatThreshold, 5.0),
+    Field("MinCompatThreshold", &Parameters::MinCompatThreshold, 0.2),
+    Field("CompatThresholdModifier", &Parameters::CompatThresholdModifier, 0.3),
+    Field("CompatTreshChangeInterval_Generations",
+          &Parameters::CompatTreshChangeInterval_Generations, 1),
+    Field("CompatTreshChangeInterval_Evaluations",
+          &Parameters::CompatTreshChangeInterval_Evaluations, 10),
+    Field("DontUseBiasNeuron", &Parameters::DontUseBiasNeuron, false),
+    Field("AllowLoops", &Parameters::AllowLoops, true),
+    Field("DivisionThreshold", &Parameters::DivisionThreshold, 0.03),
+    Field("VarianceThreshold", &Parameters::VarianceThreshold, 0.03),
+    Field("BandThreshold", &Parameters::BandThreshold, 0.3),
+    Field("InitialDepth", &Parameters::InitialDepth, 3),
+    Field("MaxDepth", &Parameters::MaxDepth, 3),
+    Field("IterationLevel", &Parameters::IterationLevel, 1),
+    Field("CPPN_Bias", &Parameters::CPPN_Bias, 1.0),
+    Field("Width", &Parameters::Width, 2.0),
+    Field("Height", &Parameters::Height, 2.0),
+    Field("Qtree_X", &Parameters::Qtree_X, 0.0),
+    Field("Qtree_Y", &Parameters::Qtree_Y, 0.0),
+    Field("Leo", &Parameters::Leo, false),
+    Field("LeoThreshold", &Parameters::LeoThreshold, 0.1),
+    Field("LeoSeed", &Parameters::LeoSeed, false),
+    Field("GeometrySeed", &Parameters::GeometrySeed, false),
+    Field("ES_Threads", &Parameters::ES_Threads, 1),
+    Field(NULL, &Parameters::MutateNeuronTraitsProb, 1.0),
+    Field(NULL, &Parameters::MutateLinkTraitsProb, 1.0),
+    Field(NULL, &Parameters::MutateGenomeTraitsProb, 1.0),
+};
+
+static const unsigned int NUM_PARAMETER_FIELDS =
+    sizeof(PARAMETER_FIELDS) / sizeof(PARAMETER_FIELDS[0]);
 
-  // Normalize genome size when calculating compatibility
-  NormalizeGenomeSize = true;
+// Load defaults
+void Parameters::Reset() {
+  for (unsigned int i = 0; i < NUM_PARAMETER_FIELDS; i++) {
+    const ParameterField &t_field = PARAMETER_FIELDS[i];
+    if (t_field.m_Int) {
+      this->*t_field.m_Int = static_cast<int>(t_field.m_Default);
+    } else if (t_field.m_Unsigned) {
+      this->*t_field.m_Unsigned = static_cast<unsigned int>(t_field.m_Default);
+    } else if (t_field.m_Double) {
+      this->*t_field.m_Double = t_field.m_Default;
+    } else {
+      this->*t_field.m_Bool = (t_field.m_Default != 0);
+    }
+  }
 
   // Pointer to a function that specifies custom topology/trait constraints
   // Should return true if the genome FAILS to meet the constraints
   CustomConstraints = NULL;
-
-  ////////////////////////////////
-  // GA Parameters
-  ////////////////////////////////
-
-  // AgeGens treshold, meaning if a species is below it, it is considered young
-  YoungAgeThreshold = 5;
-
-  // Fitness boost multiplier for young species (1.0 means no boost)
-  // Make sure it is >= 1.0 to avoid confusion
-  YoungAgeFitnessBoost = 1.1;
-
-  // Number of generations without improvement (stagnation) allowed for a
-  // species
-  SpeciesMaxStagnation = 50;
-
-  // Minimum jump in fitness necessary to be considered as improvement.
-  // Setting this value to 0.0 makes the system to behave like regular NEAT.
-  StagnationDelta = 0.0;
-
-  // AgeGens threshold, meaning if a species is above it, it is considered old
-  OldAgeThreshold = 30;
-
-  // Multiplier that penalizes old species.
-  // Make sure it is <= 1.0 to avoid confusion.
-  OldAgePenalty = 0.5;
-
-  // Detect competetive coevolution stagnation
-  // This kills the worst species of age >N (each X generations)
-  DetectCompetetiveCoevolutionStagnation = false;
-  // Each X generation..
-  KillWorstSpeciesEach = 15;
-  // Of age above..
-  KillWorstAge = 10;
-
-  // Percent of best individuals that are allowed to reproduce. 1.0 = 100%
-  SurvivalRate = 0.25;
-
-  // Probability for a baby to result from sexual reproduction
-  // (crossover/mating). 1.0 = 100% If asexual reprodiction is chosen, the baby
-  // will be mutated 100%
-  CrossoverRate = 0.7;
-
-  // If a baby results from sexual reproduction, this probability determines if
-  // mutation will be performed after crossover. 1.0 = 100% (always mutate after
-  // crossover)
-  OverallMutationRate = 0.25;
-
-  // Probability for a baby to result from inter-species mating.
-  InterspeciesCrossoverRate = 0.0001;
-
-  // Probability for a baby to result from Multipoint Crossover when mating. 1.0
-  // = 100% The default is the Average mating.
-  MultipointCrossoverRate = 0.75;
-
-  // Performing roulette wheel selection or not?
-  RouletteWheelSelection = false;
-
-  // For tournament selection
-  TournamentSize = 4;
-
-  // Fraction of individuals to be copied unchanged
-  EliteFraction = 0.01;
-
-  ///////////////////////////////////
-  // Phased Search parameters   //
-  ///////////////////////////////////
-
-  // Using phased search or not
-  PhasedSearching = false;
-
-  // Using delta coding or not
-  DeltaCoding = false;
-
-  // What is the MPC + base MPC needed to begin simplifying phase
-  SimplifyingPhaseMPCThreshold = 20;
-
-  // How many generations of global stagnation should have passed to enter
-  // simplifying phase
-  SimplifyingPhaseStagnationThreshold = 30;
-
-  // How many generations of MPC stagnation are needed to turn back on
-  // complexifying
-  ComplexityFloorGenerations = 40;
-
-  /////////////////////////////////////
-  // Novelty Search parameters       //
-  /////////////////////////////////////
-
-  // the K constant
-  NoveltySearch_K = 15;
-
-  // Sparseness treshold. Add to the archive if above
-  NoveltySearch_P_min = 0.5;
-
-  // Dynamic Pmin?
-  NoveltySearch_Dynamic_Pmin = true;
-
-  // How many evaluations should pass without adding to the archive
-  // in order to lower Pmin
-  NoveltySearch_No_Archiving_Stagnation_Threshold = 150;
-
-  // How should it be multiplied (make it less than 1.0)
-  NoveltySearch_Pmin_lowering_multiplier = 0.9;
-
-  // Not lower than this value
-  NoveltySearch_Pmin_min = 0.05;
-
-  // How many one-after-another additions to the archive should
-  // pass in order to raise Pmin
-  NoveltySearch_Quick_Archiving_Min_Evaluations = 8;
-
-  // How should it be multiplied (make it more than 1.0)
-  NoveltySearch_Pmin_raising_multiplier = 1.1;
-
-  // Per how many evaluations to recompute the sparseness of the population
-  NoveltySearch_Recompute_Sparseness_Each = 25;
-
-  ///////////////////////////////////
-  // Structural Mutation parameters
-  ///////////////////////////////////
-
-  // Probability for a baby to be mutated with the Add-Neuron mutation.
-  MutateAddNeuronProb = 0.01;
-
-  // Allow splitting of any recurrent links
-  SplitRecurrent = true;
-
-  // Allow splitting of looped recurrent links
-  SplitLoopedRecurrent = true;
-
-  // Probability for a baby to be mutated with the Add-Link mutation
-  MutateAddLinkProb = 0.03;
-
-  // Probability for a new incoming link to be from the bias neuron;
-  // This enforces it. A value of 0.0 doesn't mean there will not be such links
-  MutateAddLinkFromBiasProb = 0.0;
-
-  // Probability for a baby to be mutated with the Remove-Link mutation
-  MutateRemLinkProb = 0.0;
-
-  // Probability for a baby that a simple neuron will be replaced with a link
-  MutateRemSimpleNeuronProb = 0.0;
-
-  // Maximum number of tries to find 2 neurons to add/remove a link
-  LinkTries = 32;
-
-  // Probability that a link mutation will be made recurrent
-  RecurrentProb = 0.25;
-
-  // Probability that a recurrent link mutation will be looped
-  RecurrentLoopProb = 0.25;
-
-  ///////////////////////////////////
-  // Parameter Mutation parameters
-  ///////////////////////////////////
-
-  // Probability for a baby's weights to be mutated
-  MutateWeightsProb = 0.90;
-
-  // Probability for a severe (shaking) weight mutation
-  MutateWeightsSevereProb = 0.25;
-
-  // Probability for a particular gene's weight to be mutated. 1.0 = 100%
-  WeightMutationRate = 1.0;
-
-  // Maximum perturbation for a weight mutation
-  WeightMutationMaxPower = 1.0;
-
-  // Probability for a particular gene to be mutated via replacement of the
-  // weight. 1.0 = 100%
-  WeightReplacementRate = 0.2;
-
-  // Maximum magnitude of a replaced weight
-  WeightReplacementMaxPower = 1.0;
-
-  // Maximum absolute magnitude of a weight
-  MaxWeight = 8.0;
-
-  // Probability for a baby's A activation function parameters to be perturbed
-  MutateActivationAProb = 0.0;
-
-  // Probability for a baby's B activation function parameters to be perturbed
-  MutateActivationBProb = 0.0;
-
-  // Maximum magnitude for the A parameter perturbation
-  ActivationAMutationMaxPower = 0.0;
-
-  // Maximum magnitude for the B parameter perturbation
-  ActivationBMutationMaxPower = 0.0;
-
-  // Activation parameter A min/max
-  MinActivationA = 1.0;
-  MaxActivationA = 1.0;
-
-  // Activation parameter B min/max
-  MinActivationB = 0.0;
-  MaxActivationB = 0.0;
-
-  // Maximum magnitude for time costants perturbation
-  TimeConstantMutationMaxPower = 0.0;
-
-  // Maximum magnitude for biases perturbation
-  BiasMutationMaxPower = WeightMutationMaxPower;
-
-  // Probability for a baby's neuron time constant values to be mutated
-  MutateNeuronTimeConstantsProb = 0.0;
-
-  // Probability for a baby's neuron bias values to be mutated
-  MutateNeuronBiasesProb = 0.0;
-
-  // Time constant range
-  MinNeuronTimeConstant = 0.0;
-  MaxNeuronTimeConstant = 0.0;
-
-  // Bias range
-  MinNeuronBias = 0.0;
-  MaxNeuronBias = 0.0;
-
-  // Some default traits for testing
-  /*TraitParameters tp1;
-  tp1.m_ImportanceCoeff = 0.0;
-  tp1.m_MutationProb = 0.8;
-  tp1.type = "int";
-  IntTraitParameters itp1;
-  itp1.min = -5;
-  itp1.max = 5;
-  itp1.mut_power = 1;
-  itp1.mut_replace_prob = 0.1;
-  tp1.m_Details = itp1;
-  NeuronTraits["px"] = tp1;
-
-  TraitParameters tp2;
-  tp2.m_ImportanceCoeff = 0.0;
-  tp2.m_MutationProb = 0.8;
-  tp2.type = "int";
-  IntTraitParameters itp2;
-  itp2.min = -5;
-  itp2.max = 5;
-  itp2.mut_power = 1;
-  itp2.mut_replace_prob = 0.1;
-  tp2.m_Details = itp2;
-  NeuronTraits["py"] = tp2;*/
-
-  // Probability for a baby that an activation function type will be changed for
-  // a single neuron considered a structural mutation because of the large
-  // impact on fitness
-  MutateNeuronActivationTypeProb = 0.0;
-
-  // Probabilities for a particular activation function appearance
-  ActivationFunction_SignedSigmoid_Prob = 0.0;
-  ActivationFunction_UnsignedSigmoid_Prob = 1.0;
-  ActivationFunction_Tanh_Prob = 0.0;
-  ActivationFunction_TanhCubic_Prob = 0.0;
-  ActivationFunction_SignedStep_Prob = 0.0;
-  ActivationFunction_UnsignedStep_Prob = 0.0;
-  ActivationFunction_SignedGauss_Prob = 0.0;
-  ActivationFunction_UnsignedGauss_Prob = 0.0;
-  ActivationFunction_Abs_Prob = 0.0;
-  ActivationFunction_SignedSine_Prob = 0.0;
-  ActivationFunction_UnsignedSine_Prob = 0.0;
-  ActivationFunction_Linear_Prob = 0.0;
-  ActivationFunction_Relu_Prob = 0.0;
-  ActivationFunction_Softplus_Prob = 0.0;
-
-  // Trait mutation probabilities
-  MutateNeuronTraitsProb = 1.0;
-  MutateLinkTraitsProb = 1.0;
-  MutateGenomeTraitsProb = 1.0;
-
-  /////////////////////////////
-  // Genome properties params
-  /////////////////////////////
-
-  /////////////////////////////////////
-  // Speciation parameters
-  /////////////////////////////////////
-
-  // Percent of disjoint genes importance
-  DisjointCoeff = 1.0;
-
-  // Percent of excess genes importance
-  ExcessCoeff = 1.0;
-
-  // Average weight difference importance
-  WeightDiffCoeff = 0.5;
-
-  // Node-specific activation parameter A difference importance
-  ActivationADiffCoeff = 0.0;
-
-  // Node-specific activation parameter B difference importance
-  ActivationBDiffCoeff = 0.0;
-
-  // Average time constant difference importance
-  TimeConstantDiffCoeff = 0.0;
-
-  // Average bias difference importance
-  BiasDiffCoeff = 0.0;
-
-  // Activation function type difference importance
-  ActivationFunctionDiffCoeff = 0.0;
-
-  // Compatibility treshold
-  CompatThreshold = 5.0;
-
-  // Minumal value of the compatibility treshold
-  MinCompatThreshold = 0.2;
-
-  // Modifier per generation for keeping the species stable
-  CompatThresholdModifier = 0.3;
-
-  // Per how many generations to change the treshold
-  // (used in generational mode)
-  CompatTreshChangeInterval_Generations = 1;
-
-  // Per how many evaluations to change the treshold
-  // (used in steady state mode)
-  CompatTreshChangeInterval_Evaluations = 10;
-
-  //////////////////////////////
-  // ES-HyperNEAT parameters
-
-  DivisionThreshold = 0.03;
-
-  VarianceThreshold = 0.03;
-
-  // Used for Band prunning.
-  BandThreshold = 0.3;
-
-  // Max and Min Depths of the quadtree
-  InitialDepth = 3;
-  MaxDepth = 3;
-
-  // How many hidden layers before connecting nodes to output. At 0 there is
-  // one hidden layer. At 1, there are two and so on.
-  IterationLevel = 1;
-
-  // The Bias value for the CPPN queries.
-  CPPN_Bias = 1.0;
-
-  // Quadtree Dimensions
-  // The range of the tree. Typically set to 2,
-  Width = 2.0;
-
-  Height = 2.0;
-
-  // The (x, y) coordinates of the tree
-  Qtree_X = 0.0;
-
-  Qtree_Y = 0.0;
-
-  // Use Link Expression output
-  Leo = false;
-
-  // Threshold above which a connection is expressed
-  LeoThreshold = 0.1;
-
-  // Use geometric seeding. Currently only along the X axis. 1
-  LeoSeed = false;
-
-  GeometrySeed = false;
 }
 
 Parameters::Parameters() { Reset(); }
 
-int Parameters::Load(std::ifstream &a_DataFile) {
-  std::string s, tf;
-  do {
-    a_DataFile >> s;
-  } while (s != "NEAT_ParametersStart");
-
-  while (s != "NEAT_ParametersEnd") {
-    a_DataFile >> s;
+// Finds the field of a key with one hash and one compare. A seed that gives
+// every key a slot of its own is searched for once.
+class TextFieldIndex {
+  static const unsigned int SLOTS = 4096;
 
-    if (s == "PopulationSize")
-      a_DataFile >> PopulationSize;
+  uint32_t m_Seed;
+  // index of the field plus one, 0 for an empty slot
+  unsigned char m_Slots[SLOTS];
 
-    if (s == "DynamicCompatibility") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        DynamicCompatibility = true;
-      else
-        DynamicCompatibility = false;
+  static uint32_t Hash(std::string_view a_Key, uint32_t a_Seed) {
+    uint32_t t_hash = 2166136261u ^ (a_Seed * 0x9e3779b9u);
+    for (unsigned int i = 0; i < a_Key.size(); i++) {
+      t_hash ^= static_cast<unsigned char>(a_Key[i]);
+      t_hash *= 16777619u;
     }
+    return t_hash ^ (t_hash >> 16);
+  }
 
-    if (s == "MinSpecies")
-      a_DataFile >> MinSpecies;
-
-    if (s == "MaxSpecies")
-      a_DataFile >> MaxSpecies;
-
-    if (s == "InnovationsForever") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        InnovationsForever = true;
-      else
-        InnovationsForever = false;
-    }
-
-    if (s == "AllowClones") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        AllowClones = true;
-      else
-        AllowClones = false;
-    }
-
-    if (s == "NormalizeGenomeSize") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        NormalizeGenomeSize = true;
-      else
-        NormalizeGenomeSize = false;
-    }
-
-    if (s == "YoungAgeThreshold")
-      a_DataFile >> YoungAgeThreshold;
-
-    if (s == "YoungAgeFitnessBoost")
-      a_DataFile >> YoungAgeFitnessBoost;
-
-    if (s == "SpeciesDropoffAge")
-      a_DataFile >> SpeciesMaxStagnation;
-
-    if (s == "StagnationDelta")
-      a_DataFile >> StagnationDelta;
-
-    if (s == "OldAgeThreshold")
-      a_DataFile >> OldAgeThreshold;
-
-    if (s == "OldAgePenalty")
-      a_DataFile >> OldAgePenalty;
-
-    if (s == "DetectCompetetiveCoevolutionStagnation") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        DetectCompetetiveCoevolutionStagnation = true;
-      else
-        DetectCompetetiveCoevolutionStagnation = false;
-    }
-
-    if (s == "KillWorstSpeciesEa.hh")
-      a_DataFile >> KillWorstSpeciesEach;
-
-    if (s == "KillWorstAge")
-      a_DataFile >> KillWorstAge;
-
-    if (s == "SurvivalRate")
-      a_DataFile >> SurvivalRate;
-
-    if (s == "CrossoverRate")
-      a_DataFile >> CrossoverRate;
-
-    if (s == "OverallMutationRate")
-      a_DataFile >> OverallMutationRate;
-
-    if (s == "InterspeciesCrossoverRate")
-      a_DataFile >> InterspeciesCrossoverRate;
-
-    if (s == "MultipointCrossoverRate")
-      a_DataFile >> MultipointCrossoverRate;
-
-    if (s == "RouletteWheelSelection") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        RouletteWheelSelection = true;
-      else
-        RouletteWheelSelection = false;
-    }
-
-    if (s == "PhasedSearching") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        PhasedSearching = true;
-      else
-        PhasedSearching = false;
-    }
-
-    if (s == "DeltaCoding") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        DeltaCoding = true;
-      else
-        DeltaCoding = false;
-    }
-
-    if (s == "SimplifyingPhaseMPCThreshold")
-      a_DataFile >> SimplifyingPhaseMPCThreshold;
-
-    if (s == "SimplifyingPhaseStagnationThreshold")
-      a_DataFile >> SimplifyingPhaseStagnationThreshold;
-
-    if (s == "ComplexityFloorGenerations")
-      a_DataFile >> ComplexityFloorGenerations;
-
-    if (s == "NoveltySearch_K")
-      a_DataFile >> NoveltySearch_K;
-
-    if (s == "NoveltySearch_P_min")
-      a_DataFile >> NoveltySearch_P_min;
-
-    if (s == "NoveltySearch_Dynamic_Pmin") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        NoveltySearch_Dynamic_Pmin = true;
-      else
-        NoveltySearch_Dynamic_Pmin = false;
-    }
-
-    if (s == "NoveltySearch_No_Archiving_Stagnation_Threshold")
-      a_DataFile >> NoveltySearch_No_Archiving_Stagnation_Threshold;
-
-    if (s == "NoveltySearch_Pmin_lowering_multiplier")
-      a_DataFile >> NoveltySearch_Pmin_lowering_multiplier;
-
-    if (s == "NoveltySearch_Pmin_min")
-      a_DataFile >> NoveltySearch_Pmin_min;
-
-    if (s == "NoveltySearch_Quick_Archiving_Min_Evaluations")
-      a_DataFile >> NoveltySearch_Quick_Archiving_Min_Evaluations;
-
-    if (s == "NoveltySearch_Pmin_raising_multiplier")
-      a_DataFile >> NoveltySearch_Pmin_raising_multiplier;
-
-    if (s == "NoveltySearch_Recompute_Sparseness_Ea.hh")
-      a_DataFile >> NoveltySearch_Recompute_Sparseness_Each;
-
-    if (s == "MutateAddNeuronProb")
-      a_DataFile >> MutateAddNeuronProb;
-
-    if (s == "SplitRecurrent") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        SplitRecurrent = true;
-      else
-        SplitRecurrent = false;
+public:
+  TextFieldIndex() {
+    static_assert(NUM_PARAMETER_FIELDS < 255, "too many fields for the slots");
+
+    bool t_unique = false;
+    for (m_Seed = 0; !t_unique; m_Seed++) {
+      std::memset(m_Slots, 0, sizeof(m_Slots));
+      t_unique = true;
+      for (unsigned int i = 0; (i < NUM_PARAMETER_FIELDS) && t_unique; i++) {
+        if (!PARAMETER_FIELDS[i].m_Name) {
+          continue;
+        }
+        unsigned char &t_slot =
+            m_Slots[Hash(PARAMETER_FIELDS[i].m_Name, m_Seed) % SLOTS];
+        t_unique = (t_slot == 0);
+        t_slot = i + 1;
+      }
     }
+    m_Seed--;
+  }
 
-    if (s == "SplitLoopedRecurrent") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        SplitLoopedRecurrent = true;
-      else
-        SplitLoopedRecurrent = false;
+  const ParameterField *Find(std::string_view a_Key) const {
+    unsigned char t_slot = m_Slots[Hash(a_Key, m_Seed) % SLOTS];
+    if ((t_slot == 0) || (a_Key != PARAMETER_FIELDS[t_slot - 1].m_Name)) {
+      return NULL;
     }
+    return &PARAMETER_FIELDS[t_slot - 1];
+  }
+};
+
+// The keys of the trait parameter lines. Each line holds the name of a
+// trait and its parameters.
+static const char *NEURON_TRAIT_KEY = "NeuronTrait";
+static const char *LINK_TRAIT_KEY = "LinkTrait";
+static const char *GENOME_TRAIT_KEY = "GenomeTrait";
+
+static void SaveTraitParameters(
+    TextWriter &a_Out, const char *a_Key,
+    const std::map<std::string, TraitParameters> &a_Params) {
+  for (auto t_it = a_Params.begin(); t_it != a_Params.end(); t_it++) {
+    a_Out.Put(a_Key);
+    a_Out.PutString(t_it->first);
+    a_Out.PutTraitParameters(t_it->second);
+    a_Out.EndLine();
+  }
+}
 
-    if (s == "MutateAddLinkProb")
-      a_DataFile >> MutateAddLinkProb;
-
-    if (s == "MutateAddLinkFromBiasProb")
-      a_DataFile >> MutateAddLinkFromBiasProb;
-
-    if (s == "MutateRemLinkProb")
-      a_DataFile >> MutateRemLinkProb;
-
-    if (s == "MutateRemSimpleNeuronProb")
-      a_DataFile >> MutateRemSimpleNeuronProb;
-
-    if (s == "LinkTries")
-      a_DataFile >> LinkTries;
-
-    if (s == "RecurrentProb")
-      a_DataFile >> RecurrentProb;
-
-    if (s == "RecurrentLoopProb")
-      a_DataFile >> RecurrentLoopProb;
-
-    if (s == "MutateWeightsProb")
-      a_DataFile >> MutateWeightsProb;
-
-    if (s == "MutateWeightsSevereProb")
-      a_DataFile >> MutateWeightsSevereProb;
-
-    if (s == "WeightMutationRate")
-      a_DataFile >> WeightMutationRate;
-
-    if (s == "WeightMutationMaxPower")
-      a_DataFile >> WeightMutationMaxPower;
-
-    if (s == "WeightReplacementRate")
-      a_DataFile >> WeightReplacementRate;
-
-    if (s == "WeightReplacementMaxPower")
-      a_DataFile >> WeightReplacementMaxPower;
-
-    if (s == "MaxWeight")
-      a_DataFile >> MaxWeight;
-
-    if (s == "MutateActivationAProb")
-      a_DataFile >> MutateActivationAProb;
-
-    if (s == "MutateActivationBProb")
-      a_DataFile >> MutateActivationBProb;
-
-    if (s == "ActivationAMutationMaxPower")
-      a_DataFile >> ActivationAMutationMaxPower;
-
-    if (s == "ActivationBMutationMaxPower")
-      a_DataFile >> ActivationBMutationMaxPower;
-
-    if (s == "MinActivationA")
-      a_DataFile >> MinActivationA;
-
-    if (s == "MaxActivationA")
-      a_DataFile >> MaxActivationA;
-
-    if (s == "MinActivationB")
-      a_DataFile >> MinActivationB;
-
-    if (s == "MaxActivationB")
-      a_DataFile >> MaxActivationB;
-
-    if (s == "TimeConstantMutationMaxPower")
-      a_DataFile >> TimeConstantMutationMaxPower;
-
-    if (s == "BiasMutationMaxPower")
-      a_DataFile >> BiasMutationMaxPower;
-
-    if (s == "MutateNeuronTimeConstantsProb")
-      a_DataFile >> MutateNeuronTimeConstantsProb;
-
-    if (s == "MutateNeuronBiasesProb")
-      a_DataFile >> MutateNeuronBiasesProb;
-
-    if (s == "MinNeuronTimeConstant")
-      a_DataFile >> MinNeuronTimeConstant;
-
-    if (s == "MaxNeuronTimeConstant")
-      a_DataFile >> MaxNeuronTimeConstant;
-
-    if (s == "MinNeuronBias")
-      a_DataFile >> MinNeuronBias;
-
-    if (s == "MaxNeuronBias")
-      a_DataFile >> MaxNeuronBias;
-
-    if (s == "MutateNeuronActivationTypeProb")
-      a_DataFile >> MutateNeuronActivationTypeProb;
+int Parameters::Load(std::ifstream &a_DataFile) {
+  TextReader t_reader(a_DataFile);
+  return Load(t_reader);
+}
 
-    if (s == "ActivationFunction_SignedSigmoid_Prob")
-      a_DataFile >> ActivationFunction_SignedSigmoid_Prob;
-    if (s == "ActivationFunction_UnsignedSigmoid_Prob")
-      a_DataFile >> ActivationFunction_UnsignedSigmoid_Prob;
-    if (s == "ActivationFunction_Tanh_Prob")
-      a_DataFile >> ActivationFunction_Tanh_Prob;
-    if (s == "ActivationFunction_TanhCubic_Prob")
-      a_DataFile >> ActivationFunction_TanhCubic_Prob;
-    if (s == "ActivationFunction_SignedStep_Prob")
-      a_DataFile >> ActivationFunction_SignedStep_Prob;
-    if (s == "ActivationFunction_UnsignedStep_Prob")
-      a_DataFile >> ActivationFunction_UnsignedStep_Prob;
-    if (s == "ActivationFunction_SignedGauss_Prob")
-      a_DataFile >> ActivationFunction_SignedGauss_Prob;
-    if (s == "ActivationFunction_UnsignedGauss_Prob")
-      a_DataFile >> ActivationFunction_UnsignedGauss_Prob;
-    if (s == "ActivationFunction_Abs_Prob")
-      a_DataFile >> ActivationFunction_Abs_Prob;
-    if (s == "ActivationFunction_SignedSine_Prob")
-      a_DataFile >> ActivationFunction_SignedSine_Prob;
-    if (s == "ActivationFunction_UnsignedSine_Prob")
-      a_DataFile >> ActivationFunction_UnsignedSine_Prob;
-    if (s == "ActivationFunction_Linear_Prob")
-      a_DataFile >> ActivationFunction_Linear_Prob;
-    if (s == "ActivationFunction_Relu_Prob")
-      a_DataFile >> ActivationFunction_Relu_Prob;
-    if (s == "ActivationFunction_Softplus_Prob")
-      a_DataFile >> ActivationFunction_Softplus_Prob;
+int Parameters::Load(TextReader &a_Reader) {
+  static const TextFieldIndex t_index;
 
-    if (s == "DontUseBiasNeuron") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        DontUseBiasNeuron = true;
-      else
-        DontUseBiasNeuron = false;
-    }
+  if (!a_Reader.SkipPast("NEAT_ParametersStart")) {
+    return 0;
+  }
 
-    if (s == "AllowLoops") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        AllowLoops = true;
-      else
-        AllowLoops = false;
+  for (;;) {
+    std::string_view t_key = a_Reader.Next();
+    if (t_key.empty() || (t_key == "NEAT_ParametersEnd")) {
+      break;
     }
 
-    if (s == "ArchiveEnforcement") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        ArchiveEnforcement = true;
-      else
-        ArchiveEnforcement = false;
+    std::map<std::string, TraitParameters> *t_traits =
+        (t_key == NEURON_TRAIT_KEY)   ? &NeuronTraits
+        : (t_key == LINK_TRAIT_KEY)   ? &LinkTraits
+        : (t_key == GENOME_TRAIT_KEY) ? &GenomeTraits
+                                      : NULL;
+    if (t_traits) {
+      std::string t_name = a_Reader.GetString();
+      a_Reader.GetTraitParameters((*t_traits)[t_name]);
+      continue;
     }
 
-    if (s == "DisjointCoeff")
-      a_DataFile >> DisjointCoeff;
-
-    if (s == "ExcessCoeff")
-      a_DataFile >> ExcessCoeff;
-
-    if (s == "WeightDiffCoeff")
-      a_DataFile >> WeightDiffCoeff;
-
-    if (s == "ActivationADiffCoeff")
-      a_DataFile >> ActivationADiffCoeff;
-
-    if (s == "ActivationBDiffCoeff")
-      a_DataFile >> ActivationBDiffCoeff;
-
-    if (s == "TimeConstantDiffCoeff")
-      a_DataFile >> TimeConstantDiffCoeff;
-
-    if (s == "BiasDiffCoeff")
-      a_DataFile >> BiasDiffCoeff;
-
-    if (s == "ActivationFunctionDiffCoeff")
-      a_DataFile >> ActivationFunctionDiffCoeff;
-
-    if (s == "CompatThreshold")
-      a_DataFile >> CompatThreshold;
-
-    if (s == "MinCompatThreshold")
-      a_DataFile >> MinCompatThreshold;
-
-    if (s == "CompatThresholdModifier")
-      a_DataFile >> CompatThresholdModifier;
-
-    if (s == "CompatTreshChangeInterval_Generations")
-      a_DataFile >> CompatTreshChangeInterval_Generations;
-
-    if (s == "CompatTreshChangeInterval_Evaluations")
-      a_DataFile >> CompatTreshChangeInterval_Evaluations;
-
-    if (s == "DivisionThreshold")
-      a_DataFile >> DivisionThreshold;
-
-    if (s == "VarianceThreshold")
-      a_DataFile >> VarianceThreshold;
-
-    if (s == "BandThreshold")
-      a_DataFile >> BandThreshold;
-
-    if (s == "InitialDep.hh")
-      a_DataFile >> InitialDepth;
-
-    if (s == "MaxDep.hh")
-      a_DataFile >> MaxDepth;
-
-    if (s == "IterationLevel")
-      a_DataFile >> IterationLevel;
-
-    if (s == "TournamentSize")
-      a_DataFile >> TournamentSize;
-
-    if (s == "CPPN_Bias")
-      a_DataFile >> CPPN_Bias;
-
-    if (s == "Wid.hh")
-      a_DataFile >> Width;
-
-    if (s == "Height")
-      a_DataFile >> Height;
-
-    if (s == "Qtree_X")
-      a_DataFile >> Qtree_X;
-
-    if (s == "Qtree_Y")
-      a_DataFile >> Qtree_Y;
-
-    if (s == "Leo") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        Leo = true;
-      else
-        Leo = false;
+    // unknown keys are skipped
+    const ParameterField *t_field = t_index.Find(t_key);
+    if (!t_field) {
+      continue;
     }
-    if (s == "GeometrySeed") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        GeometrySeed = true;
-      else
-        GeometrySeed = false;
-    }
-
-    if (s == "LeoThreshold")
-      a_DataFile >> LeoThreshold;
 
-    if (s == "LeoSeed") {
-      a_DataFile >> tf;
-      if (tf == "true" || tf == "1" || tf == "1.0")
-        LeoSeed = true;
-      else
-        LeoSeed = false;
-    }
-    if (s == "Elitism") {
-      a_DataFile >> EliteFraction;
+    if (t_field->m_Int) {
+      a_Reader.Get(this->*t_field->m_Int);
+    } else if (t_field->m_Unsigned) {
+      a_Reader.Get(this->*t_field->m_Unsigned);
+    } else if (t_field->m_Double) {
+      a_Reader.Get(this->*t_field->m_Double);
+    } else {
+      this->*t_field->m_Bool = a_Reader.GetBool();
     }
   }
 
@@ -883,13 +378,11 @@ int Parameters::Load(std::ifstream &a_DataFile) {
 }
 
 int Parameters::Load(const char *a_FileName) {
-  std::ifstream data(a_FileName);
-  if (!data.is_open())
+  TextReader t_reader;
+  if (!t_reader.Open(a_FileName))
     return 0;
 
-  int result = Load(data);
-  data.close();
-  return result;
+  return Load(t_reader);
 }
 
 void Parameters::Save(const char *filename) {
@@ -899,180 +392,66 @@ void Parameters::Save(const char *filename) {
 }
 
 void Parameters::Save(FILE *a_fstream) {
-  fprintf(a_fstream, "NEAT_ParametersStart\n");
+  TextWriter t_out(a_fstream);
+  t_out.Put("NEAT_ParametersStart");
+  t_out.EndLine();
+
+  for (unsigned int i = 0; i < NUM_PARAMETER_FIELDS; i++) {
+    const ParameterField &t_field = PARAMETER_FIELDS[i];
+    if (!t_field.m_Name) {
+      continue;
+    }
+    t_out.Put(t_field.m_Name);
+    if (t_field.m_Int) {
+      t_out.Put(this->*t_field.m_Int);
+    } else if (t_field.m_Unsigned) {
+      t_out.Put(static_cast<long long>(this->*t_field.m_Unsigned));
+    } else if (t_field.m_Double) {
+      t_out.Put(this->*t_field.m_Double, 20);
+    } else {
+      t_out.PutBool(this->*t_field.m_Bool);
+    }
+    t_out.EndLine();
+  }
 
-  fprintf(a_fstream, "PopulationSize %d\n", PopulationSize);
-  fprintf(a_fstream, "DynamicCompatibility %s\n",
-          DynamicCompatibility == true ? "true" : "false");
-  fprintf(a_fstream, "MinSpecies %d\n", MinSpecies);
-  fprintf(a_fstream, "MaxSpecies %d\n", MaxSpecies);
-  fprintf(a_fstream, "InnovationsForever %s\n",
-          InnovationsForever == true ? "true" : "false");
-  fprintf(a_fstream, "AllowClones %s\n",
-          AllowClones == true ? "true" : "false");
-  fprintf(a_fstream, "NormalizeGenomeSize %s\n",
-          NormalizeGenomeSize == true ? "true" : "false");
-  fprintf(a_fstream, "YoungAgeThreshold %d\n", YoungAgeThreshold);
-  fprintf(a_fstream, "YoungAgeFitnessBoost %3.20f\n", YoungAgeFitnessBoost);
-  fprintf(a_fstream, "SpeciesDropoffAge %d\n", SpeciesMaxStagnation);
-  fprintf(a_fstream, "StagnationDelta %3.20f\n", StagnationDelta);
-  fprintf(a_fstream, "OldAgeThreshold %d\n", OldAgeThreshold);
-  fprintf(a_fstream, "OldAgePenalty %3.20f\n", OldAgePenalty);
-  fprintf(a_fstream, "DetectCompetetiveCoevolutionStagnation %s\n",
-          DetectCompetetiveCoevolutionStagnation == true ? "true" : "false");
-  fprintf(a_fstream, "KillWorstSpeciesEach %d\n", KillWorstSpeciesEach);
-  fprintf(a_fstream, "KillWorstAge %d\n", KillWorstAge);
-  fprintf(a_fstream, "SurvivalRate %3.20f\n", SurvivalRate);
-  fprintf(a_fstream, "CrossoverRate %3.20f\n", CrossoverRate);
-  fprintf(a_fstream, "OverallMutationRate %3.20f\n", OverallMutationRate);
-  fprintf(a_fstream, "InterspeciesCrossoverRate %3.20f\n",
-          InterspeciesCrossoverRate);
-  fprintf(a_fstream, "MultipointCrossoverRate %3.20f\n",
-          MultipointCrossoverRate);
-  fprintf(a_fstream, "RouletteWheelSelection %s\n",
-          RouletteWheelSelection == true ? "true" : "false");
-  fprintf(a_fstream, "PhasedSearching %s\n",
-          PhasedSearching == true ? "true" : "false");
-  fprintf(a_fstream, "DeltaCoding %s\n",
-          DeltaCoding == true ? "true" : "false");
-  fprintf(a_fstream, "SimplifyingPhaseMPCThreshold %d\n",
-          SimplifyingPhaseMPCThreshold);
-  fprintf(a_fstream, "SimplifyingPhaseStagnationThreshold %d\n",
-          SimplifyingPhaseStagnationThreshold);
-  fprintf(a_fstream, "ComplexityFloorGenerations %d\n",
-          ComplexityFloorGenerations);
-  fprintf(a_fstream, "NoveltySearch_K %d\n", NoveltySearch_K);
-  fprintf(a_fstream, "NoveltySearch_P_min %3.20f\n", NoveltySearch_P_min);
-  fprintf(a_fstream, "NoveltySearch_Dynamic_Pmin %s\n",
-          NoveltySearch_Dynamic_Pmin == true ? "true" : "false");
-  fprintf(a_fstream, "NoveltySearch_No_Archiving_Stagnation_Threshold %d\n",
-          NoveltySearch_No_Archiving_Stagnation_Threshold);
-  fprintf(a_fstream, "NoveltySearch_Pmin_lowering_multiplier %3.20f\n",
-          NoveltySearch_Pmin_lowering_multiplier);
-  fprintf(a_fstream, "NoveltySearch_Pmin_min %3.20f\n", NoveltySearch_Pmin_min);
-  fprintf(a_fstream, "NoveltySearch_Quick_Archiving_Min_Evaluations %d\n",
-          NoveltySearch_Quick_Archiving_Min_Evaluations);
-  fprintf(a_fstream, "NoveltySearch_Pmin_raising_multiplier %3.20f\n",
-          NoveltySearch_Pmin_raising_multiplier);
-  fprintf(a_fstream, "NoveltySearch_Recompute_Sparseness_Each %d\n",
-          NoveltySearch_Recompute_Sparseness_Each);
-  fprintf(a_fstream, "MutateAddNeuronProb %3.20f\n", MutateAddNeuronProb);
-  fprintf(a_fstream, "SplitRecurrent %s\n",
-          SplitRecurrent == true ? "true" : "false");
-  fprintf(a_fstream, "SplitLoopedRecurrent %s\n",
-          SplitLoopedRecurrent == true ? "true" : "false");
-  fprintf(a_fstream, "NeuronTries %d\n", NeuronTries);
-  fprintf(a_fstream, "MutateAddLinkProb %3.20f\n", MutateAddLinkProb);
-  fprintf(a_fstream, "MutateAddLinkFromBiasProb %3.20f\n",
-          MutateAddLinkFromBiasProb);
-  fprintf(a_fstream, "MutateRemLinkProb %3.20f\n", MutateRemLinkProb);
-  fprintf(a_fstream, "MutateRemSimpleNeuronProb %3.20f\n",
-          MutateRemSimpleNeuronProb);
-  fprintf(a_fstream, "LinkTries %d\n", LinkTries);
-  fprintf(a_fstream, "RecurrentProb %3.20f\n", RecurrentProb);
-  fprintf(a_fstream, "RecurrentLoopProb %3.20f\n", RecurrentLoopProb);
-  fprintf(a_fstream, "MutateWeightsProb %3.20f\n", MutateWeightsProb);
-  fprintf(a_fstream, "MutateWeightsSevereProb %3.20f\n",
-          MutateWeightsSevereProb);
-  fprintf(a_fstream, "WeightMutationRate %3.20f\n", WeightMutationRate);
-  fprintf(a_fstream, "WeightMutationMaxPower %3.20f\n", WeightMutationMaxPower);
-  fprintf(a_fstream, "WeightReplacementRate %3.20f\n", WeightReplacementRate);
-  fprintf(a_fstream, "WeightReplacementMaxPower %3.20f\n",
-          WeightReplacementMaxPower);
-  fprintf(a_fstream, "MaxWeight %3.20f\n", MaxWeight);
-  fprintf(a_fstream, "MutateActivationAProb %3.20f\n", MutateActivationAProb);
-  fprintf(a_fstream, "MutateActivationBProb %3.20f\n", MutateActivationBProb);
-  fprintf(a_fstream, "ActivationAMutationMaxPower %3.20f\n",
-          ActivationAMutationMaxPower);
-  fprintf(a_fstream, "ActivationBMutationMaxPower %3.20f\n",
-          ActivationBMutationMaxPower);
-  fprintf(a_fstream, "TimeConstantMutationMaxPower %3.20f\n",
-          TimeConstantMutationMaxPower);
-  fprintf(a_fstream, "BiasMutationMaxPower %3.20f\n", BiasMutationMaxPower);
-  fprintf(a_fstream, "MinActivationA %3.20f\n", MinActivationA);
-  fprintf(a_fstream, "MaxActivationA %3.20f\n", MaxActivationA);
-  fprintf(a_fstream, "MinActivationB %3.20f\n", MinActivationB);
-  fprintf(a_fstream, "MaxActivationB %3.20f\n", MaxActivationB);
-  fprintf(a_fstream, "MutateNeuronActivationTypeProb %3.20f\n",
-          MutateNeuronActivationTypeProb);
-  fprintf(a_fstream, "ActivationFunction_SignedSigmoid_Prob %3.20f\n",
-          ActivationFunction_SignedSigmoid_Prob);
-  fprintf(a_fstream, "ActivationFunction_UnsignedSigmoid_Prob %3.20f\n",
-          ActivationFunction_UnsignedSigmoid_Prob);
-  fprintf(a_fstream, "ActivationFunction_Tanh_Prob %3.20f\n",
-          ActivationFunction_Tanh_Prob);
-  fprintf(a_fstream, "ActivationFunction_TanhCubic_Prob %3.20f\n",
-          ActivationFunction_TanhCubic_Prob);
-  fprintf(a_fstream, "ActivationFunction_SignedStep_Prob %3.20f\n",
-          ActivationFunction_SignedStep_Prob);
-  fprintf(a_fstream, "ActivationFunction_UnsignedStep_Prob %3.20f\n",
-          ActivationFunction_UnsignedStep_Prob);
-  fprintf(a_fstream, "ActivationFunction_SignedGauss_Prob %3.20f\n",
-          ActivationFunction_SignedGauss_Prob);
-  fprintf(a_fstream, "ActivationFunction_UnsignedGauss_Prob %3.20f\n",
-          ActivationFunction_UnsignedGauss_Prob);
-  fprintf(a_fstream, "ActivationFunction_Abs_Prob %3.20f\n",
-          ActivationFunction_Abs_Prob);
-  fprintf(a_fstream, "ActivationFunction_SignedSine_Prob %3.20f\n",
-          ActivationFunction_SignedSine_Prob);
-  fprintf(a_fstream, "ActivationFunction_UnsignedSine_Prob %3.20f\n",
-          ActivationFunction_UnsignedSine_Prob);
-  fprintf(a_fstream, "ActivationFunction_Linear_Prob %3.20f\n",
-          ActivationFunction_Linear_Prob);
-  fprintf(a_fstream, "ActivationFunction_Relu_Prob %3.20f\n",
-          ActivationFunction_Relu_Prob);
-  fprintf(a_fstream, "ActivationFunction_Softplus_Prob %3.20f\n",
-          ActivationFunction_Softplus_Prob);
-  fprintf(a_fstream, "MutateNeuronTimeConstantsProb %3.20f\n",
-          MutateNeuronTimeConstantsProb);
-  fprintf(a_fstream, "MutateNeuronBiasesProb %3.20f\n", MutateNeuronBiasesProb);
-  fprintf(a_fstream, "MinNeuronTimeConstant %3.20f\n", MinNeuronTimeConstant);
-  fprintf(a_fstream, "MaxNeuronTimeConstant %3.20f\n", MaxNeuronTimeConstant);
-  fprintf(a_fstream, "MinNeuronBias %3.20f\n", MinNeuronBias);
-  fprintf(a_fstream, "MaxNeuronBias %3.20f\n", MaxNeuronBias);
-  fprintf(a_fstream, "DontUseBiasNeuron %s\n",
-          DontUseBiasNeuron == true ? "true" : "false");
-  fprintf(a_fstream, "ArchiveEnforcement %s\n",
-          ArchiveEnforcement == true ? "true" : "false");
-  fprintf(a_fstream, "AllowLoops %s\n", AllowLoops == true ? "true" : "false");
-  fprintf(a_fstream, "DisjointCoeff %3.20f\n", DisjointCoeff);
-  fprintf(a_fstream, "ExcessCoeff %3.20f\n", ExcessCoeff);
-  fprintf(a_fstream, "ActivationADiffCoeff %3.20f\n", ActivationADiffCoeff);
-  fprintf(a_fstream, "ActivationBDiffCoeff %3.20f\n", ActivationBDiffCoeff);
-  fprintf(a_fstream, "WeightDiffCoeff %3.20f\n", WeightDiffCoeff);
-  fprintf(a_fstream, "TimeConstantDiffCoeff %3.20f\n", TimeConstantDiffCoeff);
-  fprintf(a_fstream, "BiasDiffCoeff %3.20f\n", BiasDiffCoeff);
-  fprintf(a_fstream, "ActivationFunctionDiffCoeff %3.20f\n",
-          ActivationFunctionDiffCoeff);
-  fprintf(a_fstream, "CompatThreshold %3.20f\n", CompatThreshold);
-  fprintf(a_fstream, "MinCompatThreshold %3.20f\n", MinCompatThreshold);
-  fprintf(a_fstream, "CompatThresholdModifier %3.20f\n",
-          CompatThresholdModifier);
-  fprintf(a_fstream, "CompatTreshChangeInterval_Generations %d\n",
-          CompatTreshChangeInterval_Generations);
-  fprintf(a_fstream, "CompatTreshChangeInterval_Evaluations %d\n",
-          CompatTreshChangeInterval_Evaluations);
+  SaveTraitParameters(t_out, NEURON_TRAIT_KEY, NeuronTraits);
+  SaveTraitParameters(t_out, LINK_TRAIT_KEY, LinkTraits);
+  SaveTraitParameters(t_out, GENOME_TRAIT_KEY, GenomeTraits);
+
+  t_out.Put("NEAT_ParametersEnd");
+  t_out.EndLine();
+}
+
+// Calls a_Fn on every plain parameter, in checkpoint order
+template <typename P, typename F> static void ForEachValue(P &a_P, F a_Fn) {
+  for (unsigned int i = 0; i < NUM_PARAMETER_FIELDS; i++) {
+    const ParameterField &t_field = PARAMETER_FIELDS[i];
+    if (t_field.m_Int) {
+      a_Fn(a_P.*t_field.m_Int);
+    } else if (t_field.m_Unsigned) {
+      a_Fn(a_P.*t_field.m_Unsigned);
+    } else if (t_field.m_Double) {
+      a_Fn(a_P.*t_field.m_Double);
+    } else {
+      a_Fn(a_P.*t_field.m_Bool);
+    }
+  }
+}
+
+void Parameters::Save(CheckpointWriter &a_Writer) const {
+  ForEachValue(*this, [&a_Writer](const auto &a_V) { a_Writer.Put(a_V); });
+
+  a_Writer.PutTraitParameters(NeuronTraits);
+  a_Writer.PutTraitParameters(LinkTraits);
+  a_Writer.PutTraitParameters(GenomeTraits);
+}
 
-  fprintf(a_fstream, "DivisionThreshold %3.20f\n", DivisionThreshold);
-  fprintf(a_fstream, "VarianceThreshold %3.20f\n", VarianceThreshold);
-  fprintf(a_fstream, "BandThreshold %3.20f\n", BandThreshold);
-  fprintf(a_fstream, "InitialDepth %d\n", InitialDepth);
-  fprintf(a_fstream, "MaxDepth %d\n", MaxDepth);
-  fprintf(a_fstream, "IterationLevel %d\n", IterationLevel);
-  fprintf(a_fstream, "TournamentSize %d\n", TournamentSize);
-  fprintf(a_fstream, "CPPN_Bias %3.20f\n", CPPN_Bias);
-  fprintf(a_fstream, "Width %3.20f\n", Width);
-  fprintf(a_fstream, "Height %3.20f\n", Height);
-  fprintf(a_fstream, "Qtree_X %3.20f\n", Qtree_X);
-  fprintf(a_fstream, "Qtree_Y %3.20f\n", Qtree_Y);
-  fprintf(a_fstream, "Leo %s\n", Leo == true ? "true" : "false");
-  fprintf(a_fstream, "LeoThreshold %3.20f\n", LeoThreshold);
-  fprintf(a_fstream, "LeoSeed %s\n", LeoSeed == true ? "true" : "false");
-  fprintf(a_fstream, "GeometrySeed %s\n",
-          GeometrySeed == true ? "true" : "false");
-  fprintf(a_fstream, "Elitism %3.20f\n", EliteFraction);
+void Parameters::Load(CheckpointReader &a_Reader) {
+  ForEachValue(*this, [&a_Reader](auto &a_V) { a_Reader.Get(a_V); });
 
-  fprintf(a_fstream, "NEAT_ParametersEnd\n");
+  a_Reader.GetTraitParameters(NeuronTraits);
+  a_Reader.GetTraitParameters(LinkTraits);
+  a_Reader.GetTraitParameters(GenomeTraits);
 }
 
 } // namespace NEAT
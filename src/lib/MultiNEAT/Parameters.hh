@@ -37,6 +37,9 @@ namespace NEAT {
 
 // forward
 class Genome;
+class CheckpointReader;
+class CheckpointWriter;
+class TextReader;
 
 //////////////////////////////////////////////
 // The NEAT Parameters class
@@ -418,6 +421,10 @@ public:
   bool LeoSeed;
   bool GeometrySeed;
 
+  // How many threads explore the quadtrees of the nodes in each phase.
+  // 0 or 1 means no extra threads are used.
+  unsigned int ES_Threads;
+
   /////////////////////////////////////
   // Universal traits
   /////////////////////////////////////
@@ -444,11 +451,17 @@ public:
   int Load(const char *filename);
   // Load the parameters from an already opened file for reading
   int Load(std::ifstream &a_DataFile);
+  int Load(TextReader &a_Reader);
 
   void Save(const char *filename);
   // Saves the parameters to an already opened file for writing
   void Save(FILE *a_fstream);
 
+  // Binary checkpoint section, see Checkpoint.hh. CustomConstraints is not
+  // saved.
+  void Save(CheckpointWriter &a_Writer) const;
+  void Load(CheckpointReader &a_Reader);
+
   // resets the parameters to built-in defaults
   void Reset();
 };
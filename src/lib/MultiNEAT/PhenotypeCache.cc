@@ -0,0 +1,289 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        PhenotypeCache.cc
+// Description: Implementation of the phenotype cache.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Assert.hh>
+#include <MultiNEAT/PhenotypeCache.hh>
+#include <cstring>
+
+namespace NEAT {
+
+// Kinds of phenotypes built from the same genome
+enum { KEY_NEAT = 0, KEY_HYPERNEAT = 1, KEY_ES_HYPERNEAT = 2 };
+
+template <typename T>
+static void AppendKey(std::string &a_Key, const T &a_Value) {
+  a_Key.append(reinterpret_cast<const char *>(&a_Value), sizeof(T));
+}
+
+static void AppendCoordsKey(std::string &a_Key,
+                            const std::vector<std::vector<double>> &a_Coords) {
+  AppendKey(a_Key, static_cast<uint64_t>(a_Coords.size()));
+  for (unsigned int i = 0; i < a_Coords.size(); i++) {
+    AppendKey(a_Key, static_cast<uint64_t>(a_Coords[i].size()));
+    a_Key.append(reinterpret_cast<const char *>(a_Coords[i].data()),
+                 a_Coords[i].size() * sizeof(double));
+  }
+}
+
+// Everything the HyperNEAT builders read from a substrate
+static void AppendSubstrateKey(std::string &a_Key, const Substrate &a_Subst) {
+  AppendCoordsKey(a_Key, a_Subst.m_input_coords);
+  AppendCoordsKey(a_Key, a_Subst.m_hidden_coords);
+  AppendCoordsKey(a_Key, a_Subst.m_output_coords);
+
+  const bool t_flags[] = {a_Subst.m_leaky,
+                          a_Subst.m_with_distance,
+                          a_Subst.m_allow_input_hidden_links,
+                          a_Subst.m_allow_input_output_links,
+                          a_Subst.m_allow_hidden_hidden_links,
+                          a_Subst.m_allow_hidden_output_links,
+                          a_Subst.m_allow_output_hidden_links,
+                          a_Subst.m_allow_output_output_links,
+                          a_Subst.m_allow_looped_hidden_links,
+                          a_Subst.m_allow_looped_output_links,
+                          a_Subst.m_custom_conn_obeys_flags,
+                          a_Subst.m_query_weights_only};
+  AppendKey(a_Key, t_flags);
+
+  AppendKey(a_Key, static_cast<uint64_t>(a_Subst.m_custom_connectivity.size()));
+  for (unsigned int i = 0; i < a_Subst.m_custom_connectivity.size(); i++) {
+    const std::vector<int> &t_conn = a_Subst.m_custom_connectivity[i];
+    AppendKey(a_Key, static_cast<uint64_t>(t_conn.size()));
+    a_Key.append(reinterpret_cast<const char *>(t_conn.data()),
+                 t_conn.size() * sizeof(int));
+  }
+
+  AppendKey(a_Key, static_cast<int>(a_Subst.m_hidden_nodes_activation));
+  AppendKey(a_Key, static_cast<int>(a_Subst.m_output_nodes_activation));
+  AppendKey(a_Key, a_Subst.m_max_weight_and_bias);
+  AppendKey(a_Key, a_Subst.m_min_time_const);
+  AppendKey(a_Key, a_Subst.m_max_time_const);
+}
+
+// The parameters BuildESHyperNEATPhenotype() reads. ES_Threads is left out,
+// the network does not depend on it.
+static void AppendESKey(std::string &a_Key, const Parameters &a_Params) {
+  AppendKey(a_Key, a_Params.DivisionThreshold);
+  AppendKey(a_Key, a_Params.VarianceThreshold);
+  AppendKey(a_Key, a_Params.BandThreshold);
+  AppendKey(a_Key, a_Params.InitialDepth);
+  AppendKey(a_Key, a_Params.MaxDepth);
+  AppendKey(a_Key, a_Params.IterationLevel);
+  AppendKey(a_Key, a_Params.CPPN_Bias);
+  AppendKey(a_Key, a_Params.Width);
+  AppendKey(a_Key, a_Params.Height);
+  AppendKey(a_Key, a_Params.Qtree_X);
+  AppendKey(a_Key, a_Params.Qtree_Y);
+  AppendKey(a_Key, a_Params.Leo);
+  AppendKey(a_Key, a_Params.LeoThreshold);
+}
+
+// Writes a_Value at a_Pos and moves a_Pos past it
+template <typename T> static void PutKey(char *&a_Pos, T a_Value) {
+  std::memcpy(a_Pos, &a_Value, sizeof(T));
+  a_Pos += sizeof(T);
+}
+
+PhenotypeCache::PhenotypeCache(unsigned int a_Capacity)
+    : m_capacity(a_Capacity), m_hits(0), m_misses(0) {}
+
+std::string PhenotypeCache::GetKey(const Genome &a_Genome) {
+  const size_t t_neuron_size = 3 * sizeof(int) + 4 * sizeof(double);
+  const size_t t_link_size = 2 * sizeof(int) + 3 * sizeof(double) + 1;
+
+  // sized up front and filled in place, a hit costs little more than this
+  std::string t_key(4 * sizeof(unsigned int) +
+                        a_Genome.NumNeurons() * t_neuron_size +
+                        a_Genome.NumLinks() * t_link_size,
+                    0);
+  char *t_pos = &t_key[0];
+
+  PutKey<unsigned int>(t_pos, a_Genome.NumInputs());
+  PutKey<unsigned int>(t_pos, a_Genome.NumOutputs());
+  PutKey<unsigned int>(t_pos, a_Genome.NumNeurons());
+  PutKey<unsigned int>(t_pos, a_Genome.NumLinks());
+
+  for (unsigned int i = 0; i < a_Genome.NumNeurons(); i++) {
+    const NeuronGene &t_n = a_Genome.m_NeuronGenes[i];
+    PutKey<int>(t_pos, t_n.ID());
+    PutKey<int>(t_pos, t_n.Type());
+    PutKey<int>(t_pos, t_n.m_ActFunction);
+    PutKey<double>(t_pos, t_n.m_A);
+    PutKey<double>(t_pos, t_n.m_B);
+    PutKey<double>(t_pos, t_n.m_TimeConstant);
+    PutKey<double>(t_pos, t_n.m_Bias);
+  }
+
+  for (unsigned int i = 0; i < a_Genome.NumLinks(); i++) {
+    const LinkGene &t_l = a_Genome.m_LinkGenes[i];
+    double t_rate, t_pre_rate;
+    a_Genome.GetHebbRates(i, t_rate, t_pre_rate);
+
+    PutKey<int>(t_pos, t_l.FromNeuronID());
+    PutKey<int>(t_pos, t_l.ToNeuronID());
+    PutKey<double>(t_pos, t_l.GetWeight());
+    PutKey<char>(t_pos, t_l.IsRecurrent());
+    PutKey<double>(t_pos, t_rate);
+    PutKey<double>(t_pos, t_pre_rate);
+  }
+
+  ASSERT(t_pos == t_key.data() + t_key.size());
+  return t_key;
+}
+
+CompiledPhenotype PhenotypeCache::Find(const std::string &a_Key) {
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+
+  auto t_it = m_index.find(a_Key);
+  if (t_it == m_index.end()) {
+    m_misses++;
+    return CompiledPhenotype();
+  }
+
+  m_hits++;
+  m_entries.splice(m_entries.begin(), m_entries, t_it->second);
+  return t_it->second->m_net;
+}
+
+CompiledPhenotype PhenotypeCache::Insert(const std::string &a_Key,
+                                         NeuralNetwork &a_Net) {
+  // flushed once here, so Instantiate() only has to copy
+  a_Net.Flush();
+  CompiledPhenotype t_net =
+      std::make_shared<const NeuralNetwork>(std::move(a_Net));
+
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+
+  // another thread may have built the same phenotype meanwhile
+  auto t_it = m_index.find(a_Key);
+  if (t_it != m_index.end()) {
+    m_entries.splice(m_entries.begin(), m_entries, t_it->second);
+    return t_it->second->m_net;
+  }
+
+  if (m_capacity == 0) {
+    return t_net;
+  }
+
+  m_entries.push_front(Entry{a_Key, t_net});
+  m_index[a_Key] = m_entries.begin();
+
+  while (m_entries.size() > m_capacity) {
+    m_index.erase(m_entries.back().m_key);
+    m_entries.pop_back();
+  }
+
+  return t_net;
+}
+
+CompiledPhenotype PhenotypeCache::Get(Genome &a_Genome) {
+  std::string t_key = GetKey(a_Genome);
+  AppendKey(t_key, static_cast<int>(KEY_NEAT));
+
+  CompiledPhenotype t_net = Find(t_key);
+  if (t_net) {
+    return t_net;
+  }
+
+  NeuralNetwork t_built;
+  a_Genome.BuildLeanPhenotype(t_built);
+  return Insert(t_key, t_built);
+}
+
+CompiledPhenotype PhenotypeCache::GetHyperNEAT(Genome &a_Genome,
+                                               Substrate &a_Subst) {
+  std::string t_key = GetKey(a_Genome);
+  AppendKey(t_key, static_cast<int>(KEY_HYPERNEAT));
+  AppendSubstrateKey(t_key, a_Subst);
+
+  CompiledPhenotype t_net = Find(t_key);
+  if (t_net) {
+    return t_net;
+  }
+
+  NeuralNetwork t_built;
+  a_Genome.BuildHyperNEATPhenotype(t_built, a_Subst);
+  return Insert(t_key, t_built);
+}
+
+CompiledPhenotype PhenotypeCache::GetESHyperNEAT(Genome &a_Genome,
+                                                 Substrate &a_Subst,
+                                                 Parameters &a_Params) {
+  std::string t_key = GetKey(a_Genome);
+  AppendKey(t_key, static_cast<int>(KEY_ES_HYPERNEAT));
+  AppendSubstrateKey(t_key, a_Subst);
+  AppendESKey(t_key, a_Params);
+
+  CompiledPhenotype t_net = Find(t_key);
+  if (t_net) {
+    return t_net;
+  }
+
+  NeuralNetwork t_built;
+  a_Genome.BuildESHyperNEATPhenotype(t_built, a_Subst, a_Params);
+  return Insert(t_key, t_built);
+}
+
+void PhenotypeCache::Instantiate(const CompiledPhenotype &a_Compiled,
+                                 NeuralNetwork &a_State) {
+  a_State.Clear();
+  a_State.SetInputOutputDimentions(a_Compiled->NumInputs(),
+                                   a_Compiled->NumOutputs());
+  a_State.m_neurons = a_Compiled->m_neurons;
+  a_State.m_connections = a_Compiled->m_connections;
+  a_State.m_neuron_meta = a_Compiled->m_neuron_meta;
+}
+
+void PhenotypeCache::Clear() {
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+  m_entries.clear();
+  m_index.clear();
+}
+
+void PhenotypeCache::SetCapacity(unsigned int a_Capacity) {
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+  m_capacity = a_Capacity;
+  while (m_entries.size() > m_capacity) {
+    m_index.erase(m_entries.back().m_key);
+    m_entries.pop_back();
+  }
+}
+
+unsigned int PhenotypeCache::NumCached() {
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+  return m_entries.size();
+}
+
+void PhenotypeCache::ResetCounters() {
+  std::lock_guard<std::mutex> t_lock(m_mutex);
+  m_hits = 0;
+  m_misses = 0;
+}
+
+} // namespace NEAT
@@ -0,0 +1,113 @@
+#ifndef _PHENOTYPECACHE_H
+#define _PHENOTYPECACHE_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        PhenotypeCache.hh
+// Description: A bounded cache of built phenotypes, shared between genomes
+//              that would build the same network.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Substrate.hh>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace NEAT {
+
+// A built network. It is shared by everyone who asks for the same genome and
+// must not be activated directly, see PhenotypeCache::Instantiate().
+typedef std::shared_ptr<const NeuralNetwork> CompiledPhenotype;
+
+// Keeps the most recently used phenotypes. Genomes are looked up by their
+// phenotype-relevant genes (neurons, links, weights and Hebbian traits), so
+// elites, clones and re-evaluated survivors share one build no matter their ID.
+// HyperNEAT phenotypes are also keyed by the contents of the substrate, and
+// ES-HyperNEAT ones by the parameters the build reads, so changing either
+// in place only makes later lookups miss.
+// The cache can be used from several threads at once.
+class PhenotypeCache {
+  struct Entry {
+    std::string m_key;
+    CompiledPhenotype m_net;
+  };
+
+  unsigned int m_capacity;
+
+  // most recently used first
+  std::list<Entry> m_entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+
+  std::atomic<unsigned long> m_hits;
+  std::atomic<unsigned long> m_misses;
+
+  std::mutex m_mutex;
+
+  // Returns the cached network for a_Key, or an empty pointer
+  CompiledPhenotype Find(const std::string &a_Key);
+  // Adds a_Net under a_Key and evicts the least recently used entries
+  CompiledPhenotype Insert(const std::string &a_Key, NeuralNetwork &a_Net);
+
+public:
+  PhenotypeCache(unsigned int a_Capacity = 256);
+
+  // Return the phenotype of a_Genome, building it on a miss
+  CompiledPhenotype Get(Genome &a_Genome);
+  CompiledPhenotype GetHyperNEAT(Genome &a_Genome, Substrate &a_Subst);
+  CompiledPhenotype GetESHyperNEAT(Genome &a_Genome, Substrate &a_Subst,
+                                   Parameters &a_Params);
+
+  // Copies a compiled phenotype into a_State, flushed. a_State is the
+  // per-evaluation network to feed and activate. Only the neurons and
+  // connections are copied, into the storage a_State already has.
+  static void Instantiate(const CompiledPhenotype &a_Compiled,
+                          NeuralNetwork &a_State);
+
+  // Drops all cached phenotypes. The counters are kept.
+  void Clear();
+
+  unsigned int GetCapacity() const { return m_capacity; }
+  // Shrinking evicts the least recently used phenotypes
+  void SetCapacity(unsigned int a_Capacity);
+  unsigned int NumCached();
+
+  unsigned long GetHits() const { return m_hits; }
+  unsigned long GetMisses() const { return m_misses; }
+  void ResetCounters();
+
+  // The key a genome is cached under. Equal keys build equal networks.
+  static std::string GetKey(const Genome &a_Genome);
+};
+
+} // namespace NEAT
+
+#endif
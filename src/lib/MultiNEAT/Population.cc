@@ -31,12 +31,14 @@
 #include <fstream>
 
 #include <MultiNEAT/Assert.hh>
+#include <MultiNEAT/Checkpoint.hh>
 #include <MultiNEAT/Genome.hh>
 #include <MultiNEAT/Parameters.hh>
 #include <MultiNEAT/PhenotypeBehavior.hh>
 #include <MultiNEAT/Population.hh>
 #include <MultiNEAT/Random.hh>
 #include <MultiNEAT/Species.hh>
+#include <MultiNEAT/TextIO.hh>
 #include <MultiNEAT/Utils.hh>
 
 namespace NEAT {
@@ -132,6 +134,13 @@ Population::Population(const Genome &a_Seed, const Parameters &a_Parameters,
 }
 
 Population::Population(const char *a_FileName) {
+  if (CheckpointReader::IsCheckpoint(a_FileName)) {
+    CheckpointReader t_reader;
+    t_reader.Open(a_FileName);
+    Load(t_reader);
+    return;
+  }
+
   m_BestFitnessEver = 0.0;
 
   m_Generation = 0;
@@ -140,23 +149,21 @@ Population::Population(const char *a_FileName) {
   m_GensSinceBestFitnessLastChanged = 0;
   m_GensSinceMPCLastChanged = 0;
 
-  std::ifstream t_DataFile(a_FileName);
-  if (!t_DataFile.is_open())
+  TextReader t_reader;
+  if (!t_reader.Open(a_FileName))
     throw std::exception();
-  std::string t_str;
 
   // Load the parameters
-  m_Parameters.Load(t_DataFile);
+  m_Parameters.Load(t_reader);
 
   // Load the innovation database
-  m_InnovationDatabase.Init(t_DataFile);
+  m_InnovationDatabase.Init(t_reader);
 
   // Load all genomes
+  m_Genomes.reserve(m_Parameters.PopulationSize);
   for (unsigned int i = 0; i < m_Parameters.PopulationSize; i++) {
-    Genome t_genome(t_DataFile);
-    m_Genomes.push_back(t_genome);
+    m_Genomes.emplace_back(t_reader);
   }
-  t_DataFile.close();
 
   m_NextGenomeID = 0;
   for (unsigned int i = 0; i < m_Genomes.size(); i++) {
@@ -184,8 +191,12 @@ Population::Population(const char *a_FileName) {
 }
 
 // Save a whole population to a file
-void Population::Save(const char *a_FileName) {
-  FILE *t_file = fopen(a_FileName, "w");
+bool Population::Save(const char *a_FileName) {
+  ReplacementFile t_replacement(a_FileName, "w");
+  FILE *t_file = t_replacement.Get();
+  if (!t_file) {
+    return false;
+  }
 
   // Save the parameters
   m_Parameters.Save(t_file);
@@ -200,8 +211,122 @@ void Population::Save(const char *a_FileName) {
     }
   }
 
-  // bye
-  fclose(t_file);
+  // failed writes are caught here
+  return t_replacement.Commit();
+}
+
+Population::Population(CheckpointReader &a_Reader) { Load(a_Reader); }
+
+bool Population::SaveCheckpoint(const char *a_FileName) {
+  CheckpointWriter t_writer;
+  Save(t_writer);
+  return t_writer.Write(a_FileName);
+}
+
+void Population::SaveCheckpoint(const char *a_FileName,
+                                AsyncCheckpointWriter &a_Writer) {
+  CheckpointWriter t_writer;
+  Save(t_writer);
+  a_Writer.Write(std::move(t_writer), a_FileName);
+}
+
+void Population::Save(CheckpointWriter &a_Writer,
+                      unsigned int a_FirstInnovation) {
+  a_Writer.BeginSection(CHECKPOINT_PARAMETERS);
+  m_Parameters.Save(a_Writer);
+  a_Writer.EndSection();
+
+  a_Writer.BeginSection(CHECKPOINT_INNOVATIONS);
+  m_InnovationDatabase.Save(a_Writer, a_FirstInnovation);
+  a_Writer.EndSection();
+
+  a_Writer.BeginSection(CHECKPOINT_SPECIES);
+  a_Writer.Put(static_cast<uint64_t>(m_Species.size()));
+  for (unsigned int i = 0; i < m_Species.size(); i++) {
+    m_Species[i].Save(a_Writer);
+  }
+  a_Writer.EndSection();
+
+  a_Writer.BeginSection(CHECKPOINT_POPULATION);
+  a_Writer.Put(m_NextGenomeID);
+  a_Writer.Put(m_NextSpeciesID);
+  a_Writer.Put(static_cast<int32_t>(m_SearchMode));
+  a_Writer.Put(m_CurrentMPC);
+  a_Writer.Put(m_OldMPC);
+  a_Writer.Put(m_BaseMPC);
+  a_Writer.Put(m_BestFitnessEver);
+  a_Writer.Put(m_GensSinceBestFitnessLastChanged);
+  a_Writer.Put(m_EvalsSinceBestFitnessLastChanged);
+  a_Writer.Put(m_GensSinceMPCLastChanged);
+  a_Writer.Put(m_Generation);
+  a_Writer.Put(m_NumEvaluations);
+  a_Writer.Put(m_GensSinceLastArchiving);
+  a_Writer.Put(m_QuickAddCounter);
+  a_Writer.PutString(m_RNG.GetState());
+
+  m_BestGenome.Save(a_Writer);
+  m_BestGenomeEver.Save(a_Writer);
+
+  a_Writer.Put(static_cast<uint64_t>(m_Genomes.size()));
+  for (unsigned int i = 0; i < m_Genomes.size(); i++) {
+    m_Genomes[i].Save(a_Writer);
+  }
+  a_Writer.Put(static_cast<uint64_t>(m_GenomeArchive.size()));
+  for (unsigned int i = 0; i < m_GenomeArchive.size(); i++) {
+    m_GenomeArchive[i].Save(a_Writer);
+  }
+  a_Writer.EndSection();
+}
+
+void Population::Load(CheckpointReader &a_Reader) {
+  a_Reader.BeginSection(CHECKPOINT_PARAMETERS);
+  m_Parameters.Load(a_Reader);
+
+  a_Reader.BeginSection(CHECKPOINT_INNOVATIONS);
+  m_InnovationDatabase.Init(a_Reader);
+
+  a_Reader.BeginSection(CHECKPOINT_SPECIES);
+  uint64_t t_count = a_Reader.Get<uint64_t>();
+  m_Species.clear();
+  m_Species.reserve(t_count);
+  for (uint64_t i = 0; i < t_count; i++) {
+    m_Species.emplace_back(a_Reader);
+  }
+
+  a_Reader.BeginSection(CHECKPOINT_POPULATION);
+  a_Reader.Get(m_NextGenomeID);
+  a_Reader.Get(m_NextSpeciesID);
+  m_SearchMode = static_cast<SearchMode>(a_Reader.Get<int32_t>());
+  a_Reader.Get(m_CurrentMPC);
+  a_Reader.Get(m_OldMPC);
+  a_Reader.Get(m_BaseMPC);
+  a_Reader.Get(m_BestFitnessEver);
+  a_Reader.Get(m_GensSinceBestFitnessLastChanged);
+  a_Reader.Get(m_EvalsSinceBestFitnessLastChanged);
+  a_Reader.Get(m_GensSinceMPCLastChanged);
+  a_Reader.Get(m_Generation);
+  a_Reader.Get(m_NumEvaluations);
+  a_Reader.Get(m_GensSinceLastArchiving);
+  a_Reader.Get(m_QuickAddCounter);
+  m_RNG.SetState(a_Reader.GetString());
+
+  m_BestGenome = Genome(a_Reader);
+  m_BestGenomeEver = Genome(a_Reader);
+
+  t_count = a_Reader.Get<uint64_t>();
+  m_Genomes.clear();
+  m_Genomes.reserve(t_count);
+  for (uint64_t i = 0; i < t_count; i++) {
+    m_Genomes.emplace_back(a_Reader);
+  }
+  t_count = a_Reader.Get<uint64_t>();
+  m_GenomeArchive.clear();
+  m_GenomeArchive.reserve(t_count);
+  for (uint64_t i = 0; i < t_count; i++) {
+    m_GenomeArchive.emplace_back(a_Reader);
+  }
+
+  m_BehaviorArchive = NULL;
 }
 
 // Calculates the current mean population complexity
@@ -382,6 +507,9 @@ void Population::UpdateSpecies() {
 
 // the epoch method - the heart of the GA
 void Population::Epoch() {
+  NEAT_STAT(double t_epoch_start = StatsClock());
+  NEAT_STAT(m_Stats.m_Generation = m_Generation);
+
   // So, all genomes are evaluated..
   for (unsigned int i = 0; i < m_Species.size(); i++) {
     for (unsigned int j = 0; j < m_Species[i].m_Individuals.size(); j++) {
@@ -390,20 +518,32 @@ void Population::Epoch() {
   }
 
   // Sort each species's members by fitness and the species by fitness
-  Sort();
+  {
+    NEAT_STAT(StatsTimer t_timer(m_Stats.m_SortTime));
+    Sort();
+  }
 
   // Update species stagnation info & stuff
-  UpdateSpecies();
+  {
+    NEAT_STAT(StatsTimer t_timer(m_Stats.m_UpdateSpeciesTime));
+    UpdateSpecies();
+  }
 
   ///////////////////
   // Preparation
   ///////////////////
 
   // Adjust the species's fitness
-  AdjustFitness();
+  {
+    NEAT_STAT(StatsTimer t_timer(m_Stats.m_AdjustFitnessTime));
+    AdjustFitness();
+  }
 
   // Count the offspring of each individual and species
-  CountOffspring();
+  {
+    NEAT_STAT(StatsTimer t_timer(m_Stats.m_CountOffspringTime));
+    CountOffspring();
+  }
 
   // Incrementing the global stagnation counter, we can check later for global
   // stagnation
@@ -554,6 +694,7 @@ void Population::Epoch() {
   // m_Species[i].KillWorst(m_Parameters);
 
   // Perform reproduction for each species
+  NEAT_STAT(double t_reproduce_start = StatsClock());
   m_TempSpecies.clear();
   m_TempSpecies = m_Species;
   for (unsigned int i = 0; i < m_TempSpecies.size(); i++) {
@@ -561,9 +702,14 @@ void Population::Epoch() {
   }
 
   for (unsigned int i = 0; i < m_Species.size(); i++) {
+    NEAT_STAT(double t_start = StatsClock());
     m_Species[i].Reproduce(*this, m_Parameters, m_RNG);
+    NEAT_STAT(m_Stats.m_SpeciesIDs.push_back(m_Species[i].ID()));
+    NEAT_STAT(m_Stats.m_SpeciesReproduceTimes.push_back(StatsClock() -
+                                                        t_start));
   }
   m_Species = m_TempSpecies;
+  NEAT_STAT(m_Stats.m_ReproduceTime = StatsClock() - t_reproduce_start);
 
   // Now we kill off the old parents
   // Todo: this baby/adult scheme is complicated and basically sucks,
@@ -613,6 +759,27 @@ void Population::Epoch() {
   if (!m_Parameters.InnovationsForever) {
     m_InnovationDatabase.Flush();
   }
+
+  NEAT_STAT(FinishStats(StatsClock() - t_epoch_start));
+}
+
+void Population::FinishStats(double a_EpochTime) {
+  m_Stats.m_EpochTime = a_EpochTime;
+
+  unsigned long long t_builds = NumPhenotypeBuilds();
+  double t_build_time = PhenotypeBuildTime();
+  m_Stats.m_PhenotypeBuilds = t_builds - m_PhenotypeBuildsSeen;
+  m_Stats.m_PhenotypeBuildTime = t_build_time - m_PhenotypeBuildTimeSeen;
+  m_PhenotypeBuildsSeen = t_builds;
+  m_PhenotypeBuildTimeSeen = t_build_time;
+
+  m_LastStats = m_Stats;
+  m_Stats.Clear();
+
+  if (m_StatsFile) {
+    fprintf(m_StatsFile, "%s\n", m_LastStats.ToJSON().c_str());
+    fflush(m_StatsFile);
+  }
 }
 
 Genome g_dummy; // empty genome
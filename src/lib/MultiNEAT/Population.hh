@@ -40,6 +40,7 @@
 #include <MultiNEAT/PhenotypeBehavior.hh>
 #include <MultiNEAT/Random.hh>
 #include <MultiNEAT/Species.hh>
+#include <MultiNEAT/Stats.hh>
 
 namespace NEAT {
 
@@ -50,6 +51,9 @@ namespace NEAT {
 enum SearchMode { COMPLEXIFYING, SIMPLIFYING, BLENDED };
 
 class Species;
+class AsyncCheckpointWriter;
+class CheckpointReader;
+class CheckpointWriter;
 
 class Population {
   /////////////////////
@@ -118,6 +122,20 @@ private:
   // The initial list of genomes
   std::vector<Genome> m_Genomes;
 
+  // Restores everything Save(CheckpointWriter&) wrote
+  void Load(CheckpointReader &a_Reader);
+
+  // The statistics being gathered and those of the last Epoch()
+  EpochStats m_Stats;
+  EpochStats m_LastStats;
+  FILE *m_StatsFile = NULL;
+  // the process-wide phenotype build counters at the last Epoch()
+  unsigned long long m_PhenotypeBuildsSeen = NumPhenotypeBuilds();
+  double m_PhenotypeBuildTimeSeen = PhenotypeBuildTime();
+
+  // Completes m_Stats and makes them the last ones
+  void FinishStats(double a_EpochTime);
+
 public:
   // The archive
   std::vector<Genome> m_GenomeArchive;
@@ -144,9 +162,13 @@ public:
   Population(const Genome &a_G, const Parameters &a_Parameters,
              bool a_RandomizeWeights, double a_RandomRange, int a_RNG_seed);
 
-  // Loads a population from a file.
+  // Loads a population from a file. Both the text format and binary
+  // checkpoints are accepted.
   Population(const char *a_FileName);
 
+  // Loads a population from an opened binary checkpoint
+  Population(CheckpointReader &a_Reader);
+
   ////////////////////////////
   // Destructor
   ////////////////////////////
@@ -172,6 +194,14 @@ public:
   }
 
   unsigned int GetGeneration() const { return m_Generation; }
+
+  // What the last Epoch() did and how long it took, see Stats.hh. Phenotype
+  // builds are counted for the whole process.
+  const EpochStats &GetStats() const { return m_LastStats; }
+  EpochStats &AccessStats() { return m_Stats; }
+  // When set, every Epoch() appends its statistics to a_File as a line of
+  // JSON. NULL stops it.
+  void SetStatsFile(FILE *a_File) { m_StatsFile = a_File; }
   double GetBestFitnessEver() const { return m_BestFitnessEver; }
   Genome GetBestGenome() const {
     double best = std::numeric_limits<double>::min();
@@ -213,8 +243,21 @@ public:
   // Performs one generation and reproduces the genomes
   void Epoch();
 
-  // Saves the whole population to a file
-  void Save(const char *a_FileName);
+  // Saves the whole population to a file. The file is only replaced once
+  // it is completely written. Returns false if it could not be written.
+  bool Save(const char *a_FileName);
+
+  // Saves the whole population to a binary checkpoint, see Checkpoint.hh.
+  // Unlike Save(), it also keeps the species, the traits, the RNG state and
+  // all counters, and restores them exactly. Returns false if the file could
+  // not be written.
+  bool SaveCheckpoint(const char *a_FileName);
+  // Same, but only serializes the population and leaves writing the file to
+  // the thread of a_Writer. Its Wait() tells whether the file was written.
+  void SaveCheckpoint(const char *a_FileName, AsyncCheckpointWriter &a_Writer);
+  // Innovations before index a_FirstInnovation are left out, for run logs
+  // that have them already
+  void Save(CheckpointWriter &a_Writer, unsigned int a_FirstInnovation = 0);
 
   //////////////////////
   // NEW STUFF
@@ -0,0 +1,453 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        QuantizedNetwork.cc
+// Description: Implementation of the integer inference network.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Activation.hh>
+#include <MultiNEAT/QuantizedNetwork.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace NEAT {
+
+// Rounds a_x to the nearest Int, saturating
+template <typename Int> static inline Int Quantize(double a_x) {
+  double t_max = std::numeric_limits<Int>::max();
+  double t_y = std::floor(a_x + 0.5);
+  t_y = (t_y > t_max) ? t_max : ((t_y < -t_max) ? -t_max : t_y);
+  return static_cast<Int>(t_y);
+}
+
+// Runs a_Net a_Steps times on every sample and records the largest
+// |activation| and the largest |synaptic input| of the non-input neurons.
+static void MeasureRanges(const NeuralNetwork &a_Net,
+                          const std::vector<std::vector<double>> &a_Samples,
+                          unsigned int a_Steps, bool a_UseBias,
+                          double &a_MaxActivation, double &a_MaxInput) {
+  const unsigned int t_num_inputs = a_Net.NumInputs();
+  const unsigned int t_num_neurons = a_Net.m_neurons.size();
+  std::vector<double> t_activation(t_num_neurons);
+  std::vector<double> t_activesum(t_num_neurons);
+
+  a_MaxActivation = 0;
+  a_MaxInput = 0;
+  for (unsigned int s = 0; s < a_Samples.size(); s++) {
+    std::fill(t_activation.begin(), t_activation.end(), 0.0);
+    std::fill(t_activesum.begin(), t_activesum.end(), 0.0);
+    for (unsigned int i = 0; (i < t_num_inputs) && (i < a_Samples[s].size());
+         i++) {
+      t_activation[i] = a_Samples[s][i];
+      a_MaxActivation = std::max(a_MaxActivation, std::fabs(t_activation[i]));
+    }
+
+    for (unsigned int d = 0; d < a_Steps; d++) {
+      for (unsigned int c = 0; c < a_Net.m_connections.size(); c++) {
+        const Connection &t_c = a_Net.m_connections[c];
+        t_activesum[t_c.m_target_neuron_idx] +=
+            t_activation[t_c.m_source_neuron_idx] * t_c.m_weight;
+      }
+      for (unsigned int i = t_num_inputs; i < t_num_neurons; i++) {
+        const NeuronState &t_n = a_Net.m_neurons[i];
+        double x = t_activesum[i] + (a_UseBias ? t_n.m_bias : 0.0);
+        t_activesum[i] = 0;
+        t_activation[i] =
+            af_apply(t_n.m_activation_function_type, x, t_n.m_a, t_n.m_b);
+        a_MaxInput = std::max(a_MaxInput, std::fabs(x));
+        a_MaxActivation =
+            std::max(a_MaxActivation, std::fabs(t_activation[i]));
+      }
+    }
+  }
+}
+
+template <typename Int>
+QuantizedNetwork<Int>::QuantizedNetwork()
+    : m_num_inputs(0), m_num_outputs(0), m_use_bias(false),
+      m_weight_scale(1), m_activation_scale(1), m_lut_size(0),
+      m_sum_limit(0), m_sum_to_lut(0) {}
+
+template <typename Int>
+QuantizationReport
+QuantizedNetwork<Int>::Build(const NeuralNetwork &a_Net,
+                             const std::vector<std::vector<double>> &a_Samples,
+                             unsigned int a_Steps, bool a_UseBias) {
+  const double t_int_max = std::numeric_limits<Int>::max();
+
+  m_num_inputs = a_Net.NumInputs();
+  m_num_outputs = a_Net.NumOutputs();
+  m_use_bias = a_UseBias;
+
+  // Without samples assume activations in [-1, 1] and inputs in [-8, 8]
+  double t_max_activation = 1.0, t_max_input = 8.0;
+  if (!a_Samples.empty()) {
+    MeasureRanges(a_Net, a_Samples, a_Steps, a_UseBias, t_max_activation,
+                  t_max_input);
+  }
+  if (t_max_activation <= 0) {
+    t_max_activation = 1.0;
+  }
+  if (t_max_input <= 0) {
+    t_max_input = 1.0;
+  }
+
+  // Scales
+  double t_max_weight = 0;
+  for (unsigned int c = 0; c < a_Net.m_connections.size(); c++) {
+    t_max_weight =
+        std::max(t_max_weight, std::fabs(a_Net.m_connections[c].m_weight));
+  }
+  if (t_max_weight <= 0) {
+    t_max_weight = 1.0;
+  }
+  m_weight_scale = t_max_weight / t_int_max;
+  m_activation_scale = t_max_activation / t_int_max;
+  const double t_sum_scale = m_weight_scale * m_activation_scale;
+
+  // Connections
+  const unsigned int t_num_conns = a_Net.m_connections.size();
+  m_source.resize(t_num_conns);
+  m_target.resize(t_num_conns);
+  m_weight.resize(t_num_conns);
+  for (unsigned int c = 0; c < t_num_conns; c++) {
+    const Connection &t_c = a_Net.m_connections[c];
+    m_source[c] = t_c.m_source_neuron_idx;
+    m_target[c] = t_c.m_target_neuron_idx;
+    m_weight[c] = Quantize<Int>(t_c.m_weight / m_weight_scale);
+  }
+
+  // Lookup tables, one per distinct activation function and parameters
+  m_lut_size = (sizeof(Int) == 1) ? 1024 : 4096;
+  const double t_lut_step = 2.0 * t_max_input / m_lut_size;
+  m_sum_limit = static_cast<Accumulator>(std::ceil(t_max_input / t_sum_scale));
+  m_sum_to_lut = static_cast<int64_t>(
+      std::floor(t_sum_scale / t_lut_step * 4294967296.0 + 0.5));
+
+  std::map<std::tuple<int, double, double>, unsigned int> t_tables;
+  const unsigned int t_num_neurons = a_Net.m_neurons.size();
+  m_activesum.assign(t_num_neurons, 0);
+  m_activation.assign(t_num_neurons, 0);
+  m_bias.assign(t_num_neurons, 0);
+  m_lut_index.assign(t_num_neurons, 0);
+  m_luts.clear();
+  for (unsigned int i = m_num_inputs; i < t_num_neurons; i++) {
+    const NeuronState &t_n = a_Net.m_neurons[i];
+    if (a_UseBias) {
+      m_bias[i] =
+          static_cast<Accumulator>(std::floor(t_n.m_bias / t_sum_scale + 0.5));
+    }
+
+    std::tuple<int, double, double> t_key(
+        static_cast<int>(t_n.m_activation_function_type), t_n.m_a, t_n.m_b);
+    auto t_found = t_tables.find(t_key);
+    if (t_found != t_tables.end()) {
+      m_lut_index[i] = t_found->second;
+      continue;
+    }
+
+    unsigned int t_table = t_tables.size();
+    t_tables[t_key] = t_table;
+    m_lut_index[i] = t_table;
+    for (unsigned int j = 0; j < m_lut_size; j++) {
+      double x = (static_cast<double>(j) - m_lut_size / 2) * t_lut_step;
+      double y = af_apply(t_n.m_activation_function_type, x, t_n.m_a, t_n.m_b);
+      m_luts.push_back(Quantize<Int>(y / m_activation_scale));
+    }
+  }
+
+  return Evaluate(a_Net, a_Samples, a_Steps);
+}
+
+template <typename Int>
+QuantizationReport QuantizedNetwork<Int>::Evaluate(
+    const NeuralNetwork &a_Net,
+    const std::vector<std::vector<double>> &a_Samples, unsigned int a_Steps) {
+  QuantizationReport t_report;
+  t_report.m_num_samples = a_Samples.size();
+  t_report.m_max_error = 0;
+  t_report.m_mean_error = 0;
+  t_report.m_weight_scale = m_weight_scale;
+  t_report.m_activation_scale = m_activation_scale;
+  t_report.m_input_range = m_sum_limit * m_weight_scale * m_activation_scale;
+
+  NeuralNetwork t_net = a_Net;
+  unsigned int t_count = 0;
+  for (unsigned int s = 0; s < a_Samples.size(); s++) {
+    std::vector<double> t_inputs = a_Samples[s];
+    t_net.Flush();
+    t_net.Input(t_inputs);
+    Flush();
+    Input(t_inputs);
+    for (unsigned int d = 0; d < a_Steps; d++) {
+      if (m_use_bias) {
+        t_net.ActivateUseInternalBias();
+      } else {
+        t_net.Activate();
+      }
+      Activate();
+    }
+
+    std::vector<double> t_expected = t_net.Output();
+    std::vector<double> t_actual = Output();
+    for (unsigned int o = 0; o < t_expected.size(); o++) {
+      double t_err = std::fabs(t_expected[o] - t_actual[o]);
+      t_report.m_max_error = std::max(t_report.m_max_error, t_err);
+      t_report.m_mean_error += t_err;
+      t_count++;
+    }
+  }
+  if (t_count > 0) {
+    t_report.m_mean_error /= t_count;
+  }
+
+  return t_report;
+}
+
+template <typename Int> void QuantizedNetwork<Int>::Activate() {
+  const unsigned int *t_source = m_source.data();
+  const unsigned int *t_target = m_target.data();
+  const Int *t_weight = m_weight.data();
+  const Int *t_activation = m_activation.data();
+  Accumulator *t_activesum = m_activesum.data();
+
+  // Activations only change after all signals are in, so one pass is enough
+  for (unsigned int c = 0; c < m_weight.size(); c++) {
+    t_activesum[t_target[c]] +=
+        static_cast<Accumulator>(t_weight[c]) *
+        static_cast<Accumulator>(t_activation[t_source[c]]);
+  }
+
+  const int64_t t_half = m_lut_size / 2;
+  for (unsigned int i = m_num_inputs; i < m_activation.size(); i++) {
+    Accumulator x = t_activesum[i] + m_bias[i];
+    t_activesum[i] = 0;
+    x = std::min(std::max(x, -m_sum_limit), m_sum_limit);
+
+    // table offset, rounded
+    int64_t t_j = ((static_cast<int64_t>(x) * m_sum_to_lut +
+                    (static_cast<int64_t>(1) << 31)) >>
+                   32) +
+                  t_half;
+    t_j = std::min(std::max(t_j, static_cast<int64_t>(0)),
+                   static_cast<int64_t>(m_lut_size - 1));
+    m_activation[i] = m_luts[m_lut_index[i] * m_lut_size + t_j];
+  }
+}
+
+template <typename Int> void QuantizedNetwork<Int>::Flush() {
+  std::fill(m_activesum.begin(), m_activesum.end(), 0);
+  std::fill(m_activation.begin(), m_activation.end(), 0);
+}
+
+template <typename Int>
+void QuantizedNetwork<Int>::Input(const std::vector<double> &a_Inputs) {
+  unsigned int mx = a_Inputs.size();
+  if (mx > m_num_inputs) {
+    mx = m_num_inputs;
+  }
+
+  for (unsigned int i = 0; i < mx; i++) {
+    m_activation[i] = Quantize<Int>(a_Inputs[i] / m_activation_scale);
+  }
+}
+
+template <typename Int>
+std::vector<double> QuantizedNetwork<Int>::Output() const {
+  std::vector<double> t_output(m_num_outputs);
+  for (unsigned int i = 0; i < m_num_outputs; i++) {
+    t_output[i] = m_activation[i + m_num_inputs] * m_activation_scale;
+  }
+  return t_output;
+}
+
+template <typename Int>
+void QuantizedNetwork<Int>::Save(const char *a_filename) {
+  FILE *fil = fopen(a_filename, "w");
+  Save(fil);
+  fclose(fil);
+}
+
+template <typename Int> void QuantizedNetwork<Int>::Save(FILE *a_file) {
+  fprintf(a_file, "QNNstart\n");
+  // bits .. inputs .. outputs .. neurons .. use bias
+  fprintf(a_file, "%d %d %d %d %d\n", static_cast<int>(sizeof(Int) * 8),
+          m_num_inputs, m_num_outputs, static_cast<int>(m_activation.size()),
+          static_cast<int>(m_use_bias));
+  fprintf(a_file, "%3.18g %3.18g\n", m_weight_scale, m_activation_scale);
+  fprintf(a_file, "%d %lld %lld\n", m_lut_size,
+          static_cast<long long>(m_sum_limit),
+          static_cast<long long>(m_sum_to_lut));
+
+  // bias .. table of every neuron
+  for (unsigned int i = 0; i < m_activation.size(); i++) {
+    fprintf(a_file, "neuron %lld %d\n", static_cast<long long>(m_bias[i]),
+            m_lut_index[i]);
+  }
+  // from .. to .. weight
+  for (unsigned int c = 0; c < m_weight.size(); c++) {
+    fprintf(a_file, "connection %d %d %d\n", m_source[c], m_target[c],
+            static_cast<int>(m_weight[c]));
+  }
+  for (unsigned int j = 0; j < m_luts.size(); j++) {
+    fprintf(a_file, "%d%c", static_cast<int>(m_luts[j]),
+            ((j + 1) % m_lut_size == 0) ? '\n' : ' ');
+  }
+  fprintf(a_file, "QNNend\n\n");
+}
+
+// Reads the next value of a quantized network and checks that it lies in
+// [a_Min, a_Max]. Throws std::runtime_error if it does not.
+template <typename T>
+static T ReadValue(std::ifstream &a_DataFile, long long a_Min,
+                   long long a_Max) {
+  long long t_value;
+  if (!(a_DataFile >> t_value)) {
+    throw std::runtime_error("Quantized network is truncated");
+  }
+  if ((t_value < a_Min) || (t_value > a_Max)) {
+    throw std::runtime_error("Quantized network is malformed");
+  }
+  return static_cast<T>(t_value);
+}
+
+template <typename Int>
+bool QuantizedNetwork<Int>::Load(std::ifstream &a_DataFile) {
+  typedef std::numeric_limits<Int> IntLimits;
+  typedef std::numeric_limits<Accumulator> AccumulatorLimits;
+  const long long t_int_max = IntLimits::max();
+  const long long t_count_max = std::numeric_limits<int>::max();
+  std::string t_str;
+
+  // search for QNNstart
+  do {
+    a_DataFile >> t_str;
+  } while ((t_str != "QNNstart") && (!a_DataFile.eof()));
+
+  if (t_str != "QNNstart")
+    return false;
+
+  int t_bits = ReadValue<int>(a_DataFile, 0, t_count_max);
+  if (t_bits != static_cast<int>(sizeof(Int) * 8))
+    return false;
+
+  // Everything is read into t_net and checked before it replaces this
+  // network, so a malformed file leaves this one as it was.
+  QuantizedNetwork<Int> t_net;
+  t_net.m_num_inputs = ReadValue<unsigned int>(a_DataFile, 0, t_count_max);
+  t_net.m_num_outputs = ReadValue<unsigned int>(a_DataFile, 0, t_count_max);
+  const long long t_num_neurons = ReadValue<long long>(
+      a_DataFile,
+      static_cast<long long>(t_net.m_num_inputs) + t_net.m_num_outputs,
+      t_count_max);
+  t_net.m_use_bias = (ReadValue<int>(a_DataFile, 0, 1) != 0);
+
+  a_DataFile >> t_net.m_weight_scale >> t_net.m_activation_scale;
+  if (!a_DataFile || !std::isfinite(t_net.m_weight_scale) ||
+      !std::isfinite(t_net.m_activation_scale) ||
+      (t_net.m_weight_scale <= 0) || (t_net.m_activation_scale <= 0)) {
+    throw std::runtime_error("Quantized network is malformed");
+  }
+  // Build() makes tables of at most 4096 entries
+  t_net.m_lut_size = ReadValue<unsigned int>(a_DataFile, 1, 1 << 16);
+  t_net.m_sum_limit =
+      ReadValue<Accumulator>(a_DataFile, 0, AccumulatorLimits::max());
+  t_net.m_sum_to_lut = ReadValue<int64_t>(
+      a_DataFile, 0, std::numeric_limits<long long>::max());
+
+  // The neurons are read one by one, so a count that is too large fails at
+  // the end of the file rather than allocating
+  unsigned int t_num_tables = 0;
+  for (long long i = 0; i < t_num_neurons; i++) {
+    if (!(a_DataFile >> t_str) || (t_str != "neuron")) {
+      throw std::runtime_error("Quantized network is malformed");
+    }
+    t_net.m_bias.push_back(ReadValue<Accumulator>(
+        a_DataFile, AccumulatorLimits::min(), AccumulatorLimits::max()));
+    t_net.m_lut_index.push_back(
+        ReadValue<unsigned int>(a_DataFile, 0, t_num_neurons - 1));
+    // the tables of input neurons are never looked up
+    if (i >= t_net.m_num_inputs) {
+      t_num_tables = std::max(t_num_tables, t_net.m_lut_index.back() + 1);
+    }
+  }
+  t_net.m_activesum.assign(t_num_neurons, 0);
+  t_net.m_activation.assign(t_num_neurons, 0);
+
+  // connections until the tables start
+  while ((a_DataFile >> t_str) && (t_str == "connection")) {
+    t_net.m_source.push_back(
+        ReadValue<unsigned int>(a_DataFile, 0, t_num_neurons - 1));
+    t_net.m_target.push_back(
+        ReadValue<unsigned int>(a_DataFile, 0, t_num_neurons - 1));
+    t_net.m_weight.push_back(
+        ReadValue<Int>(a_DataFile, IntLimits::min(), t_int_max));
+  }
+  if (!a_DataFile) {
+    throw std::runtime_error("Quantized network is truncated");
+  }
+
+  // t_str already holds the first table entry, unless there are no tables
+  const unsigned long long t_num_entries =
+      static_cast<unsigned long long>(t_num_tables) * t_net.m_lut_size;
+  for (unsigned long long j = 0; j < t_num_entries; j++) {
+    if ((j > 0) && !(a_DataFile >> t_str)) {
+      throw std::runtime_error("Quantized network is truncated");
+    }
+    char *t_end;
+    long long t_entry = std::strtoll(t_str.c_str(), &t_end, 10);
+    if ((t_str.empty()) || (*t_end != 0) || (t_entry < IntLimits::min()) ||
+        (t_entry > t_int_max)) {
+      throw std::runtime_error("Quantized network is malformed");
+    }
+    t_net.m_luts.push_back(static_cast<Int>(t_entry));
+  }
+  if ((t_num_entries > 0) && !(a_DataFile >> t_str)) {
+    throw std::runtime_error("Quantized network is truncated");
+  }
+  if (t_str != "QNNend") {
+    throw std::runtime_error("Quantized network is malformed");
+  }
+
+  *this = std::move(t_net);
+  return true;
+}
+
+template <typename Int>
+bool QuantizedNetwork<Int>::Load(const char *a_filename) {
+  std::ifstream t_DataFile(a_filename);
+  return Load(t_DataFile);
+}
+
+template class QuantizedNetwork<int8_t>;
+template class QuantizedNetwork<int16_t>;
+
+} // namespace NEAT
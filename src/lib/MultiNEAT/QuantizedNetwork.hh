@@ -0,0 +1,132 @@
+#ifndef _QUANTIZEDNETWORK_H
+#define _QUANTIZEDNETWORK_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        QuantizedNetwork.hh
+// Description: Integer inference version of a NeuralNetwork, for deployment.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+namespace NEAT {
+
+// What the calibration found out
+struct QuantizationReport {
+  unsigned int m_num_samples;
+  double m_max_error;  // largest absolute output error
+  double m_mean_error; // mean absolute output error
+  double m_weight_scale;
+  double m_activation_scale;
+  double m_input_range; // largest |synaptic input| the lookup tables cover
+};
+
+// A network with weights and activations stored as Int (int8_t or int16_t),
+// one scale for all weights and one for all activations. The synaptic inputs
+// are summed in a wider integer, and each activation function becomes a
+// lookup table from the sum to the quantized activation.
+// Leaky integrator networks are not supported.
+template <typename Int> class QuantizedNetwork {
+public:
+  typedef typename std::conditional<sizeof(Int) == 1, int32_t, int64_t>::type
+      Accumulator;
+
+private:
+  unsigned int m_num_inputs, m_num_outputs;
+  bool m_use_bias;
+
+  double m_weight_scale;     // real weight = m_weight * m_weight_scale
+  double m_activation_scale; // real activation = m_activation * this
+
+  // connections
+  std::vector<unsigned int> m_source;
+  std::vector<unsigned int> m_target;
+  std::vector<Int> m_weight;
+
+  // neurons
+  std::vector<Accumulator> m_activesum;
+  std::vector<Int> m_activation;
+  std::vector<Accumulator> m_bias; // in units of the sums
+  std::vector<unsigned int> m_lut_index;
+
+  // The lookup tables, m_lut_size entries each. Entry j holds the activation
+  // for the sum (j - m_lut_size / 2) * m_lut_step.
+  unsigned int m_lut_size;
+  std::vector<Int> m_luts;
+  Accumulator m_sum_limit; // sums are clamped to +-this
+  int64_t m_sum_to_lut;    // maps a sum to a table offset, 32.32 fixed point
+
+public:
+  QuantizedNetwork();
+
+  // Quantizes a_Net. The ranges of the activations and of the synaptic inputs
+  // are measured by running a copy of a_Net on every sample for a_Steps
+  // activations. The returned report compares the result with a_Net on the
+  // same samples. a_UseBias selects ActivateUseInternalBias() semantics.
+  QuantizationReport Build(const NeuralNetwork &a_Net,
+                           const std::vector<std::vector<double>> &a_Samples,
+                           unsigned int a_Steps, bool a_UseBias);
+
+  // Runs a_Net and this network on the samples and reports the output error
+  QuantizationReport Evaluate(const NeuralNetwork &a_Net,
+                              const std::vector<std::vector<double>> &a_Samples,
+                              unsigned int a_Steps);
+
+  void Activate();
+  void Flush(); // clears all activations
+
+  void Input(const std::vector<double> &a_Inputs);
+  std::vector<double> Output() const;
+
+  unsigned int NumInputs() const { return m_num_inputs; }
+  unsigned int NumOutputs() const { return m_num_outputs; }
+
+  // one-shot save/load
+  void Save(const char *a_filename);
+  bool Load(const char *a_filename);
+
+  // save/load from already opened files for reading/writing
+  // Load() returns false if there is no network of this width. It throws
+  // std::runtime_error if the network is malformed and then leaves this one
+  // unchanged.
+  void Save(FILE *a_file);
+  bool Load(std::ifstream &a_DataFile);
+};
+
+typedef QuantizedNetwork<int8_t> QuantizedNetwork8;
+typedef QuantizedNetwork<int16_t> QuantizedNetwork16;
+
+extern template class QuantizedNetwork<int8_t>;
+extern template class QuantizedNetwork<int16_t>;
+
+} // namespace NEAT
+
+#endif
@@ -30,22 +30,19 @@
 // Description: Declarations for a class dealing with random numbers.
 ///////////////////////////////////////////////////////////////////////////////
 
-#ifdef USE_BOOST_RANDOM
 #include <boost/random.hpp>
-#else
-#include <stdlib.h>
-#endif
 
 #include <limits>
+#include <string>
 #include <vector>
 
 namespace NEAT {
 
 class RNG {
 
-#ifdef USE_BOOST_RANDOM
+  // Each RNG has a generator of its own, so seeding one does not disturb the
+  // others and its whole state can be saved.
   boost::random::mt19937 gen;
-#endif
 
 public:
   // Seeds the random number generator with this value
@@ -54,6 +51,12 @@ public:
   // Seeds the random number generator with time
   void TimeSeed();
 
+  // The complete state of the generator, for checkpoints. An empty state, as
+  // written by versions that used rand(), leaves the generator as it is.
+  // Throws std::runtime_error if the state is malformed.
+  std::string GetState() const;
+  void SetState(const std::string &a_State);
+
   // Returns randomly either 1 or -1
   int RandPosNeg();
 
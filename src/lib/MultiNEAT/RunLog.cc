@@ -0,0 +1,476 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        RunLog.cc
+// Description: Implementation of the run log writer and reader.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Checkpoint.hh>
+#include <MultiNEAT/Population.hh>
+#include <MultiNEAT/RunLog.hh>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace NEAT {
+
+static const char RUNLOG_MAGIC[8] = {'M', 'N', 'E', 'A', 'T', 'L', 'O', 'G'};
+static const uint32_t RUNLOG_BYTE_ORDER = 0x01020304;
+
+// magic, version, byte order
+static const size_t RUNLOG_HEADER_SIZE = 8 + 4 * 2;
+// kind, generation, payload size
+static const size_t RUNLOG_RECORD_SIZE = 4 * 2 + 8;
+
+// The sections a record has besides those of a checkpoint. Added genomes are
+// stored as reference, byte count and bytes.
+enum RunLogSection { RUNLOG_GENOMES_ADDED = 16, RUNLOG_GENOMES_REMOVED = 17 };
+
+// The sections of a checkpoint that records carry unchanged
+static const uint32_t RUNLOG_PLAIN_SECTIONS[] = {
+    CHECKPOINT_PARAMETERS, CHECKPOINT_SPECIES, CHECKPOINT_POPULATION};
+
+template <typename T> static void AppendBytes(std::vector<char> &a_Out, T a_V) {
+  const char *t_bytes = reinterpret_cast<const char *>(&a_V);
+  a_Out.insert(a_Out.end(), t_bytes, t_bytes + sizeof(T));
+}
+
+template <typename T> static T ReadBytes(const char *a_Data) {
+  T t_value;
+  std::memcpy(&t_value, a_Data, sizeof(T));
+  return t_value;
+}
+
+static void AppendFileHeader(std::vector<char> &a_Out) {
+  a_Out.insert(a_Out.end(), RUNLOG_MAGIC, RUNLOG_MAGIC + 8);
+  AppendBytes(a_Out, static_cast<uint32_t>(RUNLOG_VERSION));
+  AppendBytes(a_Out, RUNLOG_BYTE_ORDER);
+}
+
+static void AppendRecordHeader(std::vector<char> &a_Out, uint32_t a_Kind,
+                               uint32_t a_Generation, uint64_t a_Size) {
+  AppendBytes(a_Out, a_Kind);
+  AppendBytes(a_Out, a_Generation);
+  AppendBytes(a_Out, a_Size);
+}
+
+static void CopySection(const CheckpointReader &a_From, uint32_t a_ID,
+                        CheckpointWriter &a_To) {
+  const char *t_data;
+  size_t t_size;
+  a_From.GetSection(a_ID, t_data, t_size);
+  a_To.BeginSection(a_ID);
+  a_To.PutBytes(t_data, t_size);
+  a_To.EndSection();
+}
+
+static bool WriteBytes(FILE *a_File, const char *a_Data, size_t a_Size) {
+  return fwrite(a_Data, 1, a_Size, a_File) == a_Size;
+}
+
+////////////////////////////
+// Writer
+////////////////////////////
+
+// Remembers the bytes of the genomes of the last record
+class RunLogWriter::GenomeTable : public CheckpointGenomeTable {
+  std::unordered_map<std::string, uint32_t> m_refs;
+  std::unordered_set<uint32_t> m_used;
+  uint32_t m_next_ref;
+
+  // the genomes first stored since the last record
+  CheckpointWriter m_added;
+  uint64_t m_num_added;
+
+public:
+  GenomeTable() : m_next_ref(0), m_num_added(0) {}
+
+  uint32_t Store(const char *a_Data, size_t a_Size) {
+    std::string t_key(a_Data, a_Size);
+    auto t_it = m_refs.find(t_key);
+    if (t_it != m_refs.end()) {
+      m_used.insert(t_it->second);
+      return t_it->second;
+    }
+
+    uint32_t t_ref = m_next_ref++;
+    m_refs.emplace(std::move(t_key), t_ref);
+    m_used.insert(t_ref);
+
+    m_added.Put(t_ref);
+    m_added.Put(static_cast<uint64_t>(a_Size));
+    m_added.PutBytes(a_Data, a_Size);
+    m_num_added++;
+    return t_ref;
+  }
+
+  const std::vector<char> &Find(uint32_t) const {
+    throw std::runtime_error("Run log writers do not read genomes");
+  }
+
+  // Writes the genomes added since the last record and the references of the
+  // ones not stored since then, which are forgotten
+  void Finish(CheckpointWriter &a_Record) {
+    std::vector<uint32_t> t_removed;
+    for (auto t_it = m_refs.begin(); t_it != m_refs.end();) {
+      if (m_used.count(t_it->second)) {
+        t_it++;
+      } else {
+        t_removed.push_back(t_it->second);
+        t_it = m_refs.erase(t_it);
+      }
+    }
+    std::sort(t_removed.begin(), t_removed.end());
+
+    a_Record.BeginSection(RUNLOG_GENOMES_ADDED);
+    a_Record.Put(m_num_added);
+    const std::vector<char> &t_added = m_added.GetPayload();
+    a_Record.PutBytes(t_added.data(), t_added.size());
+    a_Record.EndSection();
+
+    a_Record.BeginSection(RUNLOG_GENOMES_REMOVED);
+    a_Record.PutVector(t_removed);
+    a_Record.EndSection();
+
+    m_used.clear();
+    m_added = CheckpointWriter();
+    m_num_added = 0;
+  }
+
+  // Forgets all genomes, so the next record stores every one again
+  void Clear() {
+    m_refs.clear();
+    m_used.clear();
+    m_added = CheckpointWriter();
+    m_num_added = 0;
+  }
+};
+
+RunLogWriter::RunLogWriter()
+    : m_file(NULL), m_genomes(new GenomeTable()), m_snapshot_interval(50),
+      m_deltas(0), m_need_snapshot(true), m_num_innovations(0),
+      m_last_innovation(-1) {}
+
+RunLogWriter::~RunLogWriter() { Close(); }
+
+bool RunLogWriter::Open(const char *a_FileName,
+                        unsigned int a_SnapshotInterval) {
+  Close();
+
+  // Find where the complete records of an existing log end
+  uint64_t t_end = 0;
+  std::error_code t_error;
+  uintmax_t t_size = std::filesystem::file_size(a_FileName, t_error);
+  if (!t_error && (t_size > 0)) {
+    try {
+      RunLogReader t_log;
+      t_log.Open(a_FileName);
+      t_end = t_log.GetSize();
+    } catch (std::runtime_error &) {
+      return false;
+    }
+
+    if (t_end < t_size) {
+      std::filesystem::resize_file(a_FileName, t_end, t_error);
+      if (t_error) {
+        return false;
+      }
+    }
+  }
+
+  m_file = fopen(a_FileName, "ab");
+  if (!m_file) {
+    return false;
+  }
+
+  if (t_end == 0) {
+    std::vector<char> t_header;
+    AppendFileHeader(t_header);
+    if (!WriteBytes(m_file, t_header.data(), t_header.size()) ||
+        (fflush(m_file) != 0)) {
+      Close();
+      return false;
+    }
+  }
+
+  m_snapshot_interval = a_SnapshotInterval;
+  m_deltas = 0;
+  m_need_snapshot = true;
+  return true;
+}
+
+void RunLogWriter::Close() {
+  if (m_file) {
+    fclose(m_file);
+    m_file = NULL;
+  }
+}
+
+bool RunLogWriter::Append(Population &a_Pop) {
+  if (!m_file) {
+    return false;
+  }
+
+  // Deltas only add innovations, after a flush a snapshot is needed
+  const std::vector<Innovation> &t_innovations =
+      a_Pop.AccessInnovationDatabase().m_Innovations;
+  bool t_snapshot =
+      m_need_snapshot || (m_deltas >= m_snapshot_interval) ||
+      (t_innovations.size() < m_num_innovations) ||
+      ((m_num_innovations > 0) &&
+       (t_innovations[m_num_innovations - 1].ID() != m_last_innovation));
+
+  if (t_snapshot) {
+    m_genomes->Clear();
+  }
+
+  CheckpointWriter t_record;
+  t_record.SetGenomeTable(m_genomes.get());
+  a_Pop.Save(t_record, t_snapshot ? 0 : m_num_innovations);
+  t_record.SetGenomeTable(NULL);
+  m_genomes->Finish(t_record);
+
+  std::vector<char> t_payload;
+  t_record.GetBytes(t_payload);
+  std::vector<char> t_header;
+  AppendRecordHeader(t_header, t_snapshot ? RUNLOG_SNAPSHOT : RUNLOG_DELTA,
+                     a_Pop.m_Generation, t_payload.size());
+
+  // A partly written record is dropped by the next Open()
+  if (!WriteBytes(m_file, t_header.data(), t_header.size()) ||
+      !WriteBytes(m_file, t_payload.data(), t_payload.size()) ||
+      (fflush(m_file) != 0)) {
+    Close();
+    return false;
+  }
+
+  m_need_snapshot = false;
+  m_deltas = t_snapshot ? 0 : m_deltas + 1;
+  m_num_innovations = t_innovations.size();
+  m_last_innovation = t_innovations.empty() ? -1 : t_innovations.back().ID();
+  return true;
+}
+
+////////////////////////////
+// Reader
+////////////////////////////
+
+// Holds the bytes of the genomes while records are replayed
+class RunLogReader::GenomeTable : public CheckpointGenomeTable {
+public:
+  std::unordered_map<uint32_t, std::vector<char>> m_genomes;
+
+  uint32_t Store(const char *, size_t) {
+    throw std::runtime_error("Run log readers do not store genomes");
+  }
+
+  const std::vector<char> &Find(uint32_t a_Ref) const {
+    auto t_it = m_genomes.find(a_Ref);
+    if (t_it == m_genomes.end()) {
+      throw std::runtime_error("Run log refers to a missing genome");
+    }
+    return t_it->second;
+  }
+};
+
+RunLogReader::RunLogReader() : m_end(0) {}
+
+void RunLogReader::Open(const char *a_FileName) {
+  m_file.Open(a_FileName);
+  m_records.clear();
+  m_end = 0;
+
+  const char *t_data = m_file.Data();
+  const size_t t_size = m_file.Size();
+  if ((t_size < RUNLOG_HEADER_SIZE) ||
+      (std::memcmp(t_data, RUNLOG_MAGIC, 8) != 0)) {
+    throw std::runtime_error("Not a run log");
+  }
+
+  // version 1 kept the fitness of a genome with its genes
+  uint32_t t_version = ReadBytes<uint32_t>(t_data + 8);
+  if (t_version != RUNLOG_VERSION) {
+    throw std::runtime_error("Unsupported run log version");
+  }
+  if (ReadBytes<uint32_t>(t_data + 12) != RUNLOG_BYTE_ORDER) {
+    throw std::runtime_error("Run log has a different byte order");
+  }
+
+  uint64_t t_pos = RUNLOG_HEADER_SIZE;
+  while (t_size - t_pos >= RUNLOG_RECORD_SIZE) {
+    Record t_r;
+    t_r.m_kind = ReadBytes<uint32_t>(t_data + t_pos);
+    t_r.m_generation = ReadBytes<uint32_t>(t_data + t_pos + 4);
+    t_r.m_size = ReadBytes<uint64_t>(t_data + t_pos + 8);
+    t_r.m_offset = t_pos + RUNLOG_RECORD_SIZE;
+    if (t_r.m_size > t_size - t_r.m_offset) {
+      break;
+    }
+    if ((t_r.m_kind != RUNLOG_SNAPSHOT) && (t_r.m_kind != RUNLOG_DELTA)) {
+      throw std::runtime_error("Unknown run log record");
+    }
+
+    m_records.push_back(t_r);
+    t_pos = t_r.m_offset + t_r.m_size;
+  }
+  m_end = t_pos;
+}
+
+void RunLogReader::Replay(unsigned int a_Idx, GenomeTable &a_Genomes,
+                          std::vector<char> &a_Out) const {
+  if (a_Idx >= m_records.size()) {
+    throw std::runtime_error("No such run log record");
+  }
+
+  unsigned int t_first = a_Idx;
+  while (m_records[t_first].m_kind != RUNLOG_SNAPSHOT) {
+    if (t_first == 0) {
+      throw std::runtime_error("Run log record has no snapshot before it");
+    }
+    t_first--;
+  }
+
+  InnovationDatabase t_innovations;
+  a_Genomes.m_genomes.clear();
+
+  CheckpointReader t_record;
+  std::vector<uint32_t> t_removed;
+  for (unsigned int i = t_first; i <= a_Idx; i++) {
+    t_record.Open(m_file.Data() + m_records[i].m_offset,
+                  m_records[i].m_size);
+
+    t_record.BeginSection(RUNLOG_GENOMES_REMOVED);
+    t_record.GetVector(t_removed);
+    for (unsigned int j = 0; j < t_removed.size(); j++) {
+      a_Genomes.m_genomes.erase(t_removed[j]);
+    }
+
+    t_record.BeginSection(RUNLOG_GENOMES_ADDED);
+    uint64_t t_count = t_record.Get<uint64_t>();
+    for (uint64_t j = 0; j < t_count; j++) {
+      uint32_t t_ref = t_record.Get<uint32_t>();
+      std::string t_bytes = t_record.GetString();
+      a_Genomes.m_genomes[t_ref].assign(t_bytes.begin(), t_bytes.end());
+    }
+
+    t_record.BeginSection(CHECKPOINT_INNOVATIONS);
+    t_innovations.Init(t_record);
+  }
+
+  // t_record is at a_Idx now
+  CheckpointWriter t_out;
+  for (uint32_t t_id : RUNLOG_PLAIN_SECTIONS) {
+    CopySection(t_record, t_id, t_out);
+  }
+  t_out.BeginSection(CHECKPOINT_INNOVATIONS);
+  t_innovations.Save(t_out);
+  t_out.EndSection();
+
+  t_out.GetBytes(a_Out);
+}
+
+Population RunLogReader::Load(unsigned int a_Idx) const {
+  GenomeTable t_genomes;
+  std::vector<char> t_bytes;
+  Replay(a_Idx, t_genomes, t_bytes);
+
+  CheckpointReader t_reader;
+  t_reader.Open(t_bytes.data(), t_bytes.size());
+  t_reader.SetGenomeTable(&t_genomes);
+  return Population(t_reader);
+}
+
+Population RunLogReader::LoadGeneration(unsigned int a_Generation) const {
+  for (unsigned int i = m_records.size(); i > 0; i--) {
+    if (m_records[i - 1].m_generation == a_Generation) {
+      return Load(i - 1);
+    }
+  }
+  throw std::runtime_error("Generation is not in the run log");
+}
+
+bool RunLogReader::Compact(unsigned int a_First,
+                           const char *a_FileName) const {
+  GenomeTable t_genomes;
+  std::vector<char> t_checkpoint;
+  Replay(a_First, t_genomes, t_checkpoint);
+
+  // The snapshot keeps the references the genomes have, so the deltas after
+  // it stay valid
+  CheckpointReader t_reader;
+  t_reader.Open(t_checkpoint.data(), t_checkpoint.size());
+
+  CheckpointWriter t_snapshot;
+  for (uint32_t t_id : RUNLOG_PLAIN_SECTIONS) {
+    CopySection(t_reader, t_id, t_snapshot);
+  }
+  CopySection(t_reader, CHECKPOINT_INNOVATIONS, t_snapshot);
+
+  std::vector<uint32_t> t_refs;
+  for (auto t_it = t_genomes.m_genomes.begin();
+       t_it != t_genomes.m_genomes.end(); t_it++) {
+    t_refs.push_back(t_it->first);
+  }
+  std::sort(t_refs.begin(), t_refs.end());
+
+  t_snapshot.BeginSection(RUNLOG_GENOMES_ADDED);
+  t_snapshot.Put(static_cast<uint64_t>(t_refs.size()));
+  for (unsigned int i = 0; i < t_refs.size(); i++) {
+    const std::vector<char> &t_bytes = t_genomes.Find(t_refs[i]);
+    t_snapshot.Put(t_refs[i]);
+    t_snapshot.Put(static_cast<uint64_t>(t_bytes.size()));
+    t_snapshot.PutBytes(t_bytes.data(), t_bytes.size());
+  }
+  t_snapshot.EndSection();
+
+  t_snapshot.BeginSection(RUNLOG_GENOMES_REMOVED);
+  t_snapshot.PutVector(std::vector<uint32_t>());
+  t_snapshot.EndSection();
+
+  std::vector<char> t_payload;
+  t_snapshot.GetBytes(t_payload);
+  std::vector<char> t_header;
+  AppendFileHeader(t_header);
+  AppendRecordHeader(t_header, RUNLOG_SNAPSHOT,
+                     m_records[a_First].m_generation, t_payload.size());
+
+  const uint64_t t_rest =
+      m_records[a_First].m_offset + m_records[a_First].m_size;
+
+  ReplacementFile t_file(a_FileName);
+  if (!t_file.Get()) {
+    return false;
+  }
+  bool t_ok =
+      WriteBytes(t_file.Get(), t_header.data(), t_header.size()) &&
+      WriteBytes(t_file.Get(), t_payload.data(), t_payload.size()) &&
+      WriteBytes(t_file.Get(), m_file.Data() + t_rest, m_end - t_rest);
+  return t_ok && t_file.Commit();
+}
+
+} // namespace NEAT
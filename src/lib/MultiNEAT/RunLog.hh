@@ -0,0 +1,158 @@
+#ifndef _RUNLOG_H
+#define _RUNLOG_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        RunLog.hh
+// Description: Append-only logs of evolution runs, written one generation at
+//              a time.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/MappedFile.hh>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace NEAT {
+
+class Population;
+
+// A run log starts with
+//
+//   char[8]   "MNEATLOG"
+//   uint32    format version
+//   uint32    byte order mark, 0x01020304 as written
+//
+// followed by records
+//
+//   uint32    RUNLOG_SNAPSHOT or RUNLOG_DELTA
+//   uint32    generation of the population
+//   uint64    size of the payload
+//
+// Each payload is a checkpoint (Checkpoint.hh) whose genomes are references
+// into a table of genes, each with the ID and evaluation of the genome, and
+// that also adds to and removes from the table. Genes are shared by content,
+// so a survivor or a clone is not stored again when its fitness changes. A
+// snapshot starts a new table with every genome and has all innovations. A
+// delta adds only the genomes that changed since the record before it,
+// removes the ones that are gone and has the new innovations.
+// Parameters, species, counters and the RNG state are small and come in full.
+const unsigned int RUNLOG_VERSION = 2;
+
+enum RunLogRecord { RUNLOG_SNAPSHOT = 1, RUNLOG_DELTA = 2 };
+
+class RunLogWriter {
+  class GenomeTable;
+
+  FILE *m_file;
+  std::unique_ptr<GenomeTable> m_genomes;
+
+  // a snapshot is written after this many deltas
+  unsigned int m_snapshot_interval;
+  unsigned int m_deltas;
+  bool m_need_snapshot;
+
+  // how the innovation database ended at the last record
+  unsigned int m_num_innovations;
+  int m_last_innovation;
+
+public:
+  RunLogWriter();
+  ~RunLogWriter();
+
+  // Opens a log for appending and creates it if there is none. A record cut
+  // short at the end of the log, as an interrupted run leaves it, is dropped.
+  // Every a_SnapshotInterval deltas a snapshot is written instead, so no
+  // generation needs more than that many records replayed. Returns false if
+  // the file cannot be opened or is not a run log.
+  bool Open(const char *a_FileName, unsigned int a_SnapshotInterval = 50);
+  void Close();
+  bool IsOpen() const { return m_file != NULL; }
+
+  // Logs the population as it is now. The first record after Open() is a
+  // snapshot. Returns false if the record could not be written, the next one
+  // is a snapshot then.
+  bool Append(Population &a_Pop);
+
+  // Makes the next record a snapshot
+  void RequestSnapshot() { m_need_snapshot = true; }
+};
+
+// Reads a run log in place. Throws std::runtime_error if the log is
+// malformed.
+class RunLogReader {
+  class GenomeTable;
+
+  struct Record {
+    uint32_t m_kind;
+    uint32_t m_generation;
+    uint64_t m_offset; // of the payload
+    uint64_t m_size;
+  };
+
+  MappedFile m_file;
+  std::vector<Record> m_records;
+  // where the last complete record ends
+  uint64_t m_end;
+
+  // Replays the records from the last snapshot up to a_Idx into a_Genomes
+  // and writes the complete checkpoint of record a_Idx to a_Out, its genomes
+  // left as references into a_Genomes
+  void Replay(unsigned int a_Idx, GenomeTable &a_Genomes,
+              std::vector<char> &a_Out) const;
+
+public:
+  RunLogReader();
+
+  // Maps a log and finds its records. A record cut short at the end is
+  // ignored.
+  void Open(const char *a_FileName);
+
+  unsigned int NumRecords() const { return m_records.size(); }
+  unsigned int GetGeneration(unsigned int a_Idx) const {
+    return m_records[a_Idx].m_generation;
+  }
+  bool IsSnapshot(unsigned int a_Idx) const {
+    return m_records[a_Idx].m_kind == RUNLOG_SNAPSHOT;
+  }
+  // The size of the log up to the end of the last complete record
+  uint64_t GetSize() const { return m_end; }
+
+  // Rebuilds the population logged by record a_Idx
+  Population Load(unsigned int a_Idx) const;
+  // Rebuilds the population logged last for a_Generation
+  Population LoadGeneration(unsigned int a_Generation) const;
+
+  // Writes a log that starts with a snapshot of record a_First and continues
+  // with the records after it unchanged. Returns false if the file could not
+  // be written. It may be the log being read, which is replaced at once.
+  bool Compact(unsigned int a_First, const char *a_FileName) const;
+};
+
+} // namespace NEAT
+
+#endif
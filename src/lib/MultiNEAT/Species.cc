@@ -30,11 +30,13 @@
 #include <algorithm>
 
 #include <MultiNEAT/Assert.hh>
+#include <MultiNEAT/Checkpoint.hh>
 #include <MultiNEAT/Genome.hh>
 #include <MultiNEAT/Parameters.hh>
 #include <MultiNEAT/Population.hh>
 #include <MultiNEAT/Random.hh>
 #include <MultiNEAT/Species.hh>
+#include <MultiNEAT/Stats.hh>
 #include <MultiNEAT/Utils.hh>
 
 #define COMPAT_EQUALITY_DELTA 0.0000001
@@ -81,6 +83,54 @@ Species::Species(const Genome &a_Genome, int a_ID) {
   m_B = static_cast<int>(global_rng.RandFloat() * 255);
 }
 
+Species::Species(CheckpointReader &a_Reader)
+    : m_Representative(a_Reader), m_BestGenome(a_Reader) {
+  a_Reader.Get(m_ID);
+  a_Reader.Get(m_BestSpecies);
+  a_Reader.Get(m_WorstSpecies);
+  a_Reader.Get(m_AgeGenerations);
+  a_Reader.Get(m_AgeEvaluations);
+  a_Reader.Get(m_OffspringRqd);
+  a_Reader.Get(m_BestFitness);
+  a_Reader.Get(m_GensNoImprovement);
+  a_Reader.Get(m_EvalsNoImprovement);
+  a_Reader.Get(m_R);
+  a_Reader.Get(m_G);
+  a_Reader.Get(m_B);
+  a_Reader.Get(m_AverageFitness);
+
+  uint64_t t_count = a_Reader.Get<uint64_t>();
+  m_Individuals.reserve(t_count);
+  for (uint64_t i = 0; i < t_count; i++) {
+    m_Individuals.emplace_back(a_Reader);
+  }
+}
+
+void Species::Save(CheckpointWriter &a_Writer) const {
+  // the genomes come first, the constructor reads them as members
+  m_Representative.Save(a_Writer);
+  m_BestGenome.Save(a_Writer);
+
+  a_Writer.Put(m_ID);
+  a_Writer.Put(m_BestSpecies);
+  a_Writer.Put(m_WorstSpecies);
+  a_Writer.Put(m_AgeGenerations);
+  a_Writer.Put(m_AgeEvaluations);
+  a_Writer.Put(m_OffspringRqd);
+  a_Writer.Put(m_BestFitness);
+  a_Writer.Put(m_GensNoImprovement);
+  a_Writer.Put(m_EvalsNoImprovement);
+  a_Writer.Put(m_R);
+  a_Writer.Put(m_G);
+  a_Writer.Put(m_B);
+  a_Writer.Put(m_AverageFitness);
+
+  a_Writer.Put(static_cast<uint64_t>(m_Individuals.size()));
+  for (unsigned int i = 0; i < m_Individuals.size(); i++) {
+    m_Individuals[i].Save(a_Writer);
+  }
+}
+
 Species &Species::operator=(const Species &a_S) {
   // self assignment guard
   if (this != &a_S) {
@@ -310,6 +360,7 @@ void Species::Reproduce(Population &a_Pop, Parameters &a_Parameters,
   // Spawn t_offspring_count babies
   // bool t_champ_chosen = false;
   bool t_baby_exists_in_pop = false;
+  bool t_fails_constraints = false;
   while (t_offspring_count--) {
     // Select the elite first..
 
@@ -405,11 +456,14 @@ void Species::Reproduce(Population &a_Pop, Parameters &a_Parameters,
         // Check if this baby is already present somewhere in the offspring
         // we don't want that
         t_baby_exists_in_pop = false;
+        NEAT_STAT(double t_check_start = StatsClock());
+        NEAT_STAT(unsigned long long t_checks = 0);
         // Unless of course, we want clones to exist
         if (!a_Parameters.AllowClones) {
           for (unsigned int i = 0; i < a_Pop.m_TempSpecies.size(); i++) {
             for (unsigned int j = 0;
                  j < a_Pop.m_TempSpecies[i].m_Individuals.size(); j++) {
+              NEAT_STAT(t_checks++);
               if ((t_baby.CompatibilityDistance(
                        a_Pop.m_TempSpecies[i].m_Individuals[j],
                        a_Parameters) <
@@ -425,6 +479,7 @@ void Species::Reproduce(Population &a_Pop, Parameters &a_Parameters,
         // In case we want to enforce always new individuals
         if (a_Parameters.ArchiveEnforcement) {
           for (unsigned int i = 0; i < a_Pop.m_GenomeArchive.size(); i++) {
+            NEAT_STAT(t_checks++);
             if ((t_baby.CompatibilityDistance(a_Pop.m_GenomeArchive[i],
                                               a_Parameters) <
                  COMPAT_EQUALITY_DELTA) // identical genome?
@@ -434,8 +489,20 @@ void Species::Reproduce(Population &a_Pop, Parameters &a_Parameters,
             }
           }
         }
-      } while (t_baby_exists_in_pop ||
-               (t_baby.FailsConstraints(a_Parameters))); // end do
+        NEAT_STAT(a_Pop.AccessStats().m_CloneChecks += t_checks);
+        NEAT_STAT(a_Pop.AccessStats().m_CloneCheckTime +=
+                  StatsClock() - t_check_start);
+        NEAT_STAT(a_Pop.AccessStats().m_CloneRejections +=
+                  t_baby_exists_in_pop ? 1 : 0);
+
+        t_fails_constraints = false;
+        if (!t_baby_exists_in_pop) {
+          NEAT_STAT(StatsTimer t_timer(a_Pop.AccessStats().m_ConstraintTime));
+          t_fails_constraints = t_baby.FailsConstraints(a_Parameters);
+        }
+        NEAT_STAT(a_Pop.AccessStats().m_ConstraintRejections +=
+                  t_fails_constraints ? 1 : 0);
+      } while (t_baby_exists_in_pop || t_fails_constraints); // end do
     }
 
     // We have a new offspring now
@@ -467,6 +534,7 @@ void Species::Reproduce(Population &a_Pop, Parameters &a_Parameters,
     // we will store results there.
     // after all reproduction completes, the original species will be replaced
     // back
+    NEAT_STAT(StatsTimer t_timer(a_Pop.AccessStats().m_SpeciateTime));
 
     bool t_found = false;
     std::vector<Species>::iterator t_cur_species = a_Pop.m_TempSpecies.begin();
@@ -755,73 +823,59 @@ void Species::MutateGenome(bool t_baby_is_clone, Population &a_Pop,
   // We will perform roulette wheel selection to choose the type of mutation and
   // will mutate the baby This method guarantees that the baby will be mutated
   // at least with one mutation
-  enum MutationTypes {
-    ADD_NODE = 0,
-    ADD_LINK,
-    REMOVE_NODE,
-    REMOVE_LINK,
-    CHANGE_ACTIVATION_FUNCTION,
-    MUTATE_WEIGHTS,
-    MUTATE_ACTIVATION_A,
-    MUTATE_ACTIVATION_B,
-    MUTATE_TIMECONSTS,
-    MUTATE_BIASES,
-    MUTATE_NEURON_TRAITS,
-    MUTATE_LINK_TRAITS,
-    MUTATE_GENOME_TRAITS
-  };
   std::vector<int> t_muts;
   std::vector<double> t_mut_probs;
 
-  // ADD_NODE;
+  // MUTATION_ADD_NEURON;
   t_mut_probs.push_back(a_Parameters.MutateAddNeuronProb);
 
-  // ADD_LINK;
+  // MUTATION_ADD_LINK;
   t_mut_probs.push_back(a_Parameters.MutateAddLinkProb);
 
-  // REMOVE_NODE;
+  // MUTATION_REMOVE_NEURON;
   t_mut_probs.push_back(a_Parameters.MutateRemSimpleNeuronProb);
 
-  // REMOVE_LINK;
+  // MUTATION_REMOVE_LINK;
   t_mut_probs.push_back(a_Parameters.MutateRemLinkProb);
 
-  // CHANGE_ACTIVATION_FUNCTION;
+  // MUTATION_ACTIVATION_FUNCTION;
   t_mut_probs.push_back(a_Parameters.MutateNeuronActivationTypeProb);
 
-  // MUTATE_WEIGHTS;
+  // MUTATION_WEIGHTS;
   t_mut_probs.push_back(a_Parameters.MutateWeightsProb);
 
-  // MUTATE_ACTIVATION_A;
+  // MUTATION_ACTIVATION_A;
   t_mut_probs.push_back(a_Parameters.MutateActivationAProb);
 
-  // MUTATE_ACTIVATION_B;
+  // MUTATION_ACTIVATION_B;
   t_mut_probs.push_back(a_Parameters.MutateActivationBProb);
 
-  // MUTATE_TIMECONSTS;
+  // MUTATION_TIME_CONSTANTS;
   t_mut_probs.push_back(a_Parameters.MutateNeuronTimeConstantsProb);
 
-  // MUTATE_BIASES;
+  // MUTATION_BIASES;
   t_mut_probs.push_back(a_Parameters.MutateNeuronBiasesProb);
 
-  // MUTATE_NEURON_TRAITS;
+  // MUTATION_NEURON_TRAITS;
   t_mut_probs.push_back(a_Parameters.MutateNeuronTraitsProb);
 
-  // MUTATE_LINK_TRAITS;
+  // MUTATION_LINK_TRAITS;
   t_mut_probs.push_back(a_Parameters.MutateLinkTraitsProb);
 
-  // MUTATE_GENOME_TRAITS;
+  // MUTATION_GENOME_TRAITS;
   t_mut_probs.push_back(a_Parameters.MutateGenomeTraitsProb);
+  ASSERT(t_mut_probs.size() == NUM_MUTATION_TYPES);
 
   // Special consideration for phased searching - do not allow certain mutations
   // depending on the search mode also don't use additive mutations if we just
   // want to get rid of the clones
   if ((a_Pop.GetSearchMode() == SIMPLIFYING) || t_baby_is_clone) {
-    t_mut_probs[ADD_NODE] = 0; // add node
-    t_mut_probs[ADD_LINK] = 0; // add link
+    t_mut_probs[MUTATION_ADD_NEURON] = 0; // add node
+    t_mut_probs[MUTATION_ADD_LINK] = 0;   // add link
   }
   if ((a_Pop.GetSearchMode() == COMPLEXIFYING) || t_baby_is_clone) {
-    t_mut_probs[REMOVE_NODE] = 0; // rem node
-    t_mut_probs[REMOVE_LINK] = 0; // rem link
+    t_mut_probs[MUTATION_REMOVE_NEURON] = 0; // rem node
+    t_mut_probs[MUTATION_REMOVE_LINK] = 0;   // rem link
   }
 
   bool t_mutation_success = false;
@@ -829,25 +883,33 @@ void Species::MutateGenome(bool t_baby_is_clone, Population &a_Pop,
   // repeat until successful
   while (t_mutation_success == false) {
     int ChosenMutation = a_RNG.Roulette(t_mut_probs);
+    ASSERT((ChosenMutation >= 0) && (ChosenMutation < NUM_MUTATION_TYPES));
+    NEAT_STAT(StatsTimer t_timer(
+        a_Pop.AccessStats().m_MutationTimes[ChosenMutation]));
+
+    // candidates the mutation looked at, the one it took included
+    unsigned int t_candidates = 0;
 
     // Now mutate based on the choice
     switch (ChosenMutation) {
-    case ADD_NODE:
-      t_mutation_success = t_baby.Mutate_AddNeuron(
-          a_Pop.AccessInnovationDatabase(), a_Parameters, a_RNG);
+    case MUTATION_ADD_NEURON:
+      t_mutation_success =
+          t_baby.Mutate_AddNeuron(a_Pop.AccessInnovationDatabase(),
+                                  a_Parameters, a_RNG, &t_candidates);
       break;
 
-    case ADD_LINK:
-      t_mutation_success = t_baby.Mutate_AddLink(
-          a_Pop.AccessInnovationDatabase(), a_Parameters, a_RNG);
+    case MUTATION_ADD_LINK:
+      t_mutation_success =
+          t_baby.Mutate_AddLink(a_Pop.AccessInnovationDatabase(),
+                                a_Parameters, a_RNG, &t_candidates);
       break;
 
-    case REMOVE_NODE:
+    case MUTATION_REMOVE_NEURON:
       t_mutation_success = t_baby.Mutate_RemoveSimpleNeuron(
           a_Pop.AccessInnovationDatabase(), a_RNG);
       break;
 
-    case REMOVE_LINK: {
+    case MUTATION_REMOVE_LINK: {
       // Keep doing this mutation until it is sure that the baby will not
       // end up having dead ends or no links
       Genome t_saved_baby = t_baby;
@@ -863,6 +925,7 @@ void Species::MutateGenome(bool t_baby_is_clone, Population &a_Pop,
 
         t_saved_baby = t_baby;
         t_mutation_success = t_saved_baby.Mutate_RemoveLink(a_RNG);
+        t_candidates++;
 
         t_no_links = t_has_dead_ends = false;
 
@@ -876,43 +939,43 @@ void Species::MutateGenome(bool t_baby_is_clone, Population &a_Pop,
       t_baby = t_saved_baby;
     } break;
 
-    case CHANGE_ACTIVATION_FUNCTION:
+    case MUTATION_ACTIVATION_FUNCTION:
       t_mutation_success =
           t_baby.Mutate_NeuronActivation_Type(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_WEIGHTS:
+    case MUTATION_WEIGHTS:
       t_mutation_success = t_baby.Mutate_LinkWeights(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_ACTIVATION_A:
+    case MUTATION_ACTIVATION_A:
       t_mutation_success =
           t_baby.Mutate_NeuronActivations_A(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_ACTIVATION_B:
+    case MUTATION_ACTIVATION_B:
       t_mutation_success =
           t_baby.Mutate_NeuronActivations_B(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_TIMECONSTS:
+    case MUTATION_TIME_CONSTANTS:
       t_mutation_success =
           t_baby.Mutate_NeuronTimeConstants(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_BIASES:
+    case MUTATION_BIASES:
       t_mutation_success = t_baby.Mutate_NeuronBiases(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_NEURON_TRAITS:
+    case MUTATION_NEURON_TRAITS:
       t_mutation_success = t_baby.Mutate_NeuronTraits(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_LINK_TRAITS:
+    case MUTATION_LINK_TRAITS:
       t_mutation_success = t_baby.Mutate_LinkTraits(a_Parameters, a_RNG);
       break;
 
-    case MUTATE_GENOME_TRAITS:
+    case MUTATION_GENOME_TRAITS:
       t_mutation_success = t_baby.Mutate_GenomeTraits(a_Parameters, a_RNG);
       break;
 
@@ -920,6 +983,9 @@ void Species::MutateGenome(bool t_baby_is_clone, Population &a_Pop,
       t_mutation_success = false;
       break;
     }
+
+    NEAT_STAT(a_Pop.AccessStats().CountMutation(
+        ChosenMutation, t_mutation_success, t_candidates));
   }
 #endif
 }
@@ -40,6 +40,8 @@ namespace NEAT {
 
 // forward
 class Population;
+class CheckpointReader;
+class CheckpointWriter;
 
 //////////////////////////////////////////////
 // The Species class
@@ -97,6 +99,9 @@ public:
   // initializes a species with a leader genome and an ID number
   Species(const Genome &a_Seed, int a_id);
 
+  // loads a species and its members from a checkpoint
+  Species(CheckpointReader &a_Reader);
+
   // assignment operator
   Species &operator=(const Species &a_g);
 
@@ -196,6 +201,9 @@ public:
   Genome ReproduceOne(Population &a_Pop, Parameters &a_Parameters, RNG &a_RNG);
 
   void RemoveIndividual(unsigned int a_idx);
+
+  // Saves the species and its members to a checkpoint
+  void Save(CheckpointWriter &a_Writer) const;
 };
 
 } // namespace NEAT
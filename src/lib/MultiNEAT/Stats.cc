@@ -0,0 +1,177 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        Stats.cc
+// Description: Timers and counters of the phases of a generation.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Stats.hh>
+#include <atomic>
+#include <cstdint>
+
+namespace NEAT {
+
+const char *MUTATION_NAMES[NUM_MUTATION_TYPES] = {"add_neuron",
+                                                  "add_link",
+                                                  "remove_neuron",
+                                                  "remove_link",
+                                                  "activation_function",
+                                                  "weights",
+                                                  "activation_a",
+                                                  "activation_b",
+                                                  "time_constants",
+                                                  "biases",
+                                                  "neuron_traits",
+                                                  "link_traits",
+                                                  "genome_traits"};
+
+static std::atomic<uint64_t> g_phenotype_builds(0);
+static std::atomic<uint64_t> g_phenotype_nanoseconds(0);
+
+void CountPhenotypeBuild(double a_Seconds) {
+  g_phenotype_builds.fetch_add(1, std::memory_order_relaxed);
+  g_phenotype_nanoseconds.fetch_add(static_cast<uint64_t>(a_Seconds * 1e9),
+                                    std::memory_order_relaxed);
+}
+
+unsigned long long NumPhenotypeBuilds() {
+  return g_phenotype_builds.load(std::memory_order_relaxed);
+}
+
+double PhenotypeBuildTime() {
+  return g_phenotype_nanoseconds.load(std::memory_order_relaxed) * 1e-9;
+}
+
+void EpochStats::Clear() {
+  m_Generation = 0;
+  m_EpochTime = 0;
+  m_SortTime = 0;
+  m_UpdateSpeciesTime = 0;
+  m_AdjustFitnessTime = 0;
+  m_CountOffspringTime = 0;
+  m_ReproduceTime = 0;
+  m_SpeciateTime = 0;
+  m_SpeciesIDs.clear();
+  m_SpeciesReproduceTimes.clear();
+  for (unsigned int i = 0; i < NUM_MUTATION_TYPES; i++) {
+    m_MutationAttempts[i] = 0;
+    m_MutationSuccesses[i] = 0;
+    m_MutationRetries[i] = 0;
+    m_MutationTimes[i] = 0;
+  }
+  m_CloneChecks = 0;
+  m_CloneCheckTime = 0;
+  m_CloneRejections = 0;
+  m_ConstraintRejections = 0;
+  m_ConstraintTime = 0;
+  m_PhenotypeBuilds = 0;
+  m_PhenotypeBuildTime = 0;
+}
+
+void EpochStats::CountMutation(int a_Type, bool a_Success,
+                               unsigned int a_Candidates) {
+  if ((a_Type < 0) || (a_Type >= NUM_MUTATION_TYPES)) {
+    return;
+  }
+
+  m_MutationAttempts[a_Type]++;
+  if (a_Success) {
+    m_MutationSuccesses[a_Type]++;
+    if (a_Candidates > 0) {
+      a_Candidates--;
+    }
+  }
+  m_MutationRetries[a_Type] += a_Candidates;
+}
+
+// appends "a_Key":a_Value
+static void AppendField(std::string &a_Out, const char *a_Key,
+                        double a_Value) {
+  char t_buf[64];
+  snprintf(t_buf, sizeof(t_buf), "\"%s\":%.9g", a_Key, a_Value);
+  a_Out += t_buf;
+}
+
+static void AppendField(std::string &a_Out, const char *a_Key,
+                        unsigned long long a_Value) {
+  char t_buf[64];
+  snprintf(t_buf, sizeof(t_buf), "\"%s\":%llu", a_Key, a_Value);
+  a_Out += t_buf;
+}
+
+std::string EpochStats::ToJSON() const {
+  std::string t_out = "{";
+  AppendField(t_out, "generation",
+              static_cast<unsigned long long>(m_Generation));
+  t_out += ",\"time\":{";
+  AppendField(t_out, "epoch", m_EpochTime);
+  t_out += ',';
+  AppendField(t_out, "sort", m_SortTime);
+  t_out += ',';
+  AppendField(t_out, "update_species", m_UpdateSpeciesTime);
+  t_out += ',';
+  AppendField(t_out, "adjust_fitness", m_AdjustFitnessTime);
+  t_out += ',';
+  AppendField(t_out, "count_offspring", m_CountOffspringTime);
+  t_out += ',';
+  AppendField(t_out, "reproduce", m_ReproduceTime);
+  t_out += ',';
+  AppendField(t_out, "speciate", m_SpeciateTime);
+  t_out += ',';
+  AppendField(t_out, "clone_checks", m_CloneCheckTime);
+  t_out += ',';
+  AppendField(t_out, "constraints", m_ConstraintTime);
+  t_out += ',';
+  AppendField(t_out, "phenotype_builds", m_PhenotypeBuildTime);
+  t_out += "},\"species\":[";
+  for (unsigned int i = 0; i < m_SpeciesIDs.size(); i++) {
+    char t_buf[64];
+    snprintf(t_buf, sizeof(t_buf), "%s{\"id\":%d,\"reproduce\":%.9g}",
+             (i > 0) ? "," : "", m_SpeciesIDs[i], m_SpeciesReproduceTimes[i]);
+    t_out += t_buf;
+  }
+  t_out += "],\"mutations\":{";
+  for (unsigned int i = 0; i < NUM_MUTATION_TYPES; i++) {
+    char t_buf[192];
+    snprintf(t_buf, sizeof(t_buf),
+             "%s\"%s\":{\"attempts\":%llu,\"successes\":%llu,"
+             "\"retries\":%llu,\"time\":%.9g}",
+             (i > 0) ? "," : "", MUTATION_NAMES[i], m_MutationAttempts[i],
+             m_MutationSuccesses[i], m_MutationRetries[i], m_MutationTimes[i]);
+    t_out += t_buf;
+  }
+  t_out += "},";
+  AppendField(t_out, "clone_checks", m_CloneChecks);
+  t_out += ',';
+  AppendField(t_out, "clone_rejections", m_CloneRejections);
+  t_out += ',';
+  AppendField(t_out, "constraint_rejections", m_ConstraintRejections);
+  t_out += ',';
+  AppendField(t_out, "phenotype_builds", m_PhenotypeBuilds);
+  t_out += '}';
+  return t_out;
+}
+
+} // namespace NEAT
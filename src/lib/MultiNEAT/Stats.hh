@@ -0,0 +1,160 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        Stats.hh
+// Description: Timers and counters of the phases of a generation.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Define MULTINEAT_NO_STATS to compile the timing and counting out. The
+// statistics still exist, so code that reads them builds either way, but
+// stay zero.
+#ifdef MULTINEAT_NO_STATS
+#define NEAT_STAT(a_Statement)
+#else
+#define NEAT_STAT(a_Statement) a_Statement
+#endif
+
+namespace NEAT {
+
+// The mutations Species::MutateGenome() chooses from
+enum MutationType {
+  MUTATION_ADD_NEURON = 0,
+  MUTATION_ADD_LINK,
+  MUTATION_REMOVE_NEURON,
+  MUTATION_REMOVE_LINK,
+  MUTATION_ACTIVATION_FUNCTION,
+  MUTATION_WEIGHTS,
+  MUTATION_ACTIVATION_A,
+  MUTATION_ACTIVATION_B,
+  MUTATION_TIME_CONSTANTS,
+  MUTATION_BIASES,
+  MUTATION_NEURON_TRAITS,
+  MUTATION_LINK_TRAITS,
+  MUTATION_GENOME_TRAITS,
+  NUM_MUTATION_TYPES
+};
+
+// Names of the mutation types, as used in the JSON of EpochStats
+extern const char *MUTATION_NAMES[NUM_MUTATION_TYPES];
+
+// Seconds since some fixed point in time
+inline double StatsClock() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Adds the time from its construction to its destruction to a total, in
+// seconds
+class StatsTimer {
+  double &m_total;
+  std::chrono::steady_clock::time_point m_start;
+
+public:
+  explicit StatsTimer(double &a_Total)
+      : m_total(a_Total), m_start(std::chrono::steady_clock::now()) {}
+  ~StatsTimer() {
+    m_total += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - m_start)
+                   .count();
+  }
+};
+
+// Counts phenotypes built anywhere in the process, Population::Epoch() takes
+// the difference. Every Genome build counts once, refreshes, single precision
+// and (ES-)HyperNEAT builds included. A cached phenotype counts when it is
+// built, not when it is looked up.
+void CountPhenotypeBuild(double a_Seconds);
+unsigned long long NumPhenotypeBuilds();
+double PhenotypeBuildTime();
+
+// What one Population::Epoch() did and how long it took. Times are in
+// seconds. Mutations made by Population::Tick() count toward the next
+// Epoch().
+class EpochStats {
+public:
+  // the generation the epoch started from
+  unsigned int m_Generation;
+
+  double m_EpochTime;
+  double m_SortTime;
+  double m_UpdateSpeciesTime;
+  double m_AdjustFitnessTime;
+  double m_CountOffspringTime;
+  // all species, including the speciation of their offspring
+  double m_ReproduceTime;
+  // placing offspring into species
+  double m_SpeciateTime;
+
+  // the time each species took to reproduce, in the order they did
+  std::vector<int> m_SpeciesIDs;
+  std::vector<double> m_SpeciesReproduceTimes;
+
+  // Mutations by MutationType. Species::MutateGenome() chooses again until
+  // one succeeds, so attempts minus successes is the number of times it had
+  // to. Retries are the candidates a mutation looked at and turned down
+  // before it succeeded or gave up: links for adding a neuron, pairs of
+  // neurons for adding a link, links whose removal left the genome broken.
+  unsigned long long m_MutationAttempts[NUM_MUTATION_TYPES];
+  unsigned long long m_MutationSuccesses[NUM_MUTATION_TYPES];
+  unsigned long long m_MutationRetries[NUM_MUTATION_TYPES];
+  double m_MutationTimes[NUM_MUTATION_TYPES];
+
+  // compatibility distances computed to keep clones out of the offspring
+  unsigned long long m_CloneChecks;
+  double m_CloneCheckTime;
+
+  // offspring made again because they were clones, or because they failed
+  // the constraints
+  unsigned long long m_CloneRejections;
+  unsigned long long m_ConstraintRejections;
+  double m_ConstraintTime;
+
+  // phenotypes built since the epoch before
+  unsigned long long m_PhenotypeBuilds;
+  double m_PhenotypeBuildTime;
+
+  EpochStats() { Clear(); }
+  void Clear();
+
+  // Counts an attempt at a mutation of type a_Type that looked at
+  // a_Candidates candidates, the one it took included
+  void CountMutation(int a_Type, bool a_Success, unsigned int a_Candidates);
+
+  // One line of JSON, without the line break
+  std::string ToJSON() const;
+};
+
+} // namespace NEAT
+
+#endif
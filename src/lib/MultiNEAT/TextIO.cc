@@ -0,0 +1,572 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        TextIO.cc
+// Description: Implementation of the text reader and writer.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/TextIO.hh>
+#include <charconv>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <stdexcept>
+
+namespace NEAT {
+
+// the characters isspace() accepts in the C locale
+static inline bool IsSpace(char a_C) {
+  return (a_C == ' ') || ((a_C >= '\t') && (a_C <= '\r'));
+}
+
+// the types of TraitType by which(), named like TraitParameters::type
+static const char *TRAIT_TYPE_NAMES[] = {"int", "float", "string", "intset",
+                                         "floatset"};
+static const int NUM_TRAIT_TYPES = 5;
+
+static int HexDigit(char a_C) {
+  if ((a_C >= '0') && (a_C <= '9')) {
+    return a_C - '0';
+  }
+  if ((a_C >= 'A') && (a_C <= 'F')) {
+    return a_C - 'A' + 10;
+  }
+  if ((a_C >= 'a') && (a_C <= 'f')) {
+    return a_C - 'a' + 10;
+  }
+  return -1;
+}
+
+////////////////////////////
+// Reader
+////////////////////////////
+
+TextReader::TextReader()
+    : m_data(NULL), m_pos(NULL), m_end(NULL), m_stream(NULL), m_start(0) {}
+
+TextReader::TextReader(std::istream &a_Stream) : TextReader() {
+  std::streampos t_start = a_Stream.tellg();
+  if (t_start != std::streampos(-1)) {
+    a_Stream.seekg(0, std::ios::end);
+    std::streamoff t_size = a_Stream.tellg() - t_start;
+    a_Stream.seekg(t_start);
+    if (t_size > 0) {
+      m_buffer.resize(t_size);
+      a_Stream.read(&m_buffer[0], t_size);
+      m_buffer.resize(a_Stream.gcount());
+    }
+    m_stream = &a_Stream;
+    m_start = t_start;
+  } else {
+    // not seekable, all of it is used up
+    m_buffer.assign(std::istreambuf_iterator<char>(a_Stream),
+                    std::istreambuf_iterator<char>());
+  }
+  Open(m_buffer.data(), m_buffer.size());
+}
+
+TextReader::~TextReader() {
+  if (m_stream) {
+    m_stream->clear();
+    m_stream->seekg(m_start + (m_pos - m_data));
+  }
+}
+
+bool TextReader::Open(const char *a_FileName) {
+  FILE *t_file = fopen(a_FileName, "rb");
+  if (!t_file) {
+    return false;
+  }
+
+  std::string t_buffer;
+  char t_chunk[1 << 16];
+  size_t t_read;
+  while ((t_read = fread(t_chunk, 1, sizeof(t_chunk), t_file)) > 0) {
+    t_buffer.append(t_chunk, t_read);
+  }
+  bool t_ok = !ferror(t_file);
+  fclose(t_file);
+  if (!t_ok) {
+    return false;
+  }
+
+  m_buffer.swap(t_buffer);
+  m_stream = NULL;
+  Open(m_buffer.data(), m_buffer.size());
+  return true;
+}
+
+void TextReader::Open(const char *a_Data, size_t a_Size) {
+  m_data = m_pos = a_Data;
+  m_end = a_Data + a_Size;
+}
+
+std::string_view TextReader::Next() {
+  while ((m_pos < m_end) && IsSpace(*m_pos)) {
+    m_pos++;
+  }
+  const char *t_start = m_pos;
+  while ((m_pos < m_end) && !IsSpace(*m_pos)) {
+    m_pos++;
+  }
+  return std::string_view(t_start, m_pos - t_start);
+}
+
+bool TextReader::SkipPast(std::string_view a_Token) {
+  std::string_view t_token;
+  do {
+    t_token = Next();
+    if (t_token.empty()) {
+      return false;
+    }
+  } while (t_token != a_Token);
+  return true;
+}
+
+bool TextReader::GetBool() {
+  std::string_view t_token = Next();
+  return (t_token == "true") || (t_token == "1") || (t_token == "1.0");
+}
+
+std::string TextReader::GetString() {
+  std::string_view t_token = Next();
+  std::string t_str;
+  if (t_token == "%") {
+    return t_str;
+  }
+
+  t_str.reserve(t_token.size());
+  for (size_t i = 0; i < t_token.size(); i++) {
+    int t_hi, t_lo;
+    if ((t_token[i] == '%') && (i + 2 < t_token.size()) &&
+        ((t_hi = HexDigit(t_token[i + 1])) >= 0) &&
+        ((t_lo = HexDigit(t_token[i + 2])) >= 0)) {
+      t_str += static_cast<char>((t_hi << 4) | t_lo);
+      i += 2;
+    } else {
+      t_str += t_token[i];
+    }
+  }
+  return t_str;
+}
+
+TraitType TextReader::GetTrait() {
+  std::string_view t_type = Next();
+  for (int i = 0; i < NUM_TRAIT_TYPES; i++) {
+    if (t_type == TRAIT_TYPE_NAMES[i]) {
+      return GetTraitValue(i);
+    }
+  }
+  throw std::runtime_error("Unknown trait type in file");
+}
+
+TraitType TextReader::GetTraitValue(int a_Type) {
+  TraitType t_value;
+  switch (a_Type) {
+  case 0: {
+    int t_v;
+    Get(t_v);
+    t_value = t_v;
+    break;
+  }
+  case 1: {
+    double t_v;
+    Get(t_v);
+    t_value = t_v;
+    break;
+  }
+  case 2:
+    t_value = GetString();
+    break;
+  case 3: {
+    intsetelement t_e;
+    Get(t_e.value);
+    t_value = t_e;
+    break;
+  }
+  case 4: {
+    floatsetelement t_e;
+    Get(t_e.value);
+    t_value = t_e;
+    break;
+  }
+  default:
+    throw std::runtime_error("Unknown trait type in file");
+  }
+  return t_value;
+}
+
+void TextReader::GetTraits(std::map<std::string, Trait> &a_Traits,
+                           const TraitSchema &a_Schema) {
+  a_Traits.clear();
+  unsigned int t_count;
+  Get(t_count);
+  for (unsigned int i = 0; i < t_count; i++) {
+    unsigned int t_kind;
+    Get(t_kind);
+    if (t_kind >= a_Schema.size()) {
+      throw std::runtime_error("Unknown kind of trait in file");
+    }
+    Trait &t_tr = a_Traits[a_Schema.entries[t_kind].name];
+    a_Schema.Apply(t_kind, t_tr);
+    t_tr.value = GetTraitValue(a_Schema.entries[t_kind].type);
+  }
+}
+
+void TextReader::GetTraitKind(TraitSchema &a_Schema) {
+  TraitSchema::Entry t_e;
+  t_e.name = GetString();
+  std::string_view t_type = Next();
+  t_e.type = -1;
+  for (int i = 0; i < NUM_TRAIT_TYPES; i++) {
+    if (t_type == TRAIT_TYPE_NAMES[i]) {
+      t_e.type = i;
+    }
+  }
+  if (t_e.type < 0) {
+    throw std::runtime_error("Unknown trait type in file");
+  }
+  t_e.dep_key = GetString();
+  unsigned int t_deps;
+  Get(t_deps);
+  for (unsigned int i = 0; i < t_deps; i++) {
+    t_e.dep_values.push_back(GetTrait());
+  }
+  a_Schema.entries.push_back(t_e);
+}
+
+void TextReader::GetTraitParameters(TraitParameters &a_Params) {
+  a_Params.type = GetString();
+  Get(a_Params.m_ImportanceCoeff);
+  Get(a_Params.m_MutationProb);
+
+  // the details are written for the type of values they describe
+  std::string_view t_details = Next();
+  unsigned int t_size;
+  if (t_details == "int") {
+    IntTraitParameters t_d;
+    Get(t_d.min);
+    Get(t_d.max);
+    Get(t_d.mut_power);
+    Get(t_d.mut_replace_prob);
+    a_Params.m_Details = t_d;
+  } else if (t_details == "float") {
+    FloatTraitParameters t_d;
+    Get(t_d.min);
+    Get(t_d.max);
+    Get(t_d.mut_power);
+    Get(t_d.mut_replace_prob);
+    a_Params.m_Details = t_d;
+  } else if (t_details == "string") {
+    StringTraitParameters t_d;
+    Get(t_size);
+    for (unsigned int i = 0; i < t_size; i++) {
+      t_d.set.push_back(GetString());
+    }
+    Get(t_size);
+    t_d.probs.resize(t_size);
+    for (unsigned int i = 0; i < t_size; i++) {
+      Get(t_d.probs[i]);
+    }
+    a_Params.m_Details = t_d;
+  } else if (t_details == "intset") {
+    IntSetTraitParameters t_d;
+    Get(t_size);
+    t_d.set.resize(t_size);
+    for (unsigned int i = 0; i < t_size; i++) {
+      Get(t_d.set[i].value);
+    }
+    Get(t_size);
+    t_d.probs.resize(t_size);
+    for (unsigned int i = 0; i < t_size; i++) {
+      Get(t_d.probs[i]);
+    }
+    a_Params.m_Details = t_d;
+  } else if (t_details == "floatset") {
+    FloatSetTraitParameters t_d;
+    Get(t_size);
+    t_d.set.resize(t_size);
+    for (unsigned int i = 0; i < t_size; i++) {
+      Get(t_d.set[i].value);
+    }
+    Get(t_size);
+    t_d.probs.resize(t_size);
+    for (unsigned int i = 0; i < t_size; i++) {
+      Get(t_d.probs[i]);
+    }
+    a_Params.m_Details = t_d;
+  } else {
+    throw std::runtime_error("Unknown trait parameters in file");
+  }
+
+  a_Params.dep_key = GetString();
+  a_Params.dep_values.clear();
+  Get(t_size);
+  for (unsigned int i = 0; i < t_size; i++) {
+    a_Params.dep_values.push_back(GetTrait());
+  }
+}
+
+long long TextReader::ParseInt(std::string_view a_Token) {
+  // from_chars does not take the plus sign streams allow
+  if (!a_Token.empty() && (a_Token[0] == '+')) {
+    a_Token.remove_prefix(1);
+  }
+  long long t_value = 0;
+  if (std::from_chars(a_Token.data(), a_Token.data() + a_Token.size(),
+                      t_value)
+          .ec != std::errc()) {
+    return 0;
+  }
+  return t_value;
+}
+
+double TextReader::ParseDouble(std::string_view a_Token) {
+  if (!a_Token.empty() && (a_Token[0] == '+')) {
+    a_Token.remove_prefix(1);
+  }
+  double t_value = 0;
+  if (std::from_chars(a_Token.data(), a_Token.data() + a_Token.size(),
+                      t_value)
+          .ec != std::errc()) {
+    return 0;
+  }
+  return t_value;
+}
+
+////////////////////////////
+// Writer
+////////////////////////////
+
+TextWriter::TextWriter(FILE *a_File)
+    : m_file(a_File), m_size(0), m_line_start(true) {}
+
+TextWriter::~TextWriter() { Flush(); }
+
+void TextWriter::Separate() {
+  if (!m_line_start) {
+    m_buffer[m_size++] = ' ';
+  }
+  m_line_start = false;
+}
+
+void TextWriter::Put(const char *a_Word) {
+  size_t t_length = strlen(a_Word);
+  Reserve(t_length + 1);
+  Separate();
+  if (t_length > sizeof(m_buffer) - m_size) {
+    Flush();
+    fwrite(a_Word, 1, t_length, m_file);
+    return;
+  }
+  std::memcpy(m_buffer + m_size, a_Word, t_length);
+  m_size += t_length;
+}
+
+void TextWriter::Put(long long a_Value) {
+  Reserve(32);
+  Separate();
+  m_size = std::to_chars(m_buffer + m_size, m_buffer + sizeof(m_buffer),
+                         a_Value)
+               .ptr -
+           m_buffer;
+}
+
+void TextWriter::Put(double a_Value, int a_Precision) {
+  // the integer part of a double has up to 309 digits
+  Reserve(a_Precision + 330);
+  Separate();
+  m_size = std::to_chars(m_buffer + m_size, m_buffer + sizeof(m_buffer),
+                         a_Value, std::chars_format::fixed, a_Precision)
+               .ptr -
+           m_buffer;
+}
+
+void TextWriter::PutExact(double a_Value) {
+  Reserve(32);
+  Separate();
+  m_size = std::to_chars(m_buffer + m_size, m_buffer + sizeof(m_buffer),
+                         a_Value)
+               .ptr -
+           m_buffer;
+}
+
+void TextWriter::PutBool(bool a_Value) { Put(a_Value ? "true" : "false"); }
+
+void TextWriter::PutString(const std::string &a_Str) {
+  if (a_Str.empty()) {
+    Put("%");
+    return;
+  }
+
+  static const char t_hex[] = "0123456789ABCDEF";
+  std::string t_token;
+  t_token.reserve(a_Str.size());
+  for (size_t i = 0; i < a_Str.size(); i++) {
+    unsigned char t_c = a_Str[i];
+    if ((t_c <= ' ') || (t_c == 0x7f) || (t_c == '%')) {
+      t_token += '%';
+      t_token += t_hex[t_c >> 4];
+      t_token += t_hex[t_c & 15];
+    } else {
+      t_token += a_Str[i];
+    }
+  }
+  Put(t_token.c_str());
+}
+
+void TextWriter::PutTrait(const TraitType &a_Value) {
+  Put(TRAIT_TYPE_NAMES[a_Value.which()]);
+  PutTraitValue(a_Value);
+}
+
+void TextWriter::PutTraitValue(const TraitType &a_Value) {
+  switch (a_Value.which()) {
+  case 0:
+    Put(bs::get<int>(a_Value));
+    break;
+  case 1:
+    PutExact(bs::get<double>(a_Value));
+    break;
+  case 2:
+    PutString(bs::get<std::string>(a_Value));
+    break;
+  case 3:
+    Put(bs::get<intsetelement>(a_Value).value);
+    break;
+  case 4:
+    PutExact(bs::get<floatsetelement>(a_Value).value);
+    break;
+  }
+}
+
+void TextWriter::PutTraits(const std::map<std::string, Trait> &a_Traits,
+                           const TraitSchema &a_Schema) {
+  Put(static_cast<long long>(a_Traits.size()));
+  for (auto t_it = a_Traits.begin(); t_it != a_Traits.end(); t_it++) {
+    Put(a_Schema.Find(t_it->first, t_it->second));
+    PutTraitValue(t_it->second.value);
+  }
+}
+
+void TextWriter::PutTraitKind(const TraitSchema &a_Schema,
+                              unsigned int a_Index) {
+  const TraitSchema::Entry &t_e = a_Schema.entries[a_Index];
+  PutString(t_e.name);
+  Put(TRAIT_TYPE_NAMES[t_e.type]);
+  PutString(t_e.dep_key);
+  Put(static_cast<long long>(t_e.dep_values.size()));
+  for (unsigned int i = 0; i < t_e.dep_values.size(); i++) {
+    PutTrait(t_e.dep_values[i]);
+  }
+}
+
+void TextWriter::PutTraitParameters(const TraitParameters &a_Params) {
+  PutString(a_Params.type);
+  PutExact(a_Params.m_ImportanceCoeff);
+  PutExact(a_Params.m_MutationProb);
+
+  // the details are written for the type of values they describe
+  Put(TRAIT_TYPE_NAMES[a_Params.m_Details.which()]);
+  switch (a_Params.m_Details.which()) {
+  case 0: {
+    const IntTraitParameters &t_d =
+        bs::get<IntTraitParameters>(a_Params.m_Details);
+    Put(t_d.min);
+    Put(t_d.max);
+    Put(t_d.mut_power);
+    PutExact(t_d.mut_replace_prob);
+    break;
+  }
+  case 1: {
+    const FloatTraitParameters &t_d =
+        bs::get<FloatTraitParameters>(a_Params.m_Details);
+    PutExact(t_d.min);
+    PutExact(t_d.max);
+    PutExact(t_d.mut_power);
+    PutExact(t_d.mut_replace_prob);
+    break;
+  }
+  case 2: {
+    const StringTraitParameters &t_d =
+        bs::get<StringTraitParameters>(a_Params.m_Details);
+    Put(static_cast<long long>(t_d.set.size()));
+    for (unsigned int i = 0; i < t_d.set.size(); i++) {
+      PutString(t_d.set[i]);
+    }
+    Put(static_cast<long long>(t_d.probs.size()));
+    for (unsigned int i = 0; i < t_d.probs.size(); i++) {
+      PutExact(t_d.probs[i]);
+    }
+    break;
+  }
+  case 3: {
+    const IntSetTraitParameters &t_d =
+        bs::get<IntSetTraitParameters>(a_Params.m_Details);
+    Put(static_cast<long long>(t_d.set.size()));
+    for (unsigned int i = 0; i < t_d.set.size(); i++) {
+      Put(t_d.set[i].value);
+    }
+    Put(static_cast<long long>(t_d.probs.size()));
+    for (unsigned int i = 0; i < t_d.probs.size(); i++) {
+      PutExact(t_d.probs[i]);
+    }
+    break;
+  }
+  case 4: {
+    const FloatSetTraitParameters &t_d =
+        bs::get<FloatSetTraitParameters>(a_Params.m_Details);
+    Put(static_cast<long long>(t_d.set.size()));
+    for (unsigned int i = 0; i < t_d.set.size(); i++) {
+      PutExact(t_d.set[i].value);
+    }
+    Put(static_cast<long long>(t_d.probs.size()));
+    for (unsigned int i = 0; i < t_d.probs.size(); i++) {
+      PutExact(t_d.probs[i]);
+    }
+    break;
+  }
+  }
+
+  PutString(a_Params.dep_key);
+  Put(static_cast<long long>(a_Params.dep_values.size()));
+  for (unsigned int i = 0; i < a_Params.dep_values.size(); i++) {
+    PutTrait(a_Params.dep_values[i]);
+  }
+}
+
+void TextWriter::EndLine() {
+  Reserve(1);
+  m_buffer[m_size++] = '\n';
+  m_line_start = true;
+}
+
+bool TextWriter::Flush() {
+  bool t_ok = fwrite(m_buffer, 1, m_size, m_file) == m_size;
+  m_size = 0;
+  return t_ok;
+}
+
+} // namespace NEAT
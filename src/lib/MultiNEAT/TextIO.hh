@@ -0,0 +1,159 @@
+#ifndef _TEXTIO_H
+#define _TEXTIO_H
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//    MultiNEAT - Python/C++ NeuroEvolution of Augmenting Topologies Library
+//
+//    Copyright (C) 2012 Peter Chervenski
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published
+//    by the Free Software Foundation, either version 3 of the License, or (at
+//    your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with this program.  If not, see < http://www.gnu.org/licenses/ >.
+//
+//    Contact info:
+//
+//    Peter Chervenski < spookey@abv.bg >
+//    Shane Ryan < shane.mcdonald.ryan@gmail.com >
+///////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// File:        TextIO.hh
+// Description: Buffered reading and writing of the text file formats.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <MultiNEAT/Traits.hh>
+#include <cstdio>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace NEAT {
+
+// Splits text into whitespace-separated tokens, like operator>> of a stream
+// does, and parses numbers with std::from_chars. A token that is not a
+// number reads as 0.
+class TextReader {
+  std::string m_buffer;
+  const char *m_data;
+  const char *m_pos;
+  const char *m_end;
+
+  // set when reading from a stream, which is moved past the tokens read once
+  // the reader is destroyed
+  std::istream *m_stream;
+  long long m_start;
+
+  static long long ParseInt(std::string_view a_Token);
+  static double ParseDouble(std::string_view a_Token);
+
+public:
+  TextReader();
+  // Reads the rest of a_Stream
+  explicit TextReader(std::istream &a_Stream);
+  ~TextReader();
+
+  TextReader(const TextReader &) = delete;
+  TextReader &operator=(const TextReader &) = delete;
+
+  // Reads a whole file. Returns false if it cannot be read.
+  bool Open(const char *a_FileName);
+  // Reads a_Size bytes at a_Data in place. They must outlive the reader.
+  void Open(const char *a_Data, size_t a_Size);
+
+  // The next token, empty at the end of the text
+  std::string_view Next();
+
+  // Skips tokens up to and including a_Token. Returns false if the text ends
+  // before it.
+  bool SkipPast(std::string_view a_Token);
+
+  template <typename T> void Get(T &a_Value) {
+    if constexpr (std::is_floating_point<T>::value) {
+      a_Value = static_cast<T>(ParseDouble(Next()));
+    } else {
+      a_Value = static_cast<T>(ParseInt(Next()));
+    }
+  }
+
+  // "true", "1" and "1.0" are true, anything else false
+  bool GetBool();
+
+  // A string written with TextWriter::PutString()
+  std::string GetString();
+
+  // The counterparts of the TextWriter methods. An unknown trait type throws
+  // std::runtime_error.
+  TraitType GetTrait();
+  TraitType GetTraitValue(int a_Type);
+  void GetTraits(std::map<std::string, Trait> &a_Traits,
+                 const TraitSchema &a_Schema);
+  void GetTraitKind(TraitSchema &a_Schema);
+  void GetTraitParameters(TraitParameters &a_Params);
+};
+
+// Formats text into a buffer that goes to a file in large writes. Values on
+// a line are separated by single spaces.
+class TextWriter {
+  FILE *m_file;
+  char m_buffer[1 << 16];
+  size_t m_size;
+  bool m_line_start;
+
+  // makes room for a_Bytes more, a_Bytes must be small
+  void Reserve(size_t a_Bytes) {
+    if (m_size + a_Bytes > sizeof(m_buffer)) {
+      Flush();
+    }
+  }
+  void Separate();
+
+public:
+  explicit TextWriter(FILE *a_File);
+  ~TextWriter();
+
+  TextWriter(const TextWriter &) = delete;
+  TextWriter &operator=(const TextWriter &) = delete;
+
+  void Put(const char *a_Word);
+  void Put(long long a_Value);
+  // Fixed notation with a_Precision digits, like printf("%.*f")
+  void Put(double a_Value, int a_Precision);
+  // The shortest text that reads back as exactly a_Value
+  void PutExact(double a_Value);
+  // "true" or "false"
+  void PutBool(bool a_Value);
+  // As a single token. Whitespace and '%' are written as %XX, the empty
+  // string as a lone '%'.
+  void PutString(const std::string &a_Str);
+  void EndLine();
+
+  // The type and the value
+  void PutTrait(const TraitType &a_Value);
+  // Only the value, the type is known to the reader
+  void PutTraitValue(const TraitType &a_Value);
+  // The number of traits, then the kind in a_Schema and the value of each.
+  // The kinds must have been interned before.
+  void PutTraits(const std::map<std::string, Trait> &a_Traits,
+                 const TraitSchema &a_Schema);
+  // Name, type and dependency of kind a_Index of a_Schema
+  void PutTraitKind(const TraitSchema &a_Schema, unsigned int a_Index);
+  void PutTraitParameters(const TraitParameters &a_Params);
+
+  // Writes out the buffer. Returns false if the file could not be written.
+  bool Flush();
+};
+
+} // namespace NEAT
+
+#endif
@@ -3,3 +3,47 @@
 //
 
 #include <MultiNEAT/Traits.hh>
+
+namespace NEAT {
+
+int TraitSchema::Find(const std::string &a_Name, const Trait &a_Trait) const {
+  // there are only a few kinds, a linear search is the fastest
+  for (unsigned int i = 0; i < entries.size(); i++) {
+    const Entry &t_e = entries[i];
+    if ((t_e.type == a_Trait.value.which()) && (t_e.name == a_Name) &&
+        (t_e.dep_key == a_Trait.dep_key) &&
+        (t_e.dep_values == a_Trait.dep_values)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+unsigned int TraitSchema::Intern(const std::string &a_Name,
+                                 const Trait &a_Trait) {
+  int t_idx = Find(a_Name, a_Trait);
+  if (t_idx >= 0) {
+    return t_idx;
+  }
+
+  Entry t_e;
+  t_e.name = a_Name;
+  t_e.type = a_Trait.value.which();
+  t_e.dep_key = a_Trait.dep_key;
+  t_e.dep_values = a_Trait.dep_values;
+  entries.push_back(t_e);
+  return entries.size() - 1;
+}
+
+void TraitSchema::Intern(const std::map<std::string, Trait> &a_Traits) {
+  for (auto t_it = a_Traits.begin(); t_it != a_Traits.end(); t_it++) {
+    Intern(t_it->first, t_it->second);
+  }
+}
+
+void TraitSchema::Apply(unsigned int a_Index, Trait &a_Trait) const {
+  a_Trait.dep_key = entries[a_Index].dep_key;
+  a_Trait.dep_values = entries[a_Index].dep_values;
+}
+
+} // namespace NEAT
@@ -8,6 +8,7 @@
 #include <boost/any.hpp>
 #include <boost/variant.hpp>
 #include <cmath>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -121,5 +122,37 @@ public:
   std::vector<TraitType> dep_values; // and has this value
 };
 
+// The kinds of traits found in a set of genes. A kind is a trait name
+// together with the type of its values and its dependency. These are the
+// same in every gene that carries the trait, so files write each kind once
+// and genes refer to it by index.
+class TraitSchema {
+public:
+  class Entry {
+  public:
+    std::string name;
+    int type; // which() of the values
+    std::string dep_key;
+    std::vector<TraitType> dep_values;
+  };
+
+  std::vector<Entry> entries;
+
+  // Returns the index of the kind a_Trait named a_Name is of, -1 if there
+  // is no such kind
+  int Find(const std::string &a_Name, const Trait &a_Trait) const;
+  // Same, but adds the kind if it is new
+  unsigned int Intern(const std::string &a_Name, const Trait &a_Trait);
+  // Adds the kinds of all of a_Traits
+  void Intern(const std::map<std::string, Trait> &a_Traits);
+
+  // Sets a_Trait to a trait of kind a_Index, keeping its value
+  void Apply(unsigned int a_Index, Trait &a_Trait) const;
+
+  unsigned int size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+  void clear() { entries.clear(); }
+};
+
 } // namespace NEAT
 #endif // MULTINEAT_TRAITS_H
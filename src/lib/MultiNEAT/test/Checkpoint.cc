@@ -0,0 +1,164 @@
+/*
+ * Checkpoint.cc
+ *
+ * Checks that a population loaded from a checkpoint evolves exactly like
+ * the population it was saved from, random generator included, and that
+ * files are only replaced by complete ones. Returns non-zero if any check
+ * fails.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/Checkpoint.hh>
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Population.hh>
+#include <MultiNEAT/Random.hh>
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace NEAT;
+
+static const char *g_file = "Checkpoint.test.ckpt";
+
+static void Evolve(Population &a_Pop, unsigned int a_Generations) {
+  for (unsigned int g = 0; g < a_Generations; g++) {
+    EvaluateXor(a_Pop);
+    a_Pop.Epoch();
+  }
+}
+
+static void CheckRNG() {
+  RNG t_rng;
+  t_rng.Seed(11);
+  t_rng.RandFloat();
+  std::string t_state = t_rng.GetState();
+  Check(!t_state.empty(), "the generator has a state");
+
+  std::vector<double> t_expected;
+  for (unsigned int i = 0; i < 10; i++) {
+    t_expected.push_back(t_rng.RandGaussSigned());
+  }
+
+  RNG t_restored;
+  t_restored.SetState(t_state);
+  std::vector<double> t_actual;
+  for (unsigned int i = 0; i < 10; i++) {
+    t_actual.push_back(t_restored.RandGaussSigned());
+  }
+  Check(t_actual == t_expected, "a restored generator continues the same");
+
+  // one generator does not disturb another
+  RNG t_other;
+  t_other.Seed(11);
+  t_other.RandFloat();
+  t_rng.Seed(99);
+  Check(t_other.GetState() == t_state, "generators are independent");
+
+  // malformed states are rejected and leave the generator as it was
+  bool t_threw = false;
+  try {
+    t_other.SetState("12 34 not a state");
+  } catch (std::runtime_error &) {
+    t_threw = true;
+  }
+  Check(t_threw, "a malformed state throws");
+  Check(t_other.GetState() == t_state, "a malformed state changes nothing");
+  t_other.SetState("");
+  Check(t_other.GetState() == t_state, "an empty state changes nothing");
+}
+
+static void CheckContinue() {
+  Parameters t_params;
+  t_params.PopulationSize = 60;
+  t_params.RecurrentProb = 0;
+  t_params.MutateAddNeuronProb = 0.1;
+  t_params.MutateAddLinkProb = 0.2;
+
+  Genome t_seed(0, 3, 0, 1, false, UNSIGNED_SIGMOID, UNSIGNED_SIGMOID, 0,
+                t_params, 0);
+  Population t_pop(t_seed, t_params, true, 1.0, 7);
+  Evolve(t_pop, 4);
+
+  std::string t_saved = Checkpoint(t_pop, g_file);
+  Population t_loaded(g_file);
+  Check(Checkpoint(t_loaded, g_file) == t_saved,
+        "a loaded checkpoint saves the same");
+
+  // a copy with a reseeded generator shows that the state matters
+  Population t_reseeded(g_file);
+  t_reseeded.m_RNG.Seed(8);
+
+  Evolve(t_pop, 5);
+  Evolve(t_loaded, 5);
+  Evolve(t_reseeded, 5);
+  std::string t_expected = Checkpoint(t_pop, g_file);
+  Check(Checkpoint(t_loaded, g_file) == t_expected,
+        "a loaded population evolves like the one it was saved from");
+  Check(Checkpoint(t_reseeded, g_file) != t_expected,
+        "a reseeded population evolves differently");
+  Check(t_loaded.GetGeneration() == t_pop.GetGeneration(),
+        "the generations match");
+}
+
+// The number of files next to g_file whose names start with it
+static unsigned int NumFilesLike() {
+  unsigned int t_count = 0;
+  for (auto &t_entry : std::filesystem::directory_iterator(".")) {
+    if (t_entry.path().filename().string().rfind(g_file, 0) == 0) {
+      t_count++;
+    }
+  }
+  return t_count;
+}
+
+static void CheckReplacement() {
+  std::remove(g_file);
+
+  // two writers of one file do not share the temporary one
+  {
+    ReplacementFile t_first(g_file), t_second(g_file);
+    Check(t_first.Get() && t_second.Get(), "both writers open");
+    fputs("first", t_first.Get());
+    fputs("second", t_second.Get());
+    Check(t_second.Commit() && t_first.Commit(), "both writers commit");
+  }
+  Check(ReadFile(g_file) == "first", "the last commit wins");
+  Check(NumFilesLike() == 1, "no temporary files are left");
+
+  // a failed write is caught by Commit(), reading a stream open for
+  // writing sets its error flag
+  {
+    ReplacementFile t_failed(g_file);
+    fputs("partial", t_failed.Get());
+    fgetc(t_failed.Get());
+    Check(!t_failed.Commit(), "a failed write is reported");
+  }
+  Check(ReadFile(g_file) == "first", "a failed write leaves the target");
+  Check(NumFilesLike() == 1, "a failed write leaves no temporary file");
+
+  // a writer that never commits leaves the target
+  { ReplacementFile t_dropped(g_file); }
+  Check(NumFilesLike() == 1, "a dropped writer leaves no temporary file");
+
+  Parameters t_params;
+  Genome t_seed(0, 3, 0, 1, false, UNSIGNED_SIGMOID, UNSIGNED_SIGMOID, 0,
+                t_params, 0);
+  Population t_pop(t_seed, t_params, true, 1.0, 7);
+  Check(t_pop.Save(g_file), "a population saves");
+  Check(!t_pop.Save("no/such/directory/population.txt"),
+        "an unwritable population file is reported");
+}
+
+int main() {
+  CheckRNG();
+  CheckContinue();
+  CheckReplacement();
+
+  std::remove(g_file);
+  return Failures();
+}
@@ -0,0 +1,121 @@
+/*
+ * FloatNetwork.cc
+ *
+ * Checks that the single precision phenotype follows the double precision
+ * one on randomized genomes. Returns non-zero if any output is off by more
+ * than the tolerance.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/CompactNetwork.hh>
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Random.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace NEAT;
+
+// Step functions are left out, a rounding difference right at the threshold
+// flips them.
+static const ActivationFunction g_functions[] = {
+    SIGNED_SIGMOID, UNSIGNED_SIGMOID, TANH,   TANH_CUBIC,
+    SIGNED_GAUSS,   UNSIGNED_GAUSS,   ABS,    SIGNED_SINE,
+    UNSIGNED_SINE,  LINEAR,           RELU,   SOFTPLUS};
+
+static const double g_tolerance = 1e-4;
+
+// Builds a random genome with a_Inputs inputs and a_Outputs outputs
+Genome RandomGenome(unsigned int a_Inputs, unsigned int a_Outputs,
+                    unsigned int a_Seed, Parameters &a_Params) {
+  Genome t_genome =
+      GrownGenome(a_Inputs, a_Outputs, TANH, 24, 2.0, a_Seed, a_Params);
+
+  RNG t_rng;
+  t_rng.Seed(a_Seed);
+  const unsigned int t_num_functions =
+      sizeof(g_functions) / sizeof(g_functions[0]);
+  for (unsigned int i = 0; i < t_genome.NumNeurons(); i++) {
+    NeuronGene &t_n = t_genome.m_NeuronGenes[i];
+    if ((t_n.Type() == INPUT) || (t_n.Type() == BIAS)) {
+      continue;
+    }
+    t_n.m_ActFunction = g_functions[t_rng.RandInt(0, t_num_functions - 1)];
+    t_n.m_A = t_rng.RandFloat() * 2.0 + 0.5;
+    t_n.m_B = t_rng.RandFloatSigned() * 0.5;
+    t_n.m_Bias = t_rng.RandFloatSigned();
+  }
+
+  return t_genome;
+}
+
+// Activates both networks a_Steps times on random inputs and returns the
+// largest relative difference between their outputs
+template <typename Net>
+double Compare(NeuralNetwork &a_Double, Net &a_Other, unsigned int a_Steps,
+               RNG &a_RNG) {
+  double t_worst = 0;
+  std::vector<double> t_inputs(a_Double.NumInputs());
+  for (unsigned int s = 0; s < a_Steps; s++) {
+    for (unsigned int i = 0; i < t_inputs.size(); i++) {
+      t_inputs[i] = a_RNG.RandFloatSigned();
+    }
+    a_Double.Input(t_inputs);
+    a_Double.ActivateUseInternalBias();
+    a_Other.Input(t_inputs);
+    a_Other.ActivateUseInternalBias();
+
+    std::vector<double> t_expected = a_Double.Output();
+    std::vector<double> t_actual = a_Other.Output();
+    for (unsigned int o = 0; o < t_expected.size(); o++) {
+      double t_diff = std::fabs(t_expected[o] - t_actual[o]) /
+                      std::max(1.0, std::fabs(t_expected[o]));
+      t_worst = std::max(t_worst, t_diff);
+    }
+  }
+  return t_worst;
+}
+
+int main() {
+  Parameters t_params;
+  t_params.RecurrentProb = 0;
+  RNG t_rng;
+  t_rng.Seed(1234);
+
+  double t_worst = 0;
+  for (unsigned int g = 0; g < 200; g++) {
+    Genome t_genome = RandomGenome(4, 3, g + 1, t_params);
+
+    NeuralNetwork t_net;
+    t_genome.BuildPhenotype(t_net);
+    FloatNetwork t_float;
+    t_genome.BuildPhenotype(t_float);
+    CompactNetwork<double> t_compact(t_net);
+
+    // the double compact network must not deviate at all
+    NeuralNetwork t_ref = t_net;
+    Check(Compare(t_ref, t_compact, 10, t_rng) == 0,
+          "CompactNetwork<double> matches");
+
+    // copies hold arrays of their own
+    CompactNetwork<double> t_copy;
+    {
+      CompactNetwork<double> t_gone = t_compact;
+      t_copy = t_gone;
+    }
+    Check(Compare(t_ref, t_copy, 10, t_rng) == 0,
+          "a copied CompactNetwork<double> matches");
+
+    double t_diff = Compare(t_net, t_float, 10, t_rng);
+    t_worst = std::max(t_worst, t_diff);
+    Check(t_diff <= g_tolerance, "FloatNetwork matches within tolerance");
+  }
+
+  printf("largest float deviation %g\n", t_worst);
+  return Failures();
+}
@@ -0,0 +1,160 @@
+/*
+ * Hebbian.cc
+ *
+ * Checks that Adapt() takes the same Hebbian step as the scalar rule it
+ * replaced, clamping included, that ActivateAndAdapt() propagates with the
+ * weights it started from and steps them from the same activations, and
+ * that direct changes to the connections are picked up. Returns non-zero if
+ * any check fails.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Random.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace NEAT;
+
+// A network with hidden neurons, weights of both signs, some of them zero
+// and some past the limit, and Hebbian rates that differ per connection
+static NeuralNetwork GrownNetwork(unsigned int a_Seed, Parameters &a_Params) {
+  Genome t_genome = GrownGenome(3, 2, TANH, 8, 4.0, a_Seed, a_Params);
+  NeuralNetwork t_net;
+  t_genome.BuildPhenotype(t_net);
+
+  RNG t_rng;
+  t_rng.Seed(a_Seed);
+  for (unsigned int i = 0; i < t_net.m_connections.size(); i++) {
+    Connection &t_c = t_net.m_connections[i];
+    t_c.m_hebb_rate = 0.5 * t_rng.RandFloat();
+    t_c.m_hebb_pre_rate = 0.2 * t_rng.RandFloat();
+    if (i % 5 == 0) {
+      t_c.m_weight = 0;
+    } else if (i % 5 == 1) {
+      t_c.m_weight = (i % 2) ? 5.0 : -5.0;
+    }
+  }
+  t_net.ConnectionsChanged();
+  return t_net;
+}
+
+// The rule Adapt() used before it worked on arrays, with the activations
+// given
+static void ScalarAdapt(NeuralNetwork &a_Net,
+                        const std::vector<double> &a_Activations,
+                        double a_Limit) {
+  double t_max_weight = 0;
+  for (unsigned int i = 0; i < a_Net.m_connections.size(); i++) {
+    t_max_weight =
+        std::max(t_max_weight, fabs(a_Net.m_connections[i].m_weight));
+  }
+
+  for (unsigned int i = 0; i < a_Net.m_connections.size(); i++) {
+    Connection &t_c = a_Net.m_connections[i];
+    double t_in = a_Activations[t_c.m_source_neuron_idx];
+    double t_out = a_Activations[t_c.m_target_neuron_idx];
+    double t_w = t_c.m_weight;
+    if (t_w > 0) {
+      t_w += (t_c.m_hebb_rate * (t_max_weight - t_w) * t_in * t_out) +
+             t_c.m_hebb_pre_rate * t_max_weight * t_in * (t_out - 1.0);
+    } else if (t_w < 0) {
+      t_w = -(t_w + (t_c.m_hebb_pre_rate * (t_max_weight - t_w) * t_in *
+                         (1.0 - t_out) -
+                     t_c.m_hebb_rate * t_max_weight * t_in * t_out));
+    }
+    t_c.m_weight = std::min(std::max(t_w, -a_Limit), a_Limit);
+  }
+}
+
+static std::vector<double> Activations(const NeuralNetwork &a_Net) {
+  std::vector<double> t_activations;
+  for (unsigned int i = 0; i < a_Net.m_neurons.size(); i++) {
+    t_activations.push_back(a_Net.m_neurons[i].m_activation);
+  }
+  return t_activations;
+}
+
+static bool SameWeights(const NeuralNetwork &a_Net,
+                        const NeuralNetwork &a_Other) {
+  for (unsigned int i = 0; i < a_Net.m_connections.size(); i++) {
+    if (a_Net.m_connections[i].m_weight !=
+        a_Other.m_connections[i].m_weight) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void Step(NeuralNetwork &a_Net, unsigned int a_Step) {
+  std::vector<double> t_inputs = {0.3 * a_Step - 1.0, 0.7, 1.0};
+  a_Net.Input(t_inputs);
+}
+
+static void CheckAdapt(Parameters &a_Params) {
+  NeuralNetwork t_net = GrownNetwork(1, a_Params);
+  NeuralNetwork t_scalar = t_net;
+
+  bool t_same = true, t_clamped = false;
+  for (unsigned int s = 0; s < 20; s++) {
+    Step(t_net, s);
+    Step(t_scalar, s);
+    t_net.Activate();
+    t_scalar.Activate();
+    t_net.Adapt(a_Params);
+    ScalarAdapt(t_scalar, Activations(t_scalar), a_Params.MaxWeight);
+    t_same = t_same && SameWeights(t_net, t_scalar);
+    for (unsigned int i = 0; i < t_net.m_connections.size(); i++) {
+      t_clamped = t_clamped ||
+                  (fabs(t_net.m_connections[i].m_weight) == a_Params.MaxWeight);
+    }
+  }
+  Check(t_same, "Adapt() takes the scalar step");
+  Check(t_clamped, "some weights were clamped");
+
+  // a weight set directly is used once the network is told
+  t_net.m_connections[1].m_weight = 0.25;
+  t_scalar.m_connections[1].m_weight = 0.25;
+  t_net.ConnectionsChanged();
+  t_net.Adapt(a_Params);
+  ScalarAdapt(t_scalar, Activations(t_scalar), a_Params.MaxWeight);
+  Check(SameWeights(t_net, t_scalar), "a changed weight is picked up");
+}
+
+static void CheckActivateAndAdapt(Parameters &a_Params) {
+  NeuralNetwork t_net = GrownNetwork(2, a_Params);
+  NeuralNetwork t_apart = t_net;
+
+  bool t_same = true;
+  for (unsigned int s = 0; s < 20; s++) {
+    Step(t_net, s);
+    Step(t_apart, s);
+    t_net.ActivateAndAdapt(a_Params);
+
+    // the same, in two sweeps
+    std::vector<double> t_before = Activations(t_apart);
+    t_apart.Activate();
+    ScalarAdapt(t_apart, t_before, a_Params.MaxWeight);
+
+    t_same = t_same && SameWeights(t_net, t_apart) &&
+             (t_net.Output() == t_apart.Output());
+  }
+  Check(t_same, "ActivateAndAdapt() propagates, then steps the weights");
+}
+
+int main() {
+  Parameters t_params;
+  t_params.RecurrentProb = 0.2;
+  t_params.MaxWeight = 3.0;
+
+  CheckAdapt(t_params);
+  CheckActivateAndAdapt(t_params);
+
+  return Failures();
+}
@@ -0,0 +1,282 @@
+/*
+ * MappedFile.cc
+ *
+ * Checks that flat networks and genome archives read back what was written,
+ * that a mapped network activates exactly like the network it was written
+ * from, and that truncated or malformed data is rejected without changing
+ * the network or archive it is opened into. Returns non-zero if any check
+ * fails.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/MappedFile.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Random.hh>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace NEAT;
+
+static const char *g_file = "MappedFile.test.flat";
+static const char *g_bad_file = "MappedFile.test.bad";
+
+// The bytes of a file, 8-byte aligned as Open() wants them
+static std::vector<uint64_t> ReadFile(const char *a_FileName, size_t &a_Size) {
+  std::ifstream t_file(a_FileName, std::ios::binary);
+  std::string t_bytes((std::istreambuf_iterator<char>(t_file)),
+                      std::istreambuf_iterator<char>());
+  std::vector<uint64_t> t_aligned(t_bytes.size() / 8 + 1);
+  std::memcpy(t_aligned.data(), t_bytes.data(), t_bytes.size());
+  a_Size = t_bytes.size();
+  return t_aligned;
+}
+
+static const char *Bytes(const std::vector<uint64_t> &a_Aligned) {
+  return reinterpret_cast<const char *>(a_Aligned.data());
+}
+
+template <typename T>
+static void Poke(std::vector<uint64_t> &a_Aligned, size_t a_At, T a_Value) {
+  std::memcpy(reinterpret_cast<char *>(a_Aligned.data()) + a_At, &a_Value,
+              sizeof(T));
+}
+
+static Genome RandomGenome(unsigned int a_Seed, Parameters &a_Params) {
+  Genome t_genome = GrownGenome(4, 3, TANH, 10, 2.0, a_Seed, a_Params);
+
+  RNG t_rng;
+  t_rng.Seed(a_Seed);
+  t_genome.Mutate_NeuronBiases(a_Params, t_rng);
+  // leaky activation divides by the time constants
+  for (unsigned int i = 0; i < t_genome.NumNeurons(); i++) {
+    t_genome.m_NeuronGenes[i].m_TimeConstant = 0.2 + t_rng.RandFloat();
+  }
+  t_genome.SetFitness(a_Seed * 1.5);
+  return t_genome;
+}
+
+// Activates both networks the same way on the same inputs. True if every
+// output is the same.
+template <typename Net>
+static bool SameOutputs(NeuralNetwork &a_Net, Net &a_Other) {
+  a_Net.Flush();
+  a_Other.Flush();
+  bool t_same = true;
+  for (unsigned int s = 0; s < 12; s++) {
+    std::vector<double> t_inputs(a_Net.NumInputs());
+    for (unsigned int i = 0; i < t_inputs.size(); i++) {
+      t_inputs[i] = 0.1 * (s + 1) * (i % 2 ? 1 : -1);
+    }
+    a_Net.Input(t_inputs);
+    a_Other.Input(t_inputs);
+    if (s % 3 == 0) {
+      a_Net.Activate();
+      a_Other.Activate();
+    } else if (s % 3 == 1) {
+      a_Net.ActivateUseInternalBias();
+      a_Other.ActivateUseInternalBias();
+    } else {
+      a_Net.ActivateLeaky(0.1);
+      a_Other.ActivateLeaky(0.1);
+    }
+    t_same = t_same && (a_Net.Output() == a_Other.Output());
+  }
+  return t_same;
+}
+
+// Opens a_Size bytes of a_Data into a copy of a_Good and checks that they
+// are rejected and leave the copy as it was
+static void CheckRejected(const MappedNetwork &a_Good, NeuralNetwork &a_Net,
+                          const std::vector<uint64_t> &a_Data, size_t a_Size,
+                          const char *a_What) {
+  MappedNetwork t_net = a_Good;
+  bool t_threw = false;
+  try {
+    t_net.Open(Bytes(a_Data), a_Size);
+  } catch (std::runtime_error &) {
+    t_threw = true;
+  }
+  Check(t_threw, a_What);
+  Check((t_net.NumNeurons() == a_Good.NumNeurons()) &&
+            SameOutputs(a_Net, t_net),
+        "rejected data leaves the network as it was");
+}
+
+static void CheckNetwork(NeuralNetwork &a_Net) {
+  Check(MappedNetwork::Write(a_Net, g_file), "the network is written");
+
+  // round trip and parity, from the file and from memory
+  MappedNetwork t_mapped;
+  t_mapped.Open(g_file);
+  Check((t_mapped.NumInputs() == a_Net.NumInputs()) &&
+            (t_mapped.NumOutputs() == a_Net.NumOutputs()) &&
+            (t_mapped.NumNeurons() == a_Net.m_neurons.size()) &&
+            (t_mapped.NumConnections() == a_Net.m_connections.size()),
+        "a mapped network has the counts it was written with");
+  Check(SameOutputs(a_Net, t_mapped),
+        "a mapped network activates like the one it was written from");
+
+  size_t t_size;
+  std::vector<uint64_t> t_data = ReadFile(g_file, t_size);
+  MappedNetwork t_in_memory;
+  t_in_memory.Open(Bytes(t_data), t_size);
+  Check(SameOutputs(a_Net, t_in_memory),
+        "a network in memory activates like the one it was written from");
+
+  // every cut is rejected
+  for (size_t t_len = 0; t_len < t_size; t_len += 5) {
+    CheckRejected(t_mapped, a_Net, t_data, t_len, "truncated network");
+  }
+
+  // malformed headers
+  std::vector<uint64_t> t_bad = t_data;
+  Poke<char>(t_bad, 0, 'X');
+  CheckRejected(t_mapped, a_Net, t_bad, t_size, "wrong magic");
+  t_bad = t_data;
+  Poke<uint32_t>(t_bad, 8, 99);
+  CheckRejected(t_mapped, a_Net, t_bad, t_size, "unknown version");
+  t_bad = t_data;
+  Poke<uint32_t>(t_bad, 12, 0x04030201);
+  CheckRejected(t_mapped, a_Net, t_bad, t_size, "other byte order");
+  t_bad = t_data;
+  Poke<uint32_t>(t_bad, 16, a_Net.m_neurons.size());
+  CheckRejected(t_mapped, a_Net, t_bad, t_size, "more inputs than neurons");
+  t_bad = t_data;
+  Poke<uint32_t>(t_bad, 28, 1000000);
+  CheckRejected(t_mapped, a_Net, t_bad, t_size, "too many connections");
+  t_bad = t_data;
+  Poke<uint64_t>(t_bad, 32 + 16, t_size + 8);
+  CheckRejected(t_mapped, a_Net, t_bad, t_size, "weights past the end");
+  t_bad = t_data;
+  Poke<uint64_t>(t_bad, 32 + 24, 36);
+  CheckRejected(t_mapped, a_Net, t_bad, t_size, "misaligned array");
+
+  // a connection to a missing neuron, the sources come first
+  t_bad = t_data;
+  uint64_t t_sources;
+  std::memcpy(&t_sources, Bytes(t_data) + 32, 8);
+  Poke<uint32_t>(t_bad, t_sources, a_Net.m_neurons.size());
+  CheckRejected(t_mapped, a_Net, t_bad, t_size,
+                "connection from a missing neuron");
+
+  // activation function types that are none of ActivationFunction
+  uint64_t t_types;
+  std::memcpy(&t_types, Bytes(t_data) + 32 + 56, 8);
+  t_bad = t_data;
+  Poke<int32_t>(t_bad, t_types, SOFTPLUS + 1);
+  CheckRejected(t_mapped, a_Net, t_bad, t_size,
+                "activation function type past the last");
+  t_bad = t_data;
+  Poke<int32_t>(t_bad, t_types, -1);
+  CheckRejected(t_mapped, a_Net, t_bad, t_size,
+                "negative activation function type");
+
+  // a bad file on disk leaves the mapping that is open. It has a name of its
+  // own, writing into the mapped file would change the mapping.
+  std::ofstream(g_bad_file, std::ios::binary)
+      .write(Bytes(t_data), t_size / 2);
+  bool t_threw = false;
+  try {
+    t_mapped.Open(g_bad_file);
+  } catch (std::runtime_error &) {
+    t_threw = true;
+  }
+  Check(t_threw && SameOutputs(a_Net, t_mapped),
+        "a truncated file leaves the mapped network as it was");
+}
+
+static void CheckArchive(const std::vector<Genome> &a_Genomes) {
+  Check(MappedGenomeArchive::Write(a_Genomes, g_file),
+        "the archive is written");
+
+  MappedGenomeArchive t_archive;
+  t_archive.Open(g_file);
+  Check(t_archive.NumGenomes() == a_Genomes.size(), "the number of genomes");
+  bool t_same = true;
+  for (unsigned int i = 0; i < a_Genomes.size(); i++) {
+    const Genome &t_g = a_Genomes[i];
+    MappedGenome t_m = t_archive.GetGenome(i);
+    t_same = t_same && (t_m.GetID() == t_g.GetID()) &&
+             (t_m.GetFitness() == t_g.GetFitness()) &&
+             (t_m.NumNeurons() == t_g.NumNeurons()) &&
+             (t_m.NumLinks() == t_g.NumLinks());
+    for (unsigned int j = 0; t_same && (j < t_g.NumNeurons()); j++) {
+      const NeuronGene &t_n = t_g.m_NeuronGenes[j];
+      const MappedNeuronGene &t_r = t_m.GetNeuronByIndex(j);
+      t_same = (t_r.m_id == t_n.ID()) && (t_r.m_bias == t_n.m_Bias) &&
+               (t_r.m_time_constant == t_n.m_TimeConstant) &&
+               (t_r.m_activation_function == t_n.m_ActFunction);
+    }
+    for (unsigned int j = 0; t_same && (j < t_g.NumLinks()); j++) {
+      const LinkGene &t_l = t_g.m_LinkGenes[j];
+      const MappedLinkGene &t_r = t_m.GetLinkByIndex(j);
+      t_same = (t_r.m_from_neuron_id == t_l.FromNeuronID()) &&
+               (t_r.m_to_neuron_id == t_l.ToNeuronID()) &&
+               (t_r.m_weight == t_l.GetWeight());
+    }
+  }
+  Check(t_same, "archived genomes read back as written");
+
+  bool t_threw = false;
+  try {
+    t_archive.GetGenome(a_Genomes.size());
+  } catch (std::out_of_range &) {
+    t_threw = true;
+  }
+  Check(t_threw, "a genome past the end throws");
+
+  // cut inside the index, then inside the records of the last genome
+  size_t t_size;
+  std::vector<uint64_t> t_data = ReadFile(g_file, t_size);
+  MappedGenomeArchive t_cut = t_archive;
+  t_threw = false;
+  try {
+    t_cut.Open(Bytes(t_data), 40);
+  } catch (std::runtime_error &) {
+    t_threw = true;
+  }
+  Check(t_threw && (t_cut.NumGenomes() == a_Genomes.size()),
+        "a cut index is rejected and leaves the archive");
+
+  t_cut.Open(Bytes(t_data), t_size - 8);
+  t_threw = false;
+  try {
+    t_cut.GetGenome(a_Genomes.size() - 1);
+  } catch (std::runtime_error &) {
+    t_threw = true;
+  }
+  Check(t_threw, "a genome cut short throws");
+}
+
+int main() {
+  Parameters t_params;
+  t_params.RecurrentProb = 0.2;
+
+  std::vector<Genome> t_genomes;
+  for (unsigned int g = 0; g < 6; g++) {
+    t_genomes.push_back(RandomGenome(g + 1, t_params));
+    NeuralNetwork t_net;
+    t_genomes.back().BuildPhenotype(t_net);
+    CheckNetwork(t_net);
+  }
+  CheckArchive(t_genomes);
+
+  // a file that cannot be written is reported
+  NeuralNetwork t_net;
+  t_genomes[0].BuildPhenotype(t_net);
+  Check(!MappedNetwork::Write(t_net, "no/such/directory/net.flat"),
+        "an unwritable file is reported");
+
+  std::remove(g_file);
+  std::remove(g_bad_file);
+  return Failures();
+}
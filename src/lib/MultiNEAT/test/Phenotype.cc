@@ -0,0 +1,231 @@
+/*
+ * Phenotype.cc
+ *
+ * Checks that plain phenotypes carry no neuron metadata and that the split
+ * Y of the neurons is kept when it is asked for, and that refreshing a
+ * network gives the network a fresh build would, whichever genome it was
+ * built from, and that every kind of build is counted once. Returns non-zero
+ * if any check fails.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/CompactNetwork.hh>
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/PhenotypeCache.hh>
+#include <MultiNEAT/Random.hh>
+#include <MultiNEAT/Stats.hh>
+#include <MultiNEAT/Substrate.hh>
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+using namespace NEAT;
+
+static void CheckMetadata(Parameters &a_Params) {
+  Genome t_genome = GrownGenome(3, 2, TANH, 6, 2.0, 1, a_Params);
+
+  NeuralNetwork t_plain;
+  t_genome.BuildLeanPhenotype(t_plain);
+  Check(!t_plain.HasNeuronMetadata(), "lean phenotype has no metadata");
+  Check(t_plain.GetNeuronByIndex(t_plain.NumInputs()).m_split_y == 0,
+        "lean phenotype reads back an empty split Y");
+
+  NeuralNetwork t_display;
+  t_genome.BuildPhenotype(t_display);
+  Check(t_display.HasNeuronMetadata(), "phenotype has metadata");
+  bool t_same = true;
+  for (unsigned int i = 0; i < t_genome.NumNeurons(); i++) {
+    t_same = t_same && (t_display.GetNeuronByIndex(i).m_split_y ==
+                        t_genome.m_NeuronGenes[i].SplitY());
+  }
+  Check(t_same, "phenotype keeps the split Y of every neuron");
+
+  // a rebuild keeps what the net was built with
+  t_genome.MarkPhenotypeChanged();
+  t_genome.RefreshPhenotype(t_plain);
+  t_genome.RefreshPhenotype(t_display);
+  Check(!t_plain.HasNeuronMetadata(), "rebuilt lean phenotype");
+  Check(t_display.HasNeuronMetadata(), "rebuilt phenotype");
+
+  // a net that was never built gets the metadata
+  NeuralNetwork t_fresh;
+  t_genome.RefreshPhenotype(t_fresh);
+  Check(t_fresh.HasNeuronMetadata(), "first refresh keeps the metadata");
+}
+
+// True if the nets have the same connections and neuron parameters
+static bool SameNetwork(const NeuralNetwork &a_Net,
+                        const NeuralNetwork &a_Other) {
+  if ((a_Net.m_connections.size() != a_Other.m_connections.size()) ||
+      (a_Net.m_neurons.size() != a_Other.m_neurons.size())) {
+    return false;
+  }
+  for (unsigned int i = 0; i < a_Net.m_connections.size(); i++) {
+    const Connection &t_c = a_Net.m_connections[i];
+    const Connection &t_o = a_Other.m_connections[i];
+    if ((t_c.m_source_neuron_idx != t_o.m_source_neuron_idx) ||
+        (t_c.m_target_neuron_idx != t_o.m_target_neuron_idx) ||
+        (t_c.m_weight != t_o.m_weight) ||
+        (t_c.m_hebb_rate != t_o.m_hebb_rate) ||
+        (t_c.m_hebb_pre_rate != t_o.m_hebb_pre_rate)) {
+      return false;
+    }
+  }
+  for (unsigned int i = 0; i < a_Net.m_neurons.size(); i++) {
+    const NeuronState &t_n = a_Net.m_neurons[i];
+    const NeuronState &t_o = a_Other.m_neurons[i];
+    if ((t_n.m_a != t_o.m_a) || (t_n.m_b != t_o.m_b) ||
+        (t_n.m_timeconst != t_o.m_timeconst) || (t_n.m_bias != t_o.m_bias) ||
+        (t_n.m_activation_function_type != t_o.m_activation_function_type) ||
+        (t_n.m_type != t_o.m_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// True if a_Net is what a fresh build of a_Genome gives
+static bool IsBuildOf(const NeuralNetwork &a_Net, Genome a_Genome) {
+  NeuralNetwork t_fresh;
+  a_Genome.BuildPhenotype(t_fresh);
+  return SameNetwork(a_Net, t_fresh);
+}
+
+// Changes the weights and neuron parameters but not the topology
+static void MutateParameters(Genome &a_Genome, Parameters &a_Params,
+                             RNG &a_RNG) {
+  a_Genome.Randomize_LinkWeights(2.0, a_RNG);
+  a_Genome.Mutate_NeuronBiases(a_Params, a_RNG);
+  a_Genome.Mutate_NeuronTimeConstants(a_Params, a_RNG);
+}
+
+static void CheckRefresh(Parameters &a_Params) {
+  RNG t_rng;
+  t_rng.Seed(7);
+  Genome t_genome = GrownGenome(3, 2, TANH, 6, 2.0, 2, a_Params);
+
+  // only parameters changed, patched in place
+  NeuralNetwork t_net;
+  t_genome.BuildPhenotype(t_net);
+  MutateParameters(t_genome, a_Params, t_rng);
+  Check(t_genome.RefreshPhenotype(t_net), "parameter changes are patched");
+  Check(IsBuildOf(t_net, t_genome), "patched net matches a fresh build");
+
+  // a sibling of the same topology, already built into a net of its own
+  Genome t_sibling = t_genome;
+  MutateParameters(t_sibling, a_Params, t_rng);
+  NeuralNetwork t_sibling_net;
+  t_sibling.BuildPhenotype(t_sibling_net);
+  Check(t_sibling.GetPhenotypeChanges() == Genome::CHANGED_NONE,
+        "a built sibling has no changes");
+  Check(!t_sibling.RefreshPhenotype(t_net),
+        "the net of another genome is rebuilt");
+  Check(IsBuildOf(t_net, t_sibling), "net refreshed from a sibling");
+
+  // and back again, the first genome has no changes but the net is no
+  // longer its build
+  Check(!t_genome.RefreshPhenotype(t_net),
+        "a net built from a sibling since is rebuilt");
+  Check(IsBuildOf(t_net, t_genome), "net refreshed back");
+
+  // a clone made after the build patches the net, as a baby that only
+  // changed its parent's weights does, and the original then rebuilds it
+  Genome t_clone = t_genome;
+  Check(t_clone.GetPhenotypeChanges() == t_genome.GetPhenotypeChanges(),
+        "a copy carries the changes");
+  MutateParameters(t_clone, a_Params, t_rng);
+  Check(t_clone.RefreshPhenotype(t_net), "a clone patches the net");
+  Check(IsBuildOf(t_net, t_clone), "net refreshed from a clone");
+  Check(!t_genome.RefreshPhenotype(t_net),
+        "a net a clone patched is rebuilt for the original");
+  Check(IsBuildOf(t_net, t_genome), "net refreshed back from a clone");
+
+  // an assigned copy carries the changes made since the build
+  MutateParameters(t_genome, a_Params, t_rng);
+  Genome t_copy_genome;
+  t_copy_genome = t_genome;
+  Check(t_copy_genome.RefreshPhenotype(t_net),
+        "an assigned copy patches the net");
+  Check(IsBuildOf(t_net, t_genome), "net refreshed from an assigned copy");
+
+  // nor does a copy of the net stand for it
+  t_genome.BuildPhenotype(t_net);
+  NeuralNetwork t_copy = t_net;
+  MutateParameters(t_genome, a_Params, t_rng);
+  Check(!t_genome.RefreshPhenotype(t_copy), "a copied net is rebuilt");
+  Check(IsBuildOf(t_copy, t_genome), "copied net refreshed");
+  Check(!t_genome.RefreshPhenotype(t_net),
+        "a net built before the last build is rebuilt");
+  Check(IsBuildOf(t_net, t_genome), "older net refreshed");
+}
+
+// True if one build was counted since a_Before, which is then moved on
+static bool CountedOnce(unsigned long long &a_Before) {
+  unsigned long long t_now = NumPhenotypeBuilds();
+#ifdef MULTINEAT_NO_STATS
+  bool t_once = (t_now == 0);
+#else
+  bool t_once = (t_now == a_Before + 1);
+#endif
+  a_Before = t_now;
+  return t_once;
+}
+
+static void CheckBuildCount(Parameters &a_Params) {
+  RNG t_rng;
+  t_rng.Seed(5);
+  Genome t_genome = GrownGenome(3, 2, TANH, 6, 2.0, 3, a_Params);
+  unsigned long long t_builds = NumPhenotypeBuilds();
+
+  NeuralNetwork t_net;
+  t_genome.BuildPhenotype(t_net);
+  Check(CountedOnce(t_builds), "a build counts once");
+  MutateParameters(t_genome, a_Params, t_rng);
+  t_genome.RefreshPhenotype(t_net);
+  Check(CountedOnce(t_builds), "a patch counts once");
+  t_genome.MarkPhenotypeChanged();
+  t_genome.RefreshPhenotype(t_net);
+  Check(CountedOnce(t_builds), "a rebuild counts once");
+
+  FloatNetwork t_float;
+  t_genome.BuildPhenotype(t_float);
+  Check(CountedOnce(t_builds), "a single precision build counts once");
+
+  // a CPPN for a substrate in three dimensions
+  Genome t_cppn(0, 7, 0, 2, false, TANH, TANH, 0, a_Params, 0);
+  std::vector<std::vector<double>> t_inputs = {{-1, -1, 0}, {1, -1, 0}};
+  std::vector<std::vector<double>> t_outputs = {{0, 1, 0}};
+  Substrate t_subst(std::move(t_inputs), std::vector<std::vector<double>>(),
+                    std::move(t_outputs));
+  t_cppn.BuildHyperNEATPhenotype(t_net, t_subst);
+  Check(CountedOnce(t_builds), "a HyperNEAT build counts once");
+
+  Parameters t_es = a_Params;
+  t_es.InitialDepth = 2;
+  t_es.MaxDepth = 3;
+  NeuralNetwork t_es_net;
+  t_cppn.BuildESHyperNEATPhenotype(t_es_net, t_subst, t_es);
+  Check(CountedOnce(t_builds), "an ES-HyperNEAT build counts once");
+
+  // the cache counts what it builds, not what it finds
+  PhenotypeCache t_cache;
+  t_cache.GetHyperNEAT(t_cppn, t_subst);
+  Check(CountedOnce(t_builds), "a cache miss counts once");
+  t_cache.GetHyperNEAT(t_cppn, t_subst);
+  Check(NumPhenotypeBuilds() == t_builds, "a cache hit is not a build");
+}
+
+int main() {
+  Parameters t_params;
+  t_params.RecurrentProb = 0;
+
+  CheckMetadata(t_params);
+  CheckRefresh(t_params);
+  CheckBuildCount(t_params);
+
+  return Failures();
+}
@@ -0,0 +1,205 @@
+/*
+ * PhenotypeCache.cc
+ *
+ * Checks the hits, misses and evictions of the phenotype cache, that
+ * changing a substrate or the ES-HyperNEAT parameters in place makes
+ * lookups miss, and that threads sharing a cache get the networks a fresh
+ * build gives. Returns non-zero if any check fails.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/PhenotypeCache.hh>
+#include <MultiNEAT/Random.hh>
+#include <MultiNEAT/Substrate.hh>
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace NEAT;
+
+// The outputs of a_Net after a few activations on fixed inputs
+static std::vector<double> Run(NeuralNetwork &a_Net) {
+  std::vector<double> t_inputs(a_Net.NumInputs());
+  for (unsigned int i = 0; i < t_inputs.size(); i++) {
+    t_inputs[i] = 0.3 * i - 0.4;
+  }
+  a_Net.Flush();
+  a_Net.Input(t_inputs);
+  for (unsigned int s = 0; s < 4; s++) {
+    a_Net.Activate();
+  }
+  return a_Net.Output();
+}
+
+static std::vector<double> Run(const CompiledPhenotype &a_Compiled) {
+  NeuralNetwork t_state;
+  PhenotypeCache::Instantiate(a_Compiled, t_state);
+  return Run(t_state);
+}
+
+static void CheckCounters(Parameters &a_Params) {
+  PhenotypeCache t_cache(2);
+  RNG t_rng;
+  t_rng.Seed(3);
+
+  Genome t_genome = GrownGenome(3, 2, SIGNED_SIGMOID, 8, 3.0, 1, a_Params);
+  Genome t_clone = t_genome;
+  CompiledPhenotype t_net = t_cache.Get(t_genome);
+  Check(t_cache.Get(t_clone) == t_net, "a clone shares the phenotype");
+  Check((t_cache.GetHits() == 1) && (t_cache.GetMisses() == 1),
+        "one miss and one hit");
+
+  NeuralNetwork t_built;
+  t_genome.BuildPhenotype(t_built);
+  Check(Run(t_net) == Run(t_built), "the cached phenotype is the build");
+
+  t_clone.Mutate_LinkWeights(a_Params, t_rng);
+  CompiledPhenotype t_mutated = t_cache.Get(t_clone);
+  Check((t_mutated != t_net) && (t_cache.GetMisses() == 2),
+        "changed weights miss");
+
+  // a third phenotype evicts the least recently used one
+  Genome t_other = GrownGenome(3, 2, SIGNED_SIGMOID, 8, 3.0, 2, a_Params);
+  t_cache.Get(t_other);
+  Check(t_cache.NumCached() == 2, "the capacity is kept");
+  t_cache.Get(t_genome);
+  Check(t_cache.GetMisses() == 4, "the oldest phenotype was evicted");
+
+  t_cache.Clear();
+  Check((t_cache.NumCached() == 0) && (t_cache.GetMisses() == 4),
+        "Clear() keeps the counters");
+  t_cache.ResetCounters();
+  Check((t_cache.GetHits() == 0) && (t_cache.GetMisses() == 0),
+        "counters reset");
+}
+
+static void CheckSubstrateKey(Parameters &a_Params) {
+  std::vector<std::vector<double>> t_inputs = {{-1, -1}, {0, -1}, {1, -1}};
+  std::vector<std::vector<double>> t_hidden = {{-0.5, 0}, {0.5, 0}};
+  std::vector<std::vector<double>> t_outputs = {{-1, 1}, {1, 1}};
+  Substrate t_subst(std::move(t_inputs), std::move(t_hidden),
+                    std::move(t_outputs));
+  t_subst.m_allow_input_hidden_links = true;
+  t_subst.m_allow_hidden_output_links = true;
+  t_subst.m_max_weight_and_bias = 4;
+
+  PhenotypeCache t_cache;
+  Genome t_cppn = GrownGenome(t_subst.GetMinCPPNInputs(), 2, SIGNED_SIGMOID,
+                              8, 3.0, 4, a_Params);
+  CompiledPhenotype t_net = t_cache.GetHyperNEAT(t_cppn, t_subst);
+  Check(!t_net->m_connections.empty(), "the substrate is connected");
+  Check(t_cache.GetHyperNEAT(t_cppn, t_subst) == t_net,
+        "the same substrate hits");
+
+  // an equal substrate elsewhere builds the same network
+  Substrate t_equal = t_subst;
+  Check(t_cache.GetHyperNEAT(t_cppn, t_equal) == t_net,
+        "an equal substrate hits");
+
+  // changed in place
+  t_subst.m_max_weight_and_bias = 8;
+  CompiledPhenotype t_changed = t_cache.GetHyperNEAT(t_cppn, t_subst);
+  Check(t_changed != t_net, "a substrate changed in place misses");
+  NeuralNetwork t_built;
+  t_cppn.BuildHyperNEATPhenotype(t_built, t_subst);
+  Check(Run(t_changed) == Run(t_built),
+        "the changed substrate's phenotype is its build");
+
+  t_subst.m_hidden_coords[0][1] = 0.25;
+  Check(t_cache.GetHyperNEAT(t_cppn, t_subst) != t_changed,
+        "moved substrate coordinates miss");
+  Check(t_cache.GetMisses() == 3, "three HyperNEAT builds");
+}
+
+static void CheckESKey(Parameters &a_Params) {
+  std::vector<std::vector<double>> t_inputs = {{-1, -1, 0}, {1, -1, 0}};
+  std::vector<std::vector<double>> t_outputs = {{0, 1, 0}};
+  Substrate t_subst(std::move(t_inputs), std::vector<std::vector<double>>(),
+                    std::move(t_outputs));
+  t_subst.m_max_weight_and_bias = 8;
+
+  Parameters t_params = a_Params;
+  t_params.InitialDepth = 2;
+  t_params.MaxDepth = 3;
+  t_params.IterationLevel = 1;
+  t_params.DivisionThreshold = 0.03;
+  t_params.VarianceThreshold = 0.03;
+  t_params.BandThreshold = 0.3;
+
+  PhenotypeCache t_cache;
+  Genome t_cppn = GrownGenome(7, 2, SIGNED_SIGMOID, 8, 3.0, 4, a_Params);
+  CompiledPhenotype t_net = t_cache.GetESHyperNEAT(t_cppn, t_subst, t_params);
+  Check(!t_net->m_connections.empty(), "the ES substrate is connected");
+  Check(t_cache.GetESHyperNEAT(t_cppn, t_subst, t_params) == t_net,
+        "the same ES parameters hit");
+
+  t_params.ES_Threads = 2;
+  Check(t_cache.GetESHyperNEAT(t_cppn, t_subst, t_params) == t_net,
+        "the thread count does not change the key");
+
+  t_params.MaxDepth = 4;
+  Check(t_cache.GetESHyperNEAT(t_cppn, t_subst, t_params) != t_net,
+        "ES parameters changed in place miss");
+}
+
+static void CheckThreads(Parameters &a_Params) {
+  // genomes with clones among them, and the outputs of their builds
+  std::vector<Genome> t_genomes;
+  for (unsigned int g = 0; g < 12; g++) {
+    t_genomes.push_back(
+        GrownGenome(3, 2, SIGNED_SIGMOID, 8, 3.0, g + 10, a_Params));
+    t_genomes.push_back(t_genomes.back());
+  }
+  std::vector<std::vector<double>> t_expected;
+  for (unsigned int g = 0; g < t_genomes.size(); g++) {
+    NeuralNetwork t_net;
+    t_genomes[g].BuildPhenotype(t_net);
+    t_expected.push_back(Run(t_net));
+  }
+
+  // small enough to evict while the threads run
+  PhenotypeCache t_cache(8);
+  const unsigned int t_num_threads = 4, t_lookups = 500;
+  std::vector<std::thread> t_threads;
+  for (unsigned int t = 0; t < t_num_threads; t++) {
+    t_threads.push_back(std::thread([&, t]() {
+      // each thread has its own copies, the genomes are not shared
+      std::vector<Genome> t_own = t_genomes;
+      NeuralNetwork t_state;
+      bool t_ok = true;
+      for (unsigned int i = 0; i < t_lookups; i++) {
+        unsigned int g = (i * 7 + t * 5) % t_own.size();
+        PhenotypeCache::Instantiate(t_cache.Get(t_own[g]), t_state);
+        t_ok = t_ok && (Run(t_state) == t_expected[g]);
+        t_cache.GetHits();
+        t_cache.GetMisses();
+      }
+      Check(t_ok, "threads get the phenotypes of their genomes");
+    }));
+  }
+  for (unsigned int t = 0; t < t_num_threads; t++) {
+    t_threads[t].join();
+  }
+
+  Check(t_cache.GetHits() + t_cache.GetMisses() ==
+            t_num_threads * t_lookups,
+        "every lookup is counted once");
+  Check(t_cache.NumCached() <= 8, "the capacity holds under threads");
+}
+
+int main() {
+  Parameters t_params;
+  t_params.RecurrentProb = 0;
+
+  CheckCounters(t_params);
+  CheckSubstrateKey(t_params);
+  CheckESKey(t_params);
+  CheckThreads(t_params);
+
+  return Failures();
+}
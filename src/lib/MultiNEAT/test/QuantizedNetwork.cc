@@ -0,0 +1,154 @@
+/*
+ * QuantizedNetwork.cc
+ *
+ * Checks that quantized networks load back into the same network, and that
+ * truncated or malformed files are rejected without changing the network
+ * they are loaded into. Returns non-zero if any check fails.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/QuantizedNetwork.hh>
+#include <MultiNEAT/Random.hh>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace NEAT;
+
+static const char *g_file = "QuantizedNetwork.test.qnn";
+
+static void WriteFile(const char *a_FileName, const std::string &a_Text) {
+  std::ofstream t_file(a_FileName, std::ios::binary);
+  t_file << a_Text;
+}
+
+// The outputs of a_Net after a few activations on fixed inputs
+template <typename Q> static std::vector<double> Run(Q &a_Net) {
+  std::vector<double> t_inputs(a_Net.NumInputs());
+  for (unsigned int i = 0; i < t_inputs.size(); i++) {
+    t_inputs[i] = 0.25 * i - 0.5;
+  }
+  a_Net.Flush();
+  a_Net.Input(t_inputs);
+  for (unsigned int s = 0; s < 4; s++) {
+    a_Net.Activate();
+  }
+  return a_Net.Output();
+}
+
+// 0 if a_Text loads, 1 if Load() returns false, 2 if it throws
+template <typename Q>
+static int TryLoad(Q &a_Net, const std::string &a_Text) {
+  WriteFile(g_file, a_Text);
+  try {
+    return a_Net.Load(g_file) ? 0 : 1;
+  } catch (std::runtime_error &) {
+    return 2;
+  }
+}
+
+// Loads a_Text into a copy of a_Good and checks that it is rejected and
+// leaves the copy as it was
+template <typename Q>
+static void CheckRejected(const Q &a_Good, const std::string &a_Text,
+                          const char *a_What) {
+  Q t_net = a_Good;
+  std::vector<double> t_before = Run(t_net);
+  Check(TryLoad(t_net, a_Text) != 0, a_What);
+  Check(Run(t_net) == t_before,
+        "a rejected file leaves the network as it was");
+}
+
+// Replaces the first a_Old after a_From in a_Text with a_New
+static std::string Replace(std::string a_Text, const std::string &a_From,
+                           const std::string &a_Old,
+                           const std::string &a_New) {
+  size_t t_at = a_Text.find(a_Old, a_Text.find(a_From));
+  if (t_at != std::string::npos) {
+    a_Text.replace(t_at, a_Old.size(), a_New);
+  }
+  return a_Text;
+}
+
+template <typename Q>
+static void CheckNetwork(const NeuralNetwork &a_Net,
+                         const std::vector<std::vector<double>> &a_Samples) {
+  Q t_net;
+  QuantizationReport t_report = t_net.Build(a_Net, a_Samples, 4, true);
+  t_net.Save(g_file);
+  std::string t_text = ReadFile(g_file);
+
+  // round trip
+  Q t_loaded;
+  Check(t_loaded.Load(g_file), "a saved network loads");
+  Check(Run(t_loaded) == Run(t_net),
+        "a loaded network gives the same outputs");
+  QuantizationReport t_again = t_loaded.Evaluate(a_Net, a_Samples, 4);
+  Check(t_again.m_max_error == t_report.m_max_error,
+        "a loaded network has the same error");
+  t_loaded.Save(g_file);
+  Check(ReadFile(g_file) == t_text, "a loaded network saves the same text");
+
+  // every cut before the end marker is rejected
+  size_t t_end = t_text.find("QNNend") + 6;
+  for (size_t t_len = 0; t_len < t_end; t_len += 7) {
+    CheckRejected(t_net, t_text.substr(0, t_len), "truncated network");
+  }
+
+  // other widths are not loaded
+  QuantizedNetwork<int8_t> t_narrow;
+  QuantizedNetwork<int16_t> t_wide;
+  Check((TryLoad(t_narrow, t_text) == 1) != (TryLoad(t_wide, t_text) == 1),
+        "only one width loads");
+
+  // malformed values
+  CheckRejected(t_net, Replace(t_text, "connection ", " ", " 100000 "),
+                "connection from a missing neuron");
+  CheckRejected(t_net, Replace(t_text, "connection ", " ", " -1 "),
+                "negative connection index");
+  CheckRejected(t_net, Replace(t_text, "neuron ", "neuron", "nevron"),
+                "misspelled neuron");
+  CheckRejected(t_net, Replace(t_text, "QNNstart", "\n", "\n0 "),
+                "zero bit width");
+  CheckRejected(t_net, Replace(t_text, "QNNstart", " ", " -3 "),
+                "negative counts");
+  CheckRejected(t_net, Replace(t_text, "QNNend", "QNNend", "QNNxx"),
+                "missing end marker");
+  CheckRejected(t_net, Replace(t_text, "connection", "\n", "\n1 "),
+                "table entry among the connections");
+}
+
+int main() {
+  Parameters t_params;
+  t_params.RecurrentProb = 0;
+
+  for (unsigned int g = 0; g < 4; g++) {
+    Genome t_genome = GrownGenome(4, 2, TANH, 8, 2.0, g + 1, t_params);
+    NeuralNetwork t_net;
+    t_genome.BuildPhenotype(t_net);
+
+    RNG t_rng;
+    t_rng.Seed(g + 1);
+    std::vector<std::vector<double>> t_samples;
+    for (unsigned int s = 0; s < 20; s++) {
+      std::vector<double> t_sample;
+      for (unsigned int i = 0; i < t_net.NumInputs(); i++) {
+        t_sample.push_back(t_rng.RandFloatSigned());
+      }
+      t_samples.push_back(t_sample);
+    }
+
+    CheckNetwork<QuantizedNetwork8>(t_net, t_samples);
+    CheckNetwork<QuantizedNetwork16>(t_net, t_samples);
+  }
+
+  std::remove(g_file);
+  return Failures();
+}
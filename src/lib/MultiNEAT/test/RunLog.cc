@@ -0,0 +1,139 @@
+/*
+ * RunLog.cc
+ *
+ * Logs a few generations of evolution and checks that every generation
+ * loads back into the population that was logged, that a loaded population
+ * evolves on like the original, that genomes are shared by their genes
+ * alone, and that compacted and cut-off logs still read back. Returns
+ * non-zero if any check fails.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Population.hh>
+#include <MultiNEAT/RunLog.hh>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace NEAT;
+
+static const char *g_log = "RunLog.test.log";
+static const char *g_compact = "RunLog.test.compact";
+static const char *g_checkpoint = "RunLog.test.ckpt";
+
+static void Evolve(Population &a_Pop) {
+  EvaluateXor(a_Pop);
+  a_Pop.Epoch();
+}
+
+int main() {
+  std::remove(g_log);
+
+  Parameters t_params;
+  t_params.PopulationSize = 60;
+  t_params.RecurrentProb = 0;
+  t_params.MutateAddNeuronProb = 0.1;
+  t_params.MutateAddLinkProb = 0.2;
+
+  Genome t_seed(0, 3, 0, 1, false, UNSIGNED_SIGMOID, UNSIGNED_SIGMOID, 0,
+                t_params, 0);
+  Population t_pop(t_seed, t_params, true, 1.0, 3);
+
+  // N generations, a snapshot every fourth record
+  const unsigned int t_num = 12;
+  std::vector<std::string> t_logged;
+  RunLogWriter t_writer;
+  Check(t_writer.Open(g_log, 4), "the log opens");
+  for (unsigned int g = 0; g < t_num; g++) {
+    Evolve(t_pop);
+    Check(t_writer.Append(t_pop), "a generation is logged");
+    t_logged.push_back(Checkpoint(t_pop, g_checkpoint));
+  }
+
+  // the same genes with another fitness are not stored again, so logging
+  // the population after evaluating it takes no more than logging it again
+  // unchanged
+  uint64_t t_before = std::filesystem::file_size(g_log);
+  Check(t_writer.Append(t_pop), "an unchanged population is logged");
+  uint64_t t_unchanged = std::filesystem::file_size(g_log) - t_before;
+  EvaluateXor(t_pop);
+  t_before = std::filesystem::file_size(g_log);
+  Check(t_writer.Append(t_pop), "a re-evaluation is logged");
+  uint64_t t_evaluated = std::filesystem::file_size(g_log) - t_before;
+  t_writer.Close();
+
+  RunLogReader t_log;
+  t_log.Open(g_log);
+  Check(t_log.NumRecords() == t_num + 2, "every record is found");
+  Check(t_log.IsSnapshot(0) && !t_log.IsSnapshot(1) && t_log.IsSnapshot(5),
+        "snapshots come every fifth record");
+  Check(t_evaluated == t_unchanged, "a re-evaluated population adds no genes");
+  Population t_reevaluated = t_log.Load(t_num + 1);
+  Check(Checkpoint(t_reevaluated, g_checkpoint) ==
+            Checkpoint(t_pop, g_checkpoint),
+        "a re-evaluated population loads with its new fitness");
+
+  // every generation loads back as it was logged
+  bool t_same = true;
+  for (unsigned int k = 0; k < t_num; k++) {
+    Population t_loaded = t_log.Load(k);
+    t_same = t_same && (Checkpoint(t_loaded, g_checkpoint) == t_logged[k]);
+  }
+  Check(t_same, "every record loads the population it logged");
+
+  // generation k, taken from a delta, evolves on like the original
+  const unsigned int k = 6;
+  Check(!t_log.IsSnapshot(k), "record k is a delta");
+  Population t_resumed = t_log.LoadGeneration(t_log.GetGeneration(k));
+  Check(Checkpoint(t_resumed, g_checkpoint) == t_logged[k],
+        "generation k loads");
+  for (unsigned int g = k + 1; g < t_num; g++) {
+    Evolve(t_resumed);
+  }
+  Check(Checkpoint(t_resumed, g_checkpoint) == t_logged[t_num - 1],
+        "a loaded generation evolves like the original");
+
+  // a compacted log starts at record k
+  Check(t_log.Compact(k, g_compact), "the log is compacted");
+  RunLogReader t_compact;
+  t_compact.Open(g_compact);
+  Check(t_compact.NumRecords() == t_log.NumRecords() - k,
+        "a compacted log keeps the records from k on");
+  Check(t_compact.IsSnapshot(0), "a compacted log starts with a snapshot");
+  t_same = true;
+  for (unsigned int i = 0; i + k < t_num; i++) {
+    Population t_loaded = t_compact.Load(i);
+    t_same = t_same && (Checkpoint(t_loaded, g_checkpoint) == t_logged[i + k]);
+  }
+  Check(t_same, "a compacted log loads the same populations");
+
+  // a record cut short is ignored by readers and dropped by writers
+  uint64_t t_size = t_log.GetSize();
+  std::filesystem::resize_file(g_compact, t_compact.GetSize() - 10);
+  RunLogReader t_cut;
+  t_cut.Open(g_compact);
+  Check(t_cut.NumRecords() == t_compact.NumRecords() - 1,
+        "a cut record is ignored");
+  RunLogWriter t_appender;
+  Check(t_appender.Open(g_compact), "a cut log opens for appending");
+  Check(t_appender.Append(t_pop), "a cut log is appended to");
+  t_appender.Close();
+  RunLogReader t_appended;
+  t_appended.Open(g_compact);
+  Check(t_appended.NumRecords() == t_compact.NumRecords(),
+        "the appended record replaces the cut one");
+  Population t_last = t_appended.Load(t_appended.NumRecords() - 1);
+  Check(Checkpoint(t_last, g_checkpoint) == Checkpoint(t_pop, g_checkpoint),
+        "the appended record loads");
+  Check(t_log.GetSize() == t_size, "the original log is untouched");
+
+  std::remove(g_log);
+  std::remove(g_compact);
+  std::remove(g_checkpoint);
+  return Failures();
+}
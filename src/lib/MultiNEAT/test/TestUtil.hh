@@ -0,0 +1,128 @@
+/*
+ * TestUtil.hh
+ *
+ * What the tests share: counting failed checks, genomes and populations
+ * grown from a seed, evaluating a population on XOR and reading files back.
+ */
+
+#ifndef _MULTINEAT_TEST_TESTUTIL_H
+#define _MULTINEAT_TEST_TESTUTIL_H
+
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/Innovation.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Population.hh>
+#include <MultiNEAT/Random.hh>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Checks may fail on several threads at once
+inline std::atomic<int> g_failures(0);
+
+inline void Check(bool a_Ok, const char *a_What) {
+  if (!a_Ok) {
+    printf("failed: %s\n", a_What);
+    g_failures++;
+  }
+}
+
+// Prints the number of failed checks and returns what main() should
+inline int Failures() {
+  printf("%d failures\n", g_failures.load());
+  return (g_failures > 0) ? 1 : 0;
+}
+
+inline std::string ReadFile(const char *a_FileName) {
+  std::ifstream t_file(a_FileName, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(t_file),
+                     std::istreambuf_iterator<char>());
+}
+
+// The checkpoint of a_Pop, as bytes. It is written to a_FileName.
+inline std::string Checkpoint(NEAT::Population &a_Pop,
+                              const char *a_FileName) {
+  Check(a_Pop.SaveCheckpoint(a_FileName), "the checkpoint is written");
+  return ReadFile(a_FileName);
+}
+
+// A genome with a_Inputs inputs and a_Outputs outputs of a_Function, grown
+// from a_Seed by a_Steps rounds of adding a neuron and a link. The weights
+// lie in [-a_Range, a_Range].
+inline NEAT::Genome GrownGenome(unsigned int a_Inputs, unsigned int a_Outputs,
+                                NEAT::ActivationFunction a_Function,
+                                unsigned int a_Steps, double a_Range,
+                                unsigned int a_Seed,
+                                NEAT::Parameters &a_Params) {
+  NEAT::Genome t_genome(0, a_Inputs, 0, a_Outputs, false, a_Function,
+                        a_Function, 0, a_Params, 0);
+  NEAT::InnovationDatabase t_innovs;
+  t_innovs.Init(t_genome);
+
+  // the genome reseeds the global generator, so seed after building it
+  NEAT::RNG t_rng;
+  t_rng.Seed(a_Seed);
+  for (unsigned int i = 0; i < a_Steps; i++) {
+    t_genome.Mutate_AddNeuron(t_innovs, a_Params, t_rng);
+    t_genome.Mutate_AddLink(t_innovs, a_Params, t_rng);
+  }
+  t_genome.Randomize_LinkWeights(a_Range, t_rng);
+  return t_genome;
+}
+
+// A population of a_Size genomes of five inputs and two outputs, each grown
+// by a few neurons and links
+inline NEAT::Population MakePopulation(unsigned int a_Size) {
+  NEAT::Parameters t_params;
+  t_params.PopulationSize = a_Size;
+
+  NEAT::Genome t_seed(0, 5, 0, 2, false, NEAT::UNSIGNED_SIGMOID,
+                      NEAT::UNSIGNED_SIGMOID, 0, t_params, 0);
+  NEAT::Population t_pop(t_seed, t_params, true, 2.0, 7);
+  for (unsigned int i = 0; i < t_pop.m_Species.size(); i++) {
+    for (unsigned int j = 0; j < t_pop.m_Species[i].m_Individuals.size();
+         j++) {
+      NEAT::Genome &t_genome = t_pop.m_Species[i].m_Individuals[j];
+      for (unsigned int k = 0; k < 4; k++) {
+        t_genome.Mutate_AddNeuron(t_pop.AccessInnovationDatabase(),
+                                  t_pop.m_Parameters, t_pop.m_RNG);
+        t_genome.Mutate_AddLink(t_pop.AccessInnovationDatabase(),
+                                t_pop.m_Parameters, t_pop.m_RNG);
+        t_genome.Mutate_AddLink(t_pop.AccessInnovationDatabase(),
+                                t_pop.m_Parameters, t_pop.m_RNG);
+      }
+    }
+  }
+  return t_pop;
+}
+
+// XOR, deterministic for a given population
+inline void EvaluateXor(NEAT::Population &a_Pop) {
+  const double t_cases[4][3] = {{0, 0, 0}, {0, 1, 1}, {1, 0, 1}, {1, 1, 0}};
+  for (unsigned int i = 0; i < a_Pop.m_Species.size(); i++) {
+    for (NEAT::Genome &t_genome : a_Pop.m_Species[i].m_Individuals) {
+      NEAT::NeuralNetwork t_net;
+      t_genome.BuildPhenotype(t_net);
+      double t_error = 0;
+      for (unsigned int c = 0; c < 4; c++) {
+        std::vector<double> t_inputs = {t_cases[c][0], t_cases[c][1], 1.0};
+        t_net.Flush();
+        t_net.Input(t_inputs);
+        for (unsigned int s = 0; s < 3; s++) {
+          t_net.Activate();
+        }
+        t_error += std::fabs(t_net.Output()[0] - t_cases[c][2]);
+      }
+      t_genome.SetFitness((4.0 - t_error) * (4.0 - t_error));
+      t_genome.SetEvaluated();
+    }
+  }
+}
+
+#endif
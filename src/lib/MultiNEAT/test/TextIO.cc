@@ -0,0 +1,219 @@
+/*
+ * TextIO.cc
+ *
+ * Checks that populations, networks and parameters saved in the text format
+ * load back into the same text and that genome traits survive the text and
+ * the checkpoint formats. Returns non-zero if anything differs.
+ */
+
+#include "TestUtil.hh"
+
+#include <MultiNEAT/Checkpoint.hh>
+#include <MultiNEAT/Genome.hh>
+#include <MultiNEAT/Innovation.hh>
+#include <MultiNEAT/NeuralNetwork.hh>
+#include <MultiNEAT/Parameters.hh>
+#include <MultiNEAT/Population.hh>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace NEAT;
+
+static const char *g_file = "TextIO.test.txt";
+static const char *g_copy = "TextIO.test2.txt";
+
+// Parameters with a trait of every type, one of them with a dependency
+static Parameters TraitParams() {
+  Parameters t_params;
+
+  TraitParameters t_int;
+  t_int.type = "int";
+  IntTraitParameters t_int_d;
+  t_int_d.min = -5;
+  t_int_d.max = 5;
+  t_int_d.mut_power = 2;
+  t_int.m_Details = t_int_d;
+  t_params.NeuronTraits["level"] = t_int;
+
+  TraitParameters t_str;
+  t_str.type = "str";
+  StringTraitParameters t_str_d;
+  t_str_d.set = {"red", "dark green", "50%", ""};
+  t_str_d.probs = {1, 1, 1, 1};
+  t_str.m_Details = t_str_d;
+  t_str.dep_key = "level";
+  t_str.dep_values = {TraitType(1), TraitType(2)};
+  t_params.NeuronTraits["color"] = t_str;
+
+  TraitParameters t_float;
+  t_float.type = "float";
+  FloatTraitParameters t_float_d;
+  t_float_d.min = -1;
+  t_float_d.max = 1;
+  t_float_d.mut_power = 0.1;
+  t_float.m_Details = t_float_d;
+  t_params.LinkTraits["rate"] = t_float;
+
+  TraitParameters t_floatset;
+  t_floatset.type = "floatset";
+  FloatSetTraitParameters t_floatset_d;
+  t_floatset_d.set = {{0.1}, {1.0 / 3}, {1e-30}};
+  t_floatset_d.probs = {1, 1, 1};
+  t_floatset.m_Details = t_floatset_d;
+  t_params.LinkTraits["scale"] = t_floatset;
+
+  TraitParameters t_intset;
+  t_intset.type = "intset";
+  IntSetTraitParameters t_intset_d;
+  t_intset_d.set = {{1}, {4}, {9}};
+  t_intset_d.probs = {1, 2, 3};
+  t_intset.m_Details = t_intset_d;
+  t_params.GenomeTraits["size"] = t_intset;
+
+  return t_params;
+}
+
+static bool SameTraits(const std::map<std::string, Trait> &a_A,
+                       const std::map<std::string, Trait> &a_B) {
+  if (a_A.size() != a_B.size()) {
+    return false;
+  }
+  for (auto t_a = a_A.begin(), t_b = a_B.begin(); t_a != a_A.end();
+       t_a++, t_b++) {
+    if ((t_a->first != t_b->first) ||
+        !(t_a->second.value == t_b->second.value) ||
+        (t_a->second.dep_key != t_b->second.dep_key) ||
+        !(t_a->second.dep_values == t_b->second.dep_values)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool SameTraits(const Genome &a_A, const Genome &a_B) {
+  if (!SameTraits(a_A.m_GenomeGene.m_Traits, a_B.m_GenomeGene.m_Traits) ||
+      (a_A.NumNeurons() != a_B.NumNeurons()) ||
+      (a_A.NumLinks() != a_B.NumLinks())) {
+    return false;
+  }
+  for (unsigned int i = 0; i < a_A.NumNeurons(); i++) {
+    if (!SameTraits(a_A.m_NeuronGenes[i].m_Traits,
+                    a_B.m_NeuronGenes[i].m_Traits)) {
+      return false;
+    }
+  }
+  for (unsigned int i = 0; i < a_A.NumLinks(); i++) {
+    if (!SameTraits(a_A.m_LinkGenes[i].m_Traits, a_B.m_LinkGenes[i].m_Traits)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The lines of a file in sorted order. Loading a population speciates it
+// again, which can change the order of the genomes.
+static std::vector<std::string> SortedLines(const char *a_FileName) {
+  std::ifstream t_file(a_FileName);
+  std::vector<std::string> t_lines;
+  std::string t_line;
+  while (std::getline(t_file, t_line)) {
+    t_lines.push_back(t_line);
+  }
+  std::sort(t_lines.begin(), t_lines.end());
+  return t_lines;
+}
+
+int main() {
+  // populations
+  Population t_pop = MakePopulation(300);
+  t_pop.Save(g_file);
+  Population t_loaded(g_file);
+  t_loaded.Save(g_copy);
+  Check(SortedLines(g_file) == SortedLines(g_copy),
+        "population text is the same after loading");
+
+  // networks
+  NeuralNetwork t_net;
+  t_pop.m_Species[0].m_Individuals[0].BuildPhenotype(t_net);
+  t_net.Save(g_file);
+  NeuralNetwork t_net_loaded;
+  Check(t_net_loaded.Load(g_file), "network loads");
+  t_net_loaded.Save(g_copy);
+  Check(ReadFile(g_file) == ReadFile(g_copy),
+        "network text is the same after loading");
+
+  // every parameter goes through the text, including those whose keys the
+  // old loader misspelled
+  Parameters t_params;
+  t_params.KillWorstSpeciesEach = 7;
+  t_params.NoveltySearch_Recompute_Sparseness_Each = 9;
+  t_params.NeuronTries = 11;
+  t_params.InitialDepth = 2;
+  t_params.MaxDepth = 5;
+  t_params.Width = 3.5;
+  t_params.Leo = true;
+  t_params.Save(g_file);
+  Parameters t_params_loaded;
+  t_params_loaded.Load(g_file);
+  t_params_loaded.Save(g_copy);
+  Check((ReadFile(g_file) == ReadFile(g_copy)) &&
+            (t_params_loaded.KillWorstSpeciesEach == 7) &&
+            (t_params_loaded.NoveltySearch_Recompute_Sparseness_Each == 9) &&
+            (t_params_loaded.NeuronTries == 11) &&
+            (t_params_loaded.InitialDepth == 2) &&
+            (t_params_loaded.MaxDepth == 5) && (t_params_loaded.Width == 3.5),
+        "parameters are the same after loading");
+
+  // traits
+  Parameters t_trait_params = TraitParams();
+  t_trait_params.Save(g_file);
+  Parameters t_trait_params_loaded;
+  t_trait_params_loaded.Load(g_file);
+  t_trait_params_loaded.Save(g_copy);
+  Check((ReadFile(g_file) == ReadFile(g_copy)) &&
+            (t_trait_params_loaded.NeuronTraits["color"].dep_values.size() ==
+             2),
+        "trait parameters are the same after loading");
+
+  RNG t_rng;
+  Genome t_traits(0, 3, 0, 1, false, UNSIGNED_SIGMOID, UNSIGNED_SIGMOID, 0,
+                  t_trait_params, 0);
+  InnovationDatabase t_innovs;
+  t_innovs.Init(t_traits);
+  for (unsigned int i = 0; i < 5; i++) {
+    t_traits.Mutate_AddNeuron(t_innovs, t_trait_params, t_rng);
+    t_traits.Mutate_AddLink(t_innovs, t_trait_params, t_rng);
+    t_traits.Mutate_NeuronTraits(t_trait_params, t_rng);
+    t_traits.Mutate_LinkTraits(t_trait_params, t_rng);
+    t_traits.Mutate_GenomeTraits(t_trait_params, t_rng);
+  }
+
+  t_traits.Save(g_file);
+  Genome t_traits_text(g_file);
+  t_traits_text.Save(g_copy);
+  Check(SameTraits(t_traits, t_traits_text) &&
+            (ReadFile(g_file) == ReadFile(g_copy)),
+        "genome traits are the same after loading the text");
+
+  CheckpointWriter t_writer;
+  t_writer.BeginSection(CHECKPOINT_POPULATION);
+  t_traits.Save(t_writer);
+  t_writer.EndSection();
+  std::vector<char> t_bytes;
+  t_writer.GetBytes(t_bytes);
+  CheckpointReader t_reader;
+  t_reader.Open(t_bytes.data(), t_bytes.size());
+  t_reader.BeginSection(CHECKPOINT_POPULATION);
+  Genome t_traits_binary(t_reader);
+  Check(SameTraits(t_traits, t_traits_binary),
+        "genome traits are the same after loading the checkpoint");
+
+  remove(g_file);
+  remove(g_copy);
+
+  return Failures();
+}